@@ -0,0 +1,113 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const Packet = taptun.Packet;
+const headers = taptun.headers;
+
+const batch_size = 64;
+const batches = 50_000;
+const tunnel_mtu = 1400;
+
+const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+const peer_mac = [_]u8{ 0x02, 0x00, 0x5E, 0xAA, 0xBB, 0xCC };
+const our_ip: u32 = 0x0A150064; // 10.21.0.100
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun Batch Arena Benchmark ===\n", .{});
+    std.debug.print("{d} batches of {d} packets, tunnel MTU {d}\n\n", .{ batches, batch_size, tunnel_mtu });
+
+    // Every control_every-th packet takes a slow path
+    for ([_]usize{ 32, 8, 2 }) |control_every| {
+        std.debug.print("1 in {d} packets is control traffic\n", .{control_every});
+        const general_ns = try run(allocator, control_every, false);
+        const scratch_ns = try run(allocator, control_every, true);
+        report("general", general_ns, control_every);
+        report("arena", scratch_ns, control_every);
+        std.debug.print("\n", .{});
+    }
+
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+/// Mixed batches: bulk packets in place, plus oversize DF packets (local ICMP
+/// Too Big) and ARP requests for our address from rotating peers
+fn run(allocator: std.mem.Allocator, control_every: usize, use_arena: bool) !i128 {
+    var translator = try taptun.L2L3Translator.init(allocator, .{
+        .our_mac = our_mac,
+        .tunnel_mtu = tunnel_mtu,
+        .icmp_rate_per_sec = std.math.maxInt(u32),
+        .icmp_burst = std.math.maxInt(u32),
+    });
+    defer translator.deinit();
+    translator.setOurIp(our_ip);
+
+    var scratch = try taptun.BatchArena.init(allocator, taptun.arena.default_size);
+    defer scratch.deinit();
+    if (use_arena) translator.setScratch(&scratch);
+
+    var peer = try taptun.ArpHandler.init(allocator, peer_mac);
+    defer peer.deinit();
+    var arp_requests: [16][]const u8 = undefined;
+    for (&arp_requests, 0..) |*request, i| request.* = try peer.buildArpRequest(0x0A150001 + @as(u32, @intCast(i)), our_ip);
+    defer for (arp_requests) |request| allocator.free(request);
+
+    const buffer = try allocator.alloc(u8, taptun.packet.bufferSizeForMtu(taptun.default_mtu, taptun.packet.default_headroom));
+    defer allocator.free(buffer);
+    var pkt = Packet.init(buffer, taptun.packet.default_headroom);
+
+    const start = std.time.nanoTimestamp();
+    var seq: usize = 0;
+    for (0..batches) |_| {
+        for (0..batch_size) |_| {
+            seq += 1;
+            if (seq % control_every != 0) {
+                try bulk(&translator, &pkt, 512);
+            } else if (seq % (2 * control_every) == 0) {
+                _ = try translator.ethernetToIp(arp_requests[(seq / control_every) % arp_requests.len]);
+            } else {
+                bulk(&translator, &pkt, taptun.default_mtu) catch |err| if (err != error.PacketTooBig) return err;
+            }
+        }
+
+        // End of batch: drain what the slow paths produced
+        while (translator.popTunReply()) |reply| translator.releaseTunReply(reply);
+        while (translator.popArpReply()) |reply| allocator.free(reply);
+        scratch.reset();
+    }
+    return std.time.nanoTimestamp() - start;
+}
+
+fn bulk(translator: *taptun.L2L3Translator, pkt: *Packet, len: u32) !void {
+    pkt.reset(taptun.packet.default_headroom);
+    buildIpHeader(try pkt.put(len), len);
+    try translator.ipToEthernetPacket(pkt);
+}
+
+fn report(name: []const u8, elapsed_ns: i128, control_every: usize) void {
+    const ns = @as(f64, @floatFromInt(elapsed_ns));
+    const packets = @as(f64, @floatFromInt(batches * batch_size));
+    const control = packets / @as(f64, @floatFromInt(control_every));
+    std.debug.print("  {s:<8} {d:9.1} ns/packet  {d:9.1} ns/batch  {d:9.1} ns/control packet (amortized)\n", .{
+        name, ns / packets, ns / @as(f64, batches), ns / control,
+    });
+}
+
+fn buildIpHeader(buf: []u8, len: u32) void {
+    @memset(buf, 0x42);
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.tos, 0);
+    ip.set(.total_length, @intCast(len));
+    ip.set(.identification, 0x1234);
+    ip.set(.flags_fragment, 0x4000); // DF
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.src_ip, our_ip);
+    ip.set(.dst_ip, 0xC0A80101); // 192.168.1.1
+    ip.set(.checksum, 0);
+    ip.set(.checksum, taptun.checksum.internet(buf[0..headers.Ipv4.size]));
+}
@@ -0,0 +1,154 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const Packet = taptun.Packet;
+const headers = taptun.headers;
+const block = taptun.block;
+const Adapter = taptun.GenericTunAdapter(taptun.LoopbackDevice);
+
+const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+const frames_per_block = 64;
+const blocks = 20_000;
+/// Room for a full block of full-MTU frames
+const block_size = block.header_size +
+    frames_per_block * (block.frame_header_size + taptun.maxFrameSize(taptun.default_mtu));
+
+/// How each frame crosses the adapter
+const Mode = enum {
+    copy, // writeEthernet / readEthernet, one frame per call
+    packet, // writeEthernetPacket / readEthernetPacket, one frame per call
+    block, // writeBlock / readBlock, one block per call
+
+    fn label(mode: Mode, inbound: bool) []const u8 {
+        return switch (mode) {
+            .copy => if (inbound) "writeEthernet per frame" else "readEthernet per frame",
+            .packet => if (inbound) "writeEthernetPacket per frame" else "readEthernetPacket per frame",
+            .block => if (inbound) "writeBlock" else "readBlock",
+        };
+    }
+};
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun SoftEther Block Benchmark ===\n", .{});
+    std.debug.print("{d} blocks of {d} frames per run, loopback device\n\n", .{ blocks, frames_per_block });
+
+    const work = try allocator.alloc(u8, block_size);
+    defer allocator.free(work);
+    const template = try allocator.alloc(u8, block_size);
+    defer allocator.free(template);
+
+    const sizes = [_]u16{ 64, 512, 1500 };
+    for (sizes) |ip_len| {
+        var frame: [taptun.maxFrameSize(taptun.default_mtu)]u8 = undefined;
+        const eth_frame = frame[0 .. headers.Ethernet.size + ip_len];
+        buildFrame(eth_frame, ip_len);
+
+        var writer = try block.Writer.init(template);
+        for (0..frames_per_block) |_| try writer.append(eth_frame);
+        const template_block = writer.finish();
+
+        std.debug.print("{d} B IP packets\n", .{ip_len});
+        for ([_]bool{ true, false }) |inbound| {
+            for (std.enums.values(Mode)) |mode| {
+                const adapter = try Adapter.open(allocator, .{ .translator = .{ .our_mac = our_mac } });
+                defer adapter.close();
+                const elapsed_ns = if (inbound)
+                    try runInbound(adapter, template_block, work, mode)
+                else
+                    try runOutbound(adapter, eth_frame[headers.Ethernet.size..], work, mode);
+                report(mode.label(inbound), elapsed_ns);
+            }
+        }
+        std.debug.print("\n", .{});
+    }
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+/// VPN → TUN: translate a received block's frames and write them to the device
+fn runInbound(adapter: *Adapter, template: []const u8, work: []u8, mode: Mode) !u64 {
+    var drain: [taptun.maxFrameSize(taptun.default_mtu)]u8 = undefined;
+    var timer = try std.time.Timer.start();
+    for (0..blocks) |_| {
+        // Translation is in place, so every variant starts from a fresh copy
+        const blk = work[0..template.len];
+        @memcpy(blk, template);
+        switch (mode) {
+            .copy, .packet => {
+                var reader = try block.Reader.init(blk);
+                while (try reader.next()) |frame| {
+                    var pkt = frame;
+                    if (mode == .copy) {
+                        try adapter.writeEthernet(pkt.data());
+                    } else {
+                        _ = try adapter.writeEthernetPacket(&pkt);
+                    }
+                }
+            },
+            .block => _ = try adapter.writeBlock(blk),
+        }
+        while (adapter.device.pending() > 0) _ = try adapter.device.read(&drain);
+    }
+    return timer.read();
+}
+
+/// TUN → VPN: read the device's packets into an outbound block
+fn runOutbound(adapter: *Adapter, ip_packet: []const u8, work: []u8, mode: Mode) !u64 {
+    var frame_buf: [taptun.maxFrameSize(taptun.default_mtu) + headers.Ethernet.size]u8 = undefined;
+    var timer = try std.time.Timer.start();
+    for (0..blocks) |_| {
+        // The host stack's packets, the same cost for every variant
+        for (0..frames_per_block) |_| try adapter.device.write(ip_packet);
+        switch (mode) {
+            .copy => {
+                var writer = try block.Writer.init(work);
+                while (writer.count < frames_per_block) try writer.append(try adapter.readEthernet(&frame_buf));
+                _ = writer.finish();
+            },
+            .packet => {
+                var writer = try block.Writer.init(work);
+                while (writer.count < frames_per_block) {
+                    var pkt = Packet.init(&frame_buf, headers.Ethernet.size);
+                    try adapter.readEthernetPacket(&pkt);
+                    try writer.append(pkt.data());
+                }
+                _ = writer.finish();
+            },
+            .block => _ = (try adapter.readBlock(work, frames_per_block)).?,
+        }
+    }
+    return timer.read();
+}
+
+fn report(name: []const u8, elapsed_ns: u64) void {
+    const ns = @as(f64, @floatFromInt(elapsed_ns));
+    const frames = @as(f64, blocks * frames_per_block);
+    std.debug.print("  {s:<30} {d:8.2} Mpps  {d:7.1} ns/frame\n", .{ name, frames * 1e3 / ns, ns / frames });
+}
+
+fn buildFrame(frame: []u8, ip_len: u16) void {
+    @memset(frame, 0);
+    const eth = headers.Ethernet.viewMut(frame) catch unreachable;
+    eth.set(.dst_mac, our_mac);
+    eth.set(.src_mac, .{ 0x02, 0x00, 0x5E, 0xAA, 0xBB, 0xCC });
+    eth.set(.ethertype, headers.EtherType.ipv4);
+
+    const l3 = frame[headers.Ethernet.size..];
+    const ip = headers.Ipv4.viewMut(l3) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, ip_len);
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.src_ip, 0xC0A80101); // 192.168.1.1
+    ip.set(.dst_ip, 0x0A150064); // 10.21.0.100
+    ip.set(.checksum, taptun.checksum.internet(l3[0..headers.Ipv4.size]));
+
+    const udp = headers.Udp.viewMut(l3[headers.Ipv4.size..]) catch unreachable;
+    udp.set(.src_port, 4500);
+    udp.set(.dst_port, 4500);
+    udp.set(.length, @intCast(ip_len - headers.Ipv4.size));
+}
@@ -0,0 +1,113 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const bonding = taptun.bonding;
+const Bond = bonding.Bond(u64);
+
+const members = 4;
+const weights = [members]u32{ 1, 1, 1, 2 };
+const flows = 4096;
+const packets = 20_000_000;
+
+/// Shared by the session threads: last sequence number seen per flow
+const Checker = struct {
+    bond: *Bond,
+    last: [flows]std.atomic.Value(u32) = [_]std.atomic.Value(u32){std.atomic.Value(u32).init(0)} ** flows,
+    reordered: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+    discarded: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+    running: std.atomic.Value(bool) = std.atomic.Value(bool).init(true),
+
+    /// Session thread: drain one member, checking each flow's order across members
+    fn session(self: *Checker, member: usize) void {
+        while (true) {
+            const item = self.bond.next(member) orelse {
+                if (!self.running.load(.acquire)) return;
+                std.atomic.spinLoopHint();
+                continue;
+            };
+            defer self.bond.release(member);
+            // A lost session's queue is discarded
+            if (!self.bond.memberStats(member).up) {
+                _ = self.discarded.fetchAdd(1, .monotonic);
+                continue;
+            }
+            const flow: usize = @intCast(item.* >> 32);
+            const seq: u32 = @truncate(item.*);
+            if (self.last[flow].swap(seq, .monotonic) >= seq) _ = self.reordered.fetchAdd(1, .monotonic);
+        }
+    }
+};
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun Bonding Benchmark ===\n", .{});
+    std.debug.print("{d} packets over {d} flows, {d} members weighted {any}\n", .{ packets, flows, members, weights });
+    std.debug.print("Member 3 is reweighted to 1 at 25%, member 1 goes down at 50% and returns at 75%\n\n", .{});
+
+    const bond = try Bond.create(allocator, &weights);
+    defer bond.destroy();
+    const checker = try allocator.create(Checker);
+    defer allocator.destroy(checker);
+    checker.* = .{ .bond = bond };
+
+    var threads: [members]std.Thread = undefined;
+    for (&threads, 0..) |*thread, member| thread.* = try std.Thread.spawn(.{}, Checker.session, .{ checker, member });
+
+    var hashes: [flows]u32 = undefined;
+    for (&hashes, 0..) |*hash, flow| hash.* = @truncate(std.hash.Wyhash.hash(0, std.mem.asBytes(&flow)));
+    var seqs = [_]u32{0} ** flows;
+
+    var prng = std.Random.DefaultPrng.init(42);
+    const random = prng.random();
+    var ring_full: u64 = 0;
+    var timer = try std.time.Timer.start();
+    for (0..packets) |i| {
+        switch (i) {
+            packets / 4 => bond.setWeight(3, 1),
+            packets / 2 => bond.setUp(1, false),
+            packets * 3 / 4 => bond.setUp(1, true),
+            else => {},
+        }
+        const flow = random.uintLessThan(usize, flows);
+        seqs[flow] += 1;
+        const item = (@as(u64, flow) << 32) | seqs[flow];
+        // Sessions fall behind in bursts; retry rather than lose sequence numbers
+        while (bond.steer(hashes[flow], 1400, item) == null) {
+            ring_full += 1;
+            std.atomic.spinLoopHint();
+        }
+    }
+    const steer_ns = timer.read();
+
+    checker.running.store(false, .release);
+    for (threads) |thread| thread.join();
+
+    const ns = @as(f64, @floatFromInt(steer_ns));
+    std.debug.print("steer: {d:.2} Mpps, {d:.1} ns/packet (including ring-full retries: {d})\n\n", .{
+        @as(f64, packets) * 1e3 / ns,
+        ns / @as(f64, packets),
+        ring_full,
+    });
+
+    std.debug.print("{s:<8} {s:>6} {s:>8} {s:>12} {s:>7}\n", .{ "member", "weight", "buckets", "packets", "share" });
+    for (0..members) |member| {
+        const stats = bond.memberStats(member);
+        std.debug.print("{d:<8} {d:>6} {d:>8} {d:>12} {d:>6.1}%\n", .{
+            member,
+            stats.weight,
+            stats.buckets,
+            stats.packets,
+            @as(f64, @floatFromInt(stats.packets)) * 100 / packets,
+        });
+    }
+    std.debug.print("\nbuckets moved: {d}, failed over: {d}, discarded on the lost member: {d}, reordered: {d}\n\n", .{
+        bond.buckets_moved.load(.monotonic),
+        bond.buckets_failed_over.load(.monotonic),
+        checker.discarded.load(.monotonic),
+        checker.reordered.load(.monotonic),
+    });
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
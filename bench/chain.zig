@@ -0,0 +1,159 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const Packet = taptun.Packet;
+const PacketPool = taptun.PacketPool;
+const headers = taptun.headers;
+const checksum = taptun.checksum;
+
+/// Payload per segment, as handed over by GRO/TSO (one TCP MSS on a 1500 MTU link)
+const segment_payload = 1448;
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun Chained Packet Benchmark ===\n", .{});
+    std.debug.print("Delivering 64 KB super-packets: linearized copy vs. segment chain\n\n", .{});
+
+    var translator = try taptun.L2L3Translator.init(allocator, .{
+        .our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 },
+    });
+    defer translator.deinit();
+
+    const payload_sizes = [_]usize{ 16 * 1024, 32 * 1024, 65535 - headers.Ipv4.size - headers.Udp.size };
+    const iterations = 5_000;
+
+    std.debug.print("Running {d} iterations per size...\n\n", .{iterations});
+
+    for (payload_sizes) |size| {
+        try benchSize(&translator, allocator, size, iterations);
+    }
+
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+const Result = struct {
+    elapsed_ns: i128,
+    bytes_delivered: u64,
+    bytes_copied: u64,
+    checksum_sink: u32,
+};
+
+fn benchSize(
+    translator: *taptun.L2L3Translator,
+    allocator: std.mem.Allocator,
+    payload_size: usize,
+    iterations: usize,
+) !void {
+    const segments = std.math.divCeil(usize, payload_size, segment_payload) catch unreachable;
+    var pool = try PacketPool.init(allocator, segments + 1, 2048, taptun.packet.default_headroom);
+    defer pool.deinit();
+
+    // Head segment carries IP + UDP headers; payload segments follow
+    const head = pool.get().?;
+    buildHeaders(try head.put(headers.Ipv4.size + headers.Udp.size), payload_size);
+    var remaining = payload_size;
+    while (remaining > 0) {
+        const seg = pool.get().?;
+        const n = @min(remaining, segment_payload);
+        @memset(try seg.put(n), 0x42);
+        head.append(seg);
+        remaining -= n;
+    }
+    defer pool.putChain(head);
+
+    const flat = try allocator.alloc(u8, taptun.packet.default_headroom + head.totalLen());
+    defer allocator.free(flat);
+
+    // Warmup
+    _ = try runLinear(translator, head, flat, 100);
+    _ = try runChained(translator, head, 100);
+
+    const linear = try runLinear(translator, head, flat, iterations);
+    const chained = try runChained(translator, head, iterations);
+    std.mem.doNotOptimizeAway(linear.checksum_sink +% chained.checksum_sink);
+
+    std.debug.print("Payload: {d} bytes in {d} segments\n", .{ payload_size, segments });
+    report("linearized", linear, iterations);
+    report("chained", chained, iterations);
+    std.debug.print("\n", .{});
+}
+
+/// Copy the chain into one contiguous buffer, then translate, checksum and deliver
+fn runLinear(translator: *taptun.L2L3Translator, head: *Packet, flat: []u8, iterations: usize) !Result {
+    var result = Result{ .elapsed_ns = 0, .bytes_delivered = 0, .bytes_copied = 0, .checksum_sink = 0 };
+    const start = std.time.nanoTimestamp();
+
+    for (0..iterations) |_| {
+        const bytes = try head.linearize(flat[taptun.packet.default_headroom..]);
+        result.bytes_copied += bytes.len;
+
+        var pkt = try Packet.fromBuffer(flat, taptun.packet.default_headroom, bytes.len);
+        try translator.ipToEthernetPacket(&pkt);
+
+        const l4 = pkt.l4().?;
+        result.checksum_sink +%= checksum.internet(l4);
+        result.bytes_delivered += pkt.len;
+    }
+
+    result.elapsed_ns = std.time.nanoTimestamp() - start;
+    return result;
+}
+
+/// Translate in the head segment's headroom, checksum over the chain, gather for delivery
+fn runChained(translator: *taptun.L2L3Translator, head: *Packet, iterations: usize) !Result {
+    var result = Result{ .elapsed_ns = 0, .bytes_delivered = 0, .bytes_copied = 0, .checksum_sink = 0 };
+    var iov: [taptun.packet.max_segments]std.posix.iovec_const = undefined;
+    const start = std.time.nanoTimestamp();
+
+    for (0..iterations) |_| {
+        head.flags.parsed = false;
+        try translator.ipToEthernetPacket(head);
+
+        var cs = checksum.Checksum{};
+        checksum.updateChain(&cs, head, head.l4_offset.? - head.head);
+        result.checksum_sink +%= cs.final();
+
+        for (try head.gather(&iov)) |v| result.bytes_delivered += v.len;
+
+        // Restore the IP packet for the next iteration
+        _ = try head.pull(headers.Ethernet.size);
+    }
+
+    result.elapsed_ns = std.time.nanoTimestamp() - start;
+    return result;
+}
+
+fn report(name: []const u8, r: Result, iterations: usize) void {
+    const elapsed_s = @as(f64, @floatFromInt(r.elapsed_ns)) / 1e9;
+    const gbps = @as(f64, @floatFromInt(r.bytes_delivered * 8)) / elapsed_s / 1e9;
+    const per_packet_us = elapsed_s * 1e6 / @as(f64, @floatFromInt(iterations));
+    const copies = @as(f64, @floatFromInt(r.bytes_copied)) / @as(f64, @floatFromInt(r.bytes_delivered));
+
+    std.debug.print("  {s:<10} {d:8.2} Gbps  {d:8.2} µs/packet  {d:.3} bytes copied per byte delivered\n", .{
+        name, gbps, per_packet_us, copies,
+    });
+}
+
+fn buildHeaders(buf: []u8, payload_size: usize) void {
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.tos, 0);
+    ip.set(.total_length, @intCast(headers.Ipv4.size + headers.Udp.size + payload_size));
+    ip.set(.identification, 0x1234);
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.checksum, 0);
+    ip.set(.src_ip, 0xC0A8010A); // 192.168.1.10
+    ip.set(.dst_ip, 0xC0A80101); // 192.168.1.1
+    ip.set(.checksum, checksum.internet(buf[0..headers.Ipv4.size]));
+
+    const udp = headers.Udp.viewMut(buf[headers.Ipv4.size..]) catch unreachable;
+    udp.set(.src_port, 40000);
+    udp.set(.dst_port, 4789);
+    udp.set(.length, @intCast(headers.Udp.size + payload_size));
+    udp.set(.checksum, 0);
+}
@@ -0,0 +1,90 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const sim = taptun.sim;
+
+// The DHCP client logs each OFFER/ACK at info level
+pub const std_options: std.Options = .{ .log_level = .warn };
+
+const seeds = 2000;
+
+const Profile = struct {
+    name: []const u8,
+    link: sim.LinkOptions,
+};
+
+const profiles = [_]Profile{
+    .{ .name = "LAN 2 ms", .link = .{ .latency_ms = 2 } },
+    .{ .name = "WAN 40 ms", .link = .{ .latency_ms = 40, .jitter_ms = 10 } },
+    .{ .name = "WAN 40 ms, 5% loss", .link = .{ .latency_ms = 40, .jitter_ms = 10, .loss = 0.05, .reorder = 0.02 } },
+    .{ .name = "WAN 40 ms, 20% loss", .link = .{ .latency_ms = 40, .jitter_ms = 10, .loss = 0.2, .reorder = 0.05 } },
+    .{ .name = "satellite 300 ms, 2% loss", .link = .{ .latency_ms = 300, .jitter_ms = 50, .loss = 0.02 } },
+};
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun Control-Plane Convergence Benchmark ===\n", .{});
+    std.debug.print("{d} seeds per profile, virtual time, same loss/latency both ways\n", .{seeds});
+    std.debug.print("Time from DHCP start to IP and to unicast gateway MAC, in virtual ms\n\n", .{});
+
+    const to_ip = try allocator.alloc(i64, seeds);
+    defer allocator.free(to_ip);
+    const to_mac = try allocator.alloc(i64, seeds);
+    defer allocator.free(to_mac);
+
+    std.debug.print("{s:<26} {s:>8} {s:>8} {s:>8} {s:>8} {s:>8} {s:>8} {s:>7} {s:>6}\n", .{
+        "profile", "IP p50", "IP p99", "IP max", "MAC p50", "MAC p99", "MAC max", "rexmit", "fail",
+    });
+
+    const wall_start = std.time.nanoTimestamp();
+    for (profiles) |profile| {
+        var converged: usize = 0;
+        var retransmits: u64 = 0;
+        for (0..seeds) |seed| {
+            const result = try sim.run(allocator, .{
+                .seed = seed,
+                .uplink = profile.link,
+                .downlink = profile.link,
+            });
+            retransmits += result.dhcp_retransmits;
+            if (!result.converged()) continue;
+            to_ip[converged] = result.time_to_ip_ms.?;
+            to_mac[converged] = result.time_to_gateway_mac_ms.?;
+            converged += 1;
+        }
+
+        const ip = to_ip[0..converged];
+        const mac = to_mac[0..converged];
+        std.mem.sort(i64, ip, {}, std.sort.asc(i64));
+        std.mem.sort(i64, mac, {}, std.sort.asc(i64));
+        std.debug.print("{s:<26} {d:>8} {d:>8} {d:>8} {d:>8} {d:>8} {d:>8} {d:>7.2} {d:>6}\n", .{
+            profile.name,
+            percentile(ip, 50),
+            percentile(ip, 99),
+            percentile(ip, 100),
+            percentile(mac, 50),
+            percentile(mac, 99),
+            percentile(mac, 100),
+            @as(f64, @floatFromInt(retransmits)) / seeds,
+            seeds - converged,
+        });
+    }
+
+    const wall_ns = std.time.nanoTimestamp() - wall_start;
+    std.debug.print("\n{d} runs in {d:.1} ms wall time ({d:.1} us/run)\n\n", .{
+        seeds * profiles.len,
+        @as(f64, @floatFromInt(wall_ns)) / 1e6,
+        @as(f64, @floatFromInt(wall_ns)) / 1e3 / (seeds * profiles.len),
+    });
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+/// Nearest-rank percentile of sorted samples; 0 when there are none
+fn percentile(sorted: []const i64, p: usize) i64 {
+    if (sorted.len == 0) return 0;
+    const rank = (sorted.len * p + 99) / 100;
+    return sorted[@max(rank, 1) - 1];
+}
@@ -0,0 +1,118 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const headers = taptun.headers;
+
+const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+
+/// Share of frames on the hub that are actually for us (per mille)
+const ours_per_mille = 20;
+const broadcast_per_mille = 10;
+const multicast_per_mille = 20;
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun Hub Flood Benchmark ===\n", .{});
+    std.debug.print("Virtual hub traffic: {d}% ours, {d}% broadcast, {d}% multicast, rest unicast to other members\n\n", .{
+        ours_per_mille / 10, broadcast_per_mille / 10, multicast_per_mille / 10,
+    });
+
+    const frame_count = 4096;
+    const frame_size = 1400;
+    const iterations = 50;
+
+    // Pre-build a mix of frames as a flooding hub would deliver them
+    const frames = try allocator.alloc([frame_size]u8, frame_count);
+    defer allocator.free(frames);
+    var prng = std.Random.DefaultPrng.init(0x5EED);
+    const random = prng.random();
+    for (frames) |*frame| {
+        buildFrame(frame, pickDestination(random));
+    }
+
+    for ([_]bool{ false, true }) |filter| {
+        try runFlood(allocator, frames, iterations, filter);
+    }
+
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+fn runFlood(allocator: std.mem.Allocator, frames: []const [1400]u8, iterations: usize, filter: bool) !void {
+    var translator = try taptun.L2L3Translator.init(allocator, .{
+        .our_mac = our_mac,
+        .filter_dst_mac = filter,
+    });
+    defer translator.deinit();
+
+    var delivered: u64 = 0;
+    var bytes_copied: u64 = 0;
+    const start = std.time.nanoTimestamp();
+
+    for (0..iterations) |_| {
+        for (frames) |*frame| {
+            if (try translator.ethernetToIp(frame)) |ip_packet| {
+                delivered += 1;
+                bytes_copied += ip_packet.len;
+                allocator.free(ip_packet);
+            }
+        }
+    }
+
+    const elapsed_ns = std.time.nanoTimestamp() - start;
+    const total = frames.len * iterations;
+    const elapsed_s = @as(f64, @floatFromInt(elapsed_ns)) / 1e9;
+    const fps = @as(f64, @floatFromInt(total)) / elapsed_s;
+    const ns_per_frame = @as(f64, @floatFromInt(elapsed_ns)) / @as(f64, @floatFromInt(total));
+
+    std.debug.print("MAC filter {s}\n", .{if (filter) "on" else "off"});
+    std.debug.print("  Frames/s:     {d:12.0}\n", .{fps});
+    std.debug.print("  Per frame:    {d:12.1} ns\n", .{ns_per_frame});
+    std.debug.print("  Delivered:    {d:12} of {d}\n", .{ delivered, total });
+    std.debug.print("  Copied:       {d:12.1} MB\n", .{@as(f64, @floatFromInt(bytes_copied)) / (1024 * 1024)});
+    std.debug.print("  Filtered:     {d:12} (unicast {d}, multicast {d})\n", .{
+        translator.mac_filter.dropped(),
+        translator.mac_filter.dropped_unicast,
+        translator.mac_filter.dropped_multicast,
+    });
+    std.debug.print("\n", .{});
+}
+
+fn pickDestination(random: std.Random) [6]u8 {
+    const roll = random.uintLessThan(u32, 1000);
+    if (roll < ours_per_mille) return our_mac;
+    if (roll < ours_per_mille + broadcast_per_mille) return [_]u8{0xFF} ** 6;
+    if (roll < ours_per_mille + broadcast_per_mille + multicast_per_mille) {
+        // Mostly unsubscribed groups (mDNS, SSDP), some all-nodes
+        return if (random.boolean())
+            [_]u8{ 0x01, 0x00, 0x5E, 0x00, 0x00, 0xFB }
+        else
+            [_]u8{ 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 };
+    }
+    // Another hub member
+    var mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x00 };
+    random.bytes(mac[3..]);
+    return mac;
+}
+
+fn buildFrame(frame: []u8, dst_mac: [6]u8) void {
+    @memset(frame, 0x42);
+
+    const eth = headers.Ethernet.viewMut(frame) catch unreachable;
+    eth.set(.dst_mac, dst_mac);
+    eth.set(.src_mac, .{ 0x02, 0x00, 0x5E, 0x77, 0x88, 0x99 });
+    eth.set(.ethertype, headers.EtherType.ipv4);
+
+    const ip = headers.Ipv4.viewMut(frame[headers.Ethernet.size..]) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.tos, 0);
+    ip.set(.total_length, @intCast(frame.len - headers.Ethernet.size));
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.checksum, 0);
+    ip.set(.src_ip, 0x0A150002); // 10.21.0.2
+    ip.set(.dst_ip, 0x0A150064); // 10.21.0.100
+}
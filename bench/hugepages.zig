@@ -0,0 +1,151 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const taptun = @import("taptun");
+
+const Packet = taptun.Packet;
+const PacketPool = taptun.PacketPool;
+const headers = taptun.headers;
+
+const pool_count = 32 * 1024; // 64 MB of 2 KB buffers
+const buffer_size = 2048;
+const packet_len = 256;
+const warm_passes = 8;
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun Huge Page Pool Benchmark ===\n", .{});
+    std.debug.print("{d} buffers x {d} bytes, {d}-byte packets in random buffer order\n\n", .{ pool_count, buffer_size, packet_len });
+
+    var translator = try taptun.L2L3Translator.init(allocator, .{
+        .our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 },
+    });
+    defer translator.deinit();
+
+    // Random visiting order defeats the hardware prefetcher, as many flows do
+    const order = try allocator.alloc(u32, pool_count);
+    defer allocator.free(order);
+    for (order, 0..) |*o, i| o.* = @intCast(i);
+    var prng = std.Random.DefaultPrng.init(0x2B);
+    prng.random().shuffle(u32, order);
+
+    var counter = TlbCounter.open();
+    defer counter.close();
+    if (counter.fd == null) std.debug.print("(dTLB counters unavailable: needs Linux perf_event access)\n\n", .{});
+
+    const configs = [_]struct { name: []const u8, options: taptun.packet.PoolOptions }{
+        .{ .name = "4 KB pages", .options = .{} },
+        .{ .name = "4 KB + prefault", .options = .{ .prefault = true } },
+        .{ .name = "2 MB + prefault", .options = .{ .huge_pages = true, .prefault = true } },
+    };
+    for (configs) |cfg| {
+        try benchPool(allocator, &translator, &counter, order, cfg.name, cfg.options);
+    }
+
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+fn benchPool(
+    allocator: std.mem.Allocator,
+    translator: *taptun.L2L3Translator,
+    counter: *TlbCounter,
+    order: []const u32,
+    name: []const u8,
+    options: taptun.packet.PoolOptions,
+) !void {
+    const init_start = std.time.nanoTimestamp();
+    var pool = try PacketPool.initWithOptions(allocator, pool_count, buffer_size, taptun.packet.default_headroom, options);
+    defer pool.deinit();
+    const init_ns = std.time.nanoTimestamp() - init_start;
+
+    std.debug.print("{s} (backing: {s}, init {d:.1} ms)\n", .{ name, @tagName(pool.backing), @as(f64, @floatFromInt(init_ns)) / 1e6 });
+
+    // First pass touches every buffer for the first time
+    counter.reset();
+    var start = std.time.nanoTimestamp();
+    try pass(translator, &pool, order);
+    report("cold", std.time.nanoTimestamp() - start, order.len, counter.read());
+
+    counter.reset();
+    start = std.time.nanoTimestamp();
+    for (0..warm_passes) |_| try pass(translator, &pool, order);
+    report("warm", std.time.nanoTimestamp() - start, order.len * warm_passes, counter.read());
+    std.debug.print("\n", .{});
+}
+
+/// IP → Ethernet → IP in each buffer once
+fn pass(translator: *taptun.L2L3Translator, pool: *PacketPool, order: []const u32) !void {
+    for (order) |index| {
+        const pkt = &pool.packets[index];
+        pkt.reset(pool.headroom);
+        buildIpHeader(try pkt.put(packet_len));
+        try translator.ipToEthernetPacket(pkt);
+        pkt.flags.parsed = false;
+        _ = try translator.ethernetToIpPacket(pkt);
+    }
+}
+
+fn report(label: []const u8, elapsed_ns: i128, packets: usize, tlb_misses: ?u64) void {
+    const ns = @as(f64, @floatFromInt(elapsed_ns));
+    const count = @as(f64, @floatFromInt(packets));
+    std.debug.print("  {s}: {d:8.2} Mpps  {d:7.1} ns/packet", .{ label, count * 1e3 / ns, ns / count });
+    if (tlb_misses) |misses| {
+        std.debug.print("  {d:6.3} dTLB misses/packet", .{@as(f64, @floatFromInt(misses)) / count});
+    }
+    std.debug.print("\n", .{});
+}
+
+fn buildIpHeader(buf: []u8) void {
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.tos, 0);
+    ip.set(.total_length, packet_len);
+    ip.set(.identification, 0x1234);
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.src_ip, 0xC0A8010A); // 192.168.1.10
+    ip.set(.dst_ip, 0xC0A80101); // 192.168.1.1
+    ip.set(.checksum, 0);
+    ip.set(.checksum, taptun.checksum.internet(buf[0..headers.Ipv4.size]));
+}
+
+/// dTLB load misses of this thread via perf_event_open (Linux only)
+const TlbCounter = struct {
+    fd: ?std.posix.fd_t = null,
+
+    // PERF_TYPE_HW_CACHE config: DTLB | OP_READ << 8 | RESULT_MISS << 16
+    const cache_dtlb = 3;
+    const op_read = 0;
+    const result_miss = 1;
+
+    fn open() TlbCounter {
+        if (builtin.os.tag != .linux) return .{};
+        const linux = std.os.linux;
+        var attr = linux.perf_event_attr{
+            .type = .HW_CACHE,
+            .config = cache_dtlb | (op_read << 8) | (result_miss << 16),
+            .flags = .{ .exclude_kernel = true, .exclude_hv = true },
+        };
+        const fd = std.posix.perf_event_open(&attr, 0, -1, -1, linux.PERF.FLAG.FD_CLOEXEC) catch return .{};
+        return .{ .fd = fd };
+    }
+
+    fn close(self: *TlbCounter) void {
+        if (self.fd) |fd| std.posix.close(fd);
+    }
+
+    fn reset(self: *TlbCounter) void {
+        const fd = self.fd orelse return;
+        _ = std.os.linux.ioctl(fd, std.os.linux.PERF.EVENT_IOC.RESET, 0);
+    }
+
+    fn read(self: *TlbCounter) ?u64 {
+        const fd = self.fd orelse return null;
+        var value: u64 = 0;
+        const n = std.posix.read(fd, std.mem.asBytes(&value)) catch return null;
+        return if (n == @sizeOf(u64)) value else null;
+    }
+};
@@ -0,0 +1,135 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const Packet = taptun.Packet;
+const headers = taptun.headers;
+const IpProto = headers.IpProto;
+
+const packet_count = 4096;
+const packet_size = 512;
+const passes = 500;
+
+const Mix = enum { typical, adversarial };
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun IPv6 Extension Header Benchmark ===\n", .{});
+    std.debug.print("{d} generated IPv6 packets x {d} passes\n", .{ packet_count, passes });
+    std.debug.print("typical: 90% bare TCP/UDP, 6% Hop-by-Hop, 2% Destination Options, 2% fragments\n", .{});
+    std.debug.print("adversarial: chains of 4-12 headers up to 32 bytes each, non-first fragments\n\n", .{});
+
+    const storage = try allocator.alloc([packet_size]u8, packet_count);
+    defer allocator.free(storage);
+
+    for ([_]Mix{ .typical, .adversarial }) |mix| {
+        var prng = std.Random.DefaultPrng.init(0x1F6);
+        const lens = try allocator.alloc(usize, packet_count);
+        defer allocator.free(lens);
+        var ext_total: usize = 0;
+        for (storage, lens) |*buf, *len| {
+            const built = generate(buf, prng.random(), mix);
+            len.* = built.len;
+            ext_total += built.extensions;
+        }
+
+        std.debug.print("{s} ({d:.2} extension headers/packet)\n", .{
+            @tagName(mix), @as(f64, @floatFromInt(ext_total)) / packet_count,
+        });
+
+        // Bare walker
+        var sink: usize = 0;
+        var start = std.time.nanoTimestamp();
+        for (0..passes) |_| {
+            for (storage, lens) |*buf, len| {
+                const upper = headers.ipv6UpperLayer(buf[0..len]) catch continue;
+                sink +%= upper.offset + upper.protocol;
+            }
+        }
+        report("ipv6UpperLayer", std.time.nanoTimestamp() - start);
+
+        // Full parse as the data path runs it, including ports and flow hash
+        var ports: u64 = 0;
+        start = std.time.nanoTimestamp();
+        for (0..passes) |_| {
+            for (storage, lens) |*buf, len| {
+                var pkt = Packet.fromBuffer(buf, 0, len) catch unreachable;
+                pkt.parse(.ip) catch continue;
+                ports +%= pkt.dst_port;
+            }
+        }
+        report("Packet.parse", std.time.nanoTimestamp() - start);
+        std.mem.doNotOptimizeAway(sink);
+        std.mem.doNotOptimizeAway(ports);
+        std.debug.print("\n", .{});
+    }
+
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+fn report(name: []const u8, elapsed_ns: i128) void {
+    const ns = @as(f64, @floatFromInt(elapsed_ns));
+    const count = @as(f64, packet_count * passes);
+    std.debug.print("  {s:<16} {d:7.1} ns/packet  {d:8.2} Mpps\n", .{ name, ns / count, count * 1e3 / ns });
+}
+
+/// Build one IPv6 packet with a random extension chain and a TCP or UDP header
+fn generate(buf: *[packet_size]u8, random: std.Random, mix: Mix) struct { len: usize, extensions: usize } {
+    @memset(buf, 0);
+    buf[0] = 0x60;
+    random.bytes(buf[8..40]);
+
+    var chain: [16]u8 = undefined;
+    var count: usize = 0;
+    switch (mix) {
+        .typical => {
+            const pick = random.uintLessThan(u8, 100);
+            if (pick >= 98) {
+                chain[0] = IpProto.ipv6_fragment;
+                count = 1;
+            } else if (pick >= 96) {
+                chain[0] = IpProto.ipv6_dest_opts;
+                count = 1;
+            } else if (pick >= 90) {
+                chain[0] = IpProto.ipv6_hop_by_hop;
+                count = 1;
+            }
+        },
+        .adversarial => {
+            count = 4 + random.uintLessThan(usize, 9);
+            const kinds = [_]u8{ IpProto.ipv6_hop_by_hop, IpProto.ipv6_routing, IpProto.ipv6_dest_opts, IpProto.ipv6_fragment, IpProto.ipv6_auth };
+            for (chain[0..count]) |*kind| kind.* = kinds[random.uintLessThan(usize, kinds.len)];
+        },
+    }
+
+    const upper = if (random.boolean()) IpProto.tcp else IpProto.udp;
+    buf[6] = if (count > 0) chain[0] else upper;
+    var off: usize = headers.Ipv6.size;
+    for (chain[0..count], 0..) |kind, i| {
+        const next = if (i + 1 < count) chain[i + 1] else upper;
+        // At most 12 headers of ≤ 32 bytes, so the chain always fits the buffer
+        const ext_len: usize = switch (kind) {
+            IpProto.ipv6_fragment => 8,
+            IpProto.ipv6_auth => 24,
+            else => 8 * (1 + random.uintLessThan(usize, if (mix == .adversarial) 4 else 2)),
+        };
+        buf[off] = next;
+        buf[off + 1] = switch (kind) {
+            IpProto.ipv6_fragment => 0,
+            IpProto.ipv6_auth => @intCast(ext_len / 4 - 2),
+            else => @intCast(ext_len / 8 - 1),
+        };
+        if (kind == IpProto.ipv6_fragment and mix == .adversarial and random.boolean()) {
+            std.mem.writeInt(u16, buf[off + 2 ..][0..2], 185 << 3, .big); // Non-first fragment
+        }
+        off += ext_len;
+    }
+
+    std.mem.writeInt(u16, buf[off..][0..2], random.int(u16), .big);
+    std.mem.writeInt(u16, buf[off + 2 ..][0..2], 443, .big);
+    const len = off + headers.Tcp.size;
+    std.mem.writeInt(u16, buf[4..6], @intCast(len - headers.Ipv6.size), .big);
+    return .{ .len = len, .extensions = count };
+}
@@ -86,9 +86,68 @@ pub fn main() !void {
     std.debug.print("  p99.9:   {d:8.2} µs\n", .{@as(f64, @floatFromInt(p999_ns)) / 1000.0});
     std.debug.print("  Max:     {d:8.2} µs\n", .{@as(f64, @floatFromInt(max_ns)) / 1000.0});
 
+    try benchTail(allocator, &translator, eth_packet);
+
     std.debug.print("\n=== Benchmark Complete ===\n\n", .{});
 }
 
+/// Tail latency of the in-place packet path, before and after entering
+/// low-latency mode (mlockall, SCHED_FIFO, prefaulted pool, reserved queues)
+fn benchTail(allocator: std.mem.Allocator, translator: *taptun.L2L3Translator, eth_packet: []const u8) !void {
+    const realtime = taptun.realtime;
+    const iterations = 1_000_000;
+    const pool_size = 4096;
+
+    var pool = try taptun.PacketPool.init(allocator, pool_size, 2048, taptun.packet.default_headroom);
+    defer pool.deinit();
+    var hist = realtime.LatencyHistogram{};
+
+    std.debug.print("\nTail latency, packet path ({d} packets across {d} buffers):\n", .{ iterations, pool_size });
+    try measureTail(translator, &pool, eth_packet, &hist, iterations);
+    reportTail("default", &hist);
+
+    // Low-latency mode; each step is best effort without privileges
+    try realtime.prepareTranslator(translator);
+    realtime.preparePool(&pool);
+    realtime.prepareValue(&hist);
+    const locked = if (realtime.lockMemory()) true else |_| false;
+    defer if (locked) realtime.unlockMemory();
+    const fifo = if (realtime.enterDataPath(.{ .fifo_priority = 50, .cpu = 0 })) true else |_| false;
+    std.debug.print("  (mlockall: {s}, SCHED_FIFO: {s})\n", .{
+        if (locked) "on" else "denied",
+        if (fifo) "on" else "denied",
+    });
+
+    hist.reset();
+    try measureTail(translator, &pool, eth_packet, &hist, iterations);
+    reportTail("low-latency", &hist);
+}
+
+fn measureTail(
+    translator: *taptun.L2L3Translator,
+    pool: *taptun.PacketPool,
+    eth_packet: []const u8,
+    hist: *taptun.realtime.LatencyHistogram,
+    iterations: usize,
+) !void {
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |i| {
+        const pkt = &pool.packets[i % pool.packets.len];
+        pkt.reset(pool.headroom);
+        @memcpy(try pkt.put(eth_packet.len), eth_packet);
+
+        const start = timer.read();
+        _ = try translator.ethernetToIpPacket(pkt);
+        hist.record(timer.read() - start);
+    }
+}
+
+fn reportTail(label: []const u8, hist: *const taptun.realtime.LatencyHistogram) void {
+    std.debug.print("  {s:<12} p50 {d:6} ns  p99 {d:6} ns  p99.9 {d:6} ns  p99.99 {d:7} ns  max {d:8} ns\n", .{
+        label, hist.percentile(50), hist.percentile(99), hist.percentile(99.9), hist.percentile(99.99), hist.max,
+    });
+}
+
 fn buildEthernetPacket(buf: []u8, size: usize) void {
     // Ethernet header
     @memcpy(buf[0..6], &[_]u8{ 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }); // Dest MAC
@@ -0,0 +1,101 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const Packet = taptun.Packet;
+const headers = taptun.headers;
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun MTU Scaling Benchmark ===\n", .{});
+    std.debug.print("Per-byte cost of L2↔L3 translation at standard and jumbo MTUs\n\n", .{});
+
+    var translator = try taptun.L2L3Translator.init(allocator, .{
+        .our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 },
+    });
+    defer translator.deinit();
+
+    const mtus = [_]u32{ 1500, 9000, taptun.max_mtu };
+    const bytes_per_size = 256 * 1024 * 1024; // Same volume at every MTU
+
+    for (mtus) |mtu| {
+        const iterations = bytes_per_size / mtu;
+        try benchMtu(&translator, allocator, mtu, iterations);
+    }
+
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+fn benchMtu(
+    translator: *taptun.L2L3Translator,
+    allocator: std.mem.Allocator,
+    mtu: u32,
+    iterations: usize,
+) !void {
+    const buffer = try allocator.alloc(u8, taptun.packet.bufferSizeForMtu(mtu, taptun.packet.default_headroom));
+    defer allocator.free(buffer);
+    @memset(buffer, 0x42);
+
+    var pkt = Packet.init(buffer, taptun.packet.default_headroom);
+    buildIpHeader(try pkt.put(mtu), mtu);
+
+    // Warmup
+    for (0..100) |_| try roundTrip(translator, &pkt);
+
+    // Packet path: header push/pull in place
+    var start = std.time.nanoTimestamp();
+    for (0..iterations) |_| try roundTrip(translator, &pkt);
+    const packet_ns = std.time.nanoTimestamp() - start;
+
+    // Slice path: allocating copy per direction
+    const frame = try translator.ipToEthernet(pkt.data());
+    defer allocator.free(frame);
+    start = std.time.nanoTimestamp();
+    for (0..iterations) |_| {
+        if (try translator.ethernetToIp(frame)) |ip_slice| {
+            allocator.free(ip_slice);
+        }
+    }
+    const slice_ns = std.time.nanoTimestamp() - start;
+
+    std.debug.print("MTU {d:5} ({d} packets)\n", .{ mtu, iterations });
+    report("in-place", packet_ns, mtu, iterations);
+    report("copying", slice_ns, mtu, iterations);
+    std.debug.print("\n", .{});
+}
+
+/// IP → Ethernet → IP on one descriptor
+fn roundTrip(translator: *taptun.L2L3Translator, pkt: *Packet) !void {
+    pkt.flags.parsed = false;
+    try translator.ipToEthernetPacket(pkt);
+    pkt.flags.parsed = false;
+    _ = try translator.ethernetToIpPacket(pkt);
+}
+
+fn report(name: []const u8, elapsed_ns: i128, mtu: u32, iterations: usize) void {
+    const ns = @as(f64, @floatFromInt(elapsed_ns));
+    const total_bytes = @as(f64, @floatFromInt(@as(u64, mtu) * iterations));
+    const gbps = total_bytes * 8 / ns;
+    const ns_per_packet = ns / @as(f64, @floatFromInt(iterations));
+
+    std.debug.print("  {s:<9} {d:9.1} ns/packet  {d:7.4} ns/byte  {d:8.2} Gbps\n", .{
+        name, ns_per_packet, ns / total_bytes, gbps,
+    });
+}
+
+fn buildIpHeader(buf: []u8, mtu: u32) void {
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.tos, 0);
+    ip.set(.total_length, @intCast(mtu));
+    ip.set(.identification, 0x1234);
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.src_ip, 0xC0A8010A); // 192.168.1.10
+    ip.set(.dst_ip, 0xC0A80101); // 192.168.1.1
+    ip.set(.checksum, 0);
+    ip.set(.checksum, taptun.checksum.internet(buf[0..headers.Ipv4.size]));
+}
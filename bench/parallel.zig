@@ -0,0 +1,195 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const Packet = taptun.Packet;
+const headers = taptun.headers;
+const parallel = taptun.parallel;
+const L2L3Translator = taptun.L2L3Translator;
+
+const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+const gateway_mac = [_]u8{ 0x5E, 0x00, 0x00, 0x00, 0x00, 0x01 };
+const ip_len = 1500;
+const buffer_size = headers.Ethernet.size + ip_len;
+const burst = taptun.simd.max_burst;
+const window = 64;
+const batches = 200_000;
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    const cpus = std.Thread.getCpuCount() catch 1;
+    // The reader and the writer keep a core each
+    const max_workers = @max(cpus -| 2, 1);
+
+    std.debug.print("\n=== ZigTapTun Ordered Parallel Translation Benchmark ===\n", .{});
+    std.debug.print("One TCP flow, {d} B packets, {d} batches of {d}, window {d}, {d} CPUs\n", .{ ip_len, batches, burst, window, cpus });
+    std.debug.print("IP → Ethernet; the writer checks every packet comes out in arrival order\n\n", .{});
+
+    var template: [ip_len]u8 = undefined;
+    buildPacket(&template);
+
+    std.debug.print("{s:<10} {s:>8} {s:>8} {s:>8} {s:>10}\n", .{ "workers", "Mpps", "Gbit/s", "speedup", "steals" });
+    const inline_ns = try runInline(allocator, &template);
+    report("inline", inline_ns, inline_ns, 0);
+
+    var workers: usize = 1;
+    while (true) : (workers *= 2) {
+        const count = @min(workers, max_workers);
+        const result = try runPipeline(allocator, &template, count);
+        var label_buf: [16]u8 = undefined;
+        report(try std.fmt.bufPrint(&label_buf, "{d}", .{count}), result.ns, inline_ns, result.steals);
+        if (count == max_workers) break;
+    }
+    std.debug.print("\n=== Benchmark Complete ===\n\n", .{});
+}
+
+/// Baseline: the reader translates its own batches, one core
+fn runInline(allocator: std.mem.Allocator, template: []const u8) !u64 {
+    var translator = try initTranslator(allocator);
+    defer translator.deinit();
+
+    const slab = try allocator.alloc(u8, burst * buffer_size);
+    defer allocator.free(slab);
+    var batch = parallel.PacketBatch{};
+    attachBuffers(&batch, slab, template);
+
+    var id: u16 = 0;
+    var expected: u16 = 0;
+    var timer = try std.time.Timer.start();
+    for (0..batches) |_| {
+        fillBatch(&batch, &id);
+        parallel.translateOutbound(&translator, &batch);
+        if (checkBatch(&batch, &expected) != 0) return error.OutOfOrder;
+    }
+    return timer.read();
+}
+
+fn runPipeline(allocator: std.mem.Allocator, template: []const u8, workers: usize) !struct { ns: u64, steals: u64 } {
+    const translators = try allocator.alloc(L2L3Translator, workers);
+    defer allocator.free(translators);
+    for (translators) |*translator| translator.* = try initTranslator(allocator);
+    defer for (translators) |*translator| translator.deinit();
+
+    const pipeline = try parallel.OutboundPipeline.create(allocator, translators, window);
+    defer pipeline.destroy();
+
+    // Every slot's packets keep their buffers; the reader only resets them
+    const slab = try allocator.alloc(u8, window * burst * buffer_size);
+    defer allocator.free(slab);
+    for (pipeline.slots, 0..) |*slot, i| {
+        attachBuffers(&slot.batch, slab[i * burst * buffer_size ..][0 .. burst * buffer_size], template);
+    }
+    try pipeline.start();
+
+    var writer = Writer{ .pipeline = pipeline };
+    var timer = try std.time.Timer.start();
+    const writer_thread = try std.Thread.spawn(.{}, Writer.run, .{&writer});
+
+    var id: u16 = 0;
+    var submitted: usize = 0;
+    while (submitted < batches) {
+        const batch = pipeline.reserve() orelse {
+            std.atomic.spinLoopHint();
+            continue;
+        };
+        fillBatch(batch, &id);
+        pipeline.submit();
+        submitted += 1;
+    }
+    writer_thread.join();
+    const ns = timer.read();
+
+    if (writer.out_of_order != 0) return error.OutOfOrder;
+    return .{ .ns = ns, .steals = pipeline.steals.load(.monotonic) };
+}
+
+/// Device-write side: takes batches in order and checks the packets
+const Writer = struct {
+    pipeline: *parallel.OutboundPipeline,
+    out_of_order: u64 = 0,
+
+    fn run(self: *Writer) void {
+        var expected: u16 = 0;
+        var written: usize = 0;
+        while (written < batches) {
+            const batch = self.pipeline.next() orelse {
+                std.atomic.spinLoopHint();
+                continue;
+            };
+            self.out_of_order += checkBatch(batch, &expected);
+            self.pipeline.release();
+            written += 1;
+        }
+    }
+};
+
+fn initTranslator(allocator: std.mem.Allocator) !L2L3Translator {
+    // Pipeline workers may not snoop multicast joins
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = our_mac, .snoop_multicast = false });
+    translator.gateway_mac = gateway_mac;
+    return translator;
+}
+
+fn attachBuffers(batch: *parallel.PacketBatch, slab: []u8, template: []const u8) void {
+    for (&batch.packets, 0..) |*pkt, i| {
+        const buf = slab[i * buffer_size ..][0..buffer_size];
+        @memcpy(buf[headers.Ethernet.size..], template);
+        pkt.* = Packet.fromBuffer(buf, headers.Ethernet.size, ip_len) catch unreachable;
+    }
+}
+
+/// What a TUN read leaves: a fresh IP packet in each buffer, numbered in the IP ID
+fn fillBatch(batch: *parallel.PacketBatch, id: *u16) void {
+    batch.len = burst;
+    for (&batch.packets) |*pkt| {
+        pkt.reset(headers.Ethernet.size);
+        pkt.len = ip_len;
+        std.mem.writeInt(u16, pkt.data()[4..6], id.*, .big);
+        id.* +%= 1;
+    }
+}
+
+/// Packets out of order or not delivered
+fn checkBatch(batch: *const parallel.PacketBatch, expected: *u16) u64 {
+    var bad: u64 = 0;
+    for (batch.packets[0..batch.len], 0..) |*pkt, i| {
+        const l3 = pkt.data()[headers.Ethernet.size..];
+        const delivered = ((batch.delivered >> @intCast(i)) & 1) == 1;
+        if (!delivered or std.mem.readInt(u16, l3[4..6], .big) != expected.*) bad += 1;
+        expected.* +%= 1;
+    }
+    return bad;
+}
+
+fn report(name: []const u8, elapsed_ns: u64, inline_ns: u64, steals: u64) void {
+    const ns = @as(f64, @floatFromInt(elapsed_ns));
+    const packets = @as(f64, batches * burst);
+    std.debug.print("{s:<10} {d:>8.2} {d:>8.2} {d:>7.2}x {d:>10}\n", .{
+        name,
+        packets * 1e3 / ns,
+        packets * ip_len * 8 / ns,
+        @as(f64, @floatFromInt(inline_ns)) / ns,
+        steals,
+    });
+}
+
+fn buildPacket(ip_packet: []u8) void {
+    @memset(ip_packet, 0);
+    const ip = headers.Ipv4.viewMut(ip_packet) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, ip_len);
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.tcp);
+    ip.set(.src_ip, 0x0A150064); // 10.21.0.100
+    ip.set(.dst_ip, 0xC0A80101); // 192.168.1.1
+    ip.set(.checksum, taptun.checksum.internet(ip_packet[0..headers.Ipv4.size]));
+
+    const tcp = ip_packet[headers.Ipv4.size..];
+    std.mem.writeInt(u16, tcp[0..2], 50000, .big);
+    std.mem.writeInt(u16, tcp[2..4], 443, .big);
+    tcp[12] = 0x50; // Data offset 5
+    tcp[13] = 0x10; // ACK
+}
@@ -0,0 +1,102 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const simd = taptun.simd;
+
+const packet_len = 1500;
+const burst = simd.max_burst;
+const iterations = 2_000_000;
+
+pub fn main() !void {
+    std.debug.print("\n=== ZigTapTun SIMD Kernel Benchmark ===\n", .{});
+    std.debug.print("Host picks: {s}  ({d}-byte packets, {d}-frame bursts, {d} iterations)\n\n", .{
+        @tagName(simd.active()), packet_len, burst, iterations,
+    });
+
+    var prng = std.Random.DefaultPrng.init(0x5D);
+    const random = prng.random();
+
+    var src: [packet_len]u8 = undefined;
+    random.bytes(&src);
+    var dst: [packet_len]u8 = undefined;
+
+    // A flooding hub: 5% ours or broadcast, the rest unicast for other members
+    const our_key: u64 = 0x0200_5E10_2030;
+    var keys: [burst]u64 = undefined;
+    for (&keys) |*key| {
+        key.* = switch (random.uintLessThan(u8, 40)) {
+            0 => our_key,
+            1 => 0xFFFF_FFFF_FFFF,
+            else => random.int(u48) & ~@as(u64, 1 << 40),
+        };
+    }
+    // Mostly IPv4/TCP with some UDP, ICMPv6 and ARP
+    var ethertypes: [burst]u16 = undefined;
+    var protocols: [burst]u8 = undefined;
+    for (&ethertypes, &protocols) |*ethertype, *protocol| {
+        const pick = random.uintLessThan(u8, 20);
+        ethertype.* = if (pick == 0) taptun.headers.EtherType.arp else if (pick < 3) taptun.headers.EtherType.ipv6 else taptun.headers.EtherType.ipv4;
+        protocol.* = if (pick < 3) taptun.headers.IpProto.icmpv6 else if (pick < 6) taptun.headers.IpProto.udp else taptun.headers.IpProto.tcp;
+    }
+
+    std.debug.print("{s:<8} {s:>14} {s:>14} {s:>14} {s:>14}\n", .{ "variant", "checksum GB/s", "copy GB/s", "filter ns/64", "classify ns/64" });
+    const features = simd.hostFeatures();
+    for (std.enums.values(simd.Variant)) |variant| {
+        if (!simd.built(variant)) continue;
+        if (!features.supports(variant)) {
+            std.debug.print("{s:<8} (not supported by this CPU)\n", .{@tagName(variant)});
+            continue;
+        }
+        const k = simd.kernelsFor(variant).?;
+
+        var sink: u64 = 0;
+        var start = std.time.nanoTimestamp();
+        for (0..iterations) |_| sink +%= k.sum16(&src);
+        const sum_ns = std.time.nanoTimestamp() - start;
+        std.mem.doNotOptimizeAway(sink);
+
+        start = std.time.nanoTimestamp();
+        for (0..iterations) |_| {
+            k.copy(&dst, &src);
+            std.mem.doNotOptimizeAway(&dst);
+        }
+        const copy_ns = std.time.nanoTimestamp() - start;
+
+        start = std.time.nanoTimestamp();
+        for (0..iterations) |_| sink +%= k.unicastMiss(&keys, our_key);
+        const filter_ns = std.time.nanoTimestamp() - start;
+
+        start = std.time.nanoTimestamp();
+        for (0..iterations) |_| sink +%= k.controlCandidates(&ethertypes, &protocols);
+        const classify_ns = std.time.nanoTimestamp() - start;
+        std.mem.doNotOptimizeAway(sink);
+
+        std.debug.print("{s:<8} {d:>14.2} {d:>14.2} {d:>14.1} {d:>14.1}\n", .{
+            @tagName(variant),
+            gbPerSec(sum_ns),
+            gbPerSec(copy_ns),
+            perCall(filter_ns),
+            perCall(classify_ns),
+        });
+    }
+
+    // End to end: the dispatched path as the translator uses it
+    try simd.select(features.best());
+    const start = std.time.nanoTimestamp();
+    var sink: u32 = 0;
+    for (0..iterations) |_| sink +%= taptun.checksum.internet(&src);
+    std.mem.doNotOptimizeAway(sink);
+    std.debug.print("\nchecksum.internet via dispatch ({s}): {d:.2} GB/s\n\n", .{
+        @tagName(simd.active()), gbPerSec(std.time.nanoTimestamp() - start),
+    });
+
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+fn gbPerSec(elapsed_ns: i128) f64 {
+    return @as(f64, packet_len * iterations) / @as(f64, @floatFromInt(elapsed_ns));
+}
+
+fn perCall(elapsed_ns: i128) f64 {
+    return @as(f64, @floatFromInt(elapsed_ns)) / @as(f64, iterations);
+}
@@ -0,0 +1,493 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const taptun = @import("taptun");
+
+const headers = taptun.headers;
+const Adapter = taptun.GenericTunAdapter(taptun.LoopbackDevice);
+
+// Capture open/close and DHCP restarts log at info level
+pub const std_options: std.Options = .{ .log_level = .warn };
+
+const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+const gateway_mac = [_]u8{ 0x5E, 0x00, 0x00, 0x00, 0x00, 0x01 };
+const our_ip: u32 = 0x0A150064; // 10.21.0.100
+const gateway_ip: u32 = 0x0A150001; // 10.21.0.1
+
+/// Host-stack packets and VPN frames per round
+const outbound_per_round = 48;
+const inbound_per_round = 64;
+/// A DHCP NAK forces a client restart this often
+const dhcp_restart_rounds = 2000;
+
+const Settings = struct {
+    duration_s: u64 = 60,
+    interval_s: u64 = 5,
+    capture_rotate_s: u64 = 10,
+    /// Rotation reopens (truncates) this file; the null device keeps disk out of the loop
+    capture_path: []const u8 = if (builtin.os.tag == .windows) "NUL" else "/dev/null",
+    /// Drift limits, final samples against the first sample after warm-up
+    max_throughput_drop_pct: f64 = 20,
+    max_p99_growth: f64 = 2.0,
+    max_heap_growth_kb: u64 = 256,
+    max_rss_growth_mb: u64 = 32,
+
+    fn parse(args: []const [:0]u8) !Settings {
+        var settings = Settings{};
+        for (args) |arg| {
+            const eq = std.mem.indexOfScalar(u8, arg, '=') orelse return error.InvalidArgument;
+            const name = arg[0..eq];
+            const value = arg[eq + 1 ..];
+            if (std.mem.eql(u8, name, "--duration")) {
+                settings.duration_s = try std.fmt.parseInt(u64, value, 10);
+            } else if (std.mem.eql(u8, name, "--interval")) {
+                settings.interval_s = try std.fmt.parseInt(u64, value, 10);
+            } else if (std.mem.eql(u8, name, "--capture-rotate")) {
+                settings.capture_rotate_s = try std.fmt.parseInt(u64, value, 10);
+            } else if (std.mem.eql(u8, name, "--capture")) {
+                settings.capture_path = value;
+            } else if (std.mem.eql(u8, name, "--max-throughput-drop")) {
+                settings.max_throughput_drop_pct = try std.fmt.parseFloat(f64, value);
+            } else if (std.mem.eql(u8, name, "--max-p99-growth")) {
+                settings.max_p99_growth = try std.fmt.parseFloat(f64, value);
+            } else if (std.mem.eql(u8, name, "--max-heap-growth-kb")) {
+                settings.max_heap_growth_kb = try std.fmt.parseInt(u64, value, 10);
+            } else if (std.mem.eql(u8, name, "--max-rss-growth-mb")) {
+                settings.max_rss_growth_mb = try std.fmt.parseInt(u64, value, 10);
+            } else {
+                return error.InvalidArgument;
+            }
+        }
+        if (settings.interval_s == 0 or settings.duration_s < 2 * settings.interval_s) return error.InvalidArgument;
+        return settings;
+    }
+};
+
+/// Allocator wrapper that tracks live bytes and allocations
+const CountingAllocator = struct {
+    parent: std.mem.Allocator,
+    live_bytes: usize = 0,
+    live_allocs: usize = 0,
+    total_allocs: u64 = 0,
+
+    fn allocator(self: *CountingAllocator) std.mem.Allocator {
+        return .{ .ptr = self, .vtable = &.{
+            .alloc = alloc,
+            .resize = resize,
+            .remap = remap,
+            .free = free,
+        } };
+    }
+
+    fn alloc(ctx: *anyopaque, len: usize, alignment: std.mem.Alignment, ret_addr: usize) ?[*]u8 {
+        const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+        const ptr = self.parent.rawAlloc(len, alignment, ret_addr) orelse return null;
+        self.live_bytes += len;
+        self.live_allocs += 1;
+        self.total_allocs += 1;
+        return ptr;
+    }
+
+    fn resize(ctx: *anyopaque, memory: []u8, alignment: std.mem.Alignment, new_len: usize, ret_addr: usize) bool {
+        const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+        if (!self.parent.rawResize(memory, alignment, new_len, ret_addr)) return false;
+        self.live_bytes = self.live_bytes - memory.len + new_len;
+        return true;
+    }
+
+    fn remap(ctx: *anyopaque, memory: []u8, alignment: std.mem.Alignment, new_len: usize, ret_addr: usize) ?[*]u8 {
+        const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+        const ptr = self.parent.rawRemap(memory, alignment, new_len, ret_addr) orelse return null;
+        self.live_bytes = self.live_bytes - memory.len + new_len;
+        return ptr;
+    }
+
+    fn free(ctx: *anyopaque, memory: []u8, alignment: std.mem.Alignment, ret_addr: usize) void {
+        const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+        self.parent.rawFree(memory, alignment, ret_addr);
+        self.live_bytes -= memory.len;
+        self.live_allocs -= 1;
+    }
+};
+
+const Sample = struct {
+    elapsed_s: f64,
+    kpps: f64,
+    p99_ns: u64,
+    live_bytes: usize,
+    live_allocs: usize,
+    rss_bytes: ?u64,
+};
+
+/// Resident set size: current on Linux, peak elsewhere
+fn residentBytes() ?u64 {
+    if (builtin.os.tag == .linux) {
+        var buf: [128]u8 = undefined;
+        const statm = std.fs.cwd().readFile("/proc/self/statm", &buf) catch return null;
+        var fields = std.mem.tokenizeScalar(u8, statm, ' ');
+        _ = fields.next() orelse return null;
+        const pages = std.fmt.parseInt(u64, fields.next() orelse return null, 10) catch return null;
+        return pages * std.heap.pageSize();
+    }
+    if (builtin.os.tag == .windows) return null;
+    const usage = std.posix.getrusage(std.posix.rusage.SELF);
+    // ru_maxrss is bytes on macOS, kilobytes on the BSDs
+    const scale: u64 = if (builtin.os.tag.isDarwin()) 1 else 1024;
+    return @as(u64, @intCast(usage.maxrss)) * scale;
+}
+
+/// Mixed traffic through a loopback adapter
+const Soak = struct {
+    adapter: *Adapter,
+    random: std.Random,
+    timer: std.time.Timer,
+    latency: taptun.realtime.LatencyHistogram = .{},
+    ops: u64 = 0,
+    rounds: u64 = 0,
+    dhcp_restarts: u64 = 0,
+    read_buffer: [2048]u8 = undefined,
+
+    // Templates, mutated in place between sends
+    tcp4: [1400]u8 = undefined,
+    udp4: [120]u8 = undefined,
+    tcp6: [600]u8 = undefined,
+    inbound: [headers.Ethernet.size + 1400]u8 = undefined,
+    flood: [headers.Ethernet.size + 200]u8 = undefined,
+    arp_request: [headers.Ethernet.size + headers.Arp.size]u8 = undefined,
+
+    fn buildTemplates(self: *Soak) void {
+        buildIpv4(&self.tcp4, our_ip, 0x5DB8D822, headers.IpProto.tcp);
+        buildIpv4(&self.udp4, our_ip, 0x08080808, headers.IpProto.udp);
+        buildIpv6(&self.tcp6);
+
+        writeEthernet(&self.inbound, our_mac, gateway_mac, headers.EtherType.ipv4);
+        buildIpv4(self.inbound[headers.Ethernet.size..], gateway_ip, our_ip, headers.IpProto.tcp);
+        // Unicast for another hub member, dropped by the MAC filter
+        writeEthernet(&self.flood, .{ 0x02, 0x00, 0x5E, 0x77, 0x77, 0x77 }, gateway_mac, headers.EtherType.ipv4);
+        buildIpv4(self.flood[headers.Ethernet.size..], gateway_ip, 0x0A150099, headers.IpProto.udp);
+
+        writeEthernet(&self.arp_request, [_]u8{0xFF} ** 6, gateway_mac, headers.EtherType.arp);
+        const arp = headers.Arp.viewMut(self.arp_request[headers.Ethernet.size..]) catch unreachable;
+        arp.set(.hardware_type, 1);
+        arp.set(.protocol_type, headers.EtherType.ipv4);
+        arp.set(.hardware_size, 6);
+        arp.set(.protocol_size, 4);
+        arp.set(.opcode, 1);
+        arp.set(.target_ip, our_ip);
+    }
+
+    fn round(self: *Soak) !void {
+        // Host stack → VPN
+        for (0..outbound_per_round) |_| {
+            const pick = self.random.uintLessThan(u8, 10);
+            const pkt: []u8 = if (pick < 6) &self.tcp4 else if (pick < 9) &self.udp4 else &self.tcp6;
+            const l4: usize = if (pick < 9) headers.Ipv4.size else headers.Ipv6.size;
+            std.mem.writeInt(u16, pkt[l4..][0..2], self.random.int(u16), .big);
+            try self.adapter.device.write(pkt);
+        }
+
+        // VPN → host: data for us, hub flooding, and ARP from a churning set of peers
+        for (0..inbound_per_round) |_| {
+            const pick = self.random.uintLessThan(u8, 10);
+            const frame: []u8 = if (pick < 7) &self.inbound else if (pick < 9) &self.flood else &self.arp_request;
+            if (pick == 9) {
+                const arp = headers.Arp.viewMut(frame[headers.Ethernet.size..]) catch unreachable;
+                arp.set(.sender_ip, 0x0A150000 | @as(u32, self.random.int(u16)));
+            }
+            const start = self.timer.read();
+            try self.adapter.writeEthernet(frame);
+            self.record(start);
+        }
+
+        // Outbound packets plus inbound ones the loopback returned
+        while (true) {
+            const start = self.timer.read();
+            _ = self.adapter.readEthernet(&self.read_buffer) catch |err| switch (err) {
+                error.WouldBlock => break,
+                else => return err,
+            };
+            self.record(start);
+        }
+
+        const translator = &self.adapter.translator;
+        while (translator.popArpReply()) |reply| translator.allocator.free(reply);
+
+        self.rounds += 1;
+        if (self.rounds % dhcp_restart_rounds == 0) try self.restartDhcp();
+    }
+
+    fn record(self: *Soak, start: u64) void {
+        self.latency.record(self.timer.read() - start);
+        self.ops += 1;
+    }
+
+    /// NAK the current DHCP transaction so the translator restarts the client
+    fn restartDhcp(self: *Soak) !void {
+        const translator = &self.adapter.translator;
+        if (translator.dhcp_client) |client| {
+            var frame: [nak_frame_size]u8 = undefined;
+            try translator.processDhcpPacket(buildNak(&frame, client.transaction_id));
+            self.dhcp_restarts += 1;
+        } else {
+            try translator.startDhcp();
+        }
+        while (translator.popDhcpPacket()) |discover| translator.allocator.free(discover);
+    }
+};
+
+/// Reopens the capture file and swaps writers on the live adapter
+const CaptureRotation = struct {
+    allocator: std.mem.Allocator,
+    path: []const u8,
+    writer: ?*taptun.pcap.PcapWriter = null,
+    generation: usize = 0,
+
+    fn rotate(self: *CaptureRotation, adapter: *Adapter) !void {
+        const next = try taptun.pcap.PcapWriter.init(self.allocator, self.path, .ETHERNET);
+        var cfg = adapter.currentConfig().*;
+        cfg.capture = next;
+        _ = try adapter.reconfigure(cfg);
+        try adapter.syncConfig();
+
+        if (self.writer) |old| old.deinit();
+        self.writer = next;
+        self.generation += 1;
+    }
+
+    fn deinit(self: *CaptureRotation) void {
+        if (self.writer) |writer| writer.deinit();
+    }
+};
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer if (gpa.deinit() == .leak) {
+        std.debug.print("FAIL: allocations leaked (see the traces above)\n", .{});
+        std.process.exit(1);
+    };
+
+    const args = try std.process.argsAlloc(gpa.allocator());
+    defer std.process.argsFree(gpa.allocator(), args);
+    const settings = Settings.parse(args[1..]) catch {
+        std.debug.print(
+            \\usage: soak [--duration=S] [--interval=S] [--capture-rotate=S] [--capture=PATH]
+            \\            [--max-throughput-drop=PCT] [--max-p99-growth=X]
+            \\            [--max-heap-growth-kb=N] [--max-rss-growth-mb=N]
+            \\
+        , .{});
+        std.process.exit(2);
+    };
+
+    std.debug.print("\n=== ZigTapTun Soak Benchmark ===\n", .{});
+    std.debug.print("{d} s, sampled every {d} s; loopback adapter, capture rotated every {d} s, DHCP NAK every {d} rounds\n", .{
+        settings.duration_s, settings.interval_s, settings.capture_rotate_s, dhcp_restart_rounds,
+    });
+    std.debug.print("Per round: {d} host packets, {d} VPN frames (70% data, 20% flood, 10% ARP)\n\n", .{
+        outbound_per_round, inbound_per_round,
+    });
+
+    var counting = CountingAllocator{ .parent = gpa.allocator() };
+    const allocator = counting.allocator();
+
+    var samples: std.ArrayList(Sample) = .{};
+    defer samples.deinit(gpa.allocator());
+
+    {
+        // Looped-back inbound packets carry the gateway's source address, so pin ours
+        const adapter = try Adapter.open(allocator, .{ .translator = .{ .our_mac = our_mac, .learn_ip = false } });
+        defer adapter.close();
+        adapter.translator.setOurIp(our_ip);
+        adapter.translator.setGateway(gateway_ip);
+
+        var prng = std.Random.DefaultPrng.init(0x50A4);
+        var soak = Soak{ .adapter = adapter, .random = prng.random(), .timer = try std.time.Timer.start() };
+        soak.buildTemplates();
+        try soak.restartDhcp();
+
+        var capture = CaptureRotation{ .allocator = allocator, .path = settings.capture_path };
+        defer capture.deinit();
+        try capture.rotate(adapter);
+
+        std.debug.print("{s:>8} {s:>10} {s:>9} {s:>12} {s:>8} {s:>10}\n", .{ "time s", "kpps", "p99 ns", "heap KB", "allocs", "RSS MB" });
+        const interval_ns = settings.interval_s * std.time.ns_per_s;
+        const rotate_ns = settings.capture_rotate_s * std.time.ns_per_s;
+        const end_ns = settings.duration_s * std.time.ns_per_s;
+        var next_sample = interval_ns;
+        var next_rotation = rotate_ns;
+        var ops_at_sample: u64 = 0;
+        var last_sample_ns: u64 = 0;
+        while (true) {
+            try soak.round();
+            const now = soak.timer.read();
+
+            if (now >= next_sample) {
+                const sample = Sample{
+                    .elapsed_s = @as(f64, @floatFromInt(now)) / std.time.ns_per_s,
+                    .kpps = @as(f64, @floatFromInt(soak.ops - ops_at_sample)) * 1e6 / @as(f64, @floatFromInt(now - last_sample_ns)),
+                    .p99_ns = soak.latency.percentile(99),
+                    .live_bytes = counting.live_bytes,
+                    .live_allocs = counting.live_allocs,
+                    .rss_bytes = residentBytes(),
+                };
+                try samples.append(gpa.allocator(), sample);
+                printSample(sample);
+
+                soak.latency.reset();
+                ops_at_sample = soak.ops;
+                last_sample_ns = now;
+                next_sample += interval_ns;
+                if (now >= end_ns) break;
+            }
+            if (rotate_ns > 0 and now >= next_rotation) {
+                try capture.rotate(adapter);
+                next_rotation += rotate_ns;
+            }
+        }
+
+        std.debug.print("\n{d} rounds, {d} adapter calls, {d} DHCP restarts, {d} capture rotations, {d} loopback drops\n", .{
+            soak.rounds, soak.ops, soak.dhcp_restarts, capture.generation, adapter.device.dropped,
+        });
+    }
+
+    var failures: usize = 0;
+    if (counting.live_allocs != 0) {
+        std.debug.print("FAIL: {d} allocations ({d} bytes) still live after close\n", .{ counting.live_allocs, counting.live_bytes });
+        failures += 1;
+    }
+    failures += checkDrift(samples.items, settings);
+    if (failures > 0) std.process.exit(1);
+
+    std.debug.print("PASS: no drift beyond thresholds\n", .{});
+    std.debug.print("\n=== Benchmark Complete ===\n\n", .{});
+}
+
+fn printSample(sample: Sample) void {
+    std.debug.print("{d:>8.0} {d:>10.1} {d:>9} {d:>12.1} {d:>8}", .{
+        sample.elapsed_s,                                       sample.kpps, sample.p99_ns,
+        @as(f64, @floatFromInt(sample.live_bytes)) / 1024.0, sample.live_allocs,
+    });
+    if (sample.rss_bytes) |rss| {
+        std.debug.print(" {d:>10.1}\n", .{@as(f64, @floatFromInt(rss)) / (1024.0 * 1024.0)});
+    } else {
+        std.debug.print(" {s:>10}\n", .{"n/a"});
+    }
+}
+
+/// Compare the end of the run against the first sample after warm-up
+/// Throughput and p99 use the mean of up to three samples at each end to ride
+/// out scheduler noise; memory must not grow at all beyond its allowance.
+fn checkDrift(samples: []const Sample, settings: Settings) usize {
+    // The first interval includes warm-up (page faults, pool and map growth)
+    if (samples.len < 3) return 0;
+    const steady = samples[1..];
+    const window = @min(3, steady.len / 2);
+    const head = steady[0..window];
+    const tail = steady[steady.len - window ..];
+    const base = steady[0];
+    const last = steady[steady.len - 1];
+    var failures: usize = 0;
+
+    const kpps_before = mean(head, "kpps");
+    const kpps_after = mean(tail, "kpps");
+    const drop_pct = (1 - kpps_after / kpps_before) * 100;
+    if (drop_pct > settings.max_throughput_drop_pct) {
+        std.debug.print("FAIL: throughput fell {d:.1}% ({d:.1} -> {d:.1} kpps)\n", .{ drop_pct, kpps_before, kpps_after });
+        failures += 1;
+    }
+
+    const p99_before = mean(head, "p99_ns");
+    const p99_after = mean(tail, "p99_ns");
+    if (p99_after > p99_before * settings.max_p99_growth) {
+        std.debug.print("FAIL: p99 grew {d:.2}x ({d:.0} -> {d:.0} ns)\n", .{ p99_after / p99_before, p99_before, p99_after });
+        failures += 1;
+    }
+
+    if (last.live_bytes > base.live_bytes + settings.max_heap_growth_kb * 1024) {
+        std.debug.print("FAIL: live heap grew {d} -> {d} bytes ({d} -> {d} allocations)\n", .{
+            base.live_bytes, last.live_bytes, base.live_allocs, last.live_allocs,
+        });
+        failures += 1;
+    }
+
+    if (base.rss_bytes != null and last.rss_bytes != null) {
+        const growth = last.rss_bytes.? -| base.rss_bytes.?;
+        if (growth > settings.max_rss_growth_mb * 1024 * 1024) {
+            std.debug.print("FAIL: RSS grew {d:.1} MB\n", .{@as(f64, @floatFromInt(growth)) / (1024.0 * 1024.0)});
+            failures += 1;
+        }
+    }
+    return failures;
+}
+
+fn mean(samples: []const Sample, comptime field: []const u8) f64 {
+    var sum: f64 = 0;
+    for (samples) |sample| {
+        const value = @field(sample, field);
+        const v: f64 = if (@TypeOf(value) == f64) value else @floatFromInt(value);
+        sum += v;
+    }
+    return sum / @as(f64, @floatFromInt(samples.len));
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Packet Templates
+// ═══════════════════════════════════════════════════════════════════════════
+
+fn writeEthernet(frame: []u8, dst: [6]u8, src: [6]u8, ethertype: u16) void {
+    @memset(frame, 0);
+    const eth = headers.Ethernet.viewMut(frame) catch unreachable;
+    eth.set(.dst_mac, dst);
+    eth.set(.src_mac, src);
+    eth.set(.ethertype, ethertype);
+}
+
+fn buildIpv4(buf: []u8, src: u32, dst: u32, protocol: u8) void {
+    @memset(buf, 0);
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, @intCast(buf.len));
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, protocol);
+    ip.set(.src_ip, src);
+    ip.set(.dst_ip, dst);
+    ip.set(.checksum, taptun.checksum.internet(buf[0..headers.Ipv4.size]));
+    std.mem.writeInt(u16, buf[headers.Ipv4.size + 2 ..][0..2], 443, .big);
+}
+
+fn buildIpv6(buf: []u8) void {
+    @memset(buf, 0);
+    buf[0] = 0x60;
+    std.mem.writeInt(u16, buf[4..6], @intCast(buf.len - headers.Ipv6.size), .big);
+    buf[6] = headers.IpProto.tcp;
+    buf[7] = 64;
+    buf[8] = 0xFD; // fd00::100 -> 2001:db8::1
+    buf[23] = 0x64;
+    buf[24] = 0x20;
+    buf[25] = 0x01;
+    buf[26] = 0x0D;
+    buf[27] = 0xB8;
+    buf[39] = 0x01;
+    std.mem.writeInt(u16, buf[headers.Ipv6.size + 2 ..][0..2], 443, .big);
+}
+
+const nak_frame_size = headers.Ethernet.size + headers.Ipv4.size + headers.Udp.size + taptun.DhcpPacket.wire_size;
+
+fn buildNak(frame: *[nak_frame_size]u8, xid: u32) []const u8 {
+    writeEthernet(frame, [_]u8{0xFF} ** 6, gateway_mac, headers.EtherType.ipv4);
+    const l3 = frame[headers.Ethernet.size..];
+    buildIpv4(l3, gateway_ip, 0xFFFFFFFF, headers.IpProto.udp);
+    const udp = headers.Udp.viewMut(l3[headers.Ipv4.size..]) catch unreachable;
+    udp.set(.src_port, 67);
+    udp.set(.dst_port, 68);
+    udp.set(.length, @intCast(l3.len - headers.Ipv4.size));
+
+    var nak = taptun.DhcpPacket.init();
+    nak.op = taptun.DhcpPacket.BOOTREPLY;
+    nak.xid = xid;
+    nak.options[0] = 53; // Message type
+    nak.options[1] = 1;
+    nak.options[2] = 6; // NAK
+    nak.options[3] = 255;
+    nak.writeTo(l3[headers.Ipv4.size + headers.Udp.size ..]) catch unreachable;
+    return frame;
+}
@@ -0,0 +1,160 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const headers = taptun.headers;
+const split_tunnel = taptun.split_tunnel;
+
+const rule_count = 1000;
+const name_count = 4096;
+const addrs_per_answer = 4;
+
+/// Counts route changes instead of touching the routing table
+const CountingSink = struct {
+    added: u64 = 0,
+    deleted: u64 = 0,
+    batches: u64 = 0,
+
+    pub fn applyRoutes(self: *CountingSink, add: []const split_tunnel.Address, delete: []const split_tunnel.Address) !void {
+        self.added += add.len;
+        self.deleted += delete.len;
+        self.batches += 1;
+    }
+};
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun Split Tunnel Benchmark ===\n", .{});
+    std.debug.print("{d} domain rules, {d} names, {d} A records per answer\n\n", .{ rule_count, name_count, addrs_per_answer });
+
+    var split = try split_tunnel.SplitTunnel.init(allocator, .{ .max_routes = 1 << 20, .min_route_ttl_s = 60 });
+    defer split.deinit();
+
+    var rule_buf: [64]u8 = undefined;
+    for (0..rule_count) |i| {
+        const rule = try std.fmt.bufPrint(&rule_buf, "svc{d}.corp{d}.example", .{ i, i % 16 });
+        try split.addRule(rule, .tunnel);
+    }
+
+    // Half the names fall under a rule, half do not
+    const names = try allocator.alloc([64]u8, name_count);
+    defer allocator.free(names);
+    const name_lens = try allocator.alloc(usize, name_count);
+    defer allocator.free(name_lens);
+    var prng = std.Random.DefaultPrng.init(0x5EED);
+    const random = prng.random();
+    for (names, name_lens, 0..) |*name, *len, i| {
+        const svc = random.uintLessThan(usize, rule_count);
+        const zone = if (i % 2 == 0) svc % 16 else 16 + svc % 16;
+        len.* = (try std.fmt.bufPrint(name, "host{d}.svc{d}.corp{d}.example", .{ i, svc, zone })).len;
+    }
+
+    try benchMatch(&split, names, name_lens);
+    try benchInsert(allocator, &split, names, name_lens);
+
+    std.debug.print("=== Benchmark Complete ===\n\n", .{});
+}
+
+fn benchMatch(split: *split_tunnel.SplitTunnel, names: []const [64]u8, name_lens: []const usize) !void {
+    const iterations = 200;
+    var matched: u64 = 0;
+    const start = std.time.nanoTimestamp();
+
+    for (0..iterations) |_| {
+        for (names, name_lens) |*name, len| {
+            if (split.rules.match(name[0..len]) == .tunnel) matched += 1;
+        }
+    }
+
+    const elapsed_ns = std.time.nanoTimestamp() - start;
+    const total = names.len * iterations;
+    std.debug.print("Trie match ({d} nodes)\n", .{split.rules.nodeCount()});
+    std.debug.print("  Per name:     {d:12.1} ns\n", .{@as(f64, @floatFromInt(elapsed_ns)) / @as(f64, @floatFromInt(total))});
+    std.debug.print("  Matched:      {d:12} of {d}\n\n", .{ matched, total });
+}
+
+fn benchInsert(allocator: std.mem.Allocator, split: *split_tunnel.SplitTunnel, names: []const [64]u8, name_lens: []const usize) !void {
+    // One pre-built DNS response per name, each answering with a block of addresses
+    const packets = try allocator.alloc([512]u8, names.len);
+    defer allocator.free(packets);
+    const packet_lens = try allocator.alloc(usize, names.len);
+    defer allocator.free(packet_lens);
+    for (packets, packet_lens, names, name_lens, 0..) |*pkt, *len, *name, name_len, i| {
+        len.* = buildResponse(pkt, name[0..name_len], @intCast(i));
+    }
+
+    const batch_size = 64; // Answers between flushes
+    var sink = CountingSink{};
+    var now_ms: i64 = 0;
+    const start = std.time.nanoTimestamp();
+
+    for (packets, packet_lens, 0..) |*pkt, len, i| {
+        try split.onDnsResponse(pkt[0..len], now_ms);
+        if (i % batch_size == batch_size - 1) try split.flush(&sink, now_ms);
+        now_ms += 1;
+    }
+    try split.flush(&sink, now_ms);
+    const insert_ns = std.time.nanoTimestamp() - start;
+
+    // Everything expires in one flush
+    const expire_start = std.time.nanoTimestamp();
+    try split.flush(&sink, now_ms + 3600 * 1000);
+    const expire_ns = std.time.nanoTimestamp() - expire_start;
+
+    const insert_s = @as(f64, @floatFromInt(insert_ns)) / 1e9;
+    std.debug.print("Route insertion (flush every {d} answers)\n", .{batch_size});
+    std.debug.print("  Answers/s:    {d:12.0}\n", .{@as(f64, @floatFromInt(names.len)) / insert_s});
+    std.debug.print("  Routes/s:     {d:12.0}\n", .{@as(f64, @floatFromInt(sink.added)) / insert_s});
+    std.debug.print("  Routes added: {d:12} in {d} batches\n", .{ sink.added, sink.batches });
+    std.debug.print("  Expired:      {d:12} in {d:.2} ms\n\n", .{ sink.deleted, @as(f64, @floatFromInt(expire_ns)) / 1e6 });
+}
+
+/// IPv4/UDP DNS response for a dotted `name` with `addrs_per_answer` A records
+fn buildResponse(buf: []u8, name: []const u8, seed: u16) usize {
+    const msg_off = headers.Ipv4.size + headers.Udp.size;
+    const msg = buf[msg_off..];
+    @memset(msg[0..headers.Dns.size], 0);
+    const hdr = headers.Dns.viewMut(msg) catch unreachable;
+    hdr.set(.id, seed);
+    hdr.set(.flags, 0x8180);
+    hdr.set(.qdcount, 1);
+    hdr.set(.ancount, addrs_per_answer);
+
+    // Dotted name to wire format
+    var len: usize = headers.Dns.size;
+    var it = std.mem.splitScalar(u8, name, '.');
+    while (it.next()) |label| {
+        msg[len] = @intCast(label.len);
+        @memcpy(msg[len + 1 ..][0..label.len], label);
+        len += 1 + label.len;
+    }
+    msg[len] = 0;
+    len += 1;
+    @memcpy(msg[len..][0..4], &[_]u8{ 0, 1, 0, 1 });
+    len += 4;
+
+    for (0..addrs_per_answer) |a| {
+        const rr = [_]u8{ 0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0x01, 0x2C, 0, 4 }; // TTL 300
+        @memcpy(msg[len..][0..rr.len], &rr);
+        len += rr.len;
+        msg[len..][0..4].* = .{ 10, @truncate(seed >> 8), @truncate(seed), @intCast(a + 1) };
+        len += 4;
+    }
+
+    const total = msg_off + len;
+    @memset(buf[0..msg_off], 0);
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, @intCast(total));
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.src_ip, 0x0A150001); // 10.21.0.1
+    ip.set(.dst_ip, 0x0A150064); // 10.21.0.100
+    const udp = headers.Udp.viewMut(buf[headers.Ipv4.size..]) catch unreachable;
+    udp.set(.src_port, 53);
+    udp.set(.dst_port, 40000);
+    udp.set(.length, @intCast(headers.Udp.size + len));
+    return total;
+}
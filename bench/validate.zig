@@ -0,0 +1,94 @@
+const std = @import("std");
+const taptun = @import("taptun");
+
+const Packet = taptun.Packet;
+const headers = taptun.headers;
+
+const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+const iterations = 5_000_000;
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    std.debug.print("\n=== ZigTapTun IP Validation Benchmark ===\n", .{});
+    std.debug.print("{d} inbound frames per run, in-place packet path\n\n", .{iterations});
+
+    // Minimum-size frame with a padded 40-byte ACK, and a full 1500-byte packet
+    const sizes = [_]struct { name: []const u8, ip_len: u16, frame_len: usize }{
+        .{ .name = "40 B ACK (padded)", .ip_len = 40, .frame_len = 60 },
+        .{ .name = "1500 B", .ip_len = 1500, .frame_len = 1514 },
+    };
+    for (sizes) |size| {
+        std.debug.print("{s}\n", .{size.name});
+        const off_ns = try run(allocator, size.ip_len, size.frame_len, false);
+        const on_ns = try run(allocator, size.ip_len, size.frame_len, true);
+        report("unchecked", off_ns);
+        report("validate_ip", on_ns);
+        std.debug.print("  validator cost: {d:.1} ns/packet\n\n", .{
+            @as(f64, @floatFromInt(on_ns - off_ns)) / @as(f64, iterations),
+        });
+    }
+
+    // The check alone, without the translator around it
+    var frame: [60]u8 = undefined;
+    buildFrame(&frame, 40);
+    const start = std.time.nanoTimestamp();
+    var trimmed: usize = 0;
+    for (0..iterations) |_| {
+        trimmed +%= (try taptun.validate.ipPacket(frame[headers.Ethernet.size..])).len;
+        std.mem.doNotOptimizeAway(&frame);
+    }
+    std.mem.doNotOptimizeAway(trimmed);
+    report("ipPacket only", std.time.nanoTimestamp() - start);
+
+    std.debug.print("\n=== Benchmark Complete ===\n\n", .{});
+}
+
+fn run(allocator: std.mem.Allocator, ip_len: u16, frame_len: usize, validate_ip: bool) !i128 {
+    var translator = try taptun.L2L3Translator.init(allocator, .{
+        .our_mac = our_mac,
+        .learn_gateway_mac = false,
+        .validate_ip = validate_ip,
+    });
+    defer translator.deinit();
+
+    var storage = [_]u8{0} ** 2048;
+    var template: [1514]u8 = undefined;
+    buildFrame(template[0..frame_len], ip_len);
+
+    var pkt = Packet.init(&storage, taptun.packet.default_headroom);
+    const start = std.time.nanoTimestamp();
+    for (0..iterations) |_| {
+        pkt.reset(taptun.packet.default_headroom);
+        // Only the headers change between packets; the payload stays in place
+        @memcpy((try pkt.put(frame_len))[0..34], template[0..34]);
+        if (!try translator.ethernetToIpPacket(&pkt)) return error.Dropped;
+    }
+    return std.time.nanoTimestamp() - start;
+}
+
+fn report(name: []const u8, elapsed_ns: i128) void {
+    const ns = @as(f64, @floatFromInt(elapsed_ns));
+    std.debug.print("  {s:<14} {d:8.2} Mpps  {d:7.1} ns/packet\n", .{ name, @as(f64, iterations) * 1e3 / ns, ns / @as(f64, iterations) });
+}
+
+fn buildFrame(frame: []u8, ip_len: u16) void {
+    @memset(frame, 0);
+    const eth = headers.Ethernet.viewMut(frame) catch unreachable;
+    eth.set(.dst_mac, our_mac);
+    eth.set(.src_mac, .{ 0x02, 0x00, 0x5E, 0xAA, 0xBB, 0xCC });
+    eth.set(.ethertype, headers.EtherType.ipv4);
+
+    const l3 = frame[headers.Ethernet.size..];
+    const ip = headers.Ipv4.viewMut(l3) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, ip_len);
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.tcp);
+    ip.set(.src_ip, 0xC0A80101); // 192.168.1.1
+    ip.set(.dst_ip, 0x0A150064); // 10.21.0.100
+    ip.set(.checksum, taptun.checksum.internet(l3[0..headers.Ipv4.size]));
+}
@@ -27,6 +27,10 @@ pub fn build(b: *std.Build) void {
         .optimize = optimize,
     });
 
+    // The Linux TUN device takes its ioctl structures from the C headers
+    if (target.result.os.tag == .linux) taptun_module.link_libc = true;
+    addSimdKernels(b, taptun_module, target, optimize);
+
     // Export C FFI module for iOS/Android integration
     const c_ffi_module = b.addModule("taptun_c_ffi", .{
         .root_source_file = b.path("src/c_ffi.zig"),
@@ -34,6 +38,7 @@ pub fn build(b: *std.Build) void {
         .optimize = optimize,
     });
     c_ffi_module.addImport("taptun", taptun_module);
+    addSimdKernels(b, c_ffi_module, target, optimize);
 
     // Add iOS SDK include paths for @cImport
     if (ios_sdk_path) |sdk| {
@@ -86,47 +91,29 @@ pub fn build(b: *std.Build) void {
     docs_step.dependOn(&install_docs.step);
 
     // Benchmark executables
-    const throughput_module = b.createModule(.{
-        .root_source_file = b.path("bench/throughput.zig"),
-        .target = target,
-        .optimize = optimize,
-    });
-    throughput_module.addImport("taptun", taptun_module);
-
-    const throughput_exe = std.Build.Step.Compile.create(b, .{
-        .name = "throughput",
-        .root_module = throughput_module,
-        .kind = .exe,
-        .linkage = null,
-    });
-
-    const latency_module = b.createModule(.{
-        .root_source_file = b.path("bench/latency.zig"),
-        .target = target,
-        .optimize = optimize,
-    });
-    latency_module.addImport("taptun", taptun_module);
-
-    const latency_exe = std.Build.Step.Compile.create(b, .{
-        .name = "latency",
-        .root_module = latency_module,
-        .kind = .exe,
-        .linkage = null,
-    });
-
-    const install_throughput = b.addInstallArtifact(throughput_exe, .{});
-    const install_latency = b.addInstallArtifact(latency_exe, .{});
-
     const bench_step = b.step("bench", "Build benchmarks");
-    bench_step.dependOn(&install_throughput.step);
-    bench_step.dependOn(&install_latency.step);
-
-    const run_throughput = b.addRunArtifact(throughput_exe);
-    const run_latency = b.addRunArtifact(latency_exe);
-
     const run_bench_step = b.step("run-bench", "Run all benchmarks");
-    run_bench_step.dependOn(&run_throughput.step);
-    run_bench_step.dependOn(&run_latency.step);
+    const benches = [_][]const u8{
+        "throughput",
+        "latency",
+        "chain",
+        "mtu",
+        "hub_flood",
+        "split_tunnel",
+        "arena",
+        "hugepages",
+        "simd",
+        "validate",
+        "ipv6_ext",
+        "convergence",
+        "soak",
+        "block",
+        "bonding",
+        "parallel",
+    };
+    for (benches) |name| {
+        addBenchmark(b, name, taptun_module, target, optimize, bench_step, run_bench_step);
+    }
 
     // ═══════════════════════════════════════════════════════════════════════════
     // iOS Cross-Compilation Steps
@@ -189,6 +176,110 @@ pub fn build(b: *std.Build) void {
     _ = is_android;
 }
 
+/// One runtime-dispatched SIMD kernel build (see src/simd.zig)
+const SimdIsa = struct {
+    /// `simd.Variant` tag, also the symbol prefix
+    name: []const u8,
+    cpu: *const std.Target.Cpu.Model,
+    /// Vector width in bytes
+    width: usize,
+};
+
+const x86_64_isas = [_]SimdIsa{
+    .{ .name = "sse4_2", .cpu = &std.Target.x86.cpu.x86_64_v2, .width = 16 },
+    .{ .name = "avx2", .cpu = &std.Target.x86.cpu.x86_64_v3, .width = 32 },
+    .{ .name = "avx512", .cpu = &std.Target.x86.cpu.x86_64_v4, .width = 64 },
+};
+
+const aarch64_isas = [_]SimdIsa{
+    .{ .name = "neon", .cpu = &std.Target.aarch64.cpu.generic, .width = 16 },
+};
+
+/// Helper function to link the per-ISA SIMD kernel objects into a module
+/// Each instruction set the target architecture has a variant for gets its own
+/// object compiled from src/simd_isa.zig for that CPU model; the module learns
+/// which ones it has through the `simd_options` import.
+fn addSimdKernels(
+    b: *std.Build,
+    module: *std.Build.Module,
+    target: std.Build.ResolvedTarget,
+    optimize: std.builtin.OptimizeMode,
+) void {
+    const isas: []const SimdIsa = switch (target.result.cpu.arch) {
+        .x86_64 => &x86_64_isas,
+        .aarch64 => &aarch64_isas,
+        else => &.{},
+    };
+
+    var names: [x86_64_isas.len][]const u8 = undefined;
+    for (isas, 0..) |isa, i| {
+        var query = target.query;
+        query.cpu_model = .{ .explicit = isa.cpu };
+        query.cpu_features_add = .empty;
+        query.cpu_features_sub = .empty;
+        if (target.result.cpu.arch == .aarch64) {
+            query.cpu_features_add = std.Target.aarch64.featureSet(&.{.neon});
+        }
+
+        const isa_options = b.addOptions();
+        isa_options.addOption([]const u8, "isa", isa.name);
+        isa_options.addOption(usize, "width", isa.width);
+
+        const isa_module = b.createModule(.{
+            .root_source_file = b.path("src/simd_isa.zig"),
+            .target = b.resolveTargetQuery(query),
+            .optimize = optimize,
+            .pic = true, // Also linked into the shared library
+        });
+        isa_module.addOptions("simd_isa_options", isa_options);
+        module.addObject(b.addObject(.{
+            .name = b.fmt("taptun_simd_{s}", .{isa.name}),
+            .root_module = isa_module,
+        }));
+        names[i] = isa.name;
+    }
+
+    const options = b.addOptions();
+    options.addOption([]const []const u8, "isas", names[0..isas.len]);
+    module.addOptions("simd_options", options);
+}
+
+/// Helper function to add a benchmark executable from bench/<name>.zig
+fn addBenchmark(
+    b: *std.Build,
+    name: []const u8,
+    taptun_module: *std.Build.Module,
+    target: std.Build.ResolvedTarget,
+    optimize: std.builtin.OptimizeMode,
+    bench_step: *std.Build.Step,
+    run_bench_step: *std.Build.Step,
+) void {
+    const bench_module = b.createModule(.{
+        .root_source_file = b.path(b.fmt("bench/{s}.zig", .{name})),
+        .target = target,
+        .optimize = optimize,
+    });
+    bench_module.addImport("taptun", taptun_module);
+
+    const bench_exe = std.Build.Step.Compile.create(b, .{
+        .name = name,
+        .root_module = bench_module,
+        .kind = .exe,
+        .linkage = null,
+    });
+
+    const install_bench = b.addInstallArtifact(bench_exe, .{});
+    bench_step.dependOn(&install_bench.step);
+
+    const run_bench = b.addRunArtifact(bench_exe);
+    if (b.args) |args| run_bench.addArgs(args); // e.g. `zig build bench-soak -- --duration=3600`
+    run_bench_step.dependOn(&run_bench.step);
+
+    // Individual run step, e.g. `zig build bench-chain`
+    const run_one_step = b.step(b.fmt("bench-{s}", .{name}), b.fmt("Run the {s} benchmark", .{name}));
+    run_one_step.dependOn(&run_bench.step);
+}
+
 /// Helper function to build for a specific target triple
 fn buildForTarget(
     b: *std.Build,
@@ -239,6 +330,8 @@ fn buildForTarget(
         .optimize = optimize,
     });
 
+    addSimdKernels(b, target_module, resolved_target, optimize);
+
     // Add iOS SDK include paths if needed
     if (ios_sdk_path) |sdk| {
         const ios_include = b.fmt("{s}/usr/include", .{sdk});
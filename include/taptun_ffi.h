@@ -13,6 +13,35 @@ extern "C" {
  */
 typedef struct TapTunTranslator TapTunTranslator;
 
+/**
+ * Recommended headroom in front of packet data for in-place header pushes
+ */
+#define TAPTUN_PACKET_HEADROOM 64
+
+/**
+ * Largest supported MTU (jumbo tunnels up to the IP length limit)
+ */
+#define TAPTUN_MAX_MTU 65535
+
+/**
+ * Output buffer size that holds any Ethernet frame (TAPTUN_MAX_MTU + 14)
+ */
+#define TAPTUN_MAX_FRAME_SIZE 65549
+
+/**
+ * Packet buffer descriptor for batch APIs
+ *
+ * Data lives at buffer[offset .. offset + length]. Space before offset is
+ * headroom used to prepend headers in place; batch calls update offset and
+ * length instead of copying.
+ */
+typedef struct taptun_packet {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t offset;
+    size_t length;
+} taptun_packet_t;
+
 /**
  * Create a new L2L3 translator instance
  * 
@@ -69,6 +98,49 @@ int taptun_ip_to_ethernet(
     size_t out_buffer_size
 );
 
+/**
+ * Convert a batch of Ethernet frames to IP packets in place
+ *
+ * Each descriptor's offset/length is advanced past the Ethernet header.
+ * Frames handled internally (ARP) or rejected are given length 0.
+ *
+ * @param handle Translator handle
+ * @param packets Array of packet descriptors
+ * @param count Number of descriptors
+ * @return Number of packets to deliver, or -1 on error
+ */
+int taptun_ethernet_to_ip_batch(
+    TapTunTranslator* handle,
+    taptun_packet_t* packets,
+    size_t count
+);
+
+/**
+ * Convert a batch of IP packets to Ethernet frames in place
+ *
+ * The 14-byte Ethernet header is written into each descriptor's headroom
+ * (offset must be at least 14). Packets that cannot be translated are
+ * given length 0.
+ *
+ * @param handle Translator handle
+ * @param packets Array of packet descriptors
+ * @param count Number of descriptors
+ * @return Number of frames produced, or -1 on error
+ */
+int taptun_ip_to_ethernet_batch(
+    TapTunTranslator* handle,
+    taptun_packet_t* packets,
+    size_t count
+);
+
+/**
+ * Output buffer size needed for a full Ethernet frame at a given MTU
+ *
+ * @param mtu Interface MTU (68..TAPTUN_MAX_MTU)
+ * @return Required size in bytes, or 0 if mtu is out of range
+ */
+size_t taptun_max_frame_size(uint32_t mtu);
+
 /**
  * Get translator statistics
  * 
@@ -84,6 +156,22 @@ void taptun_translator_stats(
     uint64_t* out_arp_handled
 );
 
+/**
+ * Get destination MAC filter counters
+ *
+ * Inbound frames are dropped before translation unless addressed to our MAC,
+ * broadcast, or a subscribed multicast group.
+ *
+ * @param handle Translator handle
+ * @param out_accepted Pointer to receive accepted frame count (can be NULL)
+ * @param out_dropped Pointer to receive dropped frame count (can be NULL)
+ */
+void taptun_translator_filter_stats(
+    TapTunTranslator* handle,
+    uint64_t* out_accepted,
+    uint64_t* out_dropped
+);
+
 /**
  * Check if gateway MAC address has been learned
  * 
@@ -0,0 +1,202 @@
+//! Per-Batch Bump Arena
+//!
+//! Scratch memory for allocations that only live until the end of a batch
+//! (locally generated replies, protocol headers for a single write). Each
+//! worker owns one arena and calls `reset` after every batch.
+//!
+//! Allocation is a pointer bump in one contiguous buffer and `reset` releases
+//! everything at once by rewinding it. Freeing the most recent allocation rolls
+//! the pointer back, so `defer free` pairs keep working. Requests that do not
+//! fit go to the backing allocator until the next reset, which then grows the
+//! buffer to the high-water mark so a steady workload stays on the bump path.
+//!
+//! ```zig
+//! var arena = try BatchArena.init(allocator, 64 * 1024);
+//! defer arena.deinit();
+//!
+//! while (running) {
+//!     processBatch(arena.allocator());
+//!     arena.reset();
+//! }
+//! ```
+
+const std = @import("std");
+const Alignment = std.mem.Alignment;
+
+pub const default_size = 64 * 1024;
+
+pub const BatchArena = struct {
+    backing: std.mem.Allocator,
+    buffer: []u8,
+    end: usize = 0,
+    /// Allocations that did not fit in `buffer`, freed at `reset`
+    overflow: std.ArrayList(Overflow) = .{},
+    overflow_bytes: usize = 0,
+    /// Most scratch memory any batch has used
+    high_water: usize = 0,
+
+    // Statistics
+    resets: u64 = 0,
+    overflows: u64 = 0,
+
+    const Self = @This();
+
+    const Overflow = struct {
+        ptr: [*]u8,
+        len: usize,
+        alignment: Alignment,
+    };
+
+    const vtable = std.mem.Allocator.VTable{
+        .alloc = alloc,
+        .resize = resize,
+        .remap = remap,
+        .free = free,
+    };
+
+    pub fn init(backing: std.mem.Allocator, size: usize) !Self {
+        return .{ .backing = backing, .buffer = try backing.alloc(u8, size) };
+    }
+
+    pub fn deinit(self: *Self) void {
+        self.releaseOverflow();
+        self.overflow.deinit(self.backing);
+        self.backing.free(self.buffer);
+    }
+
+    pub fn allocator(self: *Self) std.mem.Allocator {
+        return .{ .ptr = self, .vtable = &vtable };
+    }
+
+    /// Bytes handed out since the last reset
+    pub fn used(self: *const Self) usize {
+        return self.end + self.overflow_bytes;
+    }
+
+    /// Release every allocation made since the last reset
+    /// O(1) unless the batch overflowed the buffer.
+    pub fn reset(self: *Self) void {
+        self.high_water = @max(self.high_water, self.used());
+        self.end = 0;
+        self.resets += 1;
+        if (self.overflow.items.len == 0) return;
+
+        self.releaseOverflow();
+        if (self.high_water > self.buffer.len) {
+            const size = std.math.ceilPowerOfTwo(usize, self.high_water) catch self.high_water;
+            // Keep the old buffer if growing fails; the next batch overflows again
+            if (self.backing.alloc(u8, size)) |grown| {
+                self.backing.free(self.buffer);
+                self.buffer = grown;
+            } else |_| {}
+        }
+    }
+
+    fn releaseOverflow(self: *Self) void {
+        for (self.overflow.items) |o| self.backing.rawFree(o.ptr[0..o.len], o.alignment, @returnAddress());
+        self.overflow.clearRetainingCapacity();
+        self.overflow_bytes = 0;
+    }
+
+    inline fn owns(self: *const Self, memory: []u8) bool {
+        const addr = @intFromPtr(memory.ptr);
+        const base = @intFromPtr(self.buffer.ptr);
+        return addr >= base and addr < base + self.buffer.len;
+    }
+
+    inline fn isLast(self: *const Self, memory: []u8) bool {
+        return @intFromPtr(memory.ptr) + memory.len == @intFromPtr(self.buffer.ptr) + self.end;
+    }
+
+    fn alloc(ctx: *anyopaque, len: usize, alignment: Alignment, ret_addr: usize) ?[*]u8 {
+        const self: *Self = @ptrCast(@alignCast(ctx));
+        const base = @intFromPtr(self.buffer.ptr);
+        const start = alignment.forward(base + self.end) - base;
+        if (start + len <= self.buffer.len) {
+            self.end = start + len;
+            return self.buffer.ptr + start;
+        }
+
+        self.overflow.ensureUnusedCapacity(self.backing, 1) catch return null;
+        const ptr = self.backing.rawAlloc(len, alignment, ret_addr) orelse return null;
+        self.overflow.appendAssumeCapacity(.{ .ptr = ptr, .len = len, .alignment = alignment });
+        self.overflow_bytes += len;
+        self.overflows += 1;
+        return ptr;
+    }
+
+    /// Only the most recent bump allocation can grow; any can shrink
+    fn resize(ctx: *anyopaque, memory: []u8, alignment: Alignment, new_len: usize, ret_addr: usize) bool {
+        _ = alignment;
+        _ = ret_addr;
+        const self: *Self = @ptrCast(@alignCast(ctx));
+        if (!self.owns(memory)) return false;
+        if (!self.isLast(memory)) return new_len <= memory.len;
+
+        const start = @intFromPtr(memory.ptr) - @intFromPtr(self.buffer.ptr);
+        if (start + new_len > self.buffer.len) return false;
+        self.end = start + new_len;
+        return true;
+    }
+
+    fn remap(ctx: *anyopaque, memory: []u8, alignment: Alignment, new_len: usize, ret_addr: usize) ?[*]u8 {
+        return if (resize(ctx, memory, alignment, new_len, ret_addr)) memory.ptr else null;
+    }
+
+    /// Rolls back the most recent bump allocation; everything else waits for `reset`
+    fn free(ctx: *anyopaque, memory: []u8, alignment: Alignment, ret_addr: usize) void {
+        _ = alignment;
+        _ = ret_addr;
+        const self: *Self = @ptrCast(@alignCast(ctx));
+        if (self.owns(memory) and self.isLast(memory)) {
+            self.end = @intFromPtr(memory.ptr) - @intFromPtr(self.buffer.ptr);
+        }
+    }
+};
+
+test "BatchArena bumps, rolls back the last allocation and resets" {
+    var arena = try BatchArena.init(std.testing.allocator, 256);
+    defer arena.deinit();
+    const a = arena.allocator();
+
+    const first = try a.alloc(u8, 10);
+    const second = try a.alloc(u64, 4);
+    try std.testing.expect(std.mem.isAligned(@intFromPtr(second.ptr), @alignOf(u64)));
+    try std.testing.expectEqual(@intFromPtr(first.ptr) + 16, @intFromPtr(second.ptr));
+
+    // Freeing the last allocation makes its space reusable at once
+    a.free(second);
+    const third = try a.alloc(u64, 4);
+    try std.testing.expectEqual(@intFromPtr(second.ptr), @intFromPtr(third.ptr));
+
+    // Freeing an older allocation is a no-op until reset
+    const used = arena.used();
+    a.free(first);
+    try std.testing.expectEqual(used, arena.used());
+
+    arena.reset();
+    try std.testing.expectEqual(@as(usize, 0), arena.used());
+    try std.testing.expectEqual(@intFromPtr(first.ptr), @intFromPtr((try a.alloc(u8, 1)).ptr));
+}
+
+test "BatchArena overflows to the backing allocator and grows at reset" {
+    var arena = try BatchArena.init(std.testing.allocator, 64);
+    defer arena.deinit();
+    const a = arena.allocator();
+
+    _ = try a.alloc(u8, 48);
+    const big = try a.alloc(u8, 200);
+    @memset(big, 0xAA);
+    try std.testing.expect(!arena.owns(big));
+    try std.testing.expectEqual(@as(u64, 1), arena.overflows);
+
+    // The reset frees the overflow and sizes the buffer for the whole batch
+    arena.reset();
+    try std.testing.expect(arena.buffer.len >= 248);
+    _ = try a.alloc(u8, 48);
+    try std.testing.expect(arena.owns(try a.alloc(u8, 200)));
+    try std.testing.expectEqual(@as(u64, 1), arena.overflows);
+
+    // Leftover overflow is released by deinit as well
+    _ = try a.alloc(u8, 4096);
+}
@@ -3,6 +3,7 @@
 //! Handles ARP requests and replies for L2↔L3 translation.
 
 const std = @import("std");
+const headers = @import("headers.zig");
 
 pub const ArpHandler = struct {
     allocator: std.mem.Allocator,
@@ -28,44 +29,7 @@ pub const ArpHandler = struct {
         target_mac: [6]u8,
         target_ip: u32,
     ) ![]const u8 {
-        const packet = try self.allocator.alloc(u8, 42); // Ethernet + ARP
-        errdefer self.allocator.free(packet);
-
-        var pos: usize = 0;
-
-        // Ethernet header (14 bytes)
-        @memcpy(packet[pos..][0..6], &target_mac); // Dest MAC
-        pos += 6;
-        @memcpy(packet[pos..][0..6], &self.our_mac); // Src MAC
-        pos += 6;
-        std.mem.writeInt(u16, packet[pos..][0..2], 0x0806, .big); // EtherType: ARP
-        pos += 2;
-
-        // ARP packet (28 bytes)
-        std.mem.writeInt(u16, packet[pos..][0..2], 0x0001, .big); // Hardware type: Ethernet
-        pos += 2;
-        std.mem.writeInt(u16, packet[pos..][0..2], 0x0800, .big); // Protocol type: IPv4
-        pos += 2;
-        packet[pos] = 6; // Hardware size
-        pos += 1;
-        packet[pos] = 4; // Protocol size
-        pos += 1;
-        std.mem.writeInt(u16, packet[pos..][0..2], 0x0002, .big); // Opcode: Reply
-        pos += 2;
-
-        // Sender (us)
-        @memcpy(packet[pos..][0..6], &self.our_mac); // Sender MAC
-        pos += 6;
-        std.mem.writeInt(u32, packet[pos..][0..4], our_ip, .big); // Sender IP
-        pos += 4;
-
-        // Target
-        @memcpy(packet[pos..][0..6], &target_mac); // Target MAC
-        pos += 6;
-        std.mem.writeInt(u32, packet[pos..][0..4], target_ip, .big); // Target IP
-        pos += 4;
-
-        return packet;
+        return self.buildArpFrame(2, target_mac, our_ip, target_mac, target_ip);
     }
 
     /// Build ARP request packet
@@ -74,42 +38,40 @@ pub const ArpHandler = struct {
         our_ip: u32,
         target_ip: u32,
     ) ![]const u8 {
-        const packet = try self.allocator.alloc(u8, 42);
+        const broadcast = [_]u8{0xFF} ** 6;
+        const unknown = [_]u8{0x00} ** 6;
+        return self.buildArpFrame(1, broadcast, our_ip, unknown, target_ip);
+    }
+
+    /// Build Ethernet + ARP frame (42 bytes) with us as the sender
+    fn buildArpFrame(
+        self: *Self,
+        opcode: u16,
+        dest_mac: [6]u8,
+        our_ip: u32,
+        target_mac: [6]u8,
+        target_ip: u32,
+    ) ![]const u8 {
+        const packet = try self.allocator.alloc(u8, headers.Ethernet.size + headers.Arp.size);
         errdefer self.allocator.free(packet);
 
-        var pos: usize = 0;
-
-        // Ethernet header - broadcast
-        @memset(packet[pos..][0..6], 0xFF); // Broadcast MAC
-        pos += 6;
-        @memcpy(packet[pos..][0..6], &self.our_mac); // Src MAC
-        pos += 6;
-        std.mem.writeInt(u16, packet[pos..][0..2], 0x0806, .big); // EtherType: ARP
-        pos += 2;
-
-        // ARP packet
-        std.mem.writeInt(u16, packet[pos..][0..2], 0x0001, .big); // Hardware type
-        pos += 2;
-        std.mem.writeInt(u16, packet[pos..][0..2], 0x0800, .big); // Protocol type
-        pos += 2;
-        packet[pos] = 6; // Hardware size
-        pos += 1;
-        packet[pos] = 4; // Protocol size
-        pos += 1;
-        std.mem.writeInt(u16, packet[pos..][0..2], 0x0001, .big); // Opcode: Request
-        pos += 2;
-
-        // Sender (us)
-        @memcpy(packet[pos..][0..6], &self.our_mac);
-        pos += 6;
-        std.mem.writeInt(u32, packet[pos..][0..4], our_ip, .big);
-        pos += 4;
-
-        // Target (unknown MAC)
-        @memset(packet[pos..][0..6], 0x00);
-        pos += 6;
-        std.mem.writeInt(u32, packet[pos..][0..4], target_ip, .big);
-        pos += 4;
+        // Ethernet header (14 bytes)
+        const eth = try headers.Ethernet.viewMut(packet);
+        eth.set(.dst_mac, dest_mac);
+        eth.set(.src_mac, self.our_mac);
+        eth.set(.ethertype, headers.EtherType.arp);
+
+        // ARP packet (28 bytes)
+        const arp = try headers.Arp.viewMut(packet[headers.Ethernet.size..]);
+        arp.set(.hardware_type, 0x0001); // Ethernet
+        arp.set(.protocol_type, headers.EtherType.ipv4);
+        arp.set(.hardware_size, 6);
+        arp.set(.protocol_size, 4);
+        arp.set(.opcode, opcode);
+        arp.set(.sender_mac, self.our_mac);
+        arp.set(.sender_ip, our_ip);
+        arp.set(.target_mac, target_mac);
+        arp.set(.target_ip, target_ip);
 
         return packet;
     }
@@ -130,4 +92,9 @@ test "ArpHandler basic" {
 
     try std.testing.expectEqual(@as(usize, 42), reply.len);
     try std.testing.expectEqual(@as(u16, 0x0806), std.mem.readInt(u16, reply[12..14], .big));
+
+    const arp = try headers.Arp.view(reply[headers.Ethernet.size..]);
+    try std.testing.expectEqual(@as(u16, 2), arp.get(.opcode));
+    try std.testing.expectEqual(@as(u32, 0x0A150001), arp.get(.sender_ip));
+    try std.testing.expectEqual(@as(u32, 0x0A150064), arp.get(.target_ip));
 }
@@ -0,0 +1,181 @@
+//! SoftEther Block Framing
+//!
+//! A SoftEther session carries Ethernet frames in blocks rather than one at a
+//! time: a big-endian u32 frame count, then each frame as a big-endian u32
+//! length followed by its bytes. A count of `keep_alive_magic` marks a
+//! keep-alive instead, whose single length-prefixed body is padding.
+//!
+//! ```text
+//! [count][len0][frame0 ...][len1][frame1 ...] ...
+//! ```
+//!
+//! `Reader` walks a received block and hands out each frame as a `Packet`
+//! over the block buffer itself, so the adapter translates frames where they
+//! landed. `Writer` packs outbound frames into a block buffer; `readBlock` on
+//! the adapter reads TUN packets straight into it.
+
+const std = @import("std");
+const packet = @import("packet.zig");
+const Packet = packet.Packet;
+
+/// Frame count of a keep-alive block
+pub const keep_alive_magic: u32 = 0xFFFFFFFF;
+/// Block frame count
+pub const header_size: usize = 4;
+/// Per-frame length prefix
+pub const frame_header_size: usize = 4;
+/// Largest frame accepted, a full frame at the largest MTU
+pub const max_frame_size: usize = packet.maxFrameSize(packet.max_mtu);
+
+pub const Error = error{
+    Truncated,
+    FrameTooLarge,
+    BufferTooSmall,
+};
+
+/// Size of the first block in `stream`, or null if it has not fully arrived
+/// Lets a caller cut blocks out of a byte stream before reading them.
+pub fn complete(stream: []const u8) Error!?usize {
+    if (stream.len < header_size) return null;
+    const count = std.mem.readInt(u32, stream[0..4], .big);
+    const frames: u32 = if (count == keep_alive_magic) 1 else count;
+
+    var offset: usize = header_size;
+    for (0..frames) |_| {
+        if (stream.len < offset + frame_header_size) return null;
+        const len = std.mem.readInt(u32, stream[offset..][0..4], .big);
+        if (count != keep_alive_magic and len > max_frame_size) return error.FrameTooLarge;
+        offset += frame_header_size + len;
+        if (stream.len < offset) return null;
+    }
+    return offset;
+}
+
+/// Frames of a received block, parsed in place
+pub const Reader = struct {
+    block: []u8,
+    offset: usize,
+    remaining: u32,
+    keep_alive: bool,
+
+    const Self = @This();
+
+    pub fn init(block: []u8) Error!Self {
+        if (block.len < header_size) return error.Truncated;
+        const count = std.mem.readInt(u32, block[0..4], .big);
+        const keep_alive = count == keep_alive_magic;
+        return .{
+            .block = block,
+            .offset = header_size,
+            .remaining = if (keep_alive) 0 else count,
+            .keep_alive = keep_alive,
+        };
+    }
+
+    /// Next frame as a packet over the block buffer, or null at the end
+    /// Everything in front of the frame is its headroom, so the adapter can
+    /// push a platform header into the bytes its Ethernet header used.
+    pub fn next(self: *Self) Error!?Packet {
+        if (self.remaining == 0) return null;
+        if (self.block.len < self.offset + frame_header_size) return error.Truncated;
+
+        const len = std.mem.readInt(u32, self.block[self.offset..][0..4], .big);
+        if (len > max_frame_size) return error.FrameTooLarge;
+        const start = self.offset + frame_header_size;
+        if (self.block.len < start + len) return error.Truncated;
+
+        self.offset = start + len;
+        self.remaining -= 1;
+        return Packet.fromBuffer(self.block, start, len) catch unreachable;
+    }
+
+    /// True once every frame has been handed out
+    pub fn done(self: *const Self) bool {
+        return self.remaining == 0;
+    }
+};
+
+/// Packs frames into an outbound block buffer
+pub const Writer = struct {
+    buf: []u8,
+    len: usize = header_size,
+    count: u32 = 0,
+
+    const Self = @This();
+
+    pub fn init(buf: []u8) Error!Self {
+        if (buf.len < header_size) return error.BufferTooSmall;
+        return .{ .buf = buf };
+    }
+
+    /// Offset in `buf` where the next frame's bytes go
+    pub fn nextOffset(self: *const Self) usize {
+        return self.len + frame_header_size;
+    }
+
+    /// Bytes left for the next frame, after its length prefix
+    pub fn available(self: *const Self) usize {
+        return self.buf.len -| self.nextOffset();
+    }
+
+    /// Record a frame of `len` bytes already written at `nextOffset()`
+    pub fn commit(self: *Self, len: usize) void {
+        std.debug.assert(len <= self.available() and len <= max_frame_size);
+        std.mem.writeInt(u32, self.buf[self.len..][0..4], @intCast(len), .big);
+        self.len += frame_header_size + len;
+        self.count += 1;
+    }
+
+    /// Copy a frame in
+    pub fn append(self: *Self, frame: []const u8) Error!void {
+        if (frame.len > max_frame_size) return error.FrameTooLarge;
+        if (frame.len > self.available()) return error.BufferTooSmall;
+        @memcpy(self.buf[self.nextOffset()..][0..frame.len], frame);
+        self.commit(frame.len);
+    }
+
+    /// Write the frame count and return the finished block
+    pub fn finish(self: *Self) []u8 {
+        std.mem.writeInt(u32, self.buf[0..4], self.count, .big);
+        return self.buf[0..self.len];
+    }
+};
+
+test "Writer and Reader round-trip frames in place" {
+    var buf: [256]u8 = undefined;
+    var writer = try Writer.init(&buf);
+    try writer.append("first frame....");
+    try writer.append("second");
+    const block = writer.finish();
+    try std.testing.expectEqual(@as(usize, 4 + 4 + 15 + 4 + 6), block.len);
+    try std.testing.expectEqual(@as(?usize, block.len), try complete(block));
+    try std.testing.expectEqual(@as(?usize, null), try complete(block[0 .. block.len - 1]));
+
+    var reader = try Reader.init(block);
+    const first = (try reader.next()).?;
+    try std.testing.expectEqualStrings("first frame....", first.data());
+    try std.testing.expectEqual(@as(usize, 8), first.headroom());
+    const second = (try reader.next()).?;
+    try std.testing.expectEqualStrings("second", second.data());
+    try std.testing.expect((try reader.next()) == null);
+    try std.testing.expect(reader.done());
+}
+
+test "Reader rejects truncated and oversized frames and skips keep-alives" {
+    var buf = [_]u8{ 0, 0, 0, 2, 0, 0, 0, 3, 'a', 'b', 'c', 0, 0, 0, 9, 'x' };
+    var reader = try Reader.init(&buf);
+    _ = (try reader.next()).?;
+    try std.testing.expectError(error.Truncated, reader.next());
+
+    std.mem.writeInt(u32, buf[4..8], max_frame_size + 1, .big);
+    reader = try Reader.init(&buf);
+    try std.testing.expectError(error.FrameTooLarge, reader.next());
+    try std.testing.expectError(error.FrameTooLarge, complete(&buf));
+
+    std.mem.writeInt(u32, buf[0..4], keep_alive_magic, .big);
+    std.mem.writeInt(u32, buf[4..8], 8, .big);
+    reader = try Reader.init(&buf);
+    try std.testing.expect(reader.keep_alive);
+    try std.testing.expect((try reader.next()) == null);
+    try std.testing.expectEqual(@as(?usize, 16), try complete(&buf));
+}
@@ -0,0 +1,321 @@
+//! Multi-Session Bonding
+//!
+//! One SoftEther session tops out well below what a host can send, so a client
+//! may open several sessions to the same hub and spread the TUN's traffic over
+//! them. `Bond` sits above the translator: each packet read from the TUN is
+//! steered by its symmetric flow hash (`Packet.flow_hash`) onto the egress ring
+//! of one member session, so both directions of a flow use one session and a
+//! flow's packets leave in order.
+//!
+//! Hashes index a table of flow buckets shared out between live members in
+//! proportion to their weights. A weight change or a member coming back re-plans
+//! the table, moving as few buckets as it can, and a bucket only moves once the
+//! session it leaves has taken all of that bucket's queued packets. A member
+//! that goes down loses its buckets at once; what was queued on it is lost with
+//! the session anyway.
+//!
+//! ```zig
+//! const bond = try Bond(*Packet).create(allocator, &.{ 1, 1, 2 });
+//! defer bond.destroy();
+//!
+//! // TUN read thread
+//! try adapter.readEthernetPacket(pkt);
+//! if (bond.steer(pkt.flow_hash, pkt.len, pkt) == null) dropPacket(pkt);
+//!
+//! // Session thread for member `i`
+//! while (bond.next(i)) |pkt| {
+//!     session.send(pkt.*.data()) catch bond.setUp(i, false);
+//!     bond.release(i);
+//! }
+//! ```
+
+const std = @import("std");
+const SpscRing = @import("queue.zig").SpscRing;
+
+pub const max_members = 16;
+/// Flow buckets; a power of two so the hash picks one with a mask
+pub const table_size = 256;
+/// Packets each member's egress ring holds before steering drops
+pub const ring_capacity = 1024;
+
+pub const MemberStats = struct {
+    up: bool,
+    weight: u32,
+    buckets: u32, // Flow buckets currently steered to this member
+    packets: u64,
+    bytes: u64,
+    dropped: u64, // Egress ring full
+    queued: usize,
+};
+
+/// Flow-hash steering onto `weights.len` member sessions
+/// One thread steers; each member's ring is drained by one session thread.
+/// Weights and up/down state may be changed from any thread. Heap-allocated
+/// (`create`) since the rings hold their items inline.
+pub fn Bond(comptime Item: type) type {
+    return struct {
+        allocator: std.mem.Allocator,
+        members: []Member,
+        table: [table_size]Bucket = [_]Bucket{.{}} ** table_size,
+
+        /// Bumped by `setWeight` and `setUp`; steering re-plans when it changes
+        generation: std.atomic.Value(u32) = std.atomic.Value(u32).init(0),
+        planned_generation: u32 = 0,
+
+        // Statistics
+        buckets_moved: std.atomic.Value(u64) = std.atomic.Value(u64).init(0), // Rebalanced after draining
+        buckets_failed_over: std.atomic.Value(u64) = std.atomic.Value(u64).init(0), // Moved off a member that went down
+        no_member_dropped: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+
+        const Self = @This();
+        const Ring = SpscRing(Item, ring_capacity);
+
+        const Member = struct {
+            ring: Ring = .{},
+            weight: std.atomic.Value(u32),
+            up: std.atomic.Value(bool) = std.atomic.Value(bool).init(true),
+
+            // Statistics (written by the steering thread)
+            buckets: std.atomic.Value(u32) = std.atomic.Value(u32).init(0),
+            packets: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+            bytes: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+            dropped: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+        };
+
+        const Bucket = struct {
+            /// Member the bucket's flows leave through
+            member: u8 = 0,
+            /// Member the plan wants; differs while a move waits for `member` to drain
+            target: u8 = 0,
+            /// Ring position just past the bucket's last packet on `member`
+            mark: usize = 0,
+        };
+
+        pub fn create(allocator: std.mem.Allocator, weights: []const u32) !*Self {
+            if (weights.len == 0 or weights.len > max_members) return error.InvalidConfiguration;
+
+            const self = try allocator.create(Self);
+            errdefer allocator.destroy(self);
+            const members = try allocator.alloc(Member, weights.len);
+            for (members, weights) |*member, weight| {
+                member.* = .{ .weight = std.atomic.Value(u32).init(weight) };
+            }
+            self.* = .{ .allocator = allocator, .members = members };
+
+            // Nothing is queued yet, so the first plan applies at once
+            self.plan();
+            for (&self.table) |*bucket| {
+                bucket.member = bucket.target;
+                _ = members[bucket.member].buckets.fetchAdd(1, .monotonic);
+            }
+            return self;
+        }
+
+        /// Items still queued are the caller's to release first
+        pub fn destroy(self: *Self) void {
+            self.allocator.free(self.members);
+            self.allocator.destroy(self);
+        }
+
+        // ───────────────────────────────────────────────────────────────────
+        // Any thread
+        // ───────────────────────────────────────────────────────────────────
+
+        /// Share of flows relative to the other members; 0 takes none while staying up
+        pub fn setWeight(self: *Self, member: usize, weight: u32) void {
+            self.members[member].weight.store(weight, .monotonic);
+            _ = self.generation.fetchAdd(1, .release);
+        }
+
+        /// Mark a member's session lost or restored
+        /// A session thread that went down keeps draining its ring with
+        /// `next`/`release` until it is back, discarding what it finds.
+        pub fn setUp(self: *Self, member: usize, up: bool) void {
+            self.members[member].up.store(up, .monotonic);
+            _ = self.generation.fetchAdd(1, .release);
+        }
+
+        pub fn memberStats(self: *const Self, member: usize) MemberStats {
+            const m = &self.members[member];
+            return .{
+                .up = m.up.load(.monotonic),
+                .weight = m.weight.load(.monotonic),
+                .buckets = m.buckets.load(.monotonic),
+                .packets = m.packets.load(.monotonic),
+                .bytes = m.bytes.load(.monotonic),
+                .dropped = m.dropped.load(.monotonic),
+                .queued = m.ring.len(),
+            };
+        }
+
+        // ───────────────────────────────────────────────────────────────────
+        // Steering side (one thread)
+        // ───────────────────────────────────────────────────────────────────
+
+        /// Queue `item` on the member that carries flow `hash`
+        /// `bytes` only feeds the member's byte counter.
+        /// Returns the member, or null if the item was dropped (no live member,
+        /// or its ring is full) and still belongs to the caller
+        pub fn steer(self: *Self, hash: u32, bytes: usize, item: Item) ?usize {
+            const generation = self.generation.load(.acquire);
+            if (generation != self.planned_generation) {
+                self.planned_generation = generation;
+                self.plan();
+            }
+
+            const bucket = &self.table[hash & (table_size - 1)];
+            if (bucket.member != bucket.target) self.move(bucket);
+
+            const member = &self.members[bucket.member];
+            if (!member.up.load(.monotonic)) {
+                // Every member is down, so the plan had nowhere to put the bucket
+                _ = self.no_member_dropped.fetchAdd(1, .monotonic);
+                return null;
+            }
+            if (!member.ring.push(item)) {
+                _ = member.dropped.fetchAdd(1, .monotonic);
+                return null;
+            }
+            bucket.mark = member.ring.tail.load(.monotonic);
+            _ = member.packets.fetchAdd(1, .monotonic);
+            _ = member.bytes.fetchAdd(bytes, .monotonic);
+            return bucket.member;
+        }
+
+        /// Move a bucket to its target once that cannot reorder its flows
+        fn move(self: *Self, bucket: *Bucket) void {
+            const from = &self.members[bucket.member];
+            if (from.up.load(.monotonic)) {
+                // Wait until the old session has taken the bucket's last packet
+                const head = from.ring.head.load(.acquire);
+                if (@as(isize, @bitCast(head -% bucket.mark)) < 0) return;
+                _ = self.buckets_moved.fetchAdd(1, .monotonic);
+            } else {
+                _ = self.buckets_failed_over.fetchAdd(1, .monotonic);
+            }
+
+            const to = &self.members[bucket.target];
+            _ = from.buckets.fetchSub(1, .monotonic);
+            _ = to.buckets.fetchAdd(1, .monotonic);
+            bucket.member = bucket.target;
+            bucket.mark = to.ring.head.load(.monotonic);
+        }
+
+        /// Recompute bucket targets from the current weights and live members
+        /// Buckets stay where they are (or where they were already headed) while
+        /// that member is under its share; only the surplus is handed out.
+        fn plan(self: *Self) void {
+            const n = self.members.len;
+            var weights: [max_members]u64 = undefined;
+            var total: u64 = 0;
+            for (self.members, weights[0..n]) |*member, *weight| {
+                weight.* = if (member.up.load(.monotonic)) member.weight.load(.monotonic) else 0;
+                total += weight.*;
+            }
+            if (total == 0) return;
+
+            // Shares in proportion to weight; the rounding remainder goes round-robin
+            var quota = [_]u32{0} ** max_members;
+            var assigned: u32 = 0;
+            for (weights[0..n], quota[0..n]) |weight, *q| {
+                q.* = @intCast(table_size * weight / total);
+                assigned += q.*;
+            }
+            var i: usize = 0;
+            while (assigned < table_size) : (i = (i + 1) % n) {
+                if (weights[i] == 0) continue;
+                quota[i] += 1;
+                assigned += 1;
+            }
+
+            var count = [_]u32{0} ** max_members;
+            var unplaced: [table_size]u8 = undefined;
+            var unplaced_len: usize = 0;
+            for (&self.table, 0..) |*bucket, index| {
+                if (count[bucket.member] < quota[bucket.member]) {
+                    bucket.target = bucket.member;
+                } else if (count[bucket.target] >= quota[bucket.target]) {
+                    unplaced[unplaced_len] = @intCast(index);
+                    unplaced_len += 1;
+                    continue;
+                }
+                count[bucket.target] += 1;
+            }
+
+            var m: usize = 0;
+            for (unplaced[0..unplaced_len]) |index| {
+                while (count[m] >= quota[m]) m += 1;
+                self.table[index].target = @intCast(m);
+                count[m] += 1;
+            }
+
+            // Nothing waits on a member that is down
+            for (&self.table) |*bucket| {
+                if (bucket.member != bucket.target and !self.members[bucket.member].up.load(.monotonic)) {
+                    self.move(bucket);
+                }
+            }
+        }
+
+        // ───────────────────────────────────────────────────────────────────
+        // Session side (one thread per member)
+        // ───────────────────────────────────────────────────────────────────
+
+        /// Oldest item queued for `member`, valid until `release`
+        pub fn next(self: *Self, member: usize) ?*Item {
+            return self.members[member].ring.peek();
+        }
+
+        pub fn release(self: *Self, member: usize) void {
+            self.members[member].ring.release();
+        }
+    };
+}
+
+test "Bond shares flows by weight and keeps each flow on one member" {
+    const bond = try Bond(u32).create(std.testing.allocator, &.{ 1, 3 });
+    defer bond.destroy();
+
+    try std.testing.expectEqual(@as(u32, 64), bond.memberStats(0).buckets);
+    try std.testing.expectEqual(@as(u32, 192), bond.memberStats(1).buckets);
+
+    for (0..table_size) |hash| {
+        const first = bond.steer(@intCast(hash), 100, 1).?;
+        try std.testing.expectEqual(first, bond.steer(@intCast(hash), 100, 2).?);
+    }
+    try std.testing.expectEqual(@as(u64, 128), bond.memberStats(0).packets);
+    try std.testing.expectEqual(@as(u64, 384 * 100), bond.memberStats(1).bytes);
+}
+
+test "Bond moves a flow only after its old member drains and fails over at once" {
+    const bond = try Bond(u32).create(std.testing.allocator, &.{ 1, 1, 1 });
+    defer bond.destroy();
+
+    // Find a flow on member 0 and leave one of its packets queued there
+    var hash: u32 = 0;
+    while (bond.steer(hash, 64, 0).? != 0) hash += 1;
+    for (1..3) |member| {
+        while (bond.next(member)) |_| bond.release(member);
+    }
+
+    // Rebalancing away from member 0 waits for the queued packet
+    bond.setWeight(0, 0);
+    try std.testing.expectEqual(@as(?usize, 0), bond.steer(hash, 64, 1));
+    while (bond.next(0)) |_| bond.release(0);
+    const moved = bond.steer(hash, 64, 2).?;
+    try std.testing.expect(moved != 0);
+    try std.testing.expectEqual(@as(u64, 1), bond.buckets_moved.load(.monotonic));
+
+    // Losing that member moves all of its flows without waiting
+    const lost = bond.memberStats(moved).buckets;
+    bond.setUp(moved, false);
+    const survivor = bond.steer(hash, 64, 3).?;
+    try std.testing.expect(survivor != moved and survivor != 0);
+    try std.testing.expectEqual(@as(u64, lost), bond.buckets_failed_over.load(.monotonic));
+    try std.testing.expectEqual(@as(u32, 0), bond.memberStats(moved).buckets);
+
+    // With nothing left up, packets are dropped and stay with the caller
+    bond.setUp(survivor, false);
+    try std.testing.expectEqual(@as(?usize, null), bond.steer(hash, 64, 4));
+    try std.testing.expectEqual(@as(u64, 1), bond.no_member_dropped.load(.monotonic));
+}
@@ -10,6 +10,16 @@ var gpa = std.heap.c_allocator;
 /// Opaque handle to L2L3Translator
 pub const TapTunTranslator = opaque {};
 
+/// Packet buffer descriptor for batch APIs (mirrors taptun_packet_t)
+/// `offset`/`length` describe the data inside `buffer[0..capacity]` and are
+/// updated in place; space before `offset` is headroom for header pushes.
+pub const TapTunPacket = extern struct {
+    buffer: [*]u8,
+    capacity: usize,
+    offset: usize,
+    length: usize,
+};
+
 /// Create a new L2L3 translator
 /// @param our_mac: 6-byte MAC address
 /// @return Opaque translator handle, or NULL on failure
@@ -124,6 +134,11 @@ pub export fn taptun_ip_to_ethernet(
         return -1;
     }
 
+    if (packet_len > taptun.max_mtu) {
+        std.debug.print("[TapTun C FFI] ERROR: ip_to_ethernet packet exceeds max MTU: {d} > {d}\n", .{ packet_len, taptun.max_mtu });
+        return -1;
+    }
+
     if (packet_len > out_buffer_size) {
         std.debug.print("[TapTun C FFI] ERROR: ip_to_ethernet packet too large: {d} > {d}\n", .{ packet_len, out_buffer_size });
         return -2;
@@ -140,7 +155,6 @@ pub export fn taptun_ip_to_ethernet(
 
     if (eth_frame.len > out_buffer_size) {
         std.debug.print("[TapTun C FFI] ERROR: Ethernet frame too large: {d} > {d}\n", .{ eth_frame.len, out_buffer_size });
-        gpa.free(eth_frame);
         return -2; // Buffer too small
     }
 
@@ -155,6 +169,73 @@ pub export fn taptun_ip_to_ethernet(
     return @intCast(eth_frame.len);
 }
 
+/// Convert a batch of Ethernet frames (L2) to IP packets (L3) in place
+/// Each descriptor's offset/length is moved past the Ethernet header; frames
+/// handled internally (ARP) or rejected get length 0.
+/// @return Number of packets to deliver to the TUN device, or -1 on error
+pub export fn taptun_ethernet_to_ip_batch(
+    handle: ?*TapTunTranslator,
+    packets: [*]TapTunPacket,
+    count: usize,
+) c_int {
+    const translator: *taptun.L2L3Translator = @ptrCast(@alignCast(handle orelse return -1));
+
+    var delivered: c_int = 0;
+    for (packets[0..count]) |*desc| {
+        var pkt = taptun.Packet.fromBuffer(desc.buffer[0..desc.capacity], desc.offset, desc.length) catch {
+            desc.length = 0;
+            continue;
+        };
+        const deliver = translator.ethernetToIpPacket(&pkt) catch false;
+        desc.offset = pkt.head;
+        desc.length = if (deliver) pkt.len else 0;
+        if (deliver) delivered += 1;
+    }
+    return delivered;
+}
+
+/// Convert a batch of IP packets (L3) to Ethernet frames (L2) in place
+/// The Ethernet header is written into each descriptor's headroom (offset must be >= 14).
+/// Packets that cannot be translated get length 0.
+/// @return Number of frames produced, or -1 on error
+pub export fn taptun_ip_to_ethernet_batch(
+    handle: ?*TapTunTranslator,
+    packets: [*]TapTunPacket,
+    count: usize,
+) c_int {
+    const translator: *taptun.L2L3Translator = @ptrCast(@alignCast(handle orelse return -1));
+
+    var produced: c_int = 0;
+    for (packets[0..count]) |*desc| {
+        var pkt = taptun.Packet.fromBuffer(desc.buffer[0..desc.capacity], desc.offset, desc.length) catch {
+            desc.length = 0;
+            continue;
+        };
+        translator.ipToEthernetPacket(&pkt) catch {
+            desc.length = 0;
+            continue;
+        };
+        desc.offset = pkt.head;
+        desc.length = pkt.len;
+        produced += 1;
+    }
+    return produced;
+}
+
+/// Output buffer size needed for a full Ethernet frame at `mtu` (0 if mtu is out of range)
+/// TAPTUN_MAX_FRAME_SIZE covers every supported MTU.
+pub export fn taptun_max_frame_size(mtu: u32) usize {
+    if (mtu < taptun.min_mtu or mtu > taptun.max_mtu) return 0;
+    return taptun.maxFrameSize(mtu);
+}
+
+comptime {
+    // Keep in sync with include/taptun_ffi.h
+    std.debug.assert(taptun.max_mtu == 65535);
+    std.debug.assert(taptun.maxFrameSize(taptun.max_mtu) == 65549);
+    std.debug.assert(taptun.packet.default_headroom == 64);
+}
+
 /// Get translator statistics
 pub export fn taptun_translator_stats(
     handle: ?*TapTunTranslator,
@@ -169,6 +250,20 @@ pub export fn taptun_translator_stats(
     if (out_arp_handled) |ptr| ptr.* = translator.arp_requests_handled;
 }
 
+/// Get destination MAC filter counters
+/// @param out_accepted: Frames addressed to us, broadcast or a subscribed group
+/// @param out_dropped: Frames for other hub members or unsubscribed groups
+pub export fn taptun_translator_filter_stats(
+    handle: ?*TapTunTranslator,
+    out_accepted: ?*u64,
+    out_dropped: ?*u64,
+) void {
+    const translator: *taptun.L2L3Translator = @ptrCast(@alignCast(handle orelse return));
+
+    if (out_accepted) |ptr| ptr.* = translator.mac_filter.accepted();
+    if (out_dropped) |ptr| ptr.* = translator.mac_filter.dropped();
+}
+
 /// Check if gateway MAC has been learned
 /// @return 1 if learned, 0 if not
 pub export fn taptun_translator_has_gateway_mac(handle: ?*TapTunTranslator) c_int {
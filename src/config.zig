@@ -0,0 +1,303 @@
+//! Versioned Adapter Configuration
+//!
+//! Live reconfiguration of a running adapter without reopening the device.
+//! A control thread publishes a new `Config` into a `Store`; data-path threads
+//! hold a `Reader` and call `sync` at batch boundaries, which costs one atomic
+//! load unless the version changed. Published snapshots are immutable.
+//!
+//! Old snapshots are reclaimed by epoch: each reader advertises the version it
+//! is using, and a retired snapshot is freed once every reader has synced past
+//! it. Publishing never waits for readers and readers never wait for the
+//! publisher, so a change takes effect at the next batch boundary of each
+//! data-path thread without stalling packet flow.
+//!
+//! ```zig
+//! var store = try config.Store.init(allocator, .{ .translator = .{ .our_mac = mac } });
+//! var reader = try store.register();
+//!
+//! // Data path, once per batch
+//! if (reader.sync()) |snapshot| apply(snapshot.config);
+//!
+//! // Control thread
+//! _ = try store.publish(.{ .mtu = 1400, .translator = .{ .our_mac = mac } });
+//! ```
+
+const std = @import("std");
+const taptun = @import("taptun.zig");
+const pcap = @import("pcap.zig");
+
+/// Most data-path threads that can read one store
+pub const max_readers = 16;
+
+/// Slot value of an unregistered reader
+const inactive = std.math.maxInt(u64);
+
+/// Everything that can be changed on a live adapter
+pub const Config = struct {
+    mtu: u32 = taptun.default_mtu,
+    translator: taptun.TranslatorOptions,
+    /// Pin the gateway address (null = keep learning it from traffic)
+    gateway_ip: ?u32 = null,
+    /// Capture translated frames to this writer (null = off; caller owns it)
+    capture: ?*pcap.PcapWriter = null,
+
+    pub fn validate(self: Config) !void {
+        if (self.mtu < taptun.min_mtu or self.mtu > taptun.max_mtu) return error.InvalidConfiguration;
+        if (self.translator.tunnel_mtu) |mtu| {
+            if (mtu < taptun.min_mtu) return error.InvalidConfiguration;
+        }
+    }
+};
+
+pub const Snapshot = struct {
+    version: u64,
+    config: Config,
+};
+
+pub const Store = struct {
+    allocator: std.mem.Allocator,
+    current: std.atomic.Value(*Snapshot),
+    /// Version each registered reader is using (`inactive` for free slots)
+    reader_versions: [max_readers]std.atomic.Value(u64) = [_]std.atomic.Value(u64){std.atomic.Value(u64).init(inactive)} ** max_readers,
+    /// Guards publishing, registration and `retired`; never taken on the data path
+    mutex: std.Thread.Mutex = .{},
+    retired: std.ArrayList(*Snapshot) = .{},
+
+    const Self = @This();
+
+    pub fn init(allocator: std.mem.Allocator, initial: Config) !Self {
+        try initial.validate();
+        const snapshot = try allocator.create(Snapshot);
+        snapshot.* = .{ .version = 1, .config = initial };
+        return .{ .allocator = allocator, .current = std.atomic.Value(*Snapshot).init(snapshot) };
+    }
+
+    pub fn deinit(self: *Self) void {
+        for (self.retired.items) |snapshot| self.allocator.destroy(snapshot);
+        self.retired.deinit(self.allocator);
+        self.allocator.destroy(self.current.load(.acquire));
+    }
+
+    /// Latest published version
+    pub fn version(self: *const Self) u64 {
+        return self.current.load(.acquire).version;
+    }
+
+    /// Publish a new configuration; returns its version
+    /// Readers pick it up at their next `sync`.
+    pub fn publish(self: *Self, new_config: Config) !u64 {
+        try new_config.validate();
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.publishLocked(new_config);
+    }
+
+    /// Publish the latest configuration with `edit` applied; returns its version
+    /// The read and the publish are one step, so a concurrent `publish` or
+    /// `update` is never lost.
+    pub fn update(self: *Self, context: anytype, comptime edit: fn (@TypeOf(context), *Config) void) !u64 {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        var new_config = self.current.load(.acquire).config;
+        edit(context, &new_config);
+        try new_config.validate();
+        return self.publishLocked(new_config);
+    }
+
+    /// Latest published configuration; start `publish` calls from it to keep
+    /// changes made through `update`
+    pub fn latest(self: *Self) Config {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.current.load(.acquire).config;
+    }
+
+    /// Mutex held
+    fn publishLocked(self: *Self, new_config: Config) !u64 {
+        const snapshot = try self.allocator.create(Snapshot);
+        errdefer self.allocator.destroy(snapshot);
+
+        const old = self.current.load(.acquire);
+        try self.retired.append(self.allocator, old);
+        snapshot.* = .{ .version = old.version + 1, .config = new_config };
+        self.current.store(snapshot, .release);
+
+        self.reclaim();
+        return snapshot.version;
+    }
+
+    /// Register a data-path thread
+    pub fn register(self: *Self) !Reader {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const snapshot = self.current.load(.acquire);
+        for (&self.reader_versions, 0..) |*slot, i| {
+            if (slot.load(.acquire) == inactive) {
+                slot.store(snapshot.version, .release);
+                return .{ .store = self, .slot = i, .snapshot = snapshot };
+            }
+        }
+        return error.TooManyReaders;
+    }
+
+    pub fn unregister(self: *Self, reader: *Reader) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        self.reader_versions[reader.slot].store(inactive, .release);
+        self.reclaim();
+    }
+
+    /// Snapshots waiting for readers to move on
+    pub fn retiredCount(self: *Self) usize {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.reclaim();
+        return self.retired.items.len;
+    }
+
+    /// Free retired snapshots no reader can still be using (mutex held)
+    fn reclaim(self: *Self) void {
+        var oldest = self.current.load(.acquire).version;
+        for (&self.reader_versions) |*slot| oldest = @min(oldest, slot.load(.acquire));
+
+        var i: usize = 0;
+        while (i < self.retired.items.len) {
+            const snapshot = self.retired.items[i];
+            if (snapshot.version < oldest) {
+                self.allocator.destroy(snapshot);
+                _ = self.retired.swapRemove(i);
+            } else {
+                i += 1;
+            }
+        }
+    }
+};
+
+/// A data-path thread's view of a `Store`
+/// The snapshot returned by `sync` (or `current`) stays valid until the next `sync`.
+pub const Reader = struct {
+    store: *Store,
+    slot: usize,
+    snapshot: *const Snapshot,
+
+    /// True if a newer version is waiting; `current` is still the old one
+    pub fn changed(self: *const Reader) bool {
+        return self.store.current.load(.acquire) != self.snapshot;
+    }
+
+    /// Call at a batch boundary; returns the new snapshot if the config changed
+    pub fn sync(self: *Reader) ?*const Snapshot {
+        const latest = self.store.current.load(.acquire);
+        if (latest == self.snapshot) return null;
+
+        self.snapshot = latest;
+        // From here on the previous snapshot may be freed
+        self.store.reader_versions[self.slot].store(latest.version, .release);
+        return latest;
+    }
+
+    pub fn current(self: *const Reader) *const Config {
+        return &self.snapshot.config;
+    }
+};
+
+const test_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+
+test "readers pick up new versions at sync and old snapshots are reclaimed" {
+    var store = try Store.init(std.testing.allocator, .{ .translator = .{ .our_mac = test_mac } });
+    defer store.deinit();
+
+    var fast = try store.register();
+    var slow = try store.register();
+    try std.testing.expectEqual(@as(?*const Snapshot, null), fast.sync());
+
+    try std.testing.expectEqual(@as(u64, 2), try store.publish(.{ .mtu = 1400, .translator = .{ .our_mac = test_mac } }));
+    try std.testing.expectEqual(@as(u64, 3), try store.publish(.{ .mtu = 1300, .translator = .{ .our_mac = test_mac } }));
+
+    // Both readers still reference version 1
+    try std.testing.expectEqual(@as(u32, taptun.default_mtu), slow.current().mtu);
+    try std.testing.expectEqual(@as(usize, 2), store.retiredCount());
+
+    // Readers jump straight to the latest version
+    try std.testing.expectEqual(@as(u64, 3), fast.sync().?.version);
+    try std.testing.expectEqual(@as(usize, 2), store.retiredCount());
+    try std.testing.expectEqual(@as(u32, 1300), slow.sync().?.config.mtu);
+    try std.testing.expectEqual(@as(usize, 0), store.retiredCount());
+
+    // An unregistered reader no longer holds anything back
+    _ = try store.publish(.{ .mtu = 9000, .translator = .{ .our_mac = test_mac } });
+    store.unregister(&slow);
+    try std.testing.expectEqual(@as(usize, 1), store.retiredCount());
+    _ = fast.sync();
+    try std.testing.expectEqual(@as(usize, 0), store.retiredCount());
+
+    try std.testing.expectError(error.InvalidConfiguration, store.publish(.{ .mtu = 10, .translator = .{ .our_mac = test_mac } }));
+}
+
+test "update edits the latest version" {
+    var store = try Store.init(std.testing.allocator, .{ .translator = .{ .our_mac = test_mac } });
+    defer store.deinit();
+    _ = try store.publish(.{ .mtu = 1400, .translator = .{ .our_mac = test_mac, .verbose = true } });
+
+    const Edit = struct {
+        fn tunnelMtu(mtu: u32, cfg: *Config) void {
+            cfg.translator.tunnel_mtu = mtu;
+        }
+    };
+    try std.testing.expectEqual(@as(u64, 3), try store.update(@as(u32, 1380), Edit.tunnelMtu));
+
+    const latest = store.latest();
+    try std.testing.expectEqual(@as(u32, 1400), latest.mtu);
+    try std.testing.expect(latest.translator.verbose);
+    try std.testing.expectEqual(@as(?u32, 1380), latest.translator.tunnel_mtu);
+
+    // An invalid edit publishes nothing
+    try std.testing.expectError(error.InvalidConfiguration, store.update(@as(u32, 10), Edit.tunnelMtu));
+    try std.testing.expectEqual(@as(u64, 3), store.version());
+}
+
+test "publishing under concurrent readers" {
+    var store = try Store.init(std.testing.allocator, .{ .translator = .{ .our_mac = test_mac } });
+    defer store.deinit();
+
+    const Worker = struct {
+        fn run(s: *Store, done: *std.atomic.Value(bool)) void {
+            var reader = s.register() catch return;
+            defer s.unregister(&reader);
+            var last: u64 = reader.snapshot.version;
+            while (!done.load(.acquire)) {
+                if (reader.sync()) |snapshot| {
+                    // Versions only move forward and the snapshot is intact
+                    std.debug.assert(snapshot.version > last);
+                    std.debug.assert(snapshot.config.mtu == taptun.min_mtu + snapshot.version);
+                    last = snapshot.version;
+                }
+            }
+        }
+    };
+
+    var done = std.atomic.Value(bool).init(false);
+    var threads: [2]std.Thread = undefined;
+    for (&threads) |*t| t.* = try std.Thread.spawn(.{}, Worker.run, .{ &store, &done });
+
+    for (2..500) |v| {
+        _ = try store.publish(.{ .mtu = @intCast(taptun.min_mtu + v), .translator = .{ .our_mac = test_mac } });
+    }
+    // Let both readers observe the final version before stopping
+    while (true) {
+        var caught_up = true;
+        for (&store.reader_versions) |*slot| {
+            const v = slot.load(.acquire);
+            if (v != inactive and v != 499) caught_up = false;
+        }
+        if (caught_up) break;
+        std.Thread.yield() catch {};
+    }
+    done.store(true, .release);
+    for (threads) |t| t.join();
+
+    try std.testing.expectEqual(@as(usize, 0), store.retiredCount());
+}
@@ -0,0 +1,625 @@
+//! Control-Plane / Data-Plane Split
+//!
+//! ARP and DHCP are rare, branchy and allocate; bulk IP traffic is none of
+//! those. With a `ControlPlane` attached (`TranslatorOptions.control_plane`), the
+//! translator classifies each inbound frame from fixed header offsets and copies
+//! control frames into a lock-free ring served by a low-priority control thread.
+//! Router Advertisements are copied there too but still reach the host, whose
+//! own stack handles neighbor discovery and SLAAC.
+//!
+//! The control thread owns its own translator for ARP and DHCP state and learns
+//! the IPv6 router from Router Advertisements. It publishes our IP, the gateway
+//! IP and the gateway and router MACs as atomics; the data path adopts them at
+//! its next translate call, which costs one atomic load while nothing changed.
+//!
+//! Frames the control thread generates (ARP replies, DHCP requests) wait in a
+//! second ring for the thread that sends to the VPN.
+//!
+//! ```zig
+//! const cp = try ControlPlane.create(allocator, .{ .our_mac = mac }, .{});
+//! defer cp.destroy();
+//! try cp.start();
+//! cp.startDhcp();
+//!
+//! var translator = try L2L3Translator.init(allocator, .{ .our_mac = mac, .control_plane = cp });
+//!
+//! // VPN send loop
+//! while (cp.nextOutbound()) |frame| {
+//!     try vpn.send(frame);
+//!     cp.releaseOutbound();
+//! }
+//! ```
+
+const std = @import("std");
+const builtin = @import("builtin");
+const taptun = @import("taptun.zig");
+const headers = @import("headers.zig");
+const EtherType = headers.EtherType;
+const IpProto = headers.IpProto;
+const L2L3Translator = @import("translator.zig").L2L3Translator;
+const SpscRing = @import("queue.zig").SpscRing;
+const simd = @import("simd.zig");
+
+/// Control frames larger than this are dropped (DHCP frames are 594 bytes)
+pub const max_frame_size = 1536;
+/// Frames buffered in each direction
+pub const ring_capacity = 64;
+
+const dhcp_server_port = 67;
+const dhcp_client_port = 68;
+const ndp_router_advertisement = 134;
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Classifier
+// ═══════════════════════════════════════════════════════════════════════════
+
+pub const Class = enum {
+    data,
+    /// Handled by the control thread only
+    control,
+    /// Copied to the control thread and still delivered to the host
+    observe,
+};
+
+/// Classify an inbound Ethernet frame
+/// Control: ARP and DHCP server→client (UDP 67→68). Observe: Router
+/// Advertisements, which the control thread reads for the default router.
+/// Other NDP is data: the control thread has no neighbor cache, so the host
+/// stack must see it. Only fixed offsets are read; anything unparseable is
+/// left to the data path.
+pub fn classify(frame: []const u8) Class {
+    const eth = headers.Ethernet.view(frame) catch return .data;
+    const l3 = frame[headers.Ethernet.size..];
+
+    switch (eth.get(.ethertype)) {
+        EtherType.arp => return .control,
+        EtherType.ipv4 => {
+            const ip = headers.Ipv4.view(l3) catch return .data;
+            if (ip.get(.protocol) != IpProto.udp) return .data;
+            const udp = headers.Udp.view(l3[@min(l3.len, headers.ipv4HeaderLen(ip))..]) catch return .data;
+            if (udp.get(.src_port) == dhcp_server_port and udp.get(.dst_port) == dhcp_client_port) return .control;
+            return .data;
+        },
+        EtherType.ipv6 => {
+            const ip = headers.Ipv6.view(l3) catch return .data;
+            if (ip.get(.next_header) != IpProto.icmpv6) return .data;
+            const msg = headers.Icmp.view(l3[headers.Ipv6.size..]) catch return .data;
+            if (msg.get(.msg_type) == ndp_router_advertisement) return .observe;
+            return .data;
+        },
+        else => return .data,
+    }
+}
+
+/// Classify a burst of up to `simd.max_burst` frames; bit i of the result is
+/// set if `frames[i]` goes to the control thread (control or observe). EtherType and protocol are screened in one
+/// vector pass, so only ARP, UDP and ICMPv6 frames get the full `classify`.
+pub fn classifyBurst(frames: []const []const u8) u64 {
+    std.debug.assert(frames.len <= simd.max_burst);
+    var ethertypes: [simd.max_burst]u16 = undefined;
+    var protocols: [simd.max_burst]u8 = undefined;
+    for (frames, ethertypes[0..frames.len], protocols[0..frames.len]) |frame, *ethertype, *protocol| {
+        ethertype.* = if (frame.len >= headers.Ethernet.size) std.mem.readInt(u16, frame[12..14], .big) else 0;
+        // IPv4 protocol is byte 9 of the header, IPv6 next header byte 6
+        const offset: usize = headers.Ethernet.size + @as(usize, if (ethertype.* == EtherType.ipv6) 6 else 9);
+        protocol.* = if (frame.len > offset) frame[offset] else 0;
+    }
+
+    var control: u64 = 0;
+    var candidates = simd.kernels().controlCandidates(ethertypes[0..frames.len], protocols[0..frames.len]);
+    while (candidates != 0) : (candidates &= candidates - 1) {
+        const i = @ctz(candidates);
+        if (classify(frames[i]) != .data) control |= @as(u64, 1) << @intCast(i);
+    }
+    return control;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Published State
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Control-plane results as seen by the data path
+pub const Snapshot = struct {
+    /// Changes on every publish; 0 until the first one
+    generation: u64 = 0,
+    our_ip: ?u32 = null,
+    gateway_ip: ?u32 = null,
+    gateway_mac: ?[6]u8 = null,
+    /// Default IPv6 router (from Router Advertisements)
+    router_mac: ?[6]u8 = null,
+};
+
+/// Set on packed MACs that are known
+const mac_known: u64 = 1 << 48;
+
+fn packMac(mac: ?[6]u8) u64 {
+    const m = mac orelse return 0;
+    return mac_known | std.mem.readInt(u48, &m, .big);
+}
+
+fn unpackMac(value: u64) ?[6]u8 {
+    if (value & mac_known == 0) return null;
+    var mac: [6]u8 = undefined;
+    std.mem.writeInt(u48, &mac, @truncate(value), .big);
+    return mac;
+}
+
+fn nonZero(ip: u32) ?u32 {
+    return if (ip == 0) null else ip;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Control Plane
+// ═══════════════════════════════════════════════════════════════════════════
+
+const FrameSlot = struct {
+    len: u16,
+    bytes: [max_frame_size]u8,
+
+    fn frame(self: *const FrameSlot) []const u8 {
+        return self.bytes[0..self.len];
+    }
+
+    fn fill(self: *FrameSlot, data: []const u8) void {
+        self.len = @intCast(data.len);
+        @memcpy(self.bytes[0..data.len], data);
+    }
+};
+
+const FrameRing = SpscRing(FrameSlot, ring_capacity);
+
+pub const Options = struct {
+    /// Nice value of the control thread (Linux; 0 = inherit)
+    nice: i32 = 10,
+    /// Longest idle sleep before re-checking the rings
+    idle_timeout_ms: u32 = 100,
+};
+
+/// Control thread plus the rings connecting it to one data-path thread
+/// Heap-allocated (`create`) since the rings hold their frames inline.
+pub const ControlPlane = struct {
+    allocator: std.mem.Allocator,
+    options: Options,
+    /// Control-side ARP/DHCP state; touch only before `start` or after `stop`
+    translator: L2L3Translator,
+    router_mac: ?[6]u8 = null,
+
+    inbound: FrameRing = .{},
+    outbound: FrameRing = .{},
+
+    /// Sequence count guarding the fields below; odd while `publish` writes them
+    generation: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+    /// our_ip << 32 | gateway_ip (0 = unknown)
+    ips: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+    gateway_mac: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+    published_router_mac: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+
+    wake: std.Thread.ResetEvent = .{},
+    running: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+    dhcp_requested: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+    thread: ?std.Thread = null,
+
+    // Statistics
+    inbound_dropped: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+    outbound_dropped: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+    /// Frames processed without error
+    frames_handled: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+    /// Frames (and DHCP starts) that failed
+    frames_failed: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+
+    const Self = @This();
+
+    /// `translator_options` configure the control-side translator; data-path
+    /// features (MAC filter, DNS cache, split tunnel) are switched off there.
+    pub fn create(allocator: std.mem.Allocator, translator_options: taptun.TranslatorOptions, options: Options) !*Self {
+        var control_options = translator_options;
+        control_options.filter_dst_mac = false;
+        control_options.snoop_multicast = false;
+        control_options.dns_cache = null;
+        control_options.split_tunnel = null;
+        control_options.control_plane = null;
+
+        const self = try allocator.create(Self);
+        errdefer allocator.destroy(self);
+        self.* = .{
+            .allocator = allocator,
+            .options = options,
+            .translator = try L2L3Translator.init(allocator, control_options),
+        };
+        return self;
+    }
+
+    pub fn destroy(self: *Self) void {
+        self.stop();
+        self.translator.deinit();
+        self.allocator.destroy(self);
+    }
+
+    pub fn start(self: *Self) !void {
+        if (self.thread != null) return;
+        self.running.store(true, .release);
+        errdefer self.running.store(false, .release);
+        self.thread = try std.Thread.spawn(.{}, run, .{self});
+    }
+
+    /// Stop and join the control thread; queued inbound frames are discarded
+    pub fn stop(self: *Self) void {
+        const thread = self.thread orelse return;
+        self.running.store(false, .release);
+        self.wake.set();
+        thread.join();
+        self.thread = null;
+    }
+
+    /// Ask the control thread to start DHCP discovery
+    pub fn startDhcp(self: *Self) void {
+        self.dhcp_requested.store(true, .release);
+        self.wake.set();
+    }
+
+    // ───────────────────────────────────────────────────────────────────────
+    // Data-path side (one thread)
+    // ───────────────────────────────────────────────────────────────────────
+
+    /// Copy a control frame to the control thread; false if it was dropped
+    pub fn submit(self: *Self, frame: []const u8) bool {
+        const slot = if (frame.len <= max_frame_size) self.inbound.reserve() else null;
+        if (slot == null) {
+            _ = self.inbound_dropped.fetchAdd(1, .monotonic);
+            return false;
+        }
+        slot.?.fill(frame);
+        self.inbound.commit();
+        self.wake.set();
+        return true;
+    }
+
+    /// Current generation; compare before loading a full `snapshot`
+    pub inline fn currentGeneration(self: *const Self) u64 {
+        return self.generation.load(.acquire);
+    }
+
+    /// Consistent copy of the published state; retries while a publish is
+    /// in progress or completed between the reads
+    pub fn snapshot(self: *const Self) Snapshot {
+        while (true) {
+            const generation = self.generation.load(.acquire);
+            if (generation & 1 != 0) {
+                std.atomic.spinLoopHint();
+                continue;
+            }
+            // Acquire loads keep the re-check below from moving above them
+            const ips = self.ips.load(.acquire);
+            const gateway_mac = self.gateway_mac.load(.acquire);
+            const router_mac = self.published_router_mac.load(.acquire);
+            if (self.generation.load(.monotonic) != generation) continue;
+
+            return .{
+                .generation = generation,
+                .our_ip = nonZero(@truncate(ips >> 32)),
+                .gateway_ip = nonZero(@truncate(ips)),
+                .gateway_mac = unpackMac(gateway_mac),
+                .router_mac = unpackMac(router_mac),
+            };
+        }
+    }
+
+    // ───────────────────────────────────────────────────────────────────────
+    // VPN-send side (one thread)
+    // ───────────────────────────────────────────────────────────────────────
+
+    /// Next frame for the VPN, valid until `releaseOutbound`
+    pub fn nextOutbound(self: *Self) ?[]const u8 {
+        const slot = self.outbound.peek() orelse return null;
+        return slot.frame();
+    }
+
+    pub fn releaseOutbound(self: *Self) void {
+        self.outbound.release();
+    }
+
+    // ───────────────────────────────────────────────────────────────────────
+    // Control thread
+    // ───────────────────────────────────────────────────────────────────────
+
+    fn run(self: *Self) void {
+        lowerPriority(self.options.nice);
+        const idle_ns = @as(u64, self.options.idle_timeout_ms) * std.time.ns_per_ms;
+
+        while (self.running.load(.acquire)) {
+            // Reset before draining so a submit racing the drain still wakes us
+            self.wake.reset();
+
+            if (self.dhcp_requested.swap(false, .acq_rel)) {
+                self.translator.startDhcp() catch {
+                    _ = self.frames_failed.fetchAdd(1, .monotonic);
+                };
+                self.flushReplies();
+            }
+
+            while (self.inbound.peek()) |slot| {
+                if (self.handleFrame(slot.frame())) {
+                    _ = self.frames_handled.fetchAdd(1, .monotonic);
+                } else |_| {
+                    _ = self.frames_failed.fetchAdd(1, .monotonic);
+                }
+                self.inbound.release();
+                self.flushReplies();
+            }
+
+            self.publish();
+            self.wake.timedWait(idle_ns) catch {};
+        }
+    }
+
+    fn handleFrame(self: *Self, frame: []const u8) !void {
+        const eth = try headers.Ethernet.view(frame);
+        switch (eth.get(.ethertype)) {
+            EtherType.arp => {
+                if (try self.translator.ethernetToIp(frame)) |ip_packet| self.allocator.free(ip_packet);
+            },
+            EtherType.ipv4 => {
+                try self.translator.processDhcpPacket(frame);
+                self.adoptLeaseGateway();
+            },
+            EtherType.ipv6 => self.learnRouter(frame),
+            else => {},
+        }
+    }
+
+    /// Use the DHCP router option as gateway unless one was set explicitly
+    fn adoptLeaseGateway(self: *Self) void {
+        if (self.translator.gateway_ip != null) return;
+        const client = self.translator.dhcp_client orelse return;
+        const lease = client.lease orelse return;
+        const gateway = std.mem.readInt(u32, &lease.gateway, .big);
+        if (gateway != 0) self.translator.setGateway(gateway);
+    }
+
+    /// Track the default router from Router Advertisements
+    fn learnRouter(self: *Self, frame: []const u8) void {
+        const eth = headers.Ethernet.view(frame) catch return;
+        const msg = headers.Icmp.view(frame[@min(frame.len, headers.Ethernet.size + headers.Ipv6.size)..]) catch return;
+        if (msg.get(.msg_type) != ndp_router_advertisement) return;
+
+        // Low 16 bits of the RA's first word are the router lifetime; 0 withdraws it (RFC 4861 §4.2)
+        const lifetime: u16 = @truncate(msg.get(.param));
+        self.router_mac = if (lifetime == 0) null else eth.get(.src_mac);
+    }
+
+    /// Move ARP replies and DHCP requests to the outbound ring
+    fn flushReplies(self: *Self) void {
+        while (self.translator.popArpReply()) |reply| {
+            defer self.allocator.free(reply);
+            self.queueOutbound(reply);
+        }
+        while (self.translator.popDhcpPacket()) |packet| {
+            defer self.allocator.free(packet);
+            self.queueOutbound(packet);
+        }
+    }
+
+    fn queueOutbound(self: *Self, frame: []const u8) void {
+        const slot = if (frame.len <= max_frame_size) self.outbound.reserve() else null;
+        if (slot == null) {
+            _ = self.outbound_dropped.fetchAdd(1, .monotonic);
+            return;
+        }
+        slot.?.fill(frame);
+        self.outbound.commit();
+    }
+
+    /// Publish learned state if it changed (only this thread writes it)
+    fn publish(self: *Self) void {
+        const t = &self.translator;
+        const ips = (@as(u64, t.our_ip orelse 0) << 32) | (t.gateway_ip orelse 0);
+        const gateway_mac = packMac(t.gateway_mac);
+        const router_mac = packMac(self.router_mac);
+
+        if (ips == self.ips.load(.monotonic) and
+            gateway_mac == self.gateway_mac.load(.monotonic) and
+            router_mac == self.published_router_mac.load(.monotonic)) return;
+
+        // Seqlock write: odd generation, fields, even generation. The release
+        // stores order the odd count before the fields a reader may observe.
+        const generation = self.generation.load(.monotonic);
+        self.generation.store(generation + 1, .monotonic);
+        self.ips.store(ips, .release);
+        self.gateway_mac.store(gateway_mac, .release);
+        self.published_router_mac.store(router_mac, .release);
+        self.generation.store(generation + 2, .release);
+    }
+};
+
+/// Best-effort: raise the calling thread's nice value so bulk traffic wins
+fn lowerPriority(nice: i32) void {
+    if (builtin.os.tag != .linux or nice == 0) return;
+    // Linux applies setpriority to a single thread when `who` is 0
+    const prio_process = 0;
+    _ = std.os.linux.syscall3(.setpriority, prio_process, 0, @bitCast(@as(isize, nice)));
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Tests
+// ═══════════════════════════════════════════════════════════════════════════
+
+const test_our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+const test_gateway_mac = [_]u8{ 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+
+/// Ethernet + IPv4/IPv6 header + 8 bytes of L4 header, zero elsewhere
+fn buildTestFrame(buf: []u8, ethertype: u16, proto: u8, word0: u16, word1: u16) []u8 {
+    @memset(buf, 0);
+    const eth = headers.Ethernet.viewMut(buf) catch unreachable;
+    eth.set(.ethertype, ethertype);
+    const l3 = buf[headers.Ethernet.size..];
+    const l4 = if (ethertype == EtherType.ipv6) blk: {
+        const ip = headers.Ipv6.viewMut(l3) catch unreachable;
+        ip.set(.version_class_flow, 6 << 28);
+        ip.set(.next_header, proto);
+        break :blk l3[headers.Ipv6.size..];
+    } else blk: {
+        const ip = headers.Ipv4.viewMut(l3) catch unreachable;
+        ip.set(.version_ihl, 0x45);
+        ip.set(.protocol, proto);
+        break :blk l3[headers.Ipv4.size..];
+    };
+    std.mem.writeInt(u16, l4[0..2], word0, .big);
+    std.mem.writeInt(u16, l4[2..4], word1, .big);
+    return buf[0 .. @intFromPtr(l4.ptr) - @intFromPtr(buf.ptr) + headers.Udp.size];
+}
+
+test "classify diverts ARP and DHCP and observes Router Advertisements" {
+    var buf: [128]u8 = undefined;
+
+    try std.testing.expectEqual(Class.control, classify(buildTestFrame(&buf, EtherType.arp, 0, 0, 0)));
+    try std.testing.expectEqual(Class.control, classify(buildTestFrame(&buf, EtherType.ipv4, IpProto.udp, 67, 68)));
+    try std.testing.expectEqual(Class.data, classify(buildTestFrame(&buf, EtherType.ipv4, IpProto.udp, 68, 67)));
+    try std.testing.expectEqual(Class.data, classify(buildTestFrame(&buf, EtherType.ipv4, IpProto.tcp, 67, 68)));
+    // ICMPv6 type sits in the first byte of the first word
+    try std.testing.expectEqual(Class.observe, classify(buildTestFrame(&buf, EtherType.ipv6, IpProto.icmpv6, 134 << 8, 0)));
+    try std.testing.expectEqual(Class.data, classify(buildTestFrame(&buf, EtherType.ipv6, IpProto.icmpv6, 135 << 8, 0)));
+    try std.testing.expectEqual(Class.data, classify(buildTestFrame(&buf, EtherType.ipv6, IpProto.icmpv6, 136 << 8, 0)));
+    try std.testing.expectEqual(Class.data, classify(buildTestFrame(&buf, EtherType.ipv6, IpProto.icmpv6, 128 << 8, 0)));
+    try std.testing.expectEqual(Class.data, classify(buildTestFrame(&buf, EtherType.ipv6, IpProto.udp, 547, 546)));
+    try std.testing.expectEqual(Class.data, classify(buf[0..10]));
+}
+
+test "classifyBurst agrees with classify" {
+    var bufs: [6][128]u8 = undefined;
+    const frames = [_][]const u8{
+        buildTestFrame(&bufs[0], EtherType.arp, 0, 0, 0),
+        buildTestFrame(&bufs[1], EtherType.ipv4, IpProto.udp, 67, 68),
+        buildTestFrame(&bufs[2], EtherType.ipv4, IpProto.udp, 68, 67),
+        buildTestFrame(&bufs[3], EtherType.ipv4, IpProto.tcp, 67, 68),
+        buildTestFrame(&bufs[4], EtherType.ipv6, IpProto.icmpv6, 134 << 8, 0),
+        bufs[5][0..10],
+    };
+    try std.testing.expectEqual(@as(u64, 0b10011), classifyBurst(&frames));
+}
+
+test "neighbor solicitations and Router Advertisements still reach the host" {
+    const allocator = std.testing.allocator;
+
+    // Not started: the ring shows what was copied to the control thread
+    const cp = try ControlPlane.create(allocator, .{ .our_mac = test_our_mac }, .{});
+    defer cp.destroy();
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = test_our_mac, .control_plane = cp });
+    defer translator.deinit();
+
+    var bufs: [2][128]u8 = undefined;
+    const frames = [_][]u8{
+        buildTestFrame(&bufs[0], EtherType.ipv6, IpProto.icmpv6, 135 << 8, 0),
+        buildTestFrame(&bufs[1], EtherType.ipv6, IpProto.icmpv6, 134 << 8, 0),
+    };
+    for (frames) |frame| {
+        const eth = headers.Ethernet.viewMut(frame) catch unreachable;
+        eth.set(.dst_mac, test_our_mac);
+        eth.set(.src_mac, test_gateway_mac);
+
+        const ip_packet = (try translator.ethernetToIp(frame)) orelse return error.NotDelivered;
+        defer allocator.free(ip_packet);
+        try std.testing.expectEqualSlices(u8, frame[headers.Ethernet.size..], ip_packet);
+    }
+
+    // Only the RA was copied
+    try std.testing.expectEqual(@as(usize, 1), cp.inbound.len());
+}
+
+test "control thread answers ARP and publishes the gateway to the data path" {
+    const allocator = std.testing.allocator;
+    const ArpHandler = @import("arp.zig").ArpHandler;
+    const our_ip: u32 = 0x0A150064; // 10.21.0.100
+    const gateway_ip: u32 = 0x0A150001; // 10.21.0.1
+
+    const cp = try ControlPlane.create(allocator, .{ .our_mac = test_our_mac }, .{ .idle_timeout_ms = 5 });
+    defer cp.destroy();
+    cp.translator.setOurIp(our_ip);
+    cp.translator.setGateway(gateway_ip);
+    try cp.start();
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = test_our_mac, .control_plane = cp });
+    defer translator.deinit();
+
+    var gateway = try ArpHandler.init(allocator, test_gateway_mac);
+    defer gateway.deinit();
+    const request = try gateway.buildArpRequest(gateway_ip, our_ip);
+    defer allocator.free(request);
+    const reply = try gateway.buildArpReply(gateway_ip, test_our_mac, our_ip);
+    defer allocator.free(reply);
+
+    try std.testing.expect((try translator.ethernetToIp(request)) == null);
+    try std.testing.expect((try translator.ethernetToIp(reply)) == null);
+    try std.testing.expectEqual(@as(u64, 0), translator.arp_requests_handled);
+
+    // Wait for the control thread to learn the gateway MAC
+    const deadline = std.time.milliTimestamp() + 5000;
+    while (cp.snapshot().gateway_mac == null) {
+        if (std.time.milliTimestamp() > deadline) return error.Timeout;
+        std.Thread.sleep(std.time.ns_per_ms);
+    }
+
+    // The ARP reply was queued for the VPN before the publish
+    const answer = cp.nextOutbound() orelse return error.MissingReply;
+    const arp = try headers.Arp.view(answer[headers.Ethernet.size..]);
+    try std.testing.expectEqual(gateway_ip, arp.get(.target_ip));
+    cp.releaseOutbound();
+    try std.testing.expectEqual(@as(?[]const u8, null), cp.nextOutbound());
+
+    // The data path picks up the published state at its next translation
+    var ip_packet = [_]u8{0} ** headers.Ipv4.size;
+    ip_packet[0] = 0x45;
+    const frame = try translator.ipToEthernet(&ip_packet);
+    defer allocator.free(frame);
+    try std.testing.expectEqualSlices(u8, &test_gateway_mac, frame[0..6]);
+    try std.testing.expectEqual(@as(?u32, our_ip), translator.getLearnedIp());
+}
+
+test "snapshot never mixes fields from two publishes" {
+    const allocator = std.testing.allocator;
+    const cp = try ControlPlane.create(allocator, .{ .our_mac = test_our_mac }, .{});
+    defer cp.destroy();
+
+    // Stand in for the control thread: alternate between two states whose
+    // IP and gateway MAC always change together
+    const Writer = struct {
+        fn run(plane: *ControlPlane, done: *std.atomic.Value(bool)) void {
+            var i: u32 = 0;
+            while (i < 20_000) : (i += 1) {
+                const second = i % 2 == 1;
+                plane.translator.our_ip = if (second) 2 else 1;
+                plane.translator.gateway_mac = if (second) test_gateway_mac else test_our_mac;
+                plane.publish();
+            }
+            done.store(true, .release);
+        }
+    };
+    var done = std.atomic.Value(bool).init(false);
+    const writer = try std.Thread.spawn(.{}, Writer.run, .{ cp, &done });
+    defer writer.join();
+
+    while (!done.load(.acquire)) {
+        const snap = cp.snapshot();
+        try std.testing.expect(snap.generation % 2 == 0);
+        const ip = snap.our_ip orelse continue;
+        const expected = if (ip == 2) test_gateway_mac else test_our_mac;
+        try std.testing.expectEqualSlices(u8, &expected, &snap.gateway_mac.?);
+    }
+}
+
+test "control thread counts failed frames apart from handled ones" {
+    const allocator = std.testing.allocator;
+    const cp = try ControlPlane.create(allocator, .{ .our_mac = test_our_mac }, .{ .idle_timeout_ms = 5 });
+    defer cp.destroy();
+    try cp.start();
+
+    // Too short for an Ethernet header
+    try std.testing.expect(cp.submit(&[_]u8{ 0, 1, 2, 3 }));
+
+    const deadline = std.time.milliTimestamp() + 5000;
+    while (cp.frames_failed.load(.monotonic) == 0) {
+        if (std.time.milliTimestamp() > deadline) return error.Timeout;
+        std.Thread.sleep(std.time.ns_per_ms);
+    }
+    try std.testing.expectEqual(@as(u64, 0), cp.frames_handled.load(.monotonic));
+}
@@ -0,0 +1,767 @@
+//! Minimal D-Bus Client
+//!
+//! Just enough of the D-Bus wire protocol to call methods on the system bus
+//! without spawning helper processes such as `resolvectl`: SASL EXTERNAL
+//! authentication over a Unix socket, little-endian marshalling of the basic
+//! types, arrays and structs, and blocking method calls that wait for the
+//! matching reply. Signals and other messages arriving in between are skipped.
+//! A bus that stops answering fails the call with error.Timeout.
+//!
+//! ```zig
+//! var bus = try dbus.Connection.connectUnix(allocator, dbus.system_bus_path);
+//! defer bus.close();
+//! try dbus.resolve1.setLinkDns(&bus, ifindex, &.{.{ 10, 21, 0, 1 }});
+//! ```
+
+const std = @import("std");
+const builtin = @import("builtin");
+const posix = std.posix;
+
+pub const system_bus_path = "/run/dbus/system_bus_socket";
+
+const protocol_version: u8 = 1;
+
+/// Largest message accepted from the bus; replies used here are tiny
+const max_message_size = 1024 * 1024;
+
+/// Fixed part of every message header
+const fixed_header_size = 16;
+
+/// How long authentication or a method call waits for the bus
+pub const default_timeout_ms = 5000;
+
+pub const MessageType = enum(u8) {
+    method_call = 1,
+    method_return = 2,
+    error_reply = 3,
+    signal = 4,
+    _,
+};
+
+const HeaderField = enum(u8) {
+    path = 1,
+    interface = 2,
+    member = 3,
+    error_name = 4,
+    reply_serial = 5,
+    destination = 6,
+    sender = 7,
+    signature = 8,
+    _,
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Marshalling
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Appends values in D-Bus wire format; offsets are relative to the start of
+/// the buffer, which must itself be 8-byte aligned within the message
+pub const Encoder = struct {
+    allocator: std.mem.Allocator,
+    buf: std.ArrayList(u8) = .{},
+
+    pub const ArrayMark = struct {
+        len_at: usize,
+        start: usize,
+    };
+
+    pub fn init(allocator: std.mem.Allocator) Encoder {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *Encoder) void {
+        self.buf.deinit(self.allocator);
+    }
+
+    pub fn bytes(self: *const Encoder) []const u8 {
+        return self.buf.items;
+    }
+
+    fn pad(self: *Encoder, alignment: usize) !void {
+        const aligned = std.mem.alignForward(usize, self.buf.items.len, alignment);
+        try self.buf.appendNTimes(self.allocator, 0, aligned - self.buf.items.len);
+    }
+
+    pub fn byte(self: *Encoder, value: u8) !void {
+        try self.buf.append(self.allocator, value);
+    }
+
+    pub fn uint32(self: *Encoder, value: u32) !void {
+        try self.pad(4);
+        var raw: [4]u8 = undefined;
+        std.mem.writeInt(u32, &raw, value, .little);
+        try self.buf.appendSlice(self.allocator, &raw);
+    }
+
+    pub fn int32(self: *Encoder, value: i32) !void {
+        try self.uint32(@bitCast(value));
+    }
+
+    pub fn boolean(self: *Encoder, value: bool) !void {
+        try self.uint32(@intFromBool(value));
+    }
+
+    /// Type 's' (also used for 'o')
+    pub fn string(self: *Encoder, value: []const u8) !void {
+        try self.uint32(@intCast(value.len));
+        try self.buf.appendSlice(self.allocator, value);
+        try self.buf.append(self.allocator, 0);
+    }
+
+    /// Type 'g'
+    pub fn signature(self: *Encoder, value: []const u8) !void {
+        if (value.len > 255) return error.InvalidSignature;
+        try self.byte(@intCast(value.len));
+        try self.buf.appendSlice(self.allocator, value);
+        try self.buf.append(self.allocator, 0);
+    }
+
+    /// Start an array; the length is patched in by `endArray`
+    pub fn beginArray(self: *Encoder, element_alignment: usize) !ArrayMark {
+        try self.uint32(0);
+        const len_at = self.buf.items.len - 4;
+        try self.pad(element_alignment);
+        return .{ .len_at = len_at, .start = self.buf.items.len };
+    }
+
+    pub fn endArray(self: *Encoder, mark: ArrayMark) void {
+        const len: u32 = @intCast(self.buf.items.len - mark.start);
+        std.mem.writeInt(u32, self.buf.items[mark.len_at..][0..4], len, .little);
+    }
+
+    pub fn beginStruct(self: *Encoder) !void {
+        try self.pad(8);
+    }
+
+    /// Type 'ay'
+    pub fn byteArray(self: *Encoder, value: []const u8) !void {
+        const mark = try self.beginArray(1);
+        try self.buf.appendSlice(self.allocator, value);
+        self.endArray(mark);
+    }
+};
+
+/// Reads values in D-Bus wire format (little-endian only)
+pub const Decoder = struct {
+    data: []const u8,
+    pos: usize = 0,
+
+    fn alignTo(self: *Decoder, alignment: usize) !void {
+        self.pos = std.mem.alignForward(usize, self.pos, alignment);
+        if (self.pos > self.data.len) return error.InvalidMessage;
+    }
+
+    pub fn byte(self: *Decoder) !u8 {
+        if (self.pos >= self.data.len) return error.InvalidMessage;
+        defer self.pos += 1;
+        return self.data[self.pos];
+    }
+
+    pub fn uint32(self: *Decoder) !u32 {
+        try self.alignTo(4);
+        if (self.data.len - self.pos < 4) return error.InvalidMessage;
+        defer self.pos += 4;
+        return std.mem.readInt(u32, self.data[self.pos..][0..4], .little);
+    }
+
+    pub fn int32(self: *Decoder) !i32 {
+        return @bitCast(try self.uint32());
+    }
+
+    pub fn boolean(self: *Decoder) !bool {
+        return switch (try self.uint32()) {
+            0 => false,
+            1 => true,
+            else => error.InvalidMessage,
+        };
+    }
+
+    fn terminated(self: *Decoder, len: usize) ![]const u8 {
+        if (self.data.len - self.pos < len + 1 or self.data[self.pos + len] != 0) return error.InvalidMessage;
+        defer self.pos += len + 1;
+        return self.data[self.pos..][0..len];
+    }
+
+    pub fn string(self: *Decoder) ![]const u8 {
+        return self.terminated(try self.uint32());
+    }
+
+    pub fn signature(self: *Decoder) ![]const u8 {
+        return self.terminated(try self.byte());
+    }
+
+    /// Start an array; returns the offset where it ends
+    pub fn beginArray(self: *Decoder, element_alignment: usize) !usize {
+        const len = try self.uint32();
+        try self.alignTo(element_alignment);
+        if (self.data.len - self.pos < len) return error.InvalidMessage;
+        return self.pos + len;
+    }
+
+    pub fn beginStruct(self: *Decoder) !void {
+        try self.alignTo(8);
+    }
+};
+
+/// Header fields of an outgoing message
+const Outgoing = struct {
+    msg_type: MessageType,
+    flags: u8 = 0,
+    path: ?[]const u8 = null,
+    interface: ?[]const u8 = null,
+    member: ?[]const u8 = null,
+    error_name: ?[]const u8 = null,
+    destination: ?[]const u8 = null,
+    reply_serial: ?u32 = null,
+    signature: []const u8 = "",
+};
+
+fn encodeMessage(allocator: std.mem.Allocator, header: Outgoing, serial: u32, body: []const u8) ![]u8 {
+    var enc = Encoder.init(allocator);
+    errdefer enc.deinit();
+
+    try enc.byte('l');
+    try enc.byte(@intFromEnum(header.msg_type));
+    try enc.byte(header.flags);
+    try enc.byte(protocol_version);
+    try enc.uint32(@intCast(body.len));
+    try enc.uint32(serial);
+
+    const fields = try enc.beginArray(8);
+    if (header.path) |v| try encodeField(&enc, .path, "o", v);
+    if (header.interface) |v| try encodeField(&enc, .interface, "s", v);
+    if (header.member) |v| try encodeField(&enc, .member, "s", v);
+    if (header.error_name) |v| try encodeField(&enc, .error_name, "s", v);
+    if (header.destination) |v| try encodeField(&enc, .destination, "s", v);
+    if (header.reply_serial) |v| {
+        try enc.beginStruct();
+        try enc.byte(@intFromEnum(HeaderField.reply_serial));
+        try enc.signature("u");
+        try enc.uint32(v);
+    }
+    if (header.signature.len > 0) {
+        try enc.beginStruct();
+        try enc.byte(@intFromEnum(HeaderField.signature));
+        try enc.signature("g");
+        try enc.signature(header.signature);
+    }
+    enc.endArray(fields);
+
+    try enc.pad(8);
+    try enc.buf.appendSlice(allocator, body);
+    return enc.buf.toOwnedSlice(allocator);
+}
+
+fn encodeField(enc: *Encoder, field: HeaderField, comptime sig: []const u8, value: []const u8) !void {
+    try enc.beginStruct();
+    try enc.byte(@intFromEnum(field));
+    try enc.signature(sig);
+    try enc.string(value);
+}
+
+/// Parsed message; slices point into the raw bytes
+pub const Message = struct {
+    msg_type: MessageType,
+    serial: u32,
+    reply_serial: ?u32 = null,
+    path: ?[]const u8 = null,
+    interface: ?[]const u8 = null,
+    member: ?[]const u8 = null,
+    error_name: ?[]const u8 = null,
+    signature: []const u8 = "",
+    body: []const u8 = "",
+
+    pub fn bodyDecoder(self: Message) Decoder {
+        return .{ .data = self.body };
+    }
+};
+
+fn parseMessage(raw: []const u8) !Message {
+    if (raw.len < fixed_header_size) return error.InvalidMessage;
+    if (raw[0] != 'l') return error.UnsupportedEndianness;
+
+    var d = Decoder{ .data = raw, .pos = 4 };
+    const body_len = try d.uint32();
+    var msg = Message{ .msg_type = @enumFromInt(raw[1]), .serial = try d.uint32() };
+
+    const fields_end = try d.beginArray(8);
+    while (d.pos < fields_end) {
+        try d.beginStruct();
+        const field: HeaderField = @enumFromInt(try d.byte());
+        const sig = try d.signature();
+        if (sig.len != 1) return error.InvalidMessage;
+        switch (sig[0]) {
+            's', 'o' => {
+                const value = try d.string();
+                switch (field) {
+                    .path => msg.path = value,
+                    .interface => msg.interface = value,
+                    .member => msg.member = value,
+                    .error_name => msg.error_name = value,
+                    else => {},
+                }
+            },
+            'g' => {
+                const value = try d.signature();
+                if (field == .signature) msg.signature = value;
+            },
+            'u' => {
+                const value = try d.uint32();
+                if (field == .reply_serial) msg.reply_serial = value;
+            },
+            else => return error.InvalidMessage,
+        }
+    }
+
+    try d.alignTo(8);
+    if (raw.len - d.pos != body_len) return error.InvalidMessage;
+    msg.body = raw[d.pos..];
+    return msg;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Connection
+// ═══════════════════════════════════════════════════════════════════════════
+
+pub const MethodCall = struct {
+    destination: []const u8,
+    path: []const u8,
+    interface: []const u8,
+    member: []const u8,
+    /// Body signature ("" for no arguments)
+    signature: []const u8 = "",
+};
+
+/// A received message and the buffer it lives in
+pub const Reply = struct {
+    raw: []u8,
+    message: Message,
+
+    pub fn deinit(self: *Reply, allocator: std.mem.Allocator) void {
+        allocator.free(self.raw);
+    }
+};
+
+pub const Connection = struct {
+    allocator: std.mem.Allocator,
+    fd: posix.socket_t,
+    serial: u32 = 0,
+    /// Name assigned by the bus in reply to Hello
+    unique_name: ?[]u8 = null,
+    /// Bytes received but not yet consumed
+    rx: std.ArrayList(u8) = .{},
+    timeout_ms: u32 = default_timeout_ms,
+
+    const Self = @This();
+
+    /// Connect, authenticate as the current user and register with the bus
+    pub fn connectUnix(allocator: std.mem.Allocator, path: []const u8) !Self {
+        return connectUnixTimeout(allocator, path, default_timeout_ms);
+    }
+
+    /// `connectUnix` with a receive timeout other than `default_timeout_ms`
+    pub fn connectUnixTimeout(allocator: std.mem.Allocator, path: []const u8, timeout_ms: u32) !Self {
+        const stream = try std.net.connectUnixSocket(path);
+        var self = Self{ .allocator = allocator, .fd = stream.handle, .timeout_ms = timeout_ms };
+        errdefer self.close();
+
+        // Bounds every read; `call` also bounds the wait across skipped messages
+        const tv = posix.timeval{
+            .sec = @intCast(timeout_ms / 1000),
+            .usec = @intCast(@as(u64, timeout_ms % 1000) * 1000),
+        };
+        try posix.setsockopt(self.fd, posix.SOL.SOCKET, posix.SO.RCVTIMEO, std.mem.asBytes(&tv));
+
+        try self.authenticate();
+        try self.hello();
+        return self;
+    }
+
+    pub fn close(self: *Self) void {
+        posix.close(self.fd);
+        self.rx.deinit(self.allocator);
+        if (self.unique_name) |name| self.allocator.free(name);
+        self.unique_name = null;
+    }
+
+    /// SASL EXTERNAL: the bus checks our uid against the socket's peer credentials
+    fn authenticate(self: *Self) !void {
+        const uid = if (builtin.os.tag == .linux) std.os.linux.getuid() else std.c.getuid();
+        var uid_buf: [16]u8 = undefined;
+        const uid_str = try std.fmt.bufPrint(&uid_buf, "{d}", .{uid});
+
+        var hex_buf: [32]u8 = undefined;
+        const hex_digits = "0123456789abcdef";
+        for (uid_str, 0..) |c, i| {
+            hex_buf[2 * i] = hex_digits[c >> 4];
+            hex_buf[2 * i + 1] = hex_digits[c & 0xF];
+        }
+
+        var line_buf: [64]u8 = undefined;
+        try self.writeAll(try std.fmt.bufPrint(&line_buf, "\x00AUTH EXTERNAL {s}\r\n", .{hex_buf[0 .. 2 * uid_str.len]}));
+
+        var reply_buf: [256]u8 = undefined;
+        const reply = try self.readLine(&reply_buf);
+        if (!std.mem.startsWith(u8, reply, "OK ")) return error.AuthenticationFailed;
+        try self.writeAll("BEGIN\r\n");
+    }
+
+    fn hello(self: *Self) !void {
+        var reply = try self.call(.{
+            .destination = "org.freedesktop.DBus",
+            .path = "/org/freedesktop/DBus",
+            .interface = "org.freedesktop.DBus",
+            .member = "Hello",
+        }, "");
+        defer reply.deinit(self.allocator);
+
+        var body = reply.message.bodyDecoder();
+        self.unique_name = try self.allocator.dupe(u8, try body.string());
+    }
+
+    /// Call a method and wait for its reply; the caller frees the reply
+    /// An error reply is logged with its D-Bus error name and returned as error.RemoteError.
+    pub fn call(self: *Self, method: MethodCall, body: []const u8) !Reply {
+        self.serial +%= 1;
+        if (self.serial == 0) self.serial = 1;
+        const serial = self.serial;
+
+        const msg = try encodeMessage(self.allocator, .{
+            .msg_type = .method_call,
+            .path = method.path,
+            .interface = method.interface,
+            .member = method.member,
+            .destination = method.destination,
+            .signature = method.signature,
+        }, serial, body);
+        defer self.allocator.free(msg);
+        try self.writeAll(msg);
+
+        const deadline = std.time.milliTimestamp() + self.timeout_ms;
+        while (true) {
+            if (std.time.milliTimestamp() > deadline) return error.Timeout;
+            var reply = try self.readMessage();
+            const m = reply.message;
+            if (m.reply_serial == serial and (m.msg_type == .method_return or m.msg_type == .error_reply)) {
+                if (m.msg_type == .error_reply) {
+                    std.log.warn("D-Bus {s}.{s} failed: {s}", .{ method.interface, method.member, m.error_name orelse "unknown error" });
+                    reply.deinit(self.allocator);
+                    return error.RemoteError;
+                }
+                return reply;
+            }
+            // Signals and replies to someone else
+            reply.deinit(self.allocator);
+        }
+    }
+
+    /// Send a reply to `request` (used by the stand-in bus in tests)
+    fn sendReturn(self: *Self, request: Message, signature: []const u8, body: []const u8) !void {
+        self.serial +%= 1;
+        const msg = try encodeMessage(self.allocator, .{
+            .msg_type = .method_return,
+            .reply_serial = request.serial,
+            .signature = signature,
+        }, self.serial, body);
+        defer self.allocator.free(msg);
+        try self.writeAll(msg);
+    }
+
+    fn writeAll(self: *Self, data: []const u8) !void {
+        var off: usize = 0;
+        while (off < data.len) {
+            off += try posix.write(self.fd, data[off..]);
+        }
+    }
+
+    /// Receive until at least `len` bytes are buffered
+    fn fill(self: *Self, len: usize) !void {
+        var chunk: [4096]u8 = undefined;
+        while (self.rx.items.len < len) {
+            const n = posix.read(self.fd, &chunk) catch |err| {
+                // SO_RCVTIMEO expired
+                if (err == error.WouldBlock) return error.Timeout;
+                return err;
+            };
+            if (n == 0) return error.ConnectionClosed;
+            try self.rx.appendSlice(self.allocator, chunk[0..n]);
+        }
+    }
+
+    fn consume(self: *Self, len: usize) void {
+        const rest = self.rx.items.len - len;
+        std.mem.copyForwards(u8, self.rx.items[0..rest], self.rx.items[len..]);
+        self.rx.shrinkRetainingCapacity(rest);
+    }
+
+    /// Read one CRLF-terminated line of the authentication exchange
+    fn readLine(self: *Self, out: []u8) ![]const u8 {
+        while (true) {
+            if (std.mem.indexOf(u8, self.rx.items, "\r\n")) |end| {
+                if (end > out.len) return error.AuthenticationFailed;
+                @memcpy(out[0..end], self.rx.items[0..end]);
+                self.consume(end + 2);
+                return out[0..end];
+            }
+            if (self.rx.items.len > out.len) return error.AuthenticationFailed;
+            try self.fill(self.rx.items.len + 1);
+        }
+    }
+
+    fn readMessage(self: *Self) !Reply {
+        try self.fill(fixed_header_size);
+        if (self.rx.items[0] != 'l') return error.UnsupportedEndianness;
+        const body_len = std.mem.readInt(u32, self.rx.items[4..8], .little);
+        const fields_len = std.mem.readInt(u32, self.rx.items[12..16], .little);
+        const header_len = std.mem.alignForward(usize, fixed_header_size + @as(usize, fields_len), 8);
+        const total = header_len + body_len;
+        if (total > max_message_size) return error.MessageTooLarge;
+
+        try self.fill(total);
+        const raw = try self.allocator.dupe(u8, self.rx.items[0..total]);
+        errdefer self.allocator.free(raw);
+        self.consume(total);
+        return .{ .raw = raw, .message = try parseMessage(raw) };
+    }
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// systemd-resolved (org.freedesktop.resolve1)
+// ═══════════════════════════════════════════════════════════════════════════
+
+pub const resolve1 = struct {
+    const destination = "org.freedesktop.resolve1";
+    const path = "/org/freedesktop/resolve1";
+    const interface = "org.freedesktop.resolve1.Manager";
+
+    const af_inet: i32 = 2;
+
+    fn callManager(bus: *Connection, member: []const u8, signature: []const u8, body: []const u8) !void {
+        var reply = try bus.call(.{
+            .destination = destination,
+            .path = path,
+            .interface = interface,
+            .member = member,
+            .signature = signature,
+        }, body);
+        reply.deinit(bus.allocator);
+    }
+
+    /// SetLinkDNS(ia(iay)): per-link DNS servers
+    pub fn setLinkDns(bus: *Connection, ifindex: i32, servers: []const [4]u8) !void {
+        var enc = Encoder.init(bus.allocator);
+        defer enc.deinit();
+
+        try enc.int32(ifindex);
+        const list = try enc.beginArray(8);
+        for (servers) |server| {
+            try enc.beginStruct();
+            try enc.int32(af_inet);
+            try enc.byteArray(&server);
+        }
+        enc.endArray(list);
+
+        try callManager(bus, "SetLinkDNS", "ia(iay)", enc.bytes());
+    }
+
+    /// One entry of a link's domain list
+    pub const LinkDomain = struct {
+        name: []const u8,
+        /// Only route matching queries to the link ("~corp.example"); "." with
+        /// this set makes the link take every query ("~.")
+        routing_only: bool,
+    };
+
+    /// SetLinkDomains(ia(sb)): replaces the link's search and routing-only domains
+    pub fn setLinkDomains(bus: *Connection, ifindex: i32, domains: []const LinkDomain) !void {
+        var enc = Encoder.init(bus.allocator);
+        defer enc.deinit();
+
+        try enc.int32(ifindex);
+        const list = try enc.beginArray(8);
+        for (domains) |domain| {
+            try enc.beginStruct();
+            try enc.string(domain.name);
+            try enc.boolean(domain.routing_only);
+        }
+        enc.endArray(list);
+
+        try callManager(bus, "SetLinkDomains", "ia(sb)", enc.bytes());
+    }
+
+    /// RevertLink(i): drop everything set for the link
+    pub fn revertLink(bus: *Connection, ifindex: i32) !void {
+        var enc = Encoder.init(bus.allocator);
+        defer enc.deinit();
+
+        try enc.int32(ifindex);
+        try callManager(bus, "RevertLink", "i", enc.bytes());
+    }
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Tests
+// ═══════════════════════════════════════════════════════════════════════════
+
+test "message round trip" {
+    const allocator = std.testing.allocator;
+
+    var body = Encoder.init(allocator);
+    defer body.deinit();
+    try body.int32(7);
+    const list = try body.beginArray(8);
+    try body.beginStruct();
+    try body.int32(2);
+    try body.byteArray(&[_]u8{ 10, 21, 0, 1 });
+    body.endArray(list);
+
+    const raw = try encodeMessage(allocator, .{
+        .msg_type = .method_call,
+        .path = "/org/freedesktop/resolve1",
+        .member = "SetLinkDNS",
+        .signature = "ia(iay)",
+    }, 42, body.bytes());
+    defer allocator.free(raw);
+
+    try std.testing.expectEqual(@as(usize, 0), raw.len % 8);
+    const msg = try parseMessage(raw);
+    try std.testing.expectEqual(MessageType.method_call, msg.msg_type);
+    try std.testing.expectEqual(@as(u32, 42), msg.serial);
+    try std.testing.expectEqualStrings("SetLinkDNS", msg.member.?);
+    try std.testing.expectEqualStrings("ia(iay)", msg.signature);
+
+    var d = msg.bodyDecoder();
+    try std.testing.expectEqual(@as(i32, 7), try d.int32());
+    const list_end = try d.beginArray(8);
+    try d.beginStruct();
+    try std.testing.expectEqual(@as(i32, 2), try d.int32());
+    const addr_end = try d.beginArray(1);
+    try std.testing.expectEqualSlices(u8, &[_]u8{ 10, 21, 0, 1 }, d.data[d.pos..addr_end]);
+    try std.testing.expectEqual(list_end, addr_end);
+
+    try std.testing.expectError(error.InvalidMessage, parseMessage(raw[0 .. raw.len - 1]));
+}
+
+/// Stand-in for dbus-daemon and systemd-resolved: accepts one client,
+/// answers every method call and records what it was asked
+const FakeBus = struct {
+    server: std.net.Server,
+    members: [8][32]u8 = undefined,
+    member_lens: [8]usize = undefined,
+    calls: usize = 0,
+    ifindex: i32 = 0,
+    first_server: [4]u8 = .{ 0, 0, 0, 0 },
+    failed: ?anyerror = null,
+
+    fn run(self: *FakeBus) void {
+        self.serve() catch |err| {
+            if (err != error.ConnectionClosed) self.failed = err;
+        };
+    }
+
+    fn serve(self: *FakeBus) !void {
+        const accepted = try self.server.accept();
+        var conn = Connection{ .allocator = std.testing.allocator, .fd = accepted.stream.handle };
+        defer conn.close();
+
+        var line: [128]u8 = undefined;
+        const auth = try conn.readLine(&line);
+        if (!std.mem.startsWith(u8, auth, "\x00AUTH EXTERNAL ")) return error.AuthenticationFailed;
+        try conn.writeAll("OK 0123456789abcdef0123456789abcdef\r\n");
+        if (!std.mem.eql(u8, try conn.readLine(&line), "BEGIN")) return error.AuthenticationFailed;
+
+        while (true) {
+            var request = try conn.readMessage();
+            defer request.deinit(std.testing.allocator);
+            const m = request.message;
+            const member = m.member orelse return error.InvalidMessage;
+
+            if (self.calls < self.members.len) {
+                const len = @min(member.len, 32);
+                @memcpy(self.members[self.calls][0..len], member[0..len]);
+                self.member_lens[self.calls] = len;
+            }
+            self.calls += 1;
+
+            if (std.mem.eql(u8, member, "Hello")) {
+                var body = Encoder.init(std.testing.allocator);
+                defer body.deinit();
+                try body.string(":1.42");
+                try conn.sendReturn(m, "s", body.bytes());
+                continue;
+            }
+            if (std.mem.eql(u8, member, "SetLinkDNS")) {
+                var d = m.bodyDecoder();
+                self.ifindex = try d.int32();
+                _ = try d.beginArray(8);
+                try d.beginStruct();
+                _ = try d.int32();
+                const end = try d.beginArray(1);
+                if (end - d.pos == 4) self.first_server = d.data[d.pos..][0..4].*;
+            }
+            try conn.sendReturn(m, "", "");
+        }
+    }
+
+    fn memberAt(self: *const FakeBus, index: usize) []const u8 {
+        return self.members[index][0..self.member_lens[index]];
+    }
+};
+
+test "resolve1 calls against a stand-in bus" {
+    if (builtin.os.tag == .windows) return error.SkipZigTest;
+    const allocator = std.testing.allocator;
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    const socket_path = try std.fs.path.join(allocator, &.{ dir_path, "bus" });
+    defer allocator.free(socket_path);
+
+    const address = std.net.Address.initUnix(socket_path) catch return error.SkipZigTest; // Path too long
+    var bus = FakeBus{ .server = try address.listen(.{}) };
+    defer bus.server.deinit();
+    const thread = try std.Thread.spawn(.{}, FakeBus.run, .{&bus});
+
+    {
+        var conn = try Connection.connectUnix(allocator, socket_path);
+        defer conn.close();
+        try std.testing.expectEqualStrings(":1.42", conn.unique_name.?);
+
+        try resolve1.setLinkDns(&conn, 5, &.{ .{ 10, 21, 0, 1 }, .{ 1, 1, 1, 1 } });
+        try resolve1.setLinkDomains(&conn, 5, &.{
+            .{ .name = "corp.example", .routing_only = false },
+            .{ .name = ".", .routing_only = true },
+        });
+        try resolve1.revertLink(&conn, 5);
+    }
+    thread.join();
+
+    if (bus.failed) |err| return err;
+    try std.testing.expectEqual(@as(usize, 4), bus.calls);
+    try std.testing.expectEqualStrings("SetLinkDNS", bus.memberAt(1));
+    try std.testing.expectEqualStrings("SetLinkDomains", bus.memberAt(2));
+    try std.testing.expectEqualStrings("RevertLink", bus.memberAt(3));
+    try std.testing.expectEqual(@as(i32, 5), bus.ifindex);
+    try std.testing.expectEqual([4]u8{ 10, 21, 0, 1 }, bus.first_server);
+}
+
+test "a silent bus times out instead of blocking" {
+    if (builtin.os.tag == .windows) return error.SkipZigTest;
+    const allocator = std.testing.allocator;
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    const socket_path = try std.fs.path.join(allocator, &.{ dir_path, "bus" });
+    defer allocator.free(socket_path);
+
+    // Listening but never accepting: the connect succeeds, the AUTH reply never comes
+    const address = std.net.Address.initUnix(socket_path) catch return error.SkipZigTest; // Path too long
+    var server = try address.listen(.{});
+    defer server.deinit();
+
+    try std.testing.expectError(error.Timeout, Connection.connectUnixTimeout(allocator, socket_path, 50));
+}
@@ -6,6 +6,7 @@
 /// RFC 2131: Dynamic Host Configuration Protocol
 /// RFC 2132: DHCP Options and BOOTP Vendor Extensions
 const std = @import("std");
+const headers = @import("headers.zig");
 
 /// DHCP Message Types (RFC 2132, Section 9.6)
 pub const MessageType = enum(u8) {
@@ -82,6 +83,64 @@ pub const DhcpPacket = extern struct {
             .options = [_]u8{0} ** 312,
         };
     }
+
+    /// Size of the packet on the wire (fixed header + full options area)
+    pub const wire_size: usize = headers.Dhcp.size + 312;
+
+    /// Serialize to wire format. Integer fields are written big-endian;
+    /// address fields (ciaddr..giaddr) already hold network-order bytes.
+    pub fn writeTo(self: *const DhcpPacket, out: []u8) !void {
+        if (out.len < wire_size) return error.BufferTooSmall;
+
+        const hdr = try headers.Dhcp.viewMut(out);
+        hdr.set(.op, self.op);
+        hdr.set(.htype, self.htype);
+        hdr.set(.hlen, self.hlen);
+        hdr.set(.hops, self.hops);
+        hdr.set(.xid, self.xid);
+        hdr.set(.secs, self.secs);
+        hdr.set(.flags, self.flags);
+        hdr.set(.ciaddr, @bitCast(self.ciaddr));
+        hdr.set(.yiaddr, @bitCast(self.yiaddr));
+        hdr.set(.siaddr, @bitCast(self.siaddr));
+        hdr.set(.giaddr, @bitCast(self.giaddr));
+        hdr.set(.chaddr, self.chaddr);
+        hdr.set(.sname, self.sname);
+        hdr.set(.file, self.file);
+        hdr.set(.magic, self.magic);
+        @memcpy(out[headers.Dhcp.size..wire_size], &self.options);
+    }
+
+    /// Parse from wire format. Servers commonly send fewer than 312 option
+    /// bytes (BOOTP minimum is 300 bytes total); the remainder is zero-filled.
+    pub fn parse(bytes: []const u8) !DhcpPacket {
+        const hdr = headers.Dhcp.view(bytes) catch return error.InvalidDhcpPacket;
+
+        var packet = DhcpPacket{
+            .op = hdr.get(.op),
+            .htype = hdr.get(.htype),
+            .hlen = hdr.get(.hlen),
+            .hops = hdr.get(.hops),
+            .xid = hdr.get(.xid),
+            .secs = hdr.get(.secs),
+            .flags = hdr.get(.flags),
+            .ciaddr = @bitCast(hdr.get(.ciaddr)),
+            .yiaddr = @bitCast(hdr.get(.yiaddr)),
+            .siaddr = @bitCast(hdr.get(.siaddr)),
+            .giaddr = @bitCast(hdr.get(.giaddr)),
+            .chaddr = hdr.get(.chaddr),
+            .sname = hdr.get(.sname),
+            .file = hdr.get(.file),
+            .magic = hdr.get(.magic),
+            .options = [_]u8{0} ** 312,
+        };
+        if (packet.magic != MAGIC_COOKIE) return error.InvalidDhcpPacket;
+
+        const opts = bytes[headers.Dhcp.size..];
+        const n = @min(opts.len, packet.options.len);
+        @memcpy(packet.options[0..n], opts[0..n]);
+        return packet;
+    }
 };
 
 /// DHCP Lease Information
@@ -123,6 +182,8 @@ pub const DhcpClient = struct {
     transaction_id: u32,
     lease: ?Lease = null,
     state: State,
+    /// Source of transaction IDs
+    prng: std.Random.DefaultPrng,
 
     const Self = @This();
 
@@ -141,13 +202,14 @@ pub const DhcpClient = struct {
 
         // Generate random transaction ID
         var prng = std.Random.DefaultPrng.init(@intCast(std.time.timestamp()));
-        const random = prng.random();
+        const transaction_id = prng.random().int(u32);
 
         self.* = .{
             .allocator = allocator,
             .mac_address = mac_address,
-            .transaction_id = random.int(u32),
+            .transaction_id = transaction_id,
             .state = .INIT,
+            .prng = prng,
         };
         return self;
     }
@@ -248,6 +310,29 @@ pub const DhcpClient = struct {
         return packet;
     }
 
+    /// Create a renewal REQUEST for the bound lease (RFC 2131 §4.3.2, RENEWING)
+    /// The address goes in ciaddr; requested-IP and server-ID must be omitted.
+    /// Each renewal is a new exchange with its own xid (§4.4.5); retransmits
+    /// while RENEWING keep it. The REQUEST is unicast to `lease.server_id`, so
+    /// the broadcast flag stays clear.
+    pub fn createRenewal(self: *Self) !DhcpPacket {
+        const lease = self.lease orelse return error.NoLease;
+        if (self.state != .RENEWING) self.transaction_id = self.prng.random().int(u32);
+
+        var packet = DhcpPacket.init();
+        packet.xid = self.transaction_id;
+        packet.ciaddr = @bitCast(lease.ip_address);
+        @memcpy(packet.chaddr[0..6], &self.mac_address);
+
+        packet.options[0] = @intFromEnum(Option.MESSAGE_TYPE);
+        packet.options[1] = 1;
+        packet.options[2] = @intFromEnum(MessageType.REQUEST);
+        packet.options[3] = @intFromEnum(Option.END);
+
+        self.state = .RENEWING;
+        return packet;
+    }
+
     /// Parse DHCP ACK packet and extract lease info
     pub fn parseAck(self: *Self, packet: *const DhcpPacket) !void {
         if (packet.op != DhcpPacket.BOOTREPLY) return error.InvalidPacket;
@@ -340,6 +425,8 @@ pub const DhcpClient = struct {
         });
         std.log.info("   Lease: {d}s ({d}h)", .{ lease.lease_time, lease.lease_time / 3600 });
 
+        // A renewal ACK replaces the previous lease
+        if (self.lease) |*old| old.deinit(self.allocator);
         self.lease = lease;
         self.state = .BOUND;
     }
@@ -374,6 +461,58 @@ test "DHCP packet creation" {
     try std.testing.expectEqual(DhcpClient.State.SELECTING, client.state);
 }
 
+test "DHCP packet wire round-trip" {
+    const allocator = std.testing.allocator;
+    const mac = [_]u8{ 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+
+    var client = try DhcpClient.init(allocator, mac);
+    defer client.deinit();
+
+    const discover = try client.createDiscover();
+    // Wire format is big-endian regardless of host byte order
+    var wire: [DhcpPacket.wire_size]u8 = undefined;
+    try discover.writeTo(&wire);
+    try std.testing.expectEqual(@as(u32, 0x63825363), std.mem.readInt(u32, wire[236..240], .big));
+    try std.testing.expectEqual(@as(u16, 0x8000), std.mem.readInt(u16, wire[10..12], .big));
+
+    // Short (300-byte) replies still parse
+    const parsed = try DhcpPacket.parse(wire[0..300]);
+    try std.testing.expectEqual(discover.xid, parsed.xid);
+    try std.testing.expectEqual(discover.flags, parsed.flags);
+    try std.testing.expectEqualSlices(u8, &discover.chaddr, &parsed.chaddr);
+    try std.testing.expectEqual(@as(u8, @intFromEnum(Option.MESSAGE_TYPE)), parsed.options[0]);
+}
+
+test "renewal starts a new exchange and is not broadcast" {
+    const allocator = std.testing.allocator;
+    const mac = [_]u8{ 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+
+    var client = try DhcpClient.init(allocator, mac);
+    defer client.deinit();
+    client.lease = .{
+        .ip_address = [_]u8{ 192, 168, 1, 100 },
+        .subnet_mask = [_]u8{ 255, 255, 255, 0 },
+        .gateway = [_]u8{ 192, 168, 1, 1 },
+        .dns_servers = .{},
+        .lease_time = 3600,
+        .renewal_time = 1800,
+        .rebinding_time = 3150,
+        .server_id = [_]u8{ 192, 168, 1, 1 },
+        .obtained_at = std.time.timestamp(),
+    };
+    client.state = .BOUND;
+
+    const acquired_xid = client.transaction_id;
+    const renewal = try client.createRenewal();
+    try std.testing.expect(renewal.xid != acquired_xid);
+    try std.testing.expectEqual(@as(u16, 0), renewal.flags);
+    try std.testing.expectEqual([_]u8{ 192, 168, 1, 100 }, std.mem.toBytes(renewal.ciaddr));
+
+    // A retransmit belongs to the same exchange
+    const retransmit = try client.createRenewal();
+    try std.testing.expectEqual(renewal.xid, retransmit.xid);
+}
+
 test "Lease expiration" {
     const lease = Lease{
         .ip_address = [_]u8{ 192, 168, 1, 100 },
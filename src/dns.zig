@@ -6,9 +6,58 @@
 /// - Platform-specific implementations (resolv.conf, scutil, registry)
 const std = @import("std");
 const builtin = @import("builtin");
+const dbus = @import("dbus.zig");
 
 pub const Ipv4Address = [4]u8;
 
+/// Upper bound when backing up /etc/resolv.conf
+const max_resolv_conf_size = 64 * 1024;
+
+/// Replace `path` in `dir` so readers never see a partial file: write a
+/// temporary file next to it, sync it, then rename it over the original
+/// If `path` is a symlink (resolv.conf usually is, owned by systemd-resolved or
+/// resolvconf), its target is replaced instead, in the target's directory, so
+/// the link survives.
+pub fn writeFileAtomic(dir: std.fs.Dir, path: []const u8, content: []const u8) !void {
+    var link_buf: [std.fs.max_path_bytes]u8 = undefined;
+    _ = dir.readLink(path, &link_buf) catch |err| switch (err) {
+        error.NotLink, error.FileNotFound => return replaceFile(dir, path, content),
+        else => return err,
+    };
+
+    var target_buf: [std.fs.max_path_bytes]u8 = undefined;
+    const target = dir.realpath(path, &target_buf) catch |err| switch (err) {
+        // Dangling link: writing through it creates the target
+        error.FileNotFound => return dir.writeFile(.{ .sub_path = path, .data = content }),
+        else => return err,
+    };
+    var target_dir = try std.fs.openDirAbsolute(std.fs.path.dirname(target) orelse "/", .{});
+    defer target_dir.close();
+    try replaceFile(target_dir, std.fs.path.basename(target), content);
+}
+
+/// Temporary file, sync, rename over `path`
+fn replaceFile(dir: std.fs.Dir, path: []const u8, content: []const u8) !void {
+    var tmp_buf: [std.fs.max_path_bytes]u8 = undefined;
+    const tmp_path = try std.fmt.bufPrint(&tmp_buf, "{s}.taptun-tmp", .{path});
+
+    const file = try dir.createFile(tmp_path, .{ .mode = 0o644 });
+    {
+        errdefer {
+            file.close();
+            dir.deleteFile(tmp_path) catch {};
+        }
+        try file.writeAll(content);
+        try file.sync();
+    }
+    file.close();
+
+    dir.rename(tmp_path, path) catch |err| {
+        dir.deleteFile(tmp_path) catch {};
+        return err;
+    };
+}
+
 /// DNS Configuration
 pub const DnsConfig = struct {
     servers: std.ArrayList(Ipv4Address),
@@ -31,7 +80,21 @@ pub const DnsConfig = struct {
     }
 };
 
+/// Which names go to the VPN's DNS servers
+pub const Domains = struct {
+    /// Search domains, appended to single-label names
+    search: []const []const u8 = &.{},
+    /// Send every query to the VPN's servers ("~." in resolvectl terms), not
+    /// just names under `search`; only systemd-resolved tells the two apart
+    default_route: bool = true,
+};
+
 /// Platform-specific DNS configurator
+/// Every platform provides `setDnsServers(interface, servers, domains)`,
+/// `setDnsServersAsync` with the same arguments, `waitSetup` and `restore`.
+/// Only Linux runs the asynchronous setup on a thread; elsewhere it completes
+/// before returning and `waitSetup` has nothing to wait for. Search domains
+/// are applied on Linux and macOS.
 pub const DnsConfigurator = switch (builtin.os.tag) {
     .macos => MacOSDnsConfigurator,
     .linux => LinuxDnsConfigurator,
@@ -44,6 +107,8 @@ const MacOSDnsConfigurator = struct {
     allocator: std.mem.Allocator,
     original_config: ?DnsConfig = null,
     interface: ?[]const u8 = null,
+    /// Search domains were set and are cleared on restore
+    search_set: bool = false,
 
     const Self = @This();
 
@@ -69,8 +134,8 @@ const MacOSDnsConfigurator = struct {
         return config;
     }
 
-    /// Set DNS servers for interface
-    pub fn setDnsServers(self: *Self, interface: []const u8, servers: []const Ipv4Address) !void {
+    /// Set DNS servers and search domains for interface
+    pub fn setDnsServers(self: *Self, interface: []const u8, servers: []const Ipv4Address, domains: Domains) !void {
         // Save original config
         if (self.original_config == null) {
             self.original_config = try self.getCurrentConfig();
@@ -114,9 +179,38 @@ const MacOSDnsConfigurator = struct {
             return error.DnsConfigurationFailed;
         }
 
+        if (domains.search.len > 0) try self.setSearchDomains(interface, domains.search);
+
         std.log.info("✅ DNS servers configured for {s}", .{interface});
     }
 
+    fn setSearchDomains(self: *Self, interface: []const u8, search: []const []const u8) !void {
+        var argv = std.ArrayList([]const u8){};
+        defer argv.deinit(self.allocator);
+        try argv.appendSlice(self.allocator, &.{ "networksetup", "-setsearchdomains", interface });
+        try argv.appendSlice(self.allocator, search);
+
+        const result = try std.process.Child.run(.{ .allocator = self.allocator, .argv = argv.items });
+        defer self.allocator.free(result.stdout);
+        defer self.allocator.free(result.stderr);
+
+        if (result.term != .Exited or result.term.Exited != 0) {
+            std.log.err("Failed to set search domains: {s}", .{result.stderr});
+            return error.DnsConfigurationFailed;
+        }
+        self.search_set = true;
+    }
+
+    /// Same as `setDnsServers`; the setup finishes before this returns
+    pub fn setDnsServersAsync(self: *Self, interface: []const u8, servers: []const Ipv4Address, domains: Domains) !void {
+        try self.setDnsServers(interface, servers, domains);
+    }
+
+    /// Nothing runs in the background on macOS
+    pub fn waitSetup(self: *Self) !void {
+        _ = self;
+    }
+
     /// Restore original DNS configuration
     pub fn restore(self: *Self) !void {
         if (self.original_config == null or self.interface == null) {
@@ -138,6 +232,16 @@ const MacOSDnsConfigurator = struct {
         defer self.allocator.free(result.stdout);
         defer self.allocator.free(result.stderr);
 
+        if (self.search_set) {
+            const cleared = try std.process.Child.run(.{
+                .allocator = self.allocator,
+                .argv = &[_][]const u8{ "networksetup", "-setsearchdomains", self.interface.?, "empty" },
+            });
+            self.allocator.free(cleared.stdout);
+            self.allocator.free(cleared.stderr);
+            self.search_set = false;
+        }
+
         if (self.original_config) |*config| {
             config.deinit();
             self.original_config = null;
@@ -159,11 +263,21 @@ const MacOSDnsConfigurator = struct {
     }
 };
 
-/// Linux DNS Configuration (using resolvconf or systemd-resolved)
+/// Linux DNS Configuration (systemd-resolved over D-Bus, or /etc/resolv.conf)
 const LinuxDnsConfigurator = struct {
     allocator: std.mem.Allocator,
     original_resolv_conf: ?[]u8 = null,
     interface: ?[]const u8 = null,
+    /// System bus socket (overridable for tests)
+    bus_path: []const u8 = dbus.system_bus_path,
+    /// Link configured through systemd-resolved, reverted on restore
+    resolved_ifindex: ?i32 = null,
+    /// Background setup started by `setDnsServersAsync`
+    setup_thread: ?std.Thread = null,
+    setup_error: ?anyerror = null,
+    owned_interface: ?[]u8 = null,
+    owned_servers: ?[]Ipv4Address = null,
+    owned_search: ?[][]const u8 = null,
 
     const Self = @This();
 
@@ -183,97 +297,145 @@ const LinuxDnsConfigurator = struct {
         };
         defer file.close();
 
-        const content = try file.readToEndAlloc(self.allocator, 4096);
+        const content = try file.readToEndAlloc(self.allocator, max_resolv_conf_size);
         self.original_resolv_conf = content;
         std.log.info("📋 Backed up /etc/resolv.conf", .{});
     }
 
-    /// Set DNS servers for interface
-    pub fn setDnsServers(self: *Self, interface: []const u8, servers: []const Ipv4Address) !void {
+    /// Set DNS servers and domains for interface
+    pub fn setDnsServers(self: *Self, interface: []const u8, servers: []const Ipv4Address, domains: Domains) !void {
         self.interface = interface;
 
         // Try systemd-resolved first
-        if (self.trySystemdResolved(interface, servers)) {
+        if (self.trySystemdResolved(interface, servers, domains)) {
             return;
         }
 
         // Fallback to resolvconf
         try self.backupResolvConf();
 
-        var config = std.ArrayList(u8).init(self.allocator);
-        defer config.deinit();
+        var config = std.ArrayList(u8){};
+        defer config.deinit(self.allocator);
 
         for (servers) |server| {
-            try config.writer().print("nameserver {d}.{d}.{d}.{d}\n", .{
+            var line_buf: [32]u8 = undefined;
+            try config.appendSlice(self.allocator, try std.fmt.bufPrint(&line_buf, "nameserver {d}.{d}.{d}.{d}\n", .{
                 server[0],
                 server[1],
                 server[2],
                 server[3],
-            });
+            }));
+        }
+        if (domains.search.len > 0) {
+            try config.appendSlice(self.allocator, "search");
+            for (domains.search) |domain| {
+                try config.append(self.allocator, ' ');
+                try config.appendSlice(self.allocator, domain);
+            }
+            try config.append(self.allocator, '\n');
         }
-
-        const config_str = try config.toOwnedSlice();
-        defer self.allocator.free(config_str);
 
         std.log.info("Writing DNS configuration to /etc/resolv.conf", .{});
 
-        const file = try std.fs.createFileAbsolute("/etc/resolv.conf", .{});
-        defer file.close();
-
-        try file.writeAll(config_str);
+        var etc = try std.fs.openDirAbsolute("/etc", .{});
+        defer etc.close();
+        try writeFileAtomic(etc, "resolv.conf", config.items);
 
         std.log.info("✅ DNS servers configured", .{});
     }
 
-    /// Try using systemd-resolved
-    fn trySystemdResolved(self: *Self, interface: []const u8, servers: []const Ipv4Address) bool {
-        // Build DNS server list
-        var server_list = std.ArrayList(u8).init(self.allocator);
-        defer server_list.deinit();
+    /// Configure DNS on a background thread so it stays off the connect path
+    /// The arguments are copied; `waitSetup` (or `restore`) joins the thread.
+    pub fn setDnsServersAsync(self: *Self, interface: []const u8, servers: []const Ipv4Address, domains: Domains) !void {
+        try self.waitSetup();
+        self.freeOwned();
+
+        const owned_interface = try self.allocator.dupe(u8, interface);
+        self.owned_interface = owned_interface;
+        const owned_servers = try self.allocator.dupe(Ipv4Address, servers);
+        self.owned_servers = owned_servers;
+        const owned_search = try self.allocator.alloc([]const u8, domains.search.len);
+        @memset(owned_search, "");
+        self.owned_search = owned_search;
+        for (domains.search, owned_search) |domain, *copy| copy.* = try self.allocator.dupe(u8, domain);
+
+        const owned_domains = Domains{ .search = owned_search, .default_route = domains.default_route };
+        self.setup_thread = try std.Thread.spawn(.{}, runSetup, .{ self, owned_interface, owned_servers, owned_domains });
+    }
 
-        for (servers, 0..) |server, i| {
-            if (i > 0) server_list.append(' ') catch return false;
-            server_list.writer().print("{d}.{d}.{d}.{d}", .{
-                server[0],
-                server[1],
-                server[2],
-                server[3],
-            }) catch return false;
+    fn runSetup(self: *Self, interface: []const u8, servers: []const Ipv4Address, domains: Domains) void {
+        self.setDnsServers(interface, servers, domains) catch |err| {
+            std.log.err("Background DNS setup failed: {}", .{err});
+            self.setup_error = err;
+        };
+    }
+
+    /// Wait for a background setup to finish and return its outcome
+    pub fn waitSetup(self: *Self) !void {
+        const thread = self.setup_thread orelse return;
+        thread.join();
+        self.setup_thread = null;
+
+        if (self.setup_error) |err| {
+            self.setup_error = null;
+            return err;
         }
+    }
 
-        const server_str = server_list.toOwnedSlice() catch return false;
-        defer self.allocator.free(server_str);
+    fn freeOwned(self: *Self) void {
+        if (self.owned_interface) |name| self.allocator.free(name);
+        if (self.owned_servers) |servers| self.allocator.free(servers);
+        if (self.owned_search) |search| {
+            for (search) |domain| self.allocator.free(domain);
+            self.allocator.free(search);
+        }
+        self.owned_interface = null;
+        self.owned_servers = null;
+        self.owned_search = null;
+    }
 
-        const result = std.process.Child.run(.{
-            .allocator = self.allocator,
-            .argv = &[_][]const u8{
-                "resolvectl",
-                "dns",
-                interface,
-                server_str,
-            },
-        }) catch return false;
+    /// Try systemd-resolved's D-Bus API (SetLinkDNS, SetLinkDomains) directly
+    fn trySystemdResolved(self: *Self, interface: []const u8, servers: []const Ipv4Address, domains: Domains) bool {
+        const ifindex: i32 = @intCast(std.net.if_nametoindex(interface) catch return false);
+        const link_domains = linkDomains(self.allocator, domains) catch return false;
+        defer self.allocator.free(link_domains);
 
-        defer self.allocator.free(result.stdout);
-        defer self.allocator.free(result.stderr);
+        var bus = dbus.Connection.connectUnix(self.allocator, self.bus_path) catch |err| {
+            std.log.debug("systemd-resolved unavailable ({}), using /etc/resolv.conf", .{err});
+            return false;
+        };
+        defer bus.close();
 
-        if (result.term == .Exited and result.term.Exited == 0) {
-            std.log.info("✅ DNS configured via systemd-resolved", .{});
-            return true;
-        }
+        dbus.resolve1.setLinkDns(&bus, ifindex, servers) catch return false;
+        dbus.resolve1.setLinkDomains(&bus, ifindex, link_domains) catch |err| {
+            std.log.debug("SetLinkDomains failed ({}), using /etc/resolv.conf", .{err});
+            dbus.resolve1.revertLink(&bus, ifindex) catch {};
+            return false;
+        };
+        self.resolved_ifindex = ifindex;
 
-        return false;
+        std.log.info("✅ DNS configured via systemd-resolved", .{});
+        return true;
     }
 
     /// Restore original DNS configuration
     pub fn restore(self: *Self) !void {
+        self.waitSetup() catch {};
+
+        if (self.resolved_ifindex) |ifindex| {
+            var bus = try dbus.Connection.connectUnix(self.allocator, self.bus_path);
+            defer bus.close();
+            try dbus.resolve1.revertLink(&bus, ifindex);
+            self.resolved_ifindex = null;
+            std.log.info("✅ DNS configuration restored", .{});
+        }
+
         if (self.original_resolv_conf) |content| {
             std.log.info("🔄 Restoring /etc/resolv.conf", .{});
 
-            const file = try std.fs.createFileAbsolute("/etc/resolv.conf", .{});
-            defer file.close();
-
-            try file.writeAll(content);
+            var etc = try std.fs.openDirAbsolute("/etc", .{});
+            defer etc.close();
+            try writeFileAtomic(etc, "resolv.conf", content);
 
             self.allocator.free(content);
             self.original_resolv_conf = null;
@@ -290,6 +452,7 @@ const LinuxDnsConfigurator = struct {
         if (self.original_resolv_conf) |content| {
             self.allocator.free(content);
         }
+        self.freeOwned();
 
         self.allocator.destroy(self);
     }
@@ -309,8 +472,9 @@ const WindowsDnsConfigurator = struct {
         return self;
     }
 
-    /// Set DNS servers for interface
-    pub fn setDnsServers(self: *Self, interface: []const u8, servers: []const Ipv4Address) !void {
+    /// Set DNS servers for interface (search domains are not applied on Windows)
+    pub fn setDnsServers(self: *Self, interface: []const u8, servers: []const Ipv4Address, domains: Domains) !void {
+        _ = domains;
         self.interface = interface;
 
         // Save original config (simplified)
@@ -386,6 +550,16 @@ const WindowsDnsConfigurator = struct {
         std.log.info("✅ DNS servers configured for {s}", .{interface});
     }
 
+    /// Same as `setDnsServers`; the setup finishes before this returns
+    pub fn setDnsServersAsync(self: *Self, interface: []const u8, servers: []const Ipv4Address, domains: Domains) !void {
+        try self.setDnsServers(interface, servers, domains);
+    }
+
+    /// Nothing runs in the background on Windows
+    pub fn waitSetup(self: *Self) !void {
+        _ = self;
+    }
+
     /// Restore original DNS configuration
     pub fn restore(self: *Self) !void {
         if (self.interface == null) {
@@ -431,6 +605,17 @@ const WindowsDnsConfigurator = struct {
     }
 };
 
+/// systemd-resolved's domain list for a link: the search domains, plus the
+/// root as a routing-only domain ("~.") when the link takes every query
+fn linkDomains(allocator: std.mem.Allocator, domains: Domains) ![]dbus.resolve1.LinkDomain {
+    const list = try allocator.alloc(dbus.resolve1.LinkDomain, domains.search.len + @intFromBool(domains.default_route));
+    for (domains.search, list[0..domains.search.len]) |name, *entry| {
+        entry.* = .{ .name = name, .routing_only = false };
+    }
+    if (domains.default_route) list[list.len - 1] = .{ .name = ".", .routing_only = true };
+    return list;
+}
+
 /// Unsupported platform stub
 const UnsupportedDnsConfigurator = struct {
     pub fn init(_: std.mem.Allocator) !*UnsupportedDnsConfigurator {
@@ -447,3 +632,50 @@ test "DNS configuration structure" {
 
     try std.testing.expectEqual(@as(usize, 2), config.servers.items.len);
 }
+
+test "link domains add the root as routing-only for the default route" {
+    const allocator = std.testing.allocator;
+
+    const all = try linkDomains(allocator, .{ .search = &.{ "corp.example", "lab.example" } });
+    defer allocator.free(all);
+    try std.testing.expectEqual(@as(usize, 3), all.len);
+    try std.testing.expectEqualStrings("corp.example", all[0].name);
+    try std.testing.expect(!all[1].routing_only);
+    try std.testing.expectEqualStrings(".", all[2].name);
+    try std.testing.expect(all[2].routing_only);
+
+    // Split DNS: only the search domains go to the link
+    const split = try linkDomains(allocator, .{ .search = &.{"corp.example"}, .default_route = false });
+    defer allocator.free(split);
+    try std.testing.expectEqual(@as(usize, 1), split.len);
+}
+
+test "writeFileAtomic replaces the file and leaves no temporary behind" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    try tmp.dir.writeFile(.{ .sub_path = "resolv.conf", .data = "nameserver 192.168.1.1\n" });
+    try writeFileAtomic(tmp.dir, "resolv.conf", "nameserver 10.21.0.1\n");
+
+    var buf: [64]u8 = undefined;
+    const content = try tmp.dir.readFile("resolv.conf", &buf);
+    try std.testing.expectEqualStrings("nameserver 10.21.0.1\n", content);
+    try std.testing.expectError(error.FileNotFound, tmp.dir.access("resolv.conf.taptun-tmp", .{}));
+}
+
+test "writeFileAtomic replaces a symlink's target and keeps the link" {
+    if (builtin.os.tag == .windows) return error.SkipZigTest;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    try tmp.dir.makeDir("run");
+    try tmp.dir.writeFile(.{ .sub_path = "run/stub-resolv.conf", .data = "nameserver 127.0.0.53\n" });
+    try tmp.dir.symLink("run/stub-resolv.conf", "resolv.conf", .{});
+    try writeFileAtomic(tmp.dir, "resolv.conf", "nameserver 10.21.0.1\n");
+
+    var link_buf: [std.fs.max_path_bytes]u8 = undefined;
+    try std.testing.expectEqualStrings("run/stub-resolv.conf", try tmp.dir.readLink("resolv.conf", &link_buf));
+    var buf: [64]u8 = undefined;
+    try std.testing.expectEqualStrings("nameserver 10.21.0.1\n", try tmp.dir.readFile("run/stub-resolv.conf", &buf));
+    try std.testing.expectError(error.FileNotFound, tmp.dir.access("run/stub-resolv.conf.taptun-tmp", .{}));
+}
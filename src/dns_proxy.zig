@@ -0,0 +1,800 @@
+//! In-Path DNS Cache
+//!
+//! Optional stub resolver on the TUN path. UDP/53 queries the host sends into
+//! the tunnel are parsed in place (no copies) and:
+//! - answered locally from a TTL-respecting cache on a hit; the response is
+//!   written back into the TUN with the query's ID and TTLs aged
+//! - coalesced with an identical query already in flight; when the upstream
+//!   response arrives every waiter gets its own copy
+//! - forwarded unchanged otherwise
+//!
+//! Entries in the last `prefetch_percent` of their TTL are refreshed in the
+//! background: the hit is answered from cache and the query is forwarded with
+//! an internal ID, so the refreshed response is cached without reaching the host.
+//!
+//! Memory is bounded by entry count and total response bytes; expired entries
+//! are evicted first, then the least recently used. Eviction scans the table,
+//! which is fine at the sizes used here (hundreds of entries). The in-flight
+//! table shares the entry limit; unanswered queries are swept once it fills.
+//!
+//! A response is only taken from the server and to the port the query went
+//! out on, so an off-path host cannot plant answers with a guessed ID.
+//!
+//! IPv4 only; IPv6 queries and TCP are always forwarded.
+
+const std = @import("std");
+const headers = @import("headers.zig");
+const IpProto = headers.IpProto;
+const checksum = @import("checksum.zig");
+
+pub const dns_port: u16 = 53;
+
+/// Longest wire-format domain name (RFC 1035 §3.1)
+pub const max_name_len = 255;
+
+/// Largest response cached
+pub const max_response_size = 4096;
+
+/// Classic DNS-over-UDP size limit for clients without EDNS
+const plain_udp_limit = 512;
+
+/// Queries that may wait on one upstream query
+const max_waiters = 8;
+
+pub const type_a: u16 = 1;
+pub const type_aaaa: u16 = 28;
+const type_soa: u16 = 6;
+const type_opt: u16 = 41;
+
+// Header flag bits
+pub const flag_qr: u16 = 0x8000;
+const flag_tc: u16 = 0x0200;
+const opcode_mask: u16 = 0x7800;
+const rcode_mask: u16 = 0x000F;
+const rcode_noerror: u16 = 0;
+const rcode_nxdomain: u16 = 3;
+
+pub const Options = struct {
+    max_entries: u32 = 512,
+    max_bytes: usize = 256 * 1024, // Total cached response bytes
+    max_ttl_s: u32 = 86400, // Cap on upstream TTLs
+    negative_ttl_s: u32 = 30, // NXDOMAIN/NODATA without an SOA record
+    prefetch_percent: u8 = 10, // Refresh entries in the last 10% of their TTL
+    inflight_timeout_ms: u32 = 2000, // Stop coalescing onto an unanswered query
+};
+
+/// Zero-copy view of a message's question section
+pub const Question = struct {
+    id: u16,
+    flags: u16,
+    /// Wire-format name including the root label, pointing into the message
+    name: []const u8,
+    qtype: u16,
+    qclass: u16,
+    /// Offset of the first byte after the question
+    end: usize,
+
+    /// Cache key: case-insensitive name, type and class
+    pub fn key(self: Question) u64 {
+        var lower: [max_name_len + 1]u8 = undefined;
+        // Label length bytes are < 64 and unaffected by toLower
+        for (self.name, 0..) |c, i| lower[i] = std.ascii.toLower(c);
+
+        var hasher = std.hash.Wyhash.init(0);
+        hasher.update(lower[0..self.name.len]);
+        hasher.update(std.mem.asBytes(&self.qtype));
+        hasher.update(std.mem.asBytes(&self.qclass));
+        return hasher.final();
+    }
+
+    pub fn matches(self: Question, other: Question) bool {
+        return self.qtype == other.qtype and self.qclass == other.qclass and
+            std.ascii.eqlIgnoreCase(self.name, other.name);
+    }
+};
+
+/// Skip a domain name starting at `start`; returns the offset after it
+fn skipName(msg: []const u8, start: usize, allow_pointer: bool) !usize {
+    var off = start;
+    while (true) {
+        if (off >= msg.len) return error.InvalidPacket;
+        const len = msg[off];
+        if (len == 0) return off + 1;
+        if (len & 0xC0 == 0xC0) {
+            if (!allow_pointer or off + 2 > msg.len) return error.InvalidPacket;
+            return off + 2;
+        }
+        if (len & 0xC0 != 0) return error.InvalidPacket;
+        off += 1 + @as(usize, len);
+        if (off - start > max_name_len) return error.InvalidPacket;
+    }
+}
+
+/// Parse the single question of a query or response
+pub fn parseQuestion(msg: []const u8) !Question {
+    const hdr = try headers.Dns.view(msg);
+    if (hdr.get(.qdcount) != 1) return error.InvalidPacket;
+
+    // Question names are never compressed
+    const name_end = try skipName(msg, headers.Dns.size, false);
+    if (msg.len < name_end + 4) return error.InvalidPacket;
+
+    return .{
+        .id = hdr.get(.id),
+        .flags = hdr.get(.flags),
+        .name = msg[headers.Dns.size..name_end],
+        .qtype = std.mem.readInt(u16, msg[name_end..][0..2], .big),
+        .qclass = std.mem.readInt(u16, msg[name_end + 2 ..][0..2], .big),
+        .end = name_end + 4,
+    };
+}
+
+pub const Section = enum { answer, authority, additional };
+
+/// One resource record, as offsets into the message
+pub const Record = struct {
+    section: Section,
+    rtype: u16,
+    ttl: u32,
+    ttl_offset: usize,
+    rdata: []const u8,
+};
+
+/// Walks the answer, authority and additional sections
+pub const RecordIterator = struct {
+    msg: []const u8,
+    off: usize,
+    index: usize = 0,
+    ancount: usize,
+    nscount: usize,
+    total: usize,
+
+    pub fn init(msg: []const u8, question: Question) RecordIterator {
+        const hdr = headers.Dns.view(msg) catch unreachable;
+        const ancount: usize = hdr.get(.ancount);
+        const nscount: usize = hdr.get(.nscount);
+        return .{
+            .msg = msg,
+            .off = question.end,
+            .ancount = ancount,
+            .nscount = nscount,
+            .total = ancount + nscount + hdr.get(.arcount),
+        };
+    }
+
+    pub fn next(self: *RecordIterator) !?Record {
+        if (self.index == self.total) return null;
+        const section: Section = if (self.index < self.ancount)
+            .answer
+        else if (self.index < self.ancount + self.nscount)
+            .authority
+        else
+            .additional;
+
+        const fixed = try skipName(self.msg, self.off, true);
+        if (self.msg.len < fixed + 10) return error.InvalidPacket;
+
+        const rdlen = std.mem.readInt(u16, self.msg[fixed + 8 ..][0..2], .big);
+        const rdata_start = fixed + 10;
+        if (self.msg.len < rdata_start + rdlen) return error.InvalidPacket;
+
+        self.off = rdata_start + rdlen;
+        self.index += 1;
+        return .{
+            .section = section,
+            .rtype = std.mem.readInt(u16, self.msg[fixed..][0..2], .big),
+            .ttl = std.mem.readInt(u32, self.msg[fixed + 4 ..][0..4], .big),
+            .ttl_offset = fixed + 4,
+            .rdata = self.msg[rdata_start..self.off],
+        };
+    }
+};
+
+/// How long a response may be cached, in seconds (null: do not cache)
+/// Positive answers use the smallest record TTL; negative answers use the
+/// SOA minimum (RFC 2308) or `negative_ttl_s` without one.
+pub fn cacheTtl(msg: []const u8, question: Question, options: Options) !?u32 {
+    const flags = question.flags;
+    if (flags & flag_qr == 0 or flags & flag_tc != 0) return null;
+    const rcode = flags & rcode_mask;
+    if (rcode != rcode_noerror and rcode != rcode_nxdomain) return null;
+
+    const hdr = try headers.Dns.view(msg);
+    const negative = rcode == rcode_nxdomain or hdr.get(.ancount) == 0;
+
+    var ttl: ?u32 = null;
+    var it = RecordIterator.init(msg, question);
+    while (try it.next()) |rec| {
+        if (rec.rtype == type_opt) continue;
+        var rec_ttl = rec.ttl;
+        if (negative and rec.rtype == type_soa and rec.rdata.len >= 4) {
+            const minimum = std.mem.readInt(u32, rec.rdata[rec.rdata.len - 4 ..][0..4], .big);
+            rec_ttl = @min(rec_ttl, minimum);
+        }
+        ttl = @min(ttl orelse rec_ttl, rec_ttl);
+    }
+
+    const result = ttl orelse (if (negative) options.negative_ttl_s else return null);
+    if (result == 0) return null;
+    return @min(result, options.max_ttl_s);
+}
+
+/// Reduce every record TTL by `age_s` (cached responses are served aged)
+fn ageTtls(msg: []u8, question: Question, age_s: u32) !void {
+    var it = RecordIterator.init(msg, question);
+    while (try it.next()) |rec| {
+        if (rec.rtype == type_opt) continue; // OPT "TTL" holds EDNS flags
+        std.mem.writeInt(u32, msg[rec.ttl_offset..][0..4], rec.ttl -| age_s, .big);
+    }
+}
+
+/// Addresses and payload of a UDP/IPv4 datagram
+pub const Datagram = struct {
+    src_ip: u32,
+    dst_ip: u32,
+    src_port: u16,
+    dst_port: u16,
+    payload_offset: usize,
+    payload: []const u8,
+};
+
+pub fn udpDatagram(ip_packet: []const u8) ?Datagram {
+    if (headers.ipVersion(ip_packet) != 4) return null;
+    const ip = headers.Ipv4.view(ip_packet) catch return null;
+    if (ip.get(.protocol) != IpProto.udp) return null;
+    if (ip.get(.flags_fragment) & 0x3FFF != 0) return null; // Fragments
+
+    const ihl = headers.ipv4HeaderLen(ip);
+    const total = @min(ip_packet.len, ip.get(.total_length));
+    if (ihl < headers.Ipv4.size or total < ihl + headers.Udp.size) return null;
+    const udp = headers.Udp.view(ip_packet[ihl..]) catch return null;
+    const udp_len = udp.get(.length);
+    if (udp_len < headers.Udp.size or ihl + udp_len > total) return null;
+
+    const payload_offset = ihl + headers.Udp.size;
+    return .{
+        .src_ip = ip.get(.src_ip),
+        .dst_ip = ip.get(.dst_ip),
+        .src_port = udp.get(.src_port),
+        .dst_port = udp.get(.dst_port),
+        .payload_offset = payload_offset,
+        .payload = ip_packet[payload_offset .. ihl + udp_len],
+    };
+}
+
+/// Replace the DNS ID of a UDP/53 query in place, keeping the UDP checksum valid
+pub fn rewriteQueryId(ip_packet: []u8, id: u16) void {
+    const dg = udpDatagram(ip_packet) orelse return;
+    if (dg.payload.len < headers.Dns.size) return;
+
+    const id_bytes = ip_packet[dg.payload_offset..][0..2];
+    const old_id = std.mem.readInt(u16, id_bytes, .big);
+    std.mem.writeInt(u16, id_bytes, id, .big);
+
+    const cs_bytes = ip_packet[dg.payload_offset - headers.Udp.size + headers.Udp.offsetOf(.checksum) ..][0..2];
+    const old_cs = std.mem.readInt(u16, cs_bytes, .big);
+    if (old_cs == 0) return; // Checksum not used
+    const new_cs = checksum.adjust(old_cs, old_id, id);
+    std.mem.writeInt(u16, cs_bytes, if (new_cs == 0) 0xFFFF else new_cs, .big);
+}
+
+pub const DnsProxy = struct {
+    allocator: std.mem.Allocator,
+    options: Options,
+    entries: std.AutoHashMap(u64, Entry),
+    inflight: std.AutoHashMap(u64, Inflight),
+    bytes: usize = 0,
+    next_id: u16,
+
+    // Counters
+    hits: u64 = 0,
+    misses: u64 = 0,
+    coalesced: u64 = 0,
+    prefetches: u64 = 0,
+    evictions: u64 = 0,
+    inflight_expired: u64 = 0,
+
+    const Self = @This();
+
+    const Entry = struct {
+        response: []u8,
+        stored_ms: i64,
+        ttl_ms: i64,
+        last_used_ms: i64,
+    };
+
+    /// A query waiting on an identical upstream query
+    const Waiter = struct {
+        id: u16,
+        host_ip: u32,
+        host_port: u16,
+        server_ip: u32,
+    };
+
+    const Inflight = struct {
+        upstream_id: u16,
+        /// Where the upstream query went and the port it came from
+        server_ip: u32,
+        host_port: u16,
+        /// Background refresh: the response is cached, not delivered
+        prefetch: bool,
+        started_ms: i64,
+        waiters: [max_waiters]Waiter = undefined,
+        waiter_count: usize = 0,
+    };
+
+    /// What to do with an outgoing packet
+    pub const Action = union(enum) {
+        /// Not handled here: forward unchanged
+        forward,
+        /// Answered from cache or joined an in-flight query: do not forward
+        consumed,
+        /// Answered from cache; also forward the query with this DNS ID to refresh the entry
+        prefetch: u16,
+    };
+
+    pub fn init(allocator: std.mem.Allocator, options: Options) Self {
+        return .{
+            .allocator = allocator,
+            .options = options,
+            .entries = std.AutoHashMap(u64, Entry).init(allocator),
+            .inflight = std.AutoHashMap(u64, Inflight).init(allocator),
+            .next_id = @truncate(@as(u64, @bitCast(std.time.milliTimestamp()))),
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        var it = self.entries.valueIterator();
+        while (it.next()) |entry| self.allocator.free(entry.response);
+        self.entries.deinit();
+        self.inflight.deinit();
+    }
+
+    /// Size the cache and in-flight tables for `max_entries` up front
+    pub fn preallocate(self: *Self) !void {
+        try self.entries.ensureTotalCapacity(self.options.max_entries);
+        try self.inflight.ensureTotalCapacity(self.options.max_entries);
+    }
+
+    /// Handle an IP packet the host is sending into the tunnel
+    /// Local answers are appended to `replies` as IP packets for the TUN,
+    /// allocated with `reply_allocator` (the consumer frees them).
+    pub fn onQuery(self: *Self, ip_packet: []const u8, now_ms: i64, replies: *std.ArrayList([]const u8), reply_allocator: std.mem.Allocator) !Action {
+        const dg = udpDatagram(ip_packet) orelse return .forward;
+        if (dg.dst_port != dns_port) return .forward;
+        const q = parseQuestion(dg.payload) catch return .forward;
+        if (q.flags & (flag_qr | opcode_mask) != 0) return .forward; // Only standard queries
+
+        const hdr = headers.Dns.view(dg.payload) catch unreachable;
+        const edns = hdr.get(.arcount) > 0;
+        const key = q.key();
+
+        if (self.lookup(key, q, now_ms)) |entry| {
+            if (edns or entry.response.len <= plain_udp_limit) {
+                entry.last_used_ms = now_ms;
+                self.hits += 1;
+
+                const age_ms = now_ms - entry.stored_ms;
+                try self.queueReply(replies, reply_allocator, entry.response, q.id, @intCast(@divFloor(age_ms, 1000)), .{
+                    .id = q.id,
+                    .host_ip = dg.src_ip,
+                    .host_port = dg.src_port,
+                    .server_ip = dg.dst_ip,
+                });
+
+                const remaining_ms = entry.ttl_ms - age_ms;
+                if (remaining_ms * 100 < entry.ttl_ms * self.options.prefetch_percent and !self.inflight.contains(key)) {
+                    const id = self.nextId();
+                    if (try self.track(key, .{
+                        .upstream_id = id,
+                        .server_ip = dg.dst_ip,
+                        .host_port = dg.src_port,
+                        .prefetch = true,
+                        .started_ms = now_ms,
+                    }, now_ms)) {
+                        self.prefetches += 1;
+                        return .{ .prefetch = id };
+                    }
+                }
+                return .consumed;
+            }
+        }
+
+        self.misses += 1;
+        if (self.inflight.getPtr(key)) |pending| {
+            if (now_ms - pending.started_ms < self.options.inflight_timeout_ms) {
+                if (pending.waiter_count == max_waiters) return .forward;
+                pending.waiters[pending.waiter_count] = .{
+                    .id = q.id,
+                    .host_ip = dg.src_ip,
+                    .host_port = dg.src_port,
+                    .server_ip = dg.dst_ip,
+                };
+                pending.waiter_count += 1;
+                self.coalesced += 1;
+                return .consumed;
+            }
+        }
+
+        _ = try self.track(key, .{
+            .upstream_id = q.id,
+            .server_ip = dg.dst_ip,
+            .host_port = dg.src_port,
+            .prefetch = false,
+            .started_ms = now_ms,
+        }, now_ms);
+        return .forward;
+    }
+
+    /// Handle an IP packet arriving from the tunnel
+    /// Caches responses to tracked queries and queues copies for coalesced waiters.
+    /// Returns: false if the packet must not be delivered to the host (prefetch response)
+    pub fn onResponse(self: *Self, ip_packet: []const u8, now_ms: i64, replies: *std.ArrayList([]const u8), reply_allocator: std.mem.Allocator) !bool {
+        const dg = udpDatagram(ip_packet) orelse return true;
+        if (dg.src_port != dns_port) return true;
+        const q = parseQuestion(dg.payload) catch return true;
+        if (q.flags & flag_qr == 0) return true;
+
+        const key = q.key();
+        const pending = self.inflight.get(key) orelse return true;
+        if (pending.upstream_id != q.id or pending.server_ip != dg.src_ip or pending.host_port != dg.dst_port) return true;
+        _ = self.inflight.remove(key);
+
+        if (cacheTtl(dg.payload, q, self.options) catch null) |ttl_s| {
+            try self.store(key, dg.payload, ttl_s, now_ms);
+        }
+        for (pending.waiters[0..pending.waiter_count]) |waiter| {
+            try self.queueReply(replies, reply_allocator, dg.payload, waiter.id, 0, waiter);
+        }
+        return !pending.prefetch;
+    }
+
+    /// Number of cached responses
+    pub fn count(self: *const Self) usize {
+        return self.entries.count();
+    }
+
+    fn lookup(self: *Self, key: u64, q: Question, now_ms: i64) ?*Entry {
+        const entry = self.entries.getPtr(key) orelse return null;
+        if (now_ms - entry.stored_ms >= entry.ttl_ms) return null;
+        const cached = parseQuestion(entry.response) catch return null;
+        if (!cached.matches(q)) return null; // Hash collision
+        return entry;
+    }
+
+    /// Record an upstream query, sweeping unanswered ones if the table is full
+    /// Returns: false if every slot holds a live query (forwarded untracked)
+    fn track(self: *Self, key: u64, pending: Inflight, now_ms: i64) !bool {
+        if (!self.inflight.contains(key) and self.inflight.count() >= self.options.max_entries) {
+            self.expireInflight(now_ms);
+            if (self.inflight.count() >= self.options.max_entries) return false;
+        }
+        try self.inflight.put(key, pending);
+        return true;
+    }
+
+    fn expireInflight(self: *Self, now_ms: i64) void {
+        // Removal leaves a tombstone, so the iterator stays valid
+        var it = self.inflight.iterator();
+        while (it.next()) |kv| {
+            if (now_ms - kv.value_ptr.started_ms < self.options.inflight_timeout_ms) continue;
+            self.inflight.removeByPtr(kv.key_ptr);
+            self.inflight_expired += 1;
+        }
+    }
+
+    fn nextId(self: *Self) u16 {
+        self.next_id +%= 1;
+        return self.next_id;
+    }
+
+    fn store(self: *Self, key: u64, response: []const u8, ttl_s: u32, now_ms: i64) !void {
+        if (response.len > max_response_size or response.len > self.options.max_bytes) return;
+
+        if (self.entries.fetchRemove(key)) |old| {
+            self.bytes -= old.value.response.len;
+            self.allocator.free(old.value.response);
+        }
+        while (self.entries.count() >= self.options.max_entries or
+            self.bytes + response.len > self.options.max_bytes)
+        {
+            if (!self.evictOne(now_ms)) return;
+        }
+
+        const copy = try self.allocator.dupe(u8, response);
+        errdefer self.allocator.free(copy);
+        try self.entries.put(key, .{
+            .response = copy,
+            .stored_ms = now_ms,
+            .ttl_ms = @as(i64, ttl_s) * 1000,
+            .last_used_ms = now_ms,
+        });
+        self.bytes += copy.len;
+    }
+
+    /// Evict an expired entry if there is one, else the least recently used
+    fn evictOne(self: *Self, now_ms: i64) bool {
+        var victim: ?u64 = null;
+        var oldest: i64 = std.math.maxInt(i64);
+
+        var it = self.entries.iterator();
+        while (it.next()) |kv| {
+            const entry = kv.value_ptr;
+            if (now_ms - entry.stored_ms >= entry.ttl_ms) {
+                victim = kv.key_ptr.*;
+                break;
+            }
+            if (entry.last_used_ms < oldest) {
+                oldest = entry.last_used_ms;
+                victim = kv.key_ptr.*;
+            }
+        }
+
+        const removed = self.entries.fetchRemove(victim orelse return false).?;
+        self.bytes -= removed.value.response.len;
+        self.allocator.free(removed.value.response);
+        self.evictions += 1;
+        return true;
+    }
+
+    /// Wrap a DNS response in UDP/IPv4 from the server to a waiting host
+    fn queueReply(
+        self: *Self,
+        replies: *std.ArrayList([]const u8),
+        reply_allocator: std.mem.Allocator,
+        response: []const u8,
+        id: u16,
+        age_s: u32,
+        to: Waiter,
+    ) !void {
+        const udp_len = headers.Udp.size + response.len;
+        const total = headers.Ipv4.size + udp_len;
+        const pkt = try reply_allocator.alloc(u8, total);
+        errdefer reply_allocator.free(pkt);
+
+        const ip = try headers.Ipv4.viewMut(pkt);
+        ip.set(.version_ihl, 0x45);
+        ip.set(.tos, 0);
+        ip.set(.total_length, @intCast(total));
+        ip.set(.identification, 0);
+        ip.set(.flags_fragment, 0x4000);
+        ip.set(.ttl, 64);
+        ip.set(.protocol, IpProto.udp);
+        ip.set(.checksum, 0);
+        ip.set(.src_ip, to.server_ip);
+        ip.set(.dst_ip, to.host_ip);
+        ip.set(.checksum, checksum.internet(pkt[0..headers.Ipv4.size]));
+
+        const msg = pkt[headers.Ipv4.size + headers.Udp.size ..];
+        @memcpy(msg, response);
+        std.mem.writeInt(u16, msg[0..2], id, .big);
+        if (age_s > 0) try ageTtls(msg, try parseQuestion(msg), age_s);
+
+        const udp = try headers.Udp.viewMut(pkt[headers.Ipv4.size..]);
+        udp.set(.src_port, dns_port);
+        udp.set(.dst_port, to.host_port);
+        udp.set(.length, @intCast(udp_len));
+        udp.set(.checksum, 0);
+
+        var cs = checksum.Checksum{};
+        cs.addPseudoHeaderV4(to.server_ip, to.host_ip, IpProto.udp, @intCast(udp_len));
+        cs.update(pkt[headers.Ipv4.size..]);
+        const udp_cs = cs.final();
+        udp.set(.checksum, if (udp_cs == 0) 0xFFFF else udp_cs);
+
+        try replies.append(self.allocator, pkt);
+    }
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Tests
+// ═══════════════════════════════════════════════════════════════════════════
+
+const host_ip: u32 = 0x0A150064; // 10.21.0.100
+const server_ip: u32 = 0x0A150001; // 10.21.0.1
+
+/// Build a UDP/IPv4 DNS packet for `example.com` A with one answer of `ttl`
+fn testPacket(buf: []u8, id: u16, src_port: u16, response_ttl: ?u32) []u8 {
+    const name = "\x07example\x03com\x00";
+    var len: usize = headers.Dns.size;
+    const msg = buf[headers.Ipv4.size + headers.Udp.size ..];
+    @memset(msg[0..headers.Dns.size], 0);
+
+    const hdr = headers.Dns.viewMut(msg) catch unreachable;
+    hdr.set(.id, id);
+    hdr.set(.qdcount, 1);
+    @memcpy(msg[len..][0..name.len], name);
+    len += name.len;
+    std.mem.writeInt(u16, msg[len..][0..2], 1, .big); // A
+    std.mem.writeInt(u16, msg[len + 2 ..][0..2], 1, .big); // IN
+    len += 4;
+
+    if (response_ttl) |ttl| {
+        hdr.set(.flags, flag_qr | 0x0180);
+        hdr.set(.ancount, 1);
+        const rr = [_]u8{ 0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01 } ++ [_]u8{0} ** 4 ++ [_]u8{ 0x00, 0x04, 93, 184, 216, 34 };
+        @memcpy(msg[len..][0..rr.len], &rr);
+        std.mem.writeInt(u32, msg[len + 6 ..][0..4], ttl, .big);
+        len += rr.len;
+    }
+
+    const total = headers.Ipv4.size + headers.Udp.size + len;
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.tos, 0);
+    ip.set(.total_length, @intCast(total));
+    ip.set(.flags_fragment, 0);
+    ip.set(.protocol, IpProto.udp);
+    ip.set(.src_ip, if (response_ttl == null) host_ip else server_ip);
+    ip.set(.dst_ip, if (response_ttl == null) server_ip else host_ip);
+
+    const udp = headers.Udp.viewMut(buf[headers.Ipv4.size..]) catch unreachable;
+    udp.set(.src_port, if (response_ttl == null) src_port else dns_port);
+    udp.set(.dst_port, if (response_ttl == null) dns_port else src_port);
+    udp.set(.length, @intCast(headers.Udp.size + len));
+    udp.set(.checksum, 0);
+    return buf[0..total];
+}
+
+fn freeReplies(allocator: std.mem.Allocator, replies: *std.ArrayList([]const u8)) void {
+    for (replies.items) |r| allocator.free(r);
+    replies.deinit(allocator);
+}
+
+test "parseQuestion and cacheTtl" {
+    var buf: [512]u8 = undefined;
+    const response = testPacket(&buf, 0x1234, 40000, 300);
+    const msg = response[headers.Ipv4.size + headers.Udp.size ..];
+
+    const q = try parseQuestion(msg);
+    try std.testing.expectEqual(@as(u16, 0x1234), q.id);
+    try std.testing.expectEqualSlices(u8, "\x07example\x03com\x00", q.name);
+    try std.testing.expectEqual(@as(?u32, 300), try cacheTtl(msg, q, .{}));
+    try std.testing.expectEqual(@as(?u32, 60), try cacheTtl(msg, q, .{ .max_ttl_s = 60 }));
+
+    // Case-insensitive key
+    msg[headers.Dns.size + 1] = 'E';
+    try std.testing.expectEqual(q.key(), (try parseQuestion(msg)).key());
+}
+
+test "DnsProxy answers hits locally with aged TTLs" {
+    const allocator = std.testing.allocator;
+    var proxy = DnsProxy.init(allocator, .{});
+    defer proxy.deinit();
+    var replies = std.ArrayList([]const u8){};
+    defer freeReplies(allocator, &replies);
+
+    var buf: [512]u8 = undefined;
+    try std.testing.expectEqual(DnsProxy.Action.forward, try proxy.onQuery(testPacket(&buf, 1, 40000, null), 0, &replies, allocator));
+    try std.testing.expect(try proxy.onResponse(testPacket(&buf, 1, 40000, 300), 40, &replies, allocator));
+    try std.testing.expectEqual(@as(usize, 1), proxy.count());
+
+    // 100 s later: served from cache with the new ID and TTL 200
+    try std.testing.expectEqual(DnsProxy.Action.consumed, try proxy.onQuery(testPacket(&buf, 2, 40001, null), 100_040, &replies, allocator));
+    try std.testing.expectEqual(@as(usize, 1), replies.items.len);
+
+    const reply = replies.items[0];
+    const dg = udpDatagram(reply).?;
+    try std.testing.expectEqual(@as(u16, 40001), dg.dst_port);
+    try std.testing.expectEqual(server_ip, dg.src_ip);
+    const q = try parseQuestion(dg.payload);
+    try std.testing.expectEqual(@as(u16, 2), q.id);
+    var it = RecordIterator.init(dg.payload, q);
+    try std.testing.expectEqual(@as(u32, 200), (try it.next()).?.ttl);
+
+    // Expired: forwarded again
+    try std.testing.expectEqual(DnsProxy.Action.forward, try proxy.onQuery(testPacket(&buf, 3, 40002, null), 300_040, &replies, allocator));
+}
+
+test "DnsProxy coalesces identical in-flight queries" {
+    const allocator = std.testing.allocator;
+    var proxy = DnsProxy.init(allocator, .{});
+    defer proxy.deinit();
+    var replies = std.ArrayList([]const u8){};
+    defer freeReplies(allocator, &replies);
+
+    var buf: [512]u8 = undefined;
+    try std.testing.expectEqual(DnsProxy.Action.forward, try proxy.onQuery(testPacket(&buf, 10, 40000, null), 0, &replies, allocator));
+    try std.testing.expectEqual(DnsProxy.Action.consumed, try proxy.onQuery(testPacket(&buf, 11, 40001, null), 5, &replies, allocator));
+    try std.testing.expectEqual(DnsProxy.Action.consumed, try proxy.onQuery(testPacket(&buf, 12, 40002, null), 6, &replies, allocator));
+    try std.testing.expectEqual(@as(u64, 2), proxy.coalesced);
+
+    // One upstream response answers all three
+    try std.testing.expect(try proxy.onResponse(testPacket(&buf, 10, 40000, 60), 30, &replies, allocator));
+    try std.testing.expectEqual(@as(usize, 2), replies.items.len);
+    try std.testing.expectEqual(@as(u16, 11), (try parseQuestion(udpDatagram(replies.items[0]).?.payload)).id);
+    try std.testing.expectEqual(@as(u16, 40002), udpDatagram(replies.items[1]).?.dst_port);
+}
+
+test "DnsProxy prefetches near-expiry entries" {
+    const allocator = std.testing.allocator;
+    var proxy = DnsProxy.init(allocator, .{});
+    defer proxy.deinit();
+    var replies = std.ArrayList([]const u8){};
+    defer freeReplies(allocator, &replies);
+
+    var buf: [512]u8 = undefined;
+    _ = try proxy.onQuery(testPacket(&buf, 1, 40000, null), 0, &replies, allocator);
+    _ = try proxy.onResponse(testPacket(&buf, 1, 40000, 100), 0, &replies, allocator);
+
+    // 95 s into a 100 s TTL: answered and refreshed under an internal ID
+    const query = testPacket(&buf, 2, 40001, null);
+    const action = try proxy.onQuery(query, 95_000, &replies, allocator);
+    const prefetch_id = action.prefetch;
+    rewriteQueryId(query, prefetch_id);
+    try std.testing.expectEqual(prefetch_id, (try parseQuestion(udpDatagram(query).?.payload)).id);
+
+    // The refreshed response is cached but not delivered
+    try std.testing.expect(!try proxy.onResponse(testPacket(&buf, prefetch_id, 40001, 100), 95_050, &replies, allocator));
+    try std.testing.expectEqual(DnsProxy.Action.consumed, try proxy.onQuery(testPacket(&buf, 3, 40002, null), 150_000, &replies, allocator));
+}
+
+test "DnsProxy bounds memory by entry count" {
+    const allocator = std.testing.allocator;
+    var proxy = DnsProxy.init(allocator, .{ .max_entries = 4 });
+    defer proxy.deinit();
+    var replies = std.ArrayList([]const u8){};
+    defer freeReplies(allocator, &replies);
+
+    var buf: [512]u8 = undefined;
+    for (0..10) |i| {
+        // Vary the name so every response gets its own entry
+        const query = testPacket(&buf, @intCast(i), 40000, null);
+        query[headers.Ipv4.size + headers.Udp.size + headers.Dns.size + 1] = 'a' + @as(u8, @intCast(i));
+        _ = try proxy.onQuery(query, @intCast(i), &replies, allocator);
+
+        const response = testPacket(&buf, @intCast(i), 40000, 300);
+        response[headers.Ipv4.size + headers.Udp.size + headers.Dns.size + 1] = 'a' + @as(u8, @intCast(i));
+        _ = try proxy.onResponse(response, @intCast(i), &replies, allocator);
+    }
+    try std.testing.expectEqual(@as(usize, 4), proxy.count());
+    try std.testing.expectEqual(@as(u64, 6), proxy.evictions);
+}
+
+test "DnsProxy ignores responses from anywhere but the queried server" {
+    const allocator = std.testing.allocator;
+    var proxy = DnsProxy.init(allocator, .{});
+    defer proxy.deinit();
+    var replies = std.ArrayList([]const u8){};
+    defer freeReplies(allocator, &replies);
+
+    var buf: [512]u8 = undefined;
+    _ = try proxy.onQuery(testPacket(&buf, 7, 40000, null), 0, &replies, allocator);
+
+    // Right ID, wrong source address or destination port: delivered, not cached
+    const spoofed = testPacket(&buf, 7, 40000, 300);
+    (headers.Ipv4.viewMut(spoofed) catch unreachable).set(.src_ip, 0x0A150063);
+    try std.testing.expect(try proxy.onResponse(spoofed, 10, &replies, allocator));
+    const wrong_port = testPacket(&buf, 7, 40001, 300);
+    try std.testing.expect(try proxy.onResponse(wrong_port, 10, &replies, allocator));
+    try std.testing.expectEqual(@as(usize, 0), proxy.count());
+
+    // The real answer is still accepted
+    try std.testing.expect(try proxy.onResponse(testPacket(&buf, 7, 40000, 300), 20, &replies, allocator));
+    try std.testing.expectEqual(@as(usize, 1), proxy.count());
+}
+
+test "DnsProxy caps the in-flight table and sweeps unanswered queries" {
+    const allocator = std.testing.allocator;
+    var proxy = DnsProxy.init(allocator, .{ .max_entries = 4, .inflight_timeout_ms = 100 });
+    defer proxy.deinit();
+    var replies = std.ArrayList([]const u8){};
+    defer freeReplies(allocator, &replies);
+
+    var buf: [512]u8 = undefined;
+    for (0..8) |i| {
+        const query = testPacket(&buf, @intCast(i), 40000, null);
+        query[headers.Ipv4.size + headers.Udp.size + headers.Dns.size + 1] = 'a' + @as(u8, @intCast(i));
+        try std.testing.expectEqual(DnsProxy.Action.forward, try proxy.onQuery(query, @intCast(i), &replies, allocator));
+    }
+    // The last four found the table full of live queries and went untracked
+    try std.testing.expectEqual(@as(usize, 4), proxy.inflight.count());
+    try std.testing.expectEqual(@as(u64, 0), proxy.inflight_expired);
+
+    // Once the first four time out they make room
+    const query = testPacket(&buf, 9, 40000, null);
+    query[headers.Ipv4.size + headers.Udp.size + headers.Dns.size + 1] = 'z';
+    _ = try proxy.onQuery(query, 1_000, &replies, allocator);
+    try std.testing.expectEqual(@as(usize, 1), proxy.inflight.count());
+    try std.testing.expectEqual(@as(u64, 4), proxy.inflight_expired);
+}
@@ -0,0 +1,624 @@
+//! Zero-Downtime Process Handover
+//!
+//! Lets an upgraded daemon take over running tunnels instead of recreating
+//! them. The successor listens on a Unix socket; the old process connects and
+//! sends one message per tunnel carrying the TUN (and queue) fds as SCM_RIGHTS
+//! ancillary data together with a serialized `State`: what the translator has
+//! learned (our IP, gateway IP/MAC, multicast memberships) and the DHCP client
+//! state and lease. The successor adopts the fds and restores the state into a
+//! fresh translator, so the kernel interface, its addresses and routes never
+//! go away and nothing has to be relearned.
+//!
+//! ```zig
+//! // Successor
+//! var listener = try handover.Listener.init(handover_path);
+//! var fds: [handover.max_fds]posix.fd_t = undefined;
+//! const received = try listener.accept(&fds);
+//! const device = try taptun.platform.LinuxTun.adopt(allocator, fds[0]);
+//! const adapter = try taptun.TunAdapter.adopt(allocator, device, options);
+//! try received.state.restore(&adapter.translator);
+//!
+//! // Old process, after its last forwarded packet
+//! try handover.sendTo(handover_path, &.{adapter.getFd()}, handover.State.capture(&adapter.translator, mtu));
+//! ```
+//!
+//! The blackout window is the time between the old process's last forwarded
+//! packet (stamped into the state when it is captured) and the successor's
+//! first one; see `State.blackoutNs`.
+
+const std = @import("std");
+const builtin = @import("builtin");
+const posix = std.posix;
+const L2L3Translator = @import("translator.zig").L2L3Translator;
+const dhcp = @import("dhcp_client.zig");
+const multicast = @import("multicast.zig");
+
+/// Most fds in one handover message (TUN device plus multiqueue fds)
+pub const max_fds = 16;
+
+/// Largest serialized state
+pub const max_state_size = 2048;
+
+const magic: u32 = 0x4F485454; // "TTHO"
+const version: u16 = 1;
+
+const max_dns_servers = 4;
+
+/// DHCP client state worth keeping across a restart
+pub const DhcpState = struct {
+    state: dhcp.DhcpClient.State,
+    transaction_id: u32,
+    started: bool,
+    lease: ?Lease = null,
+
+    pub const Lease = struct {
+        ip_address: [4]u8,
+        subnet_mask: [4]u8,
+        gateway: [4]u8,
+        server_id: [4]u8,
+        lease_time: u32,
+        renewal_time: u32,
+        rebinding_time: u32,
+        obtained_at: i64,
+        dns_servers: [max_dns_servers][4]u8 = undefined,
+        dns_count: u8 = 0,
+    };
+};
+
+/// Everything a successor needs to resume forwarding without relearning
+pub const State = struct {
+    our_mac: [6]u8,
+    our_ip: ?u32 = null,
+    gateway_ip: ?u32 = null,
+    gateway_mac: ?[6]u8 = null,
+    mtu: u32,
+    tunnel_mtu: ?u32 = null,
+    multicast_groups: multicast.Membership = .{},
+    dhcp: ?DhcpState = null,
+    /// Wall clock (ns) when the old process stopped forwarding
+    stopped_ns: i64 = 0,
+
+    /// Snapshot a translator; call after the last packet has been forwarded
+    pub fn capture(translator: *const L2L3Translator, mtu: u32) State {
+        var state = State{
+            .our_mac = translator.options.our_mac,
+            .our_ip = translator.our_ip,
+            .gateway_ip = translator.gateway_ip,
+            .gateway_mac = translator.gateway_mac,
+            .mtu = mtu,
+            .tunnel_mtu = translator.options.tunnel_mtu,
+            .multicast_groups = translator.multicast_groups,
+            .stopped_ns = @intCast(std.time.nanoTimestamp()),
+        };
+
+        if (translator.dhcp_client) |client| {
+            var d = DhcpState{
+                .state = client.state,
+                .transaction_id = client.transaction_id,
+                .started = translator.dhcp_started,
+            };
+            if (client.lease) |lease| {
+                var l = DhcpState.Lease{
+                    .ip_address = lease.ip_address,
+                    .subnet_mask = lease.subnet_mask,
+                    .gateway = lease.gateway,
+                    .server_id = lease.server_id,
+                    .lease_time = lease.lease_time,
+                    .renewal_time = lease.renewal_time,
+                    .rebinding_time = lease.rebinding_time,
+                    .obtained_at = lease.obtained_at,
+                };
+                for (lease.dns_servers.items[0..@min(lease.dns_servers.items.len, max_dns_servers)]) |server| {
+                    l.dns_servers[l.dns_count] = server;
+                    l.dns_count += 1;
+                }
+                d.lease = l;
+            }
+            state.dhcp = d;
+        }
+        return state;
+    }
+
+    /// Load the snapshot into a freshly initialized translator
+    pub fn restore(self: *const State, translator: *L2L3Translator) !void {
+        if (!std.mem.eql(u8, &self.our_mac, &translator.options.our_mac)) return error.MacMismatch;
+        if (translator.dhcp_client != null) return error.InvalidState;
+
+        translator.our_ip = self.our_ip;
+        translator.gateway_ip = self.gateway_ip;
+        translator.gateway_mac = self.gateway_mac;
+        if (self.gateway_mac != null) translator.last_gateway_learn = std.time.milliTimestamp();
+        if (self.tunnel_mtu) |mtu| translator.options.tunnel_mtu = mtu;
+
+        // Joining re-subscribes the MAC filter to each group
+        for (self.multicast_groups.groups[0..self.multicast_groups.count]) |group| {
+            try translator.multicast_groups.join(&translator.mac_filter, group);
+        }
+
+        if (self.dhcp) |d| {
+            const client = try dhcp.DhcpClient.init(translator.allocator, self.our_mac);
+            errdefer translator.allocator.destroy(client);
+            client.state = d.state;
+            client.transaction_id = d.transaction_id;
+
+            if (d.lease) |l| {
+                var dns_servers = std.ArrayList([4]u8){};
+                errdefer dns_servers.deinit(translator.allocator);
+                try dns_servers.appendSlice(translator.allocator, l.dns_servers[0..l.dns_count]);
+                client.lease = .{
+                    .ip_address = l.ip_address,
+                    .subnet_mask = l.subnet_mask,
+                    .gateway = l.gateway,
+                    .dns_servers = dns_servers,
+                    .lease_time = l.lease_time,
+                    .renewal_time = l.renewal_time,
+                    .rebinding_time = l.rebinding_time,
+                    .server_id = l.server_id,
+                    .obtained_at = l.obtained_at,
+                };
+            }
+            translator.dhcp_client = client;
+            translator.dhcp_started = d.started;
+        }
+    }
+
+    /// Time between the old process's last packet and `first_packet_ns` (wall clock)
+    pub fn blackoutNs(self: *const State, first_packet_ns: i64) u64 {
+        return @intCast(@max(first_packet_ns - self.stopped_ns, 0));
+    }
+
+    pub fn encode(self: *const State, out: []u8) ![]u8 {
+        var w = Writer{ .buf = out };
+        try w.int(u32, magic);
+        try w.int(u16, version);
+        try w.bytes(&self.our_mac);
+        try w.optional(u32, self.our_ip);
+        try w.optional(u32, self.gateway_ip);
+        try w.int(u8, @intFromBool(self.gateway_mac != null));
+        try w.bytes(&(self.gateway_mac orelse [_]u8{0} ** 6));
+        try w.int(u32, self.mtu);
+        try w.optional(u32, self.tunnel_mtu);
+
+        try w.int(u8, @intCast(self.multicast_groups.count));
+        for (self.multicast_groups.groups[0..self.multicast_groups.count]) |group| try w.bytes(&group);
+
+        try w.int(u8, @intFromBool(self.dhcp != null));
+        if (self.dhcp) |d| {
+            try w.int(u8, @intFromEnum(d.state));
+            try w.int(u32, d.transaction_id);
+            try w.int(u8, @intFromBool(d.started));
+            try w.int(u8, @intFromBool(d.lease != null));
+            if (d.lease) |l| {
+                try w.bytes(&l.ip_address);
+                try w.bytes(&l.subnet_mask);
+                try w.bytes(&l.gateway);
+                try w.bytes(&l.server_id);
+                try w.int(u32, l.lease_time);
+                try w.int(u32, l.renewal_time);
+                try w.int(u32, l.rebinding_time);
+                try w.int(i64, l.obtained_at);
+                try w.int(u8, l.dns_count);
+                for (l.dns_servers[0..l.dns_count]) |server| try w.bytes(&server);
+            }
+        }
+
+        try w.int(i64, self.stopped_ns);
+        return out[0..w.pos];
+    }
+
+    pub fn decode(data: []const u8) !State {
+        var r = Reader{ .data = data };
+        if (try r.int(u32) != magic) return error.InvalidHandover;
+        if (try r.int(u16) != version) return error.UnsupportedVersion;
+
+        var state = State{ .our_mac = try r.array(6), .mtu = 0 };
+        state.our_ip = try r.optional(u32);
+        state.gateway_ip = try r.optional(u32);
+        const has_gateway_mac = try r.int(u8) != 0;
+        const gateway_mac = try r.array(6);
+        if (has_gateway_mac) state.gateway_mac = gateway_mac;
+        state.mtu = try r.int(u32);
+        state.tunnel_mtu = try r.optional(u32);
+
+        const group_count = try r.int(u8);
+        if (group_count > multicast.max_memberships) return error.InvalidHandover;
+        for (0..group_count) |i| state.multicast_groups.groups[i] = try r.array(16);
+        state.multicast_groups.count = group_count;
+
+        if (try r.int(u8) != 0) {
+            var d = DhcpState{
+                .state = std.meta.intToEnum(dhcp.DhcpClient.State, try r.int(u8)) catch return error.InvalidHandover,
+                .transaction_id = try r.int(u32),
+                .started = try r.int(u8) != 0,
+            };
+            if (try r.int(u8) != 0) {
+                var l = DhcpState.Lease{
+                    .ip_address = try r.array(4),
+                    .subnet_mask = try r.array(4),
+                    .gateway = try r.array(4),
+                    .server_id = try r.array(4),
+                    .lease_time = try r.int(u32),
+                    .renewal_time = try r.int(u32),
+                    .rebinding_time = try r.int(u32),
+                    .obtained_at = try r.int(i64),
+                };
+                l.dns_count = try r.int(u8);
+                if (l.dns_count > max_dns_servers) return error.InvalidHandover;
+                for (0..l.dns_count) |i| l.dns_servers[i] = try r.array(4);
+                d.lease = l;
+            }
+            state.dhcp = d;
+        }
+
+        state.stopped_ns = try r.int(i64);
+        if (r.pos != data.len) return error.InvalidHandover;
+        return state;
+    }
+};
+
+const Writer = struct {
+    buf: []u8,
+    pos: usize = 0,
+
+    fn bytes(self: *Writer, data: []const u8) !void {
+        if (self.buf.len - self.pos < data.len) return error.BufferTooSmall;
+        @memcpy(self.buf[self.pos..][0..data.len], data);
+        self.pos += data.len;
+    }
+
+    fn int(self: *Writer, comptime T: type, value: T) !void {
+        var raw: [@sizeOf(T)]u8 = undefined;
+        std.mem.writeInt(T, &raw, value, .little);
+        try self.bytes(&raw);
+    }
+
+    fn optional(self: *Writer, comptime T: type, value: ?T) !void {
+        try self.int(u8, @intFromBool(value != null));
+        try self.int(T, value orelse 0);
+    }
+};
+
+const Reader = struct {
+    data: []const u8,
+    pos: usize = 0,
+
+    fn array(self: *Reader, comptime n: usize) ![n]u8 {
+        if (self.data.len - self.pos < n) return error.InvalidHandover;
+        defer self.pos += n;
+        return self.data[self.pos..][0..n].*;
+    }
+
+    fn int(self: *Reader, comptime T: type) !T {
+        return std.mem.readInt(T, &try self.array(@sizeOf(T)), .little);
+    }
+
+    fn optional(self: *Reader, comptime T: type) !?T {
+        const present = try self.int(u8) != 0;
+        const value = try self.int(T);
+        return if (present) value else null;
+    }
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Fd passing (SCM_RIGHTS)
+// ═══════════════════════════════════════════════════════════════════════════
+
+const scm_rights = 1;
+
+/// Ancillary data header (struct cmsghdr)
+const CmsgHeader = extern struct {
+    len: usize,
+    level: c_int,
+    type: c_int,
+};
+
+/// Control buffer big enough for `max_fds` descriptors
+const ControlBuffer = struct {
+    bytes: [@sizeOf(CmsgHeader) + max_fds * @sizeOf(posix.fd_t)]u8 align(@alignOf(CmsgHeader)) = undefined,
+};
+
+/// Send `payload` with `fds` attached over a connected Unix socket
+pub fn sendFds(sock: posix.socket_t, fds: []const posix.fd_t, payload: []const u8) !void {
+    if (builtin.os.tag != .linux) return error.UnsupportedPlatform;
+    if (fds.len == 0 or fds.len > max_fds or payload.len == 0) return error.InvalidArgument;
+
+    var control = ControlBuffer{};
+    const control_len = @sizeOf(CmsgHeader) + fds.len * @sizeOf(posix.fd_t);
+    const header: *CmsgHeader = @ptrCast(&control.bytes);
+    header.* = .{ .len = control_len, .level = posix.SOL.SOCKET, .type = scm_rights };
+    @memcpy(control.bytes[@sizeOf(CmsgHeader)..control_len], std.mem.sliceAsBytes(fds));
+
+    const iov = [_]posix.iovec_const{.{ .base = payload.ptr, .len = payload.len }};
+    const msg = posix.msghdr_const{
+        .name = null,
+        .namelen = 0,
+        .iov = &iov,
+        .iovlen = iov.len,
+        .control = &control.bytes,
+        .controllen = @intCast(control_len),
+        .flags = 0,
+    };
+    const sent = try posix.sendmsg(sock, &msg, 0);
+    if (sent != payload.len) return error.ShortWrite;
+}
+
+pub const Received = struct {
+    fd_count: usize,
+    payload_len: usize,
+};
+
+/// Receive one message and the fds attached to it
+/// Received fds are owned by the caller.
+pub fn recvFds(sock: posix.socket_t, fds_out: []posix.fd_t, payload_buf: []u8) !Received {
+    if (builtin.os.tag != .linux) return error.UnsupportedPlatform;
+    const linux = std.os.linux;
+
+    var control = ControlBuffer{};
+    var iov = [_]posix.iovec{.{ .base = payload_buf.ptr, .len = payload_buf.len }};
+    var msg = linux.msghdr{
+        .name = null,
+        .namelen = 0,
+        .iov = &iov,
+        .iovlen = iov.len,
+        .control = &control.bytes,
+        .controllen = control.bytes.len,
+        .flags = 0,
+    };
+
+    const rc = linux.recvmsg(sock, &msg, linux.MSG.CMSG_CLOEXEC);
+    switch (linux.E.init(rc)) {
+        .SUCCESS => {},
+        .INTR, .AGAIN => return error.WouldBlock,
+        else => |errno| return posix.unexpectedErrno(errno),
+    }
+    if (rc == 0) return error.ConnectionClosed;
+
+    var count: usize = 0;
+    if (msg.controllen >= @sizeOf(CmsgHeader)) {
+        const header: *const CmsgHeader = @ptrCast(&control.bytes);
+        if (header.level == posix.SOL.SOCKET and header.type == scm_rights and header.len >= @sizeOf(CmsgHeader)) {
+            const data = control.bytes[@sizeOf(CmsgHeader)..@min(header.len, control.bytes.len)];
+            const received = std.mem.bytesAsSlice(posix.fd_t, data[0 .. data.len - data.len % @sizeOf(posix.fd_t)]);
+            for (received) |fd| {
+                if (count < fds_out.len) {
+                    fds_out[count] = fd;
+                    count += 1;
+                } else {
+                    posix.close(fd); // No room: do not leak it
+                }
+            }
+        }
+    }
+    if (msg.flags & linux.MSG.TRUNC != 0 or msg.flags & linux.MSG.CTRUNC != 0) {
+        for (fds_out[0..count]) |fd| posix.close(fd);
+        return error.MessageTruncated;
+    }
+    return .{ .fd_count = count, .payload_len = rc };
+}
+
+/// Old process: connect to the successor and hand over one tunnel
+pub fn sendTo(path: []const u8, fds: []const posix.fd_t, state: State) !void {
+    const stream = try std.net.connectUnixSocket(path);
+    defer stream.close();
+
+    var buf: [max_state_size]u8 = undefined;
+    try sendFds(stream.handle, fds, try state.encode(&buf));
+}
+
+pub const Handover = struct {
+    state: State,
+    fd_count: usize,
+};
+
+/// Successor side: accepts handovers from the previous process
+pub const Listener = struct {
+    server: std.net.Server,
+
+    pub fn init(path: []const u8) !Listener {
+        // A stale socket from an earlier upgrade would make bind fail
+        std.fs.deleteFileAbsolute(path) catch {};
+        const address = try std.net.Address.initUnix(path);
+        return .{ .server = try address.listen(.{}) };
+    }
+
+    pub fn deinit(self: *Listener) void {
+        self.server.deinit();
+    }
+
+    /// Wait for one tunnel; its fds are stored in `fds_out`
+    pub fn accept(self: *Listener, fds_out: []posix.fd_t) !Handover {
+        const connection = try self.server.accept();
+        defer connection.stream.close();
+
+        var buf: [max_state_size]u8 = undefined;
+        const received = try recvFds(connection.stream.handle, fds_out, &buf);
+        errdefer for (fds_out[0..received.fd_count]) |fd| posix.close(fd);
+
+        return .{ .state = try State.decode(buf[0..received.payload_len]), .fd_count = received.fd_count };
+    }
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Tests
+// ═══════════════════════════════════════════════════════════════════════════
+
+const test_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+
+fn testTranslator(allocator: std.mem.Allocator) !L2L3Translator {
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = test_mac, .tunnel_mtu = 1400 });
+    errdefer translator.deinit();
+
+    translator.setOurIp(0x0A150064);
+    translator.setGateway(0x0A150001);
+    translator.gateway_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0xFE };
+    try translator.multicast_groups.join(&translator.mac_filter, multicast.groupFromIpv4(0xE00000FB)); // 224.0.0.251
+
+    const client = try dhcp.DhcpClient.init(allocator, test_mac);
+    client.state = .BOUND;
+    var dns_servers = std.ArrayList([4]u8){};
+    try dns_servers.append(allocator, .{ 10, 21, 0, 1 });
+    client.lease = .{
+        .ip_address = .{ 10, 21, 0, 100 },
+        .subnet_mask = .{ 255, 255, 0, 0 },
+        .gateway = .{ 10, 21, 0, 1 },
+        .dns_servers = dns_servers,
+        .lease_time = 7200,
+        .renewal_time = 3600,
+        .rebinding_time = 6300,
+        .server_id = .{ 10, 21, 0, 1 },
+        .obtained_at = 1_700_000_000,
+    };
+    translator.dhcp_client = client;
+    translator.dhcp_started = true;
+    return translator;
+}
+
+test "State round trip restores translator, DHCP and neighbor state" {
+    const allocator = std.testing.allocator;
+    var old = try testTranslator(allocator);
+    defer old.deinit();
+
+    var buf: [max_state_size]u8 = undefined;
+    const encoded = try State.capture(&old, 1500).encode(&buf);
+    const state = try State.decode(encoded);
+
+    var successor = try L2L3Translator.init(allocator, .{ .our_mac = test_mac });
+    defer successor.deinit();
+    try state.restore(&successor);
+
+    try std.testing.expectEqual(old.our_ip, successor.our_ip);
+    try std.testing.expectEqual(old.gateway_ip, successor.gateway_ip);
+    try std.testing.expectEqual(old.gateway_mac, successor.gateway_mac);
+    try std.testing.expectEqual(@as(?u32, 1400), successor.options.tunnel_mtu);
+    try std.testing.expectEqual(@as(usize, 1), successor.multicast_groups.count);
+    try std.testing.expect(successor.mac_filter.accept(&[_]u8{ 0x01, 0x00, 0x5E, 0x00, 0x00, 0xFB }));
+
+    const client = successor.dhcp_client.?;
+    try std.testing.expectEqual(dhcp.DhcpClient.State.BOUND, client.state);
+    try std.testing.expectEqual(old.dhcp_client.?.transaction_id, client.transaction_id);
+    try std.testing.expectEqual([4]u8{ 10, 21, 0, 100 }, client.lease.?.ip_address);
+    try std.testing.expectEqual(@as(usize, 1), client.lease.?.dns_servers.items.len);
+
+    try std.testing.expectError(error.InvalidHandover, State.decode(encoded[0 .. encoded.len - 1]));
+}
+
+test "handover passes fds and state to a successor" {
+    if (builtin.os.tag != .linux) return error.SkipZigTest;
+    const allocator = std.testing.allocator;
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    const socket_path = try std.fs.path.join(allocator, &.{ dir_path, "handover" });
+    defer allocator.free(socket_path);
+
+    var listener = Listener.init(socket_path) catch return error.SkipZigTest; // Path too long
+    defer listener.deinit();
+
+    // A pipe stands in for the TUN fd: data written through the handed-over
+    // write end must come out of the read end the old process kept
+    const pipe = try posix.pipe();
+    defer posix.close(pipe[0]);
+
+    var old = try testTranslator(allocator);
+    defer old.deinit();
+    const state = State.capture(&old, 1500);
+
+    const Sender = struct {
+        fn run(path: []const u8, fd: posix.fd_t, s: State) void {
+            sendTo(path, &.{fd}, s) catch |err| std.debug.panic("handover send failed: {}", .{err});
+        }
+    };
+    const thread = try std.Thread.spawn(.{}, Sender.run, .{ socket_path, pipe[1], state });
+
+    var fds: [max_fds]posix.fd_t = undefined;
+    const received = try listener.accept(&fds);
+    thread.join();
+    posix.close(pipe[1]); // The old process exits; the successor's copy stays open
+
+    try std.testing.expectEqual(@as(usize, 1), received.fd_count);
+    defer posix.close(fds[0]);
+    _ = try posix.write(fds[0], "resume");
+    var out: [6]u8 = undefined;
+    try std.testing.expectEqual(@as(usize, 6), try posix.read(pipe[0], &out));
+    try std.testing.expectEqualStrings("resume", &out);
+
+    try std.testing.expectEqual(state.our_ip, received.state.our_ip);
+    const blackout = received.state.blackoutNs(@intCast(std.time.nanoTimestamp()));
+    try std.testing.expect(blackout < 10 * std.time.ns_per_s);
+}
+
+test "a successor adapter adopts a handed-over TUN device and forwards from it" {
+    if (builtin.os.tag != .linux) return error.SkipZigTest;
+    const allocator = std.testing.allocator;
+    const platform = @import("platform/linux.zig");
+    const Adapter = @import("tun_adapter.zig").GenericTunAdapter(platform.LinuxTun);
+
+    // Needs /dev/net/tun and CAP_NET_ADMIN
+    const old_device = platform.LinuxTunDevice.open(allocator, .{}) catch return error.SkipZigTest;
+    var old_closed = false;
+    defer if (!old_closed) old_device.close();
+    old_device.setIpAddress("10.213.0.1", "255.255.255.0") catch return error.SkipZigTest;
+    try old_device.up();
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    const socket_path = try std.fs.path.join(allocator, &.{ dir_path, "handover" });
+    defer allocator.free(socket_path);
+
+    var listener = Listener.init(socket_path) catch return error.SkipZigTest; // Path too long
+    defer listener.deinit();
+
+    var old = try testTranslator(allocator);
+    defer old.deinit();
+    const Sender = struct {
+        fn run(path: []const u8, fd: posix.fd_t, s: State) void {
+            sendTo(path, &.{fd}, s) catch |err| std.debug.panic("handover send failed: {}", .{err});
+        }
+    };
+    const thread = try std.Thread.spawn(.{}, Sender.run, .{ socket_path, old_device.fd, State.capture(&old, 1500) });
+
+    var fds: [max_fds]posix.fd_t = undefined;
+    const received = try listener.accept(&fds);
+    thread.join();
+    // The old process exits; the interface lives on through the successor's fd
+    old_device.close();
+    old_closed = true;
+
+    var device = try platform.LinuxTun.adopt(allocator, fds[0]);
+    const adapter = Adapter.adopt(allocator, device, .{ .translator = .{ .our_mac = test_mac } }) catch |err| {
+        device.close();
+        return err;
+    };
+    defer adapter.close();
+    try received.state.restore(&adapter.translator);
+    try std.testing.expectEqual(@as(?u32, 0x0A150064), adapter.translator.our_ip);
+
+    // Traffic the kernel routes into the interface comes out of the adopted fd,
+    // addressed to the gateway MAC the old process had learned
+    const sock = try posix.socket(posix.AF.INET, posix.SOCK.DGRAM, 0);
+    defer posix.close(sock);
+    const dest = std.net.Address.initIp4(.{ 10, 213, 0, 2 }, 9);
+    _ = try posix.sendto(sock, "resume", 0, &dest.any, dest.getOsSockLen());
+
+    var buffer: [2048]u8 = undefined;
+    const deadline = std.time.milliTimestamp() + 2000;
+    while (true) {
+        if (std.time.milliTimestamp() > deadline) return error.Timeout;
+        const frame = adapter.readEthernet(&buffer) catch |err| {
+            if (err == error.WouldBlock) {
+                std.Thread.sleep(std.time.ns_per_ms);
+                continue;
+            }
+            return err;
+        };
+        // Skip IPv6 chatter from the interface coming up
+        if (std.mem.readInt(u16, frame[12..14], .big) != 0x0800) continue;
+        if (!std.mem.endsWith(u8, frame, "resume")) continue;
+        try std.testing.expectEqualSlices(u8, &[_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0xFE }, frame[0..6]);
+        break;
+    }
+}
@@ -0,0 +1,430 @@
+//! Wire Header Layouts
+//!
+//! Comptime-generated views over on-the-wire protocol headers.
+//!
+//! A header is described by a plain struct whose fields are listed in wire
+//! order. `Header` computes every field offset at compile time and exposes
+//! big-endian accessors, so `ip.get(.src_ip)` compiles to the same load as
+//! `std.mem.readInt(u32, buf[12..16], .big)`. The buffer length is checked once
+//! when the view is created; individual accessors never re-check bounds.
+//!
+//! Supported field types: unsigned whole-byte integers (u8, u16, u32, ...)
+//! and byte arrays ([N]u8).
+
+const std = @import("std");
+
+/// EtherType values used by the translator
+pub const EtherType = struct {
+    pub const ipv4: u16 = 0x0800;
+    pub const arp: u16 = 0x0806;
+    pub const ipv6: u16 = 0x86DD;
+};
+
+/// IP protocol / IPv6 next-header numbers
+pub const IpProto = struct {
+    pub const icmp: u8 = 1;
+    pub const igmp: u8 = 2;
+    pub const tcp: u8 = 6;
+    pub const udp: u8 = 17;
+    pub const icmpv6: u8 = 58;
+
+    // IPv6 extension headers (RFC 8200 §4)
+    pub const ipv6_hop_by_hop: u8 = 0;
+    pub const ipv6_routing: u8 = 43;
+    pub const ipv6_fragment: u8 = 44;
+    pub const ipv6_auth: u8 = 51;
+    pub const ipv6_dest_opts: u8 = 60;
+};
+
+/// Number of bytes a field type occupies on the wire
+fn wireSize(comptime T: type) usize {
+    return switch (@typeInfo(T)) {
+        .int => |info| blk: {
+            if (info.signedness != .unsigned or info.bits % 8 != 0) {
+                @compileError("header integer fields must be unsigned whole bytes, found " ++ @typeName(T));
+            }
+            break :blk info.bits / 8;
+        },
+        .array => |info| blk: {
+            if (info.child != u8) {
+                @compileError("header array fields must be [N]u8, found " ++ @typeName(T));
+            }
+            break :blk info.len;
+        },
+        else => @compileError("unsupported header field type " ++ @typeName(T)),
+    };
+}
+
+inline fn load(comptime T: type, bytes: *const [wireSize(T)]u8) T {
+    return switch (@typeInfo(T)) {
+        .int => std.mem.readInt(T, bytes, .big),
+        .array => bytes.*,
+        else => unreachable,
+    };
+}
+
+inline fn store(comptime T: type, bytes: *[wireSize(T)]u8, value: T) void {
+    switch (@typeInfo(T)) {
+        .int => std.mem.writeInt(T, bytes, value, .big),
+        .array => bytes.* = value,
+        else => unreachable,
+    }
+}
+
+/// Generate a header layout from a wire-order field description
+pub fn Header(comptime Spec: type) type {
+    const spec_fields = @typeInfo(Spec).@"struct".fields;
+
+    return struct {
+        /// Header size on the wire (no padding between fields)
+        pub const size: usize = blk: {
+            var total: usize = 0;
+            for (spec_fields) |f| total += wireSize(f.type);
+            break :blk total;
+        };
+
+        pub const Field = std.meta.FieldEnum(Spec);
+
+        /// Host type of a field (integers are returned in host byte order)
+        pub fn FieldType(comptime field: Field) type {
+            return @FieldType(Spec, @tagName(field));
+        }
+
+        /// Byte offset of a field from the start of the header
+        pub fn offsetOf(comptime field: Field) usize {
+            return comptime blk: {
+                var off: usize = 0;
+                for (spec_fields) |f| {
+                    if (std.mem.eql(u8, f.name, @tagName(field))) break :blk off;
+                    off += wireSize(f.type);
+                }
+                unreachable;
+            };
+        }
+
+        /// Read-only view
+        pub const View = struct {
+            bytes: *const [size]u8,
+
+            pub inline fn get(self: View, comptime field: Field) FieldType(field) {
+                const T = FieldType(field);
+                return load(T, self.bytes[comptime offsetOf(field)..][0..comptime wireSize(T)]);
+            }
+
+            /// Raw bytes of a field (no byte-order conversion)
+            pub inline fn raw(self: View, comptime field: Field) *const [wireSize(FieldType(field))]u8 {
+                return self.bytes[comptime offsetOf(field)..][0..comptime wireSize(FieldType(field))];
+            }
+        };
+
+        /// Writable view
+        pub const MutView = struct {
+            bytes: *[size]u8,
+
+            pub inline fn get(self: MutView, comptime field: Field) FieldType(field) {
+                return self.asConst().get(field);
+            }
+
+            pub inline fn set(self: MutView, comptime field: Field, value: FieldType(field)) void {
+                const T = FieldType(field);
+                store(T, self.bytes[comptime offsetOf(field)..][0..comptime wireSize(T)], value);
+            }
+
+            pub inline fn raw(self: MutView, comptime field: Field) *[wireSize(FieldType(field))]u8 {
+                return self.bytes[comptime offsetOf(field)..][0..comptime wireSize(FieldType(field))];
+            }
+
+            pub inline fn asConst(self: MutView) View {
+                return .{ .bytes = self.bytes };
+            }
+        };
+
+        /// Create a read-only view; fails if the buffer is shorter than the header
+        pub inline fn view(buf: []const u8) error{InvalidPacket}!View {
+            if (buf.len < size) return error.InvalidPacket;
+            return .{ .bytes = buf[0..size] };
+        }
+
+        /// Create a writable view; fails if the buffer is shorter than the header
+        pub inline fn viewMut(buf: []u8) error{InvalidPacket}!MutView {
+            if (buf.len < size) return error.InvalidPacket;
+            return .{ .bytes = buf[0..size] };
+        }
+    };
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Protocol Headers
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Ethernet II header (14 bytes)
+pub const Ethernet = Header(struct {
+    dst_mac: [6]u8,
+    src_mac: [6]u8,
+    ethertype: u16,
+});
+
+/// ARP for IPv4 over Ethernet (28 bytes, RFC 826)
+pub const Arp = Header(struct {
+    hardware_type: u16,
+    protocol_type: u16,
+    hardware_size: u8,
+    protocol_size: u8,
+    opcode: u16,
+    sender_mac: [6]u8,
+    sender_ip: u32,
+    target_mac: [6]u8,
+    target_ip: u32,
+});
+
+/// IPv4 header without options (20 bytes, RFC 791)
+pub const Ipv4 = Header(struct {
+    version_ihl: u8,
+    tos: u8,
+    total_length: u16,
+    identification: u16,
+    flags_fragment: u16,
+    ttl: u8,
+    protocol: u8,
+    checksum: u16,
+    src_ip: u32,
+    dst_ip: u32,
+});
+
+/// IPv6 fixed header (40 bytes, RFC 8200)
+pub const Ipv6 = Header(struct {
+    version_class_flow: u32,
+    payload_length: u16,
+    next_header: u8,
+    hop_limit: u8,
+    src_ip: [16]u8,
+    dst_ip: [16]u8,
+});
+
+/// UDP header (8 bytes, RFC 768)
+pub const Udp = Header(struct {
+    src_port: u16,
+    dst_port: u16,
+    length: u16,
+    checksum: u16,
+});
+
+/// TCP header without options (20 bytes, RFC 9293)
+pub const Tcp = Header(struct {
+    src_port: u16,
+    dst_port: u16,
+    seq: u32,
+    ack: u32,
+    data_offset: u8,
+    flags: u8,
+    window: u16,
+    checksum: u16,
+    urgent: u16,
+});
+
+/// ICMP / ICMPv6 message header (8 bytes, RFC 792 / RFC 4443)
+/// `param` is the type-specific word: next-hop MTU for Fragmentation Needed
+/// (low 16 bits) and Packet Too Big, unused for most other errors.
+pub const Icmp = Header(struct {
+    msg_type: u8,
+    code: u8,
+    checksum: u16,
+    param: u32,
+});
+
+/// DNS message header (12 bytes, RFC 1035 §4.1.1)
+pub const Dns = Header(struct {
+    id: u16,
+    flags: u16,
+    qdcount: u16,
+    ancount: u16,
+    nscount: u16,
+    arcount: u16,
+});
+
+/// DHCP/BOOTP fixed header up to and including the magic cookie (240 bytes, RFC 2131)
+pub const Dhcp = Header(struct {
+    op: u8,
+    htype: u8,
+    hlen: u8,
+    hops: u8,
+    xid: u32,
+    secs: u16,
+    flags: u16,
+    ciaddr: [4]u8,
+    yiaddr: [4]u8,
+    siaddr: [4]u8,
+    giaddr: [4]u8,
+    chaddr: [16]u8,
+    sname: [64]u8,
+    file: [128]u8,
+    magic: u32,
+});
+
+/// IP version nibble of a raw L3 packet (0 if empty)
+pub inline fn ipVersion(packet: []const u8) u4 {
+    if (packet.len == 0) return 0;
+    return @intCast(packet[0] >> 4);
+}
+
+/// IPv4 header length in bytes, from the IHL field
+pub inline fn ipv4HeaderLen(ip: Ipv4.View) usize {
+    return @as(usize, ip.get(.version_ihl) & 0x0F) * 4;
+}
+
+/// True if the IPv4 Don't Fragment bit is set
+pub inline fn ipv4DontFragment(ip: Ipv4.View) bool {
+    return ip.get(.flags_fragment) & 0x4000 != 0;
+}
+
+/// TCP header length in bytes, from the data offset field
+pub inline fn tcpHeaderLen(tcp: Tcp.View) usize {
+    return @as(usize, tcp.get(.data_offset) >> 4) * 4;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// IPv6 Extension Headers
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Extension headers walked before giving up; real traffic carries one or two
+pub const max_ipv6_extensions = 8;
+
+/// Where the upper-layer header of an IPv6 packet starts
+pub const Ipv6UpperLayer = struct {
+    /// Upper-layer protocol, or the extension header the walk stopped at
+    protocol: u8,
+    /// Offset from the start of the IPv6 header
+    offset: usize,
+    /// Non-first fragment: the bytes at `offset` are not an upper-layer header
+    fragment: bool = false,
+};
+
+const ExtensionKind = enum(u2) { upper, options, fragment, auth };
+
+/// Next-header values that are extension headers, by length encoding
+const extension_kinds = blk: {
+    var kinds = [_]ExtensionKind{.upper} ** 256;
+    kinds[IpProto.ipv6_hop_by_hop] = .options;
+    kinds[IpProto.ipv6_routing] = .options;
+    kinds[IpProto.ipv6_dest_opts] = .options;
+    kinds[IpProto.ipv6_fragment] = .fragment;
+    kinds[IpProto.ipv6_auth] = .auth;
+    break :blk kinds;
+};
+
+/// Skip Hop-by-Hop, Routing, Fragment, Destination Options and AH headers
+/// The walk is bounded by `max_ipv6_extensions`; a longer chain stops at an
+/// extension header, which callers treat like any protocol without ports.
+pub fn ipv6UpperLayer(ip_packet: []const u8) error{InvalidPacket}!Ipv6UpperLayer {
+    if (ip_packet.len < Ipv6.size) return error.InvalidPacket;
+    var next = ip_packet[Ipv6.offsetOf(.next_header)];
+    var off: usize = Ipv6.size;
+
+    for (0..max_ipv6_extensions) |_| {
+        const kind = extension_kinds[next];
+        if (kind == .upper) break;
+        // Every extension header is at least 8 bytes and starts with next-header, length
+        if (ip_packet.len < off + 8) return error.InvalidPacket;
+        const len_field: usize = ip_packet[off + 1];
+        const ext_len = switch (kind) {
+            .options => (len_field + 1) * 8,
+            .auth => (len_field + 2) * 4,
+            .fragment => 8,
+            .upper => unreachable,
+        };
+        const non_first_fragment = kind == .fragment and
+            std.mem.readInt(u16, ip_packet[off + 2 ..][0..2], .big) & 0xFFF8 != 0;
+
+        next = ip_packet[off];
+        off += ext_len;
+        if (off > ip_packet.len) return error.InvalidPacket;
+        if (non_first_fragment) return .{ .protocol = next, .offset = off, .fragment = true };
+    }
+    return .{ .protocol = next, .offset = off };
+}
+
+test "header sizes and offsets" {
+    try std.testing.expectEqual(@as(usize, 14), Ethernet.size);
+    try std.testing.expectEqual(@as(usize, 28), Arp.size);
+    try std.testing.expectEqual(@as(usize, 20), Ipv4.size);
+    try std.testing.expectEqual(@as(usize, 40), Ipv6.size);
+    try std.testing.expectEqual(@as(usize, 8), Udp.size);
+    try std.testing.expectEqual(@as(usize, 20), Tcp.size);
+    try std.testing.expectEqual(@as(usize, 8), Icmp.size);
+    try std.testing.expectEqual(@as(usize, 12), Dns.size);
+    try std.testing.expectEqual(@as(usize, 240), Dhcp.size);
+
+    try std.testing.expectEqual(@as(usize, 12), Ethernet.offsetOf(.ethertype));
+    try std.testing.expectEqual(@as(usize, 14), Arp.offsetOf(.sender_ip));
+    try std.testing.expectEqual(@as(usize, 24), Arp.offsetOf(.target_ip));
+    try std.testing.expectEqual(@as(usize, 12), Ipv4.offsetOf(.src_ip));
+    try std.testing.expectEqual(@as(usize, 24), Ipv6.offsetOf(.dst_ip));
+    try std.testing.expectEqual(@as(usize, 236), Dhcp.offsetOf(.magic));
+}
+
+test "header views match hand-written offsets" {
+    var buf = [_]u8{0} ** 34;
+    const eth = try Ethernet.viewMut(&buf);
+    eth.set(.dst_mac, .{ 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF });
+    eth.set(.src_mac, .{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 });
+    eth.set(.ethertype, EtherType.ipv4);
+
+    const ip = try Ipv4.viewMut(buf[Ethernet.size..]);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.src_ip, 0x0A150064);
+
+    try std.testing.expectEqual(@as(u16, 0x0800), std.mem.readInt(u16, buf[12..14], .big));
+    try std.testing.expectEqual(@as(u32, 0x0A150064), std.mem.readInt(u32, buf[26..30], .big));
+    try std.testing.expectEqual(@as(usize, 20), ipv4HeaderLen(ip.asConst()));
+    try std.testing.expect(ipv4DontFragment(ip.asConst()));
+    try std.testing.expectEqual(@as(u4, 4), ipVersion(buf[Ethernet.size..]));
+
+    try std.testing.expectError(error.InvalidPacket, Ipv4.view(buf[0..19]));
+}
+
+test "ipv6UpperLayer skips extension headers" {
+    var buf = [_]u8{0} ** 128;
+    buf[0] = 0x60;
+
+    // No extensions
+    buf[6] = IpProto.tcp;
+    try std.testing.expectEqual(Ipv6UpperLayer{ .protocol = IpProto.tcp, .offset = 40 }, try ipv6UpperLayer(&buf));
+
+    // Hop-by-Hop (16 bytes) → Routing (8) → first Fragment → Destination Options (8) → UDP
+    buf[6] = IpProto.ipv6_hop_by_hop;
+    buf[40] = IpProto.ipv6_routing;
+    buf[41] = 1;
+    buf[56] = IpProto.ipv6_fragment;
+    buf[64] = IpProto.ipv6_dest_opts;
+    buf[65] = 0xFF; // Reserved byte; Fragment headers are always 8 bytes
+    buf[72] = IpProto.udp;
+    try std.testing.expectEqual(Ipv6UpperLayer{ .protocol = IpProto.udp, .offset = 80 }, try ipv6UpperLayer(&buf));
+
+    // Non-first fragment: no UDP header to look at
+    std.mem.writeInt(u16, buf[66..68], 185 << 3, .big);
+    try std.testing.expectEqual(
+        Ipv6UpperLayer{ .protocol = IpProto.ipv6_dest_opts, .offset = 72, .fragment = true },
+        try ipv6UpperLayer(&buf),
+    );
+
+    // Truncated extension chain
+    try std.testing.expectError(error.InvalidPacket, ipv6UpperLayer(buf[0..60]));
+}
+
+test "ipv6UpperLayer bounds adversarial chains" {
+    // More Destination Options headers than the walker follows
+    var buf = [_]u8{0} ** (40 + 8 * (max_ipv6_extensions + 2));
+    buf[0] = 0x60;
+    buf[6] = IpProto.ipv6_dest_opts;
+    var off: usize = 40;
+    while (off < buf.len) : (off += 8) buf[off] = IpProto.ipv6_dest_opts;
+
+    const upper = try ipv6UpperLayer(&buf);
+    try std.testing.expectEqual(IpProto.ipv6_dest_opts, upper.protocol);
+    try std.testing.expectEqual(@as(usize, 40 + 8 * max_ipv6_extensions), upper.offset);
+
+    // A length field pointing past the end
+    buf[41] = 0xFF;
+    try std.testing.expectError(error.InvalidPacket, ipv6UpperLayer(&buf));
+}
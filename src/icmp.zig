@@ -0,0 +1,296 @@
+//! Local ICMP "Packet Too Big" Generation
+//!
+//! When the host hands the TUN an IP packet larger than the tunnel can carry,
+//! the translator answers it locally instead of forwarding it to fail further
+//! down the path (or dropping it silently):
+//! - IPv4 with Don't Fragment set: ICMP Destination Unreachable,
+//!   Fragmentation Needed (type 3 code 4, RFC 1191)
+//! - IPv6: ICMPv6 Packet Too Big (type 2, RFC 8201)
+//!
+//! The reply is written back into the TUN, so the host's stack lowers its path
+//! MTU (and TCP its MSS) without a round trip to the far end. IPv4 packets
+//! without DF are left alone; they can still be fragmented downstream.
+//!
+//! Replies are rate-limited with a token bucket, as routers do (RFC 1812
+//! §4.3.2.8, RFC 4443 §2.4(f)), so a sender bursting oversize packets does not
+//! get one reply per packet.
+
+const std = @import("std");
+const headers = @import("headers.zig");
+const IpProto = headers.IpProto;
+const checksum = @import("checksum.zig");
+
+/// Largest ICMPv4 error datagram (RFC 1812 §4.3.2.3)
+pub const max_reply_v4 = 576;
+/// Largest ICMPv6 error packet: the IPv6 minimum MTU (RFC 4443 §2.4(c))
+pub const max_reply_v6 = 1280;
+/// Buffer size that fits any reply built here
+pub const max_reply_size = max_reply_v6;
+
+// ICMP types
+const icmp_dest_unreachable: u8 = 3;
+const icmp_code_frag_needed: u8 = 4;
+const icmpv6_packet_too_big: u8 = 2;
+
+// ICMPv6 types below 128 are errors (RFC 4443 §2.1)
+const icmpv6_first_info: u8 = 128;
+
+/// True if an outgoing packet of `packet_len` bytes exceeds `mtu` and should be
+/// answered with Fragmentation Needed / Packet Too Big.
+/// Never answers ICMP errors, non-initial fragments or IPv4 multicast/broadcast
+/// (RFC 1812 §4.3.2.7), and IPv4 without DF.
+pub fn needsTooBig(ip_packet: []const u8, packet_len: usize, mtu: u32) bool {
+    if (packet_len <= mtu) return false;
+
+    switch (headers.ipVersion(ip_packet)) {
+        4 => {
+            const ip = headers.Ipv4.view(ip_packet) catch return false;
+            if (!headers.ipv4DontFragment(ip)) return false;
+            if (ip.get(.flags_fragment) & 0x1FFF != 0) return false;
+            const dst = ip.get(.dst_ip);
+            if ((dst >> 28) == 0xE or dst == 0xFFFFFFFF) return false;
+            if (ip.get(.protocol) == IpProto.icmp) {
+                const ihl = headers.ipv4HeaderLen(ip);
+                if (ip_packet.len <= ihl) return false;
+                return isIcmpv4Query(ip_packet[ihl]);
+            }
+            return true;
+        },
+        6 => {
+            const ip = headers.Ipv6.view(ip_packet) catch return false;
+            if (ip.raw(.dst_ip)[0] == 0xFF) return false; // No unicast source to reply from
+            if (ip.get(.next_header) == IpProto.icmpv6) {
+                if (ip_packet.len <= headers.Ipv6.size) return false;
+                return ip_packet[headers.Ipv6.size] >= icmpv6_first_info;
+            }
+            return true;
+        },
+        else => return false,
+    }
+}
+
+/// ICMPv4 echo, timestamp, etc. (anything that is not an error message)
+fn isIcmpv4Query(msg_type: u8) bool {
+    return switch (msg_type) {
+        3, 4, 5, 11, 12 => false,
+        else => true,
+    };
+}
+
+/// Build the ICMP reply for an oversize packet into `out`
+/// `router_ip` is the IPv4 source to reply from (e.g. the tunnel gateway); if
+/// null the original destination is used. IPv6 replies always come from the
+/// original destination.
+///
+/// Returns: the reply IP packet (a prefix of `out`)
+/// Errors: InvalidPacket if `ip_packet` is not IPv4/IPv6, BufferTooSmall if
+/// `out` is shorter than `max_reply_size`
+pub fn buildTooBig(out: []u8, ip_packet: []const u8, mtu: u32, router_ip: ?u32) ![]u8 {
+    if (out.len < max_reply_size) return error.BufferTooSmall;
+    return switch (headers.ipVersion(ip_packet)) {
+        4 => buildFragNeeded(out, ip_packet, @intCast(@min(mtu, std.math.maxInt(u16))), router_ip),
+        6 => buildPacketTooBig(out, ip_packet, mtu),
+        else => error.InvalidPacket,
+    };
+}
+
+fn buildFragNeeded(out: []u8, ip_packet: []const u8, mtu: u16, router_ip: ?u32) ![]u8 {
+    const orig = try headers.Ipv4.view(ip_packet);
+    const quote_len = @min(ip_packet.len, max_reply_v4 - headers.Ipv4.size - headers.Icmp.size);
+    const total = headers.Ipv4.size + headers.Icmp.size + quote_len;
+
+    const ip = try headers.Ipv4.viewMut(out);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.tos, 0xC0); // Network control
+    ip.set(.total_length, @intCast(total));
+    ip.set(.identification, 0);
+    ip.set(.flags_fragment, 0);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, IpProto.icmp);
+    ip.set(.checksum, 0);
+    ip.set(.src_ip, router_ip orelse orig.get(.dst_ip));
+    ip.set(.dst_ip, orig.get(.src_ip));
+    ip.set(.checksum, checksum.internet(out[0..headers.Ipv4.size]));
+
+    const msg = out[headers.Ipv4.size..total];
+    const icmp = try headers.Icmp.viewMut(msg);
+    icmp.set(.msg_type, icmp_dest_unreachable);
+    icmp.set(.code, icmp_code_frag_needed);
+    icmp.set(.checksum, 0);
+    icmp.set(.param, mtu);
+    @memcpy(msg[headers.Icmp.size..], ip_packet[0..quote_len]);
+    icmp.set(.checksum, checksum.internet(msg));
+
+    return out[0..total];
+}
+
+fn buildPacketTooBig(out: []u8, ip_packet: []const u8, mtu: u32) ![]u8 {
+    const orig = try headers.Ipv6.view(ip_packet);
+    const quote_len = @min(ip_packet.len, max_reply_v6 - headers.Ipv6.size - headers.Icmp.size);
+    const payload_len = headers.Icmp.size + quote_len;
+
+    const ip = try headers.Ipv6.viewMut(out);
+    ip.set(.version_class_flow, 0x6000_0000);
+    ip.set(.payload_length, @intCast(payload_len));
+    ip.set(.next_header, IpProto.icmpv6);
+    ip.set(.hop_limit, 64);
+    ip.set(.src_ip, orig.get(.dst_ip));
+    ip.set(.dst_ip, orig.get(.src_ip));
+
+    const msg = out[headers.Ipv6.size..][0..payload_len];
+    const icmp = try headers.Icmp.viewMut(msg);
+    icmp.set(.msg_type, icmpv6_packet_too_big);
+    icmp.set(.code, 0);
+    icmp.set(.checksum, 0);
+    icmp.set(.param, mtu);
+    @memcpy(msg[headers.Icmp.size..], ip_packet[0..quote_len]);
+
+    var cs = checksum.Checksum{};
+    cs.addPseudoHeaderV6(ip.raw(.src_ip), ip.raw(.dst_ip), IpProto.icmpv6, @intCast(payload_len));
+    cs.update(msg);
+    icmp.set(.checksum, cs.final());
+
+    return out[0 .. headers.Ipv6.size + payload_len];
+}
+
+/// MTU advertised by a Fragmentation Needed / Packet Too Big reply (null for other packets)
+pub fn advertisedMtu(reply: []const u8) ?u32 {
+    switch (headers.ipVersion(reply)) {
+        4 => {
+            const ip = headers.Ipv4.view(reply) catch return null;
+            const ihl = headers.ipv4HeaderLen(ip);
+            if (ip.get(.protocol) != IpProto.icmp or reply.len < ihl) return null;
+            const icmp = headers.Icmp.view(reply[ihl..]) catch return null;
+            if (icmp.get(.msg_type) != icmp_dest_unreachable or icmp.get(.code) != icmp_code_frag_needed) return null;
+            return icmp.get(.param) & 0xFFFF;
+        },
+        6 => {
+            const ip = headers.Ipv6.view(reply) catch return null;
+            if (ip.get(.next_header) != IpProto.icmpv6) return null;
+            const icmp = headers.Icmp.view(reply[headers.Ipv6.size..]) catch return null;
+            if (icmp.get(.msg_type) != icmpv6_packet_too_big) return null;
+            return icmp.get(.param);
+        },
+        else => return null,
+    }
+}
+
+/// Token bucket limiting how many ICMP errors are generated
+pub const RateLimiter = struct {
+    rate_per_sec: u32,
+    burst: u32,
+    /// Available tokens, in thousandths
+    milli_tokens: u64,
+    last_ms: i64 = 0,
+
+    const Self = @This();
+
+    pub fn init(rate_per_sec: u32, burst: u32) Self {
+        return .{
+            .rate_per_sec = rate_per_sec,
+            .burst = burst,
+            .milli_tokens = @as(u64, burst) * 1000,
+        };
+    }
+
+    /// Take one token if available at time `now_ms`
+    pub fn allow(self: *Self, now_ms: i64) bool {
+        const elapsed: u64 = @intCast(@max(now_ms - self.last_ms, 0));
+        self.last_ms = @max(now_ms, self.last_ms);
+
+        const cap = @as(u64, self.burst) * 1000;
+        self.milli_tokens = @min(cap, self.milli_tokens +| elapsed *| self.rate_per_sec);
+
+        if (self.milli_tokens < 1000) return false;
+        self.milli_tokens -= 1000;
+        return true;
+    }
+};
+
+fn testIpv4(buf: []u8, len: u16, flags_fragment: u16) []u8 {
+    @memset(buf[0..len], 0x42);
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, len);
+    ip.set(.flags_fragment, flags_fragment);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, IpProto.tcp);
+    ip.set(.src_ip, 0x0A150002); // 10.21.0.2
+    ip.set(.dst_ip, 0x5DB8D822); // 93.184.216.34
+    return buf[0..len];
+}
+
+test "Fragmentation Needed for oversize DF packet" {
+    var buf: [1500]u8 = undefined;
+    var out: [max_reply_size]u8 = undefined;
+
+    const pkt = testIpv4(&buf, 1500, 0x4000);
+    try std.testing.expect(needsTooBig(pkt, pkt.len, 1400));
+    try std.testing.expect(!needsTooBig(pkt, pkt.len, 1500));
+    try std.testing.expect(!needsTooBig(testIpv4(&buf, 1500, 0), 1500, 1400)); // No DF
+    try std.testing.expect(!needsTooBig(testIpv4(&buf, 1500, 0x4010), 1500, 1400)); // Non-initial fragment
+
+    const reply = try buildTooBig(&out, testIpv4(&buf, 1500, 0x4000), 1400, 0x0A150001);
+    try std.testing.expectEqual(@as(usize, max_reply_v4), reply.len);
+    try std.testing.expectEqual(@as(?u32, 1400), advertisedMtu(reply));
+
+    const ip = try headers.Ipv4.view(reply);
+    try std.testing.expectEqual(@as(u32, 0x0A150001), ip.get(.src_ip));
+    try std.testing.expectEqual(@as(u32, 0x0A150002), ip.get(.dst_ip));
+    try std.testing.expectEqual(@as(u16, 0), checksum.internet(reply[0..headers.Ipv4.size]));
+    try std.testing.expectEqual(@as(u16, 0), checksum.internet(reply[headers.Ipv4.size..]));
+
+    // The quote starts with the original header so the host can match the socket
+    try std.testing.expectEqualSlices(u8, buf[0..headers.Ipv4.size], reply[28..48]);
+}
+
+test "Packet Too Big for oversize IPv6 packet" {
+    var buf = [_]u8{0x42} ** 1500;
+    var out: [max_reply_size]u8 = undefined;
+
+    const ip = try headers.Ipv6.viewMut(&buf);
+    ip.set(.version_class_flow, 0x6000_0000);
+    ip.set(.payload_length, 1500 - headers.Ipv6.size);
+    ip.set(.next_header, IpProto.udp);
+    ip.set(.src_ip, [_]u8{0xFD} ++ [_]u8{0} ** 14 ++ [_]u8{0x02});
+    ip.set(.dst_ip, [_]u8{ 0x20, 0x01, 0x0D, 0xB8 } ++ [_]u8{0} ** 11 ++ [_]u8{0x01});
+
+    try std.testing.expect(needsTooBig(&buf, buf.len, 1400));
+    const reply = try buildTooBig(&out, &buf, 1400, null);
+    try std.testing.expectEqual(@as(usize, max_reply_v6), reply.len);
+    try std.testing.expectEqual(@as(?u32, 1400), advertisedMtu(reply));
+
+    // Verify the ICMPv6 checksum over the pseudo-header
+    const rip = try headers.Ipv6.view(reply);
+    var cs = checksum.Checksum{};
+    cs.addPseudoHeaderV6(rip.raw(.src_ip), rip.raw(.dst_ip), IpProto.icmpv6, @intCast(reply.len - headers.Ipv6.size));
+    cs.update(reply[headers.Ipv6.size..]);
+    try std.testing.expectEqual(@as(u16, 0), cs.final());
+
+    // Never answer an ICMPv6 error with another one
+    buf[headers.Ipv6.size] = icmpv6_packet_too_big;
+    ip.set(.next_header, IpProto.icmpv6);
+    try std.testing.expect(!needsTooBig(&buf, buf.len, 1400));
+}
+
+test "RateLimiter bursts then refills at the configured rate" {
+    var limiter = RateLimiter.init(100, 5);
+
+    var sent: usize = 0;
+    for (0..50) |_| {
+        if (limiter.allow(1000)) sent += 1;
+    }
+    try std.testing.expectEqual(@as(usize, 5), sent);
+
+    // 100/s: one token every 10 ms
+    try std.testing.expect(!limiter.allow(1009));
+    try std.testing.expect(limiter.allow(1010));
+    try std.testing.expect(!limiter.allow(1010));
+
+    // A long idle period refills only up to the burst
+    sent = 0;
+    for (0..50) |_| {
+        if (limiter.allow(60_000)) sent += 1;
+    }
+    try std.testing.expectEqual(@as(usize, 5), sent);
+}
@@ -15,7 +15,7 @@ pub const InterfaceConfig = struct {
     name: []const u8,
     ip_address: ?Ipv4Address = null,
     netmask: ?Ipv4Address = null,
-    mtu: ?u16 = null,
+    mtu: ?u32 = null,
     is_up: bool = false,
 };
 
@@ -85,8 +85,8 @@ const MacOSConfigurator = struct {
     }
 
     /// Set MTU
-    pub fn setMtu(self: *Self, interface: []const u8, mtu: u16) !void {
-        var mtu_buf: [8]u8 = undefined;
+    pub fn setMtu(self: *Self, interface: []const u8, mtu: u32) !void {
+        var mtu_buf: [16]u8 = undefined;
         const mtu_str = try std.fmt.bufPrint(&mtu_buf, "{d}", .{mtu});
 
         std.log.info("Setting {s} MTU: {s}", .{ interface, mtu_str });
@@ -194,8 +194,8 @@ const LinuxConfigurator = struct {
     }
 
     /// Set MTU
-    pub fn setMtu(self: *Self, interface: []const u8, mtu: u16) !void {
-        var mtu_buf: [8]u8 = undefined;
+    pub fn setMtu(self: *Self, interface: []const u8, mtu: u32) !void {
+        var mtu_buf: [16]u8 = undefined;
         const mtu_str = try std.fmt.bufPrint(&mtu_buf, "{d}", .{mtu});
 
         std.log.info("Setting {s} MTU: {s}", .{ interface, mtu_str });
@@ -299,15 +299,15 @@ const WindowsConfigurator = struct {
     }
 
     /// Set MTU
-    pub fn setMtu(self: *Self, interface: []const u8, mtu: u16) !void {
-        var mtu_buf: [8]u8 = undefined;
-        const mtu_str = try std.fmt.bufPrint(&mtu_buf, "{d}", .{mtu});
+    pub fn setMtu(self: *Self, interface: []const u8, mtu: u32) !void {
+        var mtu_buf: [16]u8 = undefined;
+        const mtu_arg = try std.fmt.bufPrint(&mtu_buf, "mtu={d}", .{mtu});
 
-        std.log.info("Setting {s} MTU: {s}", .{ interface, mtu_str });
+        std.log.info("Setting {s} MTU: {d}", .{ interface, mtu });
 
         const result = try std.process.Child.run(.{
             .allocator = self.allocator,
-            .argv = &[_][]const u8{ "netsh", "interface", "ipv4", "set", "subinterface", interface, "mtu=" ++ mtu_str, "store=persistent" },
+            .argv = &[_][]const u8{ "netsh", "interface", "ipv4", "set", "subinterface", interface, mtu_arg, "store=persistent" },
         });
         defer self.allocator.free(result.stdout);
         defer self.allocator.free(result.stderr);
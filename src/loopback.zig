@@ -0,0 +1,183 @@
+//! In-Memory Loopback Device
+//!
+//! A TUN device without the kernel: every packet written is queued and comes
+//! back from `read` in order. Plugged into `GenericTunAdapter`, it runs the
+//! whole adapter path (translation, local replies, capture, reconfiguration)
+//! in tests, soak runs and on hosts where opening a TUN needs root. Writing a
+//! packet directly is how a harness plays the host stack sending one.
+//!
+//! ```zig
+//! const Adapter = taptun.GenericTunAdapter(taptun.LoopbackDevice);
+//! var adapter = try Adapter.open(allocator, .{ .translator = .{ .our_mac = mac } });
+//! defer adapter.close();
+//!
+//! try adapter.device.write(ip_packet); // Host stack → adapter
+//! const frame = try adapter.readEthernet(&buffer);
+//! ```
+
+const std = @import("std");
+const taptun = @import("taptun.zig");
+
+/// Packets the device holds before it tail-drops, like a TUN txqueuelen
+pub const default_capacity = 256;
+
+pub const LoopbackDevice = struct {
+    allocator: std.mem.Allocator,
+    queue: [][]u8,
+    head: usize = 0,
+    count: usize = 0,
+    mtu: u32 = taptun.default_mtu,
+    non_blocking: bool = true,
+
+    // Statistics
+    packets_written: u64 = 0,
+    packets_read: u64 = 0,
+    dropped: u64 = 0,
+
+    const Self = @This();
+
+    /// No protocol header: packets are bare IP, as from a Linux TUN opened with IFF_NO_PI
+    pub const framing = struct {
+        pub const protocol_header_len: usize = 0;
+
+        pub fn addProtocolHeader(allocator: std.mem.Allocator, ip_packet: []const u8) ![]u8 {
+            if (ip_packet.len == 0) return error.InvalidPacket;
+            return allocator.dupe(u8, ip_packet);
+        }
+
+        pub fn writeProtocolHeader(header: []u8, ip_packet: []const u8) !void {
+            if (header.len != protocol_header_len or ip_packet.len == 0) return error.InvalidPacket;
+        }
+
+        pub fn stripProtocolHeader(packet: []const u8) ![]const u8 {
+            if (packet.len == 0) return error.InvalidPacket;
+            return packet;
+        }
+    };
+
+    /// Same signature as the platform devices; there is only one unit
+    pub fn open(allocator: std.mem.Allocator, unit: ?u32) !Self {
+        _ = unit;
+        return init(allocator, default_capacity);
+    }
+
+    pub fn init(allocator: std.mem.Allocator, capacity: usize) !Self {
+        if (capacity == 0) return error.InvalidConfiguration;
+        return .{ .allocator = allocator, .queue = try allocator.alloc([]u8, capacity) };
+    }
+
+    pub fn close(self: *Self) void {
+        while (self.count > 0) self.allocator.free(self.pop());
+        self.allocator.free(self.queue);
+    }
+
+    /// Dequeue the oldest packet into `buffer`
+    /// Returns error.WouldBlock when the queue is empty, whatever the blocking
+    /// mode: nothing else can fill it while the caller waits.
+    pub fn read(self: *Self, buffer: []u8) ![]u8 {
+        if (self.count == 0) return error.WouldBlock;
+        const next = self.queue[self.head];
+        if (next.len > buffer.len) return error.BufferTooSmall;
+
+        const packet = self.pop();
+        defer self.allocator.free(packet);
+        @memcpy(buffer[0..packet.len], packet);
+        self.packets_read += 1;
+        return buffer[0..packet.len];
+    }
+
+    /// Queue a copy of `packet`; dropped (and counted) when the queue is full
+    pub fn write(self: *Self, packet: []const u8) !void {
+        if (packet.len == 0) return error.InvalidPacket;
+        if (self.count == self.queue.len) {
+            self.dropped += 1;
+            return;
+        }
+        self.push(try self.allocator.dupe(u8, packet));
+        self.packets_written += 1;
+    }
+
+    /// Gather write: the segments are queued as one packet
+    pub fn writev(self: *Self, iov: []const std.posix.iovec_const) !void {
+        var total: usize = 0;
+        for (iov) |v| total += v.len;
+        if (total == 0) return error.InvalidPacket;
+        if (self.count == self.queue.len) {
+            self.dropped += 1;
+            return;
+        }
+
+        const packet = try self.allocator.alloc(u8, total);
+        var off: usize = 0;
+        for (iov) |v| {
+            @memcpy(packet[off..][0..v.len], v.base[0..v.len]);
+            off += v.len;
+        }
+        self.push(packet);
+        self.packets_written += 1;
+    }
+
+    /// Queue several packets in one call, each tail-dropped on its own
+    pub fn writeBatch(self: *Self, packets: []const std.posix.iovec_const) !void {
+        for (packets) |p| try self.write(p.base[0..p.len]);
+    }
+
+    pub fn setNonBlocking(self: *Self, enabled: bool) !void {
+        self.non_blocking = enabled;
+    }
+
+    pub fn setMtu(self: *Self, mtu: u32) !void {
+        if (mtu < taptun.min_mtu or mtu > taptun.max_mtu) return error.InvalidConfiguration;
+        self.mtu = mtu;
+    }
+
+    pub fn getName(self: *const Self) []const u8 {
+        _ = self;
+        return "loop0";
+    }
+
+    /// Packets waiting to be read
+    pub fn pending(self: *const Self) usize {
+        return self.count;
+    }
+
+    /// Whether `read` has a packet to return
+    pub fn readable(self: *const Self) bool {
+        return self.count > 0;
+    }
+
+    fn push(self: *Self, packet: []u8) void {
+        self.queue[(self.head + self.count) % self.queue.len] = packet;
+        self.count += 1;
+    }
+
+    fn pop(self: *Self) []u8 {
+        const packet = self.queue[self.head];
+        self.head = (self.head + 1) % self.queue.len;
+        self.count -= 1;
+        return packet;
+    }
+};
+
+test "LoopbackDevice returns writes in order and tail-drops when full" {
+    var device = try LoopbackDevice.init(std.testing.allocator, 2);
+    defer device.close();
+
+    var buf: [16]u8 = undefined;
+    try std.testing.expectError(error.WouldBlock, device.read(&buf));
+
+    try device.write("one");
+    try device.write("two");
+    try device.write("three");
+    try std.testing.expectEqual(@as(u64, 1), device.dropped);
+
+    try std.testing.expectEqualStrings("one", try device.read(&buf));
+    try device.write("four");
+    try std.testing.expectError(error.BufferTooSmall, device.read(buf[0..2]));
+    try std.testing.expectEqualStrings("two", try device.read(&buf));
+    try std.testing.expectEqualStrings("four", try device.read(&buf));
+    try std.testing.expectEqual(@as(usize, 0), device.pending());
+
+    // Queued packets are freed on close
+    try device.write("five");
+}
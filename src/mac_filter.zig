@@ -0,0 +1,210 @@
+//! Destination MAC Filter
+//!
+//! First-step acceptance check for frames arriving from a virtual hub. A
+//! SoftEther hub floods unicast frames addressed to other members; those must
+//! be dropped before the translator parses or copies anything.
+//!
+//! A frame is accepted if its destination is:
+//! - our MAC (single 64-bit compare)
+//! - broadcast
+//! - a subscribed multicast group (compared against all groups at once with a
+//!   `@Vector` of u64), or one of the always-on groups: IPv4 all-hosts, IPv6
+//!   all-nodes and IPv6 solicited-node (33:33:ff:xx:xx:xx, needed for NDP)
+
+const std = @import("std");
+const simd = @import("simd.zig");
+
+/// Number of multicast groups held in the vector set
+pub const max_groups = 8;
+
+const GroupVec = @Vector(max_groups, u64);
+
+/// Unused vector slot; above the 48-bit MAC range so it never matches
+const empty_slot: u64 = std.math.maxInt(u64);
+
+const broadcast_key: u64 = 0xFFFF_FFFF_FFFF;
+const ipv4_all_hosts_key: u64 = 0x0100_5E00_0001; // 01:00:5e:00:00:01 (224.0.0.1)
+const ipv6_all_nodes_key: u64 = 0x3333_0000_0001; // 33:33:00:00:00:01 (ff02::1)
+const ipv6_solicited_node_prefix: u64 = 0x3333_FF; // 33:33:ff:xx:xx:xx
+
+/// Pack a MAC address into the low 48 bits of a u64
+pub inline fn macKey(mac: *const [6]u8) u64 {
+    return std.mem.readInt(u48, mac, .big);
+}
+
+pub const MacFilter = struct {
+    our_key: u64,
+    groups: [max_groups]u64 = [_]u64{empty_slot} ** max_groups,
+    group_count: usize = 0,
+    /// Accept every multicast destination (e.g. when snooping is unavailable)
+    accept_all_multicast: bool = false,
+
+    // Counters
+    accepted_unicast: u64 = 0,
+    accepted_broadcast: u64 = 0,
+    accepted_multicast: u64 = 0,
+    dropped_unicast: u64 = 0,
+    dropped_multicast: u64 = 0,
+
+    const Self = @This();
+
+    pub fn init(our_mac: [6]u8) Self {
+        return .{ .our_key = macKey(&our_mac) };
+    }
+
+    /// Check a frame's destination MAC; updates counters
+    pub inline fn accept(self: *Self, dst_mac: *const [6]u8) bool {
+        const key = macKey(dst_mac);
+
+        if (key == self.our_key) {
+            self.accepted_unicast += 1;
+            return true;
+        }
+
+        // Group bit clear: unicast for another hub member
+        if (dst_mac[0] & 0x01 == 0) {
+            self.dropped_unicast += 1;
+            return false;
+        }
+
+        if (key == broadcast_key) {
+            self.accepted_broadcast += 1;
+            return true;
+        }
+
+        if (self.accept_all_multicast or self.isSubscribed(key)) {
+            self.accepted_multicast += 1;
+            return true;
+        }
+
+        self.dropped_multicast += 1;
+        return false;
+    }
+
+    /// Check a burst of up to `simd.max_burst` frames; bit i of the result is
+    /// set if `frames[i]` passes. Unicast for other hub members, most of a
+    /// flooded burst, is rejected by one vector pass; the rest go through `accept`.
+    pub fn acceptBurst(self: *Self, frames: []const []const u8) u64 {
+        std.debug.assert(frames.len <= simd.max_burst);
+        var keys: [simd.max_burst]u64 = undefined;
+        for (frames, keys[0..frames.len]) |frame, *key| {
+            // Runts get a unicast key that is never ours
+            key.* = if (frame.len >= 6) macKey(frame[0..6]) else self.our_key ^ 1;
+        }
+        const miss = simd.kernels().unicastMiss(keys[0..frames.len], self.our_key);
+        self.dropped_unicast += @popCount(miss);
+
+        const all = if (frames.len == 64) std.math.maxInt(u64) else (@as(u64, 1) << @intCast(frames.len)) - 1;
+        var accepted: u64 = 0;
+        var pending = all & ~miss;
+        while (pending != 0) : (pending &= pending - 1) {
+            const i = @ctz(pending);
+            if (self.accept(frames[i][0..6])) accepted |= @as(u64, 1) << @intCast(i);
+        }
+        return accepted;
+    }
+
+    /// True if a multicast key matches an always-on or subscribed group
+    pub inline fn isSubscribed(self: *const Self, key: u64) bool {
+        if (key == ipv4_all_hosts_key or key == ipv6_all_nodes_key) return true;
+        if ((key >> 24) == ipv6_solicited_node_prefix) return true;
+        const groups: GroupVec = self.groups;
+        return @reduce(.Or, groups == @as(GroupVec, @splat(key)));
+    }
+
+    /// Subscribe to a multicast group MAC
+    pub fn subscribe(self: *Self, mac: [6]u8) !void {
+        if (mac[0] & 0x01 == 0) return error.NotMulticast;
+        const key = macKey(&mac);
+        if (self.isSubscribed(key)) return;
+        if (self.group_count == max_groups) return error.FilterFull;
+
+        self.groups[self.group_count] = key;
+        self.group_count += 1;
+    }
+
+    /// Remove a multicast group MAC (no-op if not subscribed)
+    pub fn unsubscribe(self: *Self, mac: [6]u8) void {
+        const key = macKey(&mac);
+        var i: usize = 0;
+        while (i < self.group_count) : (i += 1) {
+            if (self.groups[i] != key) continue;
+            // Keep slots packed: move the last group into the hole
+            self.group_count -= 1;
+            self.groups[i] = self.groups[self.group_count];
+            self.groups[self.group_count] = empty_slot;
+            return;
+        }
+    }
+
+    /// Total frames dropped by the filter
+    pub fn dropped(self: *const Self) u64 {
+        return self.dropped_unicast + self.dropped_multicast;
+    }
+
+    /// Total frames accepted by the filter
+    pub fn accepted(self: *const Self) u64 {
+        return self.accepted_unicast + self.accepted_broadcast + self.accepted_multicast;
+    }
+};
+
+test "MacFilter accepts ours, broadcast and subscribed multicast" {
+    const ours = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+    var filter = MacFilter.init(ours);
+
+    try std.testing.expect(filter.accept(&ours));
+    try std.testing.expect(filter.accept(&[_]u8{0xFF} ** 6));
+    try std.testing.expect(!filter.accept(&[_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x02 }));
+
+    // Always-on groups
+    try std.testing.expect(filter.accept(&[_]u8{ 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 }));
+    try std.testing.expect(filter.accept(&[_]u8{ 0x33, 0x33, 0xFF, 0x12, 0x34, 0x56 }));
+
+    const mdns = [_]u8{ 0x01, 0x00, 0x5E, 0x00, 0x00, 0xFB };
+    try std.testing.expect(!filter.accept(&mdns));
+    try filter.subscribe(mdns);
+    try std.testing.expect(filter.accept(&mdns));
+    filter.unsubscribe(mdns);
+    try std.testing.expect(!filter.accept(&mdns));
+
+    try std.testing.expectEqual(@as(u64, 1), filter.accepted_unicast);
+    try std.testing.expectEqual(@as(u64, 1), filter.dropped_unicast);
+    try std.testing.expectEqual(@as(u64, 2), filter.dropped_multicast);
+    try std.testing.expectError(error.NotMulticast, filter.subscribe(ours));
+}
+
+test "MacFilter group set capacity" {
+    var filter = MacFilter.init([_]u8{ 0x02, 0, 0, 0, 0, 1 });
+    for (0..max_groups) |i| {
+        try filter.subscribe(.{ 0x01, 0x00, 0x5E, 0x01, 0x00, @intCast(i) });
+    }
+    try std.testing.expectError(error.FilterFull, filter.subscribe(.{ 0x01, 0x00, 0x5E, 0x02, 0x00, 0x00 }));
+    filter.unsubscribe(.{ 0x01, 0x00, 0x5E, 0x01, 0x00, 0x00 });
+    try std.testing.expect(filter.isSubscribed(macKey(&[_]u8{ 0x01, 0x00, 0x5E, 0x01, 0x00, 0x07 })));
+    try std.testing.expect(!filter.isSubscribed(macKey(&[_]u8{ 0x01, 0x00, 0x5E, 0x01, 0x00, 0x00 })));
+}
+
+test "MacFilter acceptBurst matches accept frame by frame" {
+    const ours = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+    const destinations = [_][6]u8{
+        ours,
+        [_]u8{0xFF} ** 6,
+        [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x02 },
+        [_]u8{ 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 },
+        [_]u8{ 0x01, 0x00, 0x5E, 0x00, 0x00, 0xFB },
+    };
+    var frames: [simd.max_burst][]const u8 = undefined;
+    for (&frames, 0..) |*frame, i| frame.* = &destinations[i % destinations.len];
+
+    for ([_]usize{ 5, 17, simd.max_burst }) |n| {
+        var burst = MacFilter.init(ours);
+        var single = MacFilter.init(ours);
+        var expected: u64 = 0;
+        for (frames[0..n], 0..) |frame, i| {
+            if (single.accept(frame[0..6])) expected |= @as(u64, 1) << @intCast(i);
+        }
+        try std.testing.expectEqual(expected, burst.acceptBurst(frames[0..n]));
+        try std.testing.expectEqual(single.accepted(), burst.accepted());
+        try std.testing.expectEqual(single.dropped(), burst.dropped());
+    }
+}
@@ -0,0 +1,331 @@
+//! Multicast Group Snooping
+//!
+//! Tracks which multicast groups the host has joined by snooping its own
+//! outgoing IGMP (v1/v2/v3) and MLD (v1/v2) reports on the L3→L2 path. Joined
+//! groups are mapped to their Ethernet group MACs and fed to the inbound
+//! `MacFilter`, so hub multicast for groups nobody joined (mDNS, SSDP, video
+//! streams) is dropped before it is copied into the TUN.
+//!
+//! Several IP groups can share one MAC (32:1 for IPv4), so each MAC stays
+//! subscribed while at least one joined group maps to it. If the MAC filter's
+//! set overflows, the filter falls back to accepting all multicast.
+
+const std = @import("std");
+const headers = @import("headers.zig");
+const IpProto = headers.IpProto;
+const MacFilter = @import("mac_filter.zig").MacFilter;
+
+/// Maximum number of joined IP groups tracked
+pub const max_memberships = 32;
+
+// IPv6 extension header carrying the MLD router alert
+const ipv6_hop_by_hop: u8 = 0;
+
+// IGMP message types (RFC 1112, 2236, 3376)
+const igmp_v1_report: u8 = 0x12;
+const igmp_v2_report: u8 = 0x16;
+const igmp_v2_leave: u8 = 0x17;
+const igmp_v3_report: u8 = 0x22;
+
+// MLD message types (RFC 2710, 3810)
+const mld_v1_report: u8 = 131;
+const mld_v1_done: u8 = 132;
+const mld_v2_report: u8 = 143;
+
+// IGMPv3 / MLDv2 group record types
+const record_is_include: u8 = 1;
+const record_is_exclude: u8 = 2;
+const record_to_include: u8 = 3;
+const record_to_exclude: u8 = 4;
+const record_allow_new: u8 = 5;
+
+/// Group address; IPv4 groups are stored IPv4-mapped (::ffff:a.b.c.d)
+pub const GroupAddr = [16]u8;
+
+pub fn groupFromIpv4(ip: u32) GroupAddr {
+    var addr = [_]u8{0} ** 10 ++ [_]u8{ 0xFF, 0xFF } ++ [_]u8{0} ** 4;
+    std.mem.writeInt(u32, addr[12..16], ip, .big);
+    return addr;
+}
+
+fn isIpv4Mapped(addr: GroupAddr) bool {
+    return std.mem.allEqual(u8, addr[0..10], 0) and addr[10] == 0xFF and addr[11] == 0xFF;
+}
+
+/// Ethernet group MAC for a multicast group (RFC 1112 §6.4, RFC 2464 §7)
+pub fn groupMac(addr: GroupAddr) [6]u8 {
+    if (isIpv4Mapped(addr)) {
+        return .{ 0x01, 0x00, 0x5E, addr[13] & 0x7F, addr[14], addr[15] };
+    }
+    return .{ 0x33, 0x33, addr[12], addr[13], addr[14], addr[15] };
+}
+
+/// True for 224.0.0.0/4
+pub inline fn isIpv4Multicast(ip: u32) bool {
+    return (ip >> 28) == 0xE;
+}
+
+/// True for ff00::/8
+pub inline fn isIpv6Multicast(addr: *const [16]u8) bool {
+    return addr[0] == 0xFF;
+}
+
+/// Set of joined groups, kept in sync with a `MacFilter`
+pub const Membership = struct {
+    groups: [max_memberships]GroupAddr = undefined,
+    count: usize = 0,
+    /// Bumped on every change; compare to decide when to resync a kernel filter
+    generation: u64 = 0,
+    /// Joins that did not fit the table or the filter and fell back to all multicast
+    overflows: u64 = 0,
+
+    const Self = @This();
+
+    pub fn contains(self: *const Self, addr: GroupAddr) bool {
+        return self.indexOf(addr) != null;
+    }
+
+    fn indexOf(self: *const Self, addr: GroupAddr) ?usize {
+        for (self.groups[0..self.count], 0..) |g, i| {
+            if (std.mem.eql(u8, &g, &addr)) return i;
+        }
+        return null;
+    }
+
+    /// Record a join and subscribe the filter to the group MAC
+    pub fn join(self: *Self, filter: *MacFilter, addr: GroupAddr) !void {
+        if (self.contains(addr)) return;
+        if (self.count == max_memberships) return error.TooManyGroups;
+
+        self.groups[self.count] = addr;
+        self.count += 1;
+        self.generation += 1;
+
+        filter.subscribe(groupMac(addr)) catch |err| switch (err) {
+            // Out of filter slots: stay correct by accepting all multicast
+            error.FilterFull => {
+                filter.accept_all_multicast = true;
+                self.overflows += 1;
+            },
+            error.NotMulticast => unreachable,
+        };
+    }
+
+    /// Record a leave; unsubscribes the MAC once no joined group maps to it
+    pub fn leave(self: *Self, filter: *MacFilter, addr: GroupAddr) void {
+        const i = self.indexOf(addr) orelse return;
+        self.count -= 1;
+        self.groups[i] = self.groups[self.count];
+        self.generation += 1;
+
+        const mac = groupMac(addr);
+        for (self.groups[0..self.count]) |g| {
+            if (std.mem.eql(u8, &groupMac(g), &mac)) return;
+        }
+        filter.unsubscribe(mac);
+    }
+
+    /// Distinct group MACs currently joined; returns the filled prefix of `out`
+    pub fn macs(self: *const Self, out: [][6]u8) [][6]u8 {
+        var n: usize = 0;
+        outer: for (self.groups[0..self.count]) |g| {
+            const mac = groupMac(g);
+            for (out[0..n]) |m| {
+                if (std.mem.eql(u8, &m, &mac)) continue :outer;
+            }
+            if (n == out.len) break;
+            out[n] = mac;
+            n += 1;
+        }
+        return out[0..n];
+    }
+};
+
+const Action = enum { join, leave };
+
+/// Inspect an outgoing IP packet and apply any IGMP/MLD membership changes.
+/// Cheap for non-report traffic: only the IP protocol / next header is read.
+pub fn snoop(ip_packet: []const u8, membership: *Membership, filter: *MacFilter) void {
+    switch (headers.ipVersion(ip_packet)) {
+        4 => snoopIgmp(ip_packet, membership, filter) catch {},
+        6 => snoopMld(ip_packet, membership, filter) catch {},
+        else => {},
+    }
+}
+
+fn apply(membership: *Membership, filter: *MacFilter, action: Action, addr: GroupAddr) void {
+    switch (action) {
+        .join => membership.join(filter, addr) catch |err| switch (err) {
+            // Untracked group: stay correct by accepting all multicast
+            error.TooManyGroups => {
+                filter.accept_all_multicast = true;
+                membership.overflows += 1;
+            },
+        },
+        .leave => membership.leave(filter, addr),
+    }
+}
+
+/// Map an IGMPv3/MLDv2 group record to a join or leave
+fn recordAction(record_type: u8, num_sources: u16) ?Action {
+    return switch (record_type) {
+        record_is_exclude, record_to_exclude => .join,
+        record_is_include, record_to_include => if (num_sources == 0) .leave else .join,
+        record_allow_new => .join,
+        else => null, // BLOCK_OLD_SOURCES: membership unchanged
+    };
+}
+
+fn snoopIgmp(ip_packet: []const u8, membership: *Membership, filter: *MacFilter) !void {
+    const ip = try headers.Ipv4.view(ip_packet);
+    if (ip.get(.protocol) != IpProto.igmp) return;
+    const ihl = headers.ipv4HeaderLen(ip);
+    if (ihl < headers.Ipv4.size or ip_packet.len < ihl + 8) return error.InvalidPacket;
+
+    const igmp = ip_packet[ihl..];
+    switch (igmp[0]) {
+        igmp_v1_report, igmp_v2_report, igmp_v2_leave => {
+            const group = std.mem.readInt(u32, igmp[4..8], .big);
+            if (!isIpv4Multicast(group)) return;
+            apply(membership, filter, if (igmp[0] == igmp_v2_leave) .leave else .join, groupFromIpv4(group));
+        },
+        igmp_v3_report => {
+            const num_records = std.mem.readInt(u16, igmp[6..8], .big);
+            var off: usize = 8;
+            for (0..num_records) |_| {
+                if (igmp.len < off + 8) return error.InvalidPacket;
+                const rec = igmp[off..];
+                const num_sources = std.mem.readInt(u16, rec[2..4], .big);
+                const group = std.mem.readInt(u32, rec[4..8], .big);
+                if (isIpv4Multicast(group)) {
+                    if (recordAction(rec[0], num_sources)) |action| {
+                        apply(membership, filter, action, groupFromIpv4(group));
+                    }
+                }
+                off += 8 + @as(usize, num_sources) * 4 + @as(usize, rec[1]) * 4;
+            }
+        },
+        else => {},
+    }
+}
+
+fn snoopMld(ip_packet: []const u8, membership: *Membership, filter: *MacFilter) !void {
+    // MLD is sent with a Hop-by-Hop router alert option
+    const upper = try headers.ipv6UpperLayer(ip_packet);
+    const off = upper.offset;
+    if (upper.protocol != IpProto.icmpv6 or upper.fragment or ip_packet.len < off + 8) return;
+
+    const icmp = ip_packet[off..];
+    switch (icmp[0]) {
+        mld_v1_report, mld_v1_done => {
+            if (icmp.len < 24) return error.InvalidPacket;
+            const group = icmp[8..24].*;
+            if (!isIpv6Multicast(&group)) return;
+            apply(membership, filter, if (icmp[0] == mld_v1_done) .leave else .join, group);
+        },
+        mld_v2_report => {
+            const num_records = std.mem.readInt(u16, icmp[6..8], .big);
+            var rec_off: usize = 8;
+            for (0..num_records) |_| {
+                if (icmp.len < rec_off + 20) return error.InvalidPacket;
+                const rec = icmp[rec_off..];
+                const num_sources = std.mem.readInt(u16, rec[2..4], .big);
+                const group = rec[4..20].*;
+                if (isIpv6Multicast(&group)) {
+                    if (recordAction(rec[0], num_sources)) |action| {
+                        apply(membership, filter, action, group);
+                    }
+                }
+                rec_off += 20 + @as(usize, num_sources) * 16 + @as(usize, rec[1]) * 4;
+            }
+        },
+        else => {},
+    }
+}
+
+test "group MAC mapping" {
+    // 239.255.255.250 (SSDP) -> 01:00:5e:7f:ff:fa
+    const ssdp = groupMac(groupFromIpv4(0xEFFFFFFA));
+    try std.testing.expectEqualSlices(u8, &[_]u8{ 0x01, 0x00, 0x5E, 0x7F, 0xFF, 0xFA }, &ssdp);
+
+    // ff02::fb (mDNS) -> 33:33:00:00:00:fb
+    var mdns6 = [_]u8{0} ** 16;
+    mdns6[0] = 0xFF;
+    mdns6[1] = 0x02;
+    mdns6[15] = 0xFB;
+    try std.testing.expectEqualSlices(u8, &[_]u8{ 0x33, 0x33, 0x00, 0x00, 0x00, 0xFB }, &groupMac(mdns6));
+}
+
+test "IGMPv2 join and leave drive the MAC filter" {
+    var filter = MacFilter.init([_]u8{ 0x02, 0, 0, 0, 0, 1 });
+    var membership = Membership{};
+
+    var pkt = [_]u8{0} ** (headers.Ipv4.size + 8);
+    const ip = try headers.Ipv4.viewMut(&pkt);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.protocol, IpProto.igmp);
+    pkt[20] = igmp_v2_report;
+    std.mem.writeInt(u32, pkt[24..28], 0xE00000FB, .big); // 224.0.0.251
+
+    const mdns_mac = [_]u8{ 0x01, 0x00, 0x5E, 0x00, 0x00, 0xFB };
+    try std.testing.expect(!filter.accept(&mdns_mac));
+
+    snoop(&pkt, &membership, &filter);
+    snoop(&pkt, &membership, &filter); // Periodic re-report is idempotent
+    try std.testing.expectEqual(@as(usize, 1), membership.count);
+    try std.testing.expect(filter.accept(&mdns_mac));
+
+    pkt[20] = igmp_v2_leave;
+    snoop(&pkt, &membership, &filter);
+    try std.testing.expectEqual(@as(usize, 0), membership.count);
+    try std.testing.expect(!filter.accept(&mdns_mac));
+}
+
+test "MLDv2 report behind hop-by-hop header" {
+    var filter = MacFilter.init([_]u8{ 0x02, 0, 0, 0, 0, 1 });
+    var membership = Membership{};
+
+    var pkt = [_]u8{0} ** (headers.Ipv6.size + 8 + 8 + 20);
+    const ip = try headers.Ipv6.viewMut(&pkt);
+    ip.set(.version_class_flow, 0x6000_0000);
+    ip.set(.next_header, ipv6_hop_by_hop);
+
+    const hbh = pkt[headers.Ipv6.size..];
+    hbh[0] = IpProto.icmpv6;
+    hbh[1] = 0; // 8 bytes
+
+    const mld = hbh[8..];
+    mld[0] = mld_v2_report;
+    std.mem.writeInt(u16, mld[6..8], 1, .big);
+    mld[8] = record_to_exclude; // join, any source
+    mld[12] = 0xFF;
+    mld[13] = 0x05;
+    mld[27] = 0x02;
+
+    snoop(&pkt, &membership, &filter);
+    try std.testing.expectEqual(@as(usize, 1), membership.count);
+    try std.testing.expect(filter.accept(&[_]u8{ 0x33, 0x33, 0x00, 0x00, 0x00, 0x02 }));
+
+    var buf: [max_memberships][6]u8 = undefined;
+    try std.testing.expectEqual(@as(usize, 1), membership.macs(&buf).len);
+}
+
+test "joins beyond the membership table fall back to all multicast" {
+    var filter = MacFilter.init([_]u8{ 0x02, 0, 0, 0, 0, 1 });
+    var membership = Membership{};
+
+    // 32 groups that all map to 01:00:5e:00:00:01, so the filter keeps one slot
+    for (0..max_memberships) |i| {
+        const high: u32 = @intCast(i & 15);
+        const bit23: u32 = @intCast(i >> 4);
+        apply(&membership, &filter, .join, groupFromIpv4(0xE0000001 | high << 24 | bit23 << 23));
+    }
+    try std.testing.expectEqual(@as(usize, max_memberships), membership.count);
+    try std.testing.expect(!filter.accept_all_multicast);
+
+    const mac = [_]u8{ 0x01, 0x00, 0x5E, 0x00, 0x00, 0x02 };
+    try std.testing.expect(!filter.accept(&mac));
+    apply(&membership, &filter, .join, groupFromIpv4(0xE0000002));
+    try std.testing.expect(filter.accept(&mac));
+    try std.testing.expectEqual(@as(u64, 1), membership.overflows);
+}
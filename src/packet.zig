@@ -0,0 +1,661 @@
+//! Packet Descriptor
+//!
+//! mbuf-style descriptor shared by the translator, adapter, capture and FFI
+//! batch paths. A `Packet` owns no memory: it describes a window (`head`,
+//! `len`) into a caller- or pool-provided buffer with headroom in front and
+//! tailroom behind, so headers can be added and removed in place.
+//!
+//! Layer offsets, EtherType, IP protocol, flow hash and flags are filled in by
+//! a single `parse()` call and reused by every later stage. For IPv6 the
+//! protocol and L4 offset are those after any extension headers.
+//!
+//! Large packets (GSO/GRO super-packets up to 64 KB) can be built as a chain
+//! of segments linked through `next`: typically a header segment followed by
+//! payload segments taken from a pool. Devices write chains with gather I/O
+//! and checksums are computed over the chain; `linearize` copies only when a
+//! consumer really needs contiguous bytes. Headers that `parse()` looks at
+//! must live in the first segment.
+//!
+//! Layout:
+//! ```
+//! buf: [ headroom | data (head .. head+len) | tailroom ] -> next segment
+//! ```
+
+const std = @import("std");
+const builtin = @import("builtin");
+const headers = @import("headers.zig");
+const simd = @import("simd.zig");
+const EtherType = headers.EtherType;
+const IpProto = headers.IpProto;
+
+/// Default headroom reserved in front of received data: room for an
+/// Ethernet header plus a platform protocol header (utun AF / TUN PI).
+pub const default_headroom: usize = 64;
+
+/// Smallest IPv4 MTU (RFC 791)
+pub const min_mtu: u32 = 68;
+
+/// Largest MTU supported end to end (limit of the IP length fields)
+pub const max_mtu: u32 = 65535;
+
+/// Default interface MTU
+pub const default_mtu: u32 = 1500;
+
+/// Largest Ethernet frame (without FCS) carried at a given MTU
+pub fn maxFrameSize(mtu: u32) usize {
+    return @as(usize, mtu) + headers.Ethernet.size;
+}
+
+/// Buffer size that holds a full frame at `mtu` after `headroom`
+pub fn bufferSizeForMtu(mtu: u32, headroom: usize) usize {
+    return headroom + maxFrameSize(mtu);
+}
+
+/// Maximum number of segments gathered into one device write
+pub const max_segments: usize = 64;
+
+/// First header present in the data when parsing starts
+pub const Layer = enum {
+    ethernet,
+    ip,
+};
+
+pub const Packet = struct {
+    /// Backing storage (headroom + data + tailroom)
+    buf: []u8,
+    /// Offset of the first data byte within `buf`
+    head: usize,
+    /// Number of data bytes
+    len: usize,
+
+    // Parse results (absolute offsets into `buf`, stable across push/pull)
+    l2_offset: ?u32 = null,
+    l3_offset: ?u32 = null,
+    l4_offset: ?u32 = null,
+    ethertype: u16 = 0,
+    ip_proto: u8 = 0,
+    src_port: u16 = 0,
+    dst_port: u16 = 0,
+    /// Direction-independent 5-tuple hash (0 if not IP)
+    flow_hash: u32 = 0,
+    /// Receive timestamp (nanoseconds, 0 if not stamped)
+    timestamp_ns: i64 = 0,
+    flags: Flags = .{},
+    /// Next segment of a chained packet (null for single-buffer packets)
+    next: ?*Packet = null,
+
+    const Self = @This();
+
+    pub const Flags = packed struct(u16) {
+        parsed: bool = false,
+        ipv4: bool = false,
+        ipv6: bool = false,
+        /// Non-first IPv4 or IPv6 fragment (no L4 header present)
+        fragment: bool = false,
+        broadcast: bool = false,
+        multicast: bool = false,
+        _reserved: u10 = 0,
+    };
+
+    /// Empty packet over `buf` with `headroom` bytes reserved in front
+    pub fn init(buf: []u8, headroom: usize) Self {
+        std.debug.assert(headroom <= buf.len);
+        return .{ .buf = buf, .head = headroom, .len = 0 };
+    }
+
+    /// Packet describing `len` bytes already present at `buf[offset..]`
+    pub fn fromBuffer(buf: []u8, offset: usize, len: usize) !Self {
+        if (offset + len > buf.len) return error.InvalidPacket;
+        return .{ .buf = buf, .head = offset, .len = len };
+    }
+
+    /// Forget data and parse state, keeping the buffer
+    pub fn reset(self: *Self, headroom: usize) void {
+        self.* = init(self.buf, headroom);
+    }
+
+    /// Current packet bytes
+    pub fn data(self: *const Self) []u8 {
+        return self.buf[self.head..][0..self.len];
+    }
+
+    /// Free space in front of the data
+    pub fn headroom(self: *const Self) usize {
+        return self.head;
+    }
+
+    /// Free space after the data
+    pub fn tailroom(self: *const Self) usize {
+        return self.buf.len - self.head - self.len;
+    }
+
+    /// Writable space after the data (for reading a packet in)
+    pub fn tail(self: *const Self) []u8 {
+        return self.buf[self.head + self.len ..];
+    }
+
+    /// Prepend `n` bytes using headroom; returns the new header bytes
+    pub fn push(self: *Self, n: usize) ![]u8 {
+        if (n > self.head) return error.NoHeadroom;
+        self.head -= n;
+        self.len += n;
+        return self.buf[self.head..][0..n];
+    }
+
+    /// Remove `n` bytes from the front; returns the removed bytes
+    pub fn pull(self: *Self, n: usize) ![]u8 {
+        if (n > self.len) return error.InvalidPacket;
+        const removed = self.buf[self.head..][0..n];
+        self.head += n;
+        self.len -= n;
+        return removed;
+    }
+
+    /// Append `n` bytes using tailroom; returns the new bytes
+    pub fn put(self: *Self, n: usize) ![]u8 {
+        if (n > self.tailroom()) return error.NoTailroom;
+        const added = self.buf[self.head + self.len ..][0..n];
+        self.len += n;
+        return added;
+    }
+
+    /// Shrink the data to `new_len` bytes
+    pub fn trim(self: *Self, new_len: usize) void {
+        std.debug.assert(new_len <= self.len);
+        self.len = new_len;
+    }
+
+    /// Set the receive timestamp to now
+    pub fn stamp(self: *Self) void {
+        self.timestamp_ns = @intCast(std.time.nanoTimestamp());
+    }
+
+    /// Link `seg` (and any segments chained to it) after the last segment
+    pub fn append(self: *Self, seg: *Packet) void {
+        var last = self;
+        while (last.next) |n| last = n;
+        last.next = seg;
+    }
+
+    /// True if the packet spans more than one segment
+    pub fn isChained(self: *const Self) bool {
+        return self.next != null;
+    }
+
+    /// Number of segments in the chain (1 for a single-buffer packet)
+    pub fn segmentCount(self: *const Self) usize {
+        var count: usize = 1;
+        var seg = self.next;
+        while (seg) |s| : (seg = s.next) count += 1;
+        return count;
+    }
+
+    /// Total data bytes across all segments
+    pub fn totalLen(self: *const Self) usize {
+        var total = self.len;
+        var seg = self.next;
+        while (seg) |s| : (seg = s.next) total += s.len;
+        return total;
+    }
+
+    /// Fill `iov` with one entry per non-empty segment for gather writes
+    pub fn gather(self: *const Self, iov: []std.posix.iovec_const) ![]std.posix.iovec_const {
+        var count: usize = 0;
+        var seg: ?*const Packet = self;
+        while (seg) |s| : (seg = s.next) {
+            if (s.len == 0) continue;
+            if (count == iov.len) return error.TooManySegments;
+            iov[count] = .{ .base = s.buf.ptr + s.head, .len = s.len };
+            count += 1;
+        }
+        return iov[0..count];
+    }
+
+    /// Copy the whole chain into `dst` and return the contiguous bytes
+    pub fn linearize(self: *const Self, dst: []u8) ![]u8 {
+        if (self.totalLen() > dst.len) return error.BufferTooSmall;
+        var off: usize = 0;
+        var seg: ?*const Packet = self;
+        const copy = simd.kernels().copy;
+        while (seg) |s| : (seg = s.next) {
+            copy(dst[off..][0..s.len], s.data());
+            off += s.len;
+        }
+        return dst[0..off];
+    }
+
+    /// Pull the following segments into this segment's tailroom and unlink
+    /// them. Returns the detached segments so the caller can release them.
+    pub fn collapse(self: *Self) !?*Packet {
+        const rest = self.next orelse return null;
+        if (rest.totalLen() > self.tailroom()) return error.NoTailroom;
+        var seg: ?*Packet = rest;
+        while (seg) |s| : (seg = s.next) {
+            @memcpy(self.put(s.len) catch unreachable, s.data());
+        }
+        self.next = null;
+        return rest;
+    }
+
+    /// L3 (IP) bytes, if parsed
+    pub fn l3(self: *const Self) ?[]u8 {
+        const off = self.l3_offset orelse return null;
+        if (off < self.head or off > self.head + self.len) return null;
+        return self.buf[off .. self.head + self.len];
+    }
+
+    /// L4 bytes, if parsed
+    pub fn l4(self: *const Self) ?[]u8 {
+        const off = self.l4_offset orelse return null;
+        if (off < self.head or off > self.head + self.len) return null;
+        return self.buf[off .. self.head + self.len];
+    }
+
+    /// IPv4 source address, if this is a parsed IPv4 packet
+    pub fn ipv4Src(self: *const Self) ?u32 {
+        if (!self.flags.ipv4) return null;
+        const ip = headers.Ipv4.view(self.l3() orelse return null) catch return null;
+        return ip.get(.src_ip);
+    }
+
+    /// Parse headers once, starting at `first`, and cache the results
+    pub fn parse(self: *Self, first: Layer) !void {
+        const end = self.head + self.len;
+        var off = self.head;
+
+        self.l2_offset = null;
+        self.l3_offset = null;
+        self.l4_offset = null;
+        self.ip_proto = 0;
+        self.src_port = 0;
+        self.dst_port = 0;
+        self.flow_hash = 0;
+        self.flags = .{ .parsed = true };
+
+        switch (first) {
+            .ethernet => {
+                const eth = try headers.Ethernet.view(self.buf[off..end]);
+                self.l2_offset = @intCast(off);
+                self.ethertype = eth.get(.ethertype);
+
+                const dst = eth.raw(.dst_mac);
+                self.flags.broadcast = std.mem.allEqual(u8, dst, 0xFF);
+                self.flags.multicast = !self.flags.broadcast and (dst[0] & 0x01) != 0;
+                off += headers.Ethernet.size;
+            },
+            .ip => {
+                self.ethertype = switch (headers.ipVersion(self.buf[off..end])) {
+                    4 => EtherType.ipv4,
+                    6 => EtherType.ipv6,
+                    else => return error.InvalidPacket,
+                };
+            },
+        }
+
+        self.l3_offset = @intCast(off);
+        const l3_bytes = self.buf[off..end];
+
+        switch (self.ethertype) {
+            EtherType.ipv4 => {
+                const ip = try headers.Ipv4.view(l3_bytes);
+                const ihl = headers.ipv4HeaderLen(ip);
+                if (ihl < headers.Ipv4.size or ihl > l3_bytes.len) return error.InvalidPacket;
+
+                self.flags.ipv4 = true;
+                self.ip_proto = ip.get(.protocol);
+                self.flags.fragment = (ip.get(.flags_fragment) & 0x1FFF) != 0;
+                if (!self.flags.fragment) self.l4_offset = @intCast(off + ihl);
+
+                self.parsePorts();
+                self.flow_hash = flowHash(ip.raw(.src_ip), ip.raw(.dst_ip), self.ip_proto, self.src_port, self.dst_port);
+            },
+            EtherType.ipv6 => {
+                const ip = try headers.Ipv6.view(l3_bytes);
+                // Cached once here so flow hashing and L4 consumers never re-walk the chain
+                const upper = try headers.ipv6UpperLayer(l3_bytes);
+
+                self.flags.ipv6 = true;
+                self.ip_proto = upper.protocol;
+                self.flags.fragment = upper.fragment;
+                if (!upper.fragment) self.l4_offset = @intCast(off + upper.offset);
+
+                self.parsePorts();
+                self.flow_hash = flowHash(ip.raw(.src_ip), ip.raw(.dst_ip), self.ip_proto, self.src_port, self.dst_port);
+            },
+            else => {},
+        }
+    }
+
+    fn parsePorts(self: *Self) void {
+        if (self.ip_proto != IpProto.tcp and self.ip_proto != IpProto.udp) return;
+        const l4_bytes = self.l4() orelse return;
+        if (l4_bytes.len < 4) return;
+        self.src_port = std.mem.readInt(u16, l4_bytes[0..2], .big);
+        self.dst_port = std.mem.readInt(u16, l4_bytes[2..4], .big);
+    }
+};
+
+/// Symmetric 5-tuple hash: both directions of a flow hash to the same value
+pub fn flowHash(src: []const u8, dst: []const u8, proto: u8, src_port: u16, dst_port: u16) u32 {
+    const order = std.mem.order(u8, src, dst);
+    const swap = order == .gt or (order == .eq and src_port > dst_port);
+    const lo_addr = if (swap) dst else src;
+    const hi_addr = if (swap) src else dst;
+    const lo_port = if (swap) dst_port else src_port;
+    const hi_port = if (swap) src_port else dst_port;
+
+    var ports: [5]u8 = undefined;
+    std.mem.writeInt(u16, ports[0..2], lo_port, .big);
+    std.mem.writeInt(u16, ports[2..4], hi_port, .big);
+    ports[4] = proto;
+
+    var hasher = std.hash.Wyhash.init(0);
+    hasher.update(lo_addr);
+    hasher.update(hi_addr);
+    hasher.update(&ports);
+    return @truncate(hasher.final());
+}
+
+/// Huge page size used for pool slabs (x86-64 and arm64 default)
+pub const huge_page_size: usize = 2 * 1024 * 1024;
+
+/// Where a pool's slab came from
+pub const SlabBacking = enum {
+    allocator, // The pool's allocator (4 KB pages)
+    hugetlb, // Explicit huge pages (MAP_HUGETLB; needs vm.nr_hugepages)
+    transparent, // Anonymous mapping advised for transparent huge pages
+};
+
+pub const PoolOptions = struct {
+    /// Back the slab with 2 MB pages: MAP_HUGETLB, else THP via madvise,
+    /// else the allocator. Linux only; elsewhere the allocator is used.
+    huge_pages: bool = false,
+    /// Touch every page at init so the data path never takes a first-touch fault
+    prefault: bool = false,
+};
+
+/// Fixed-size pool of packet buffers carved from one slab.
+/// Not thread-safe: each worker owns its own pool.
+pub const PacketPool = struct {
+    allocator: std.mem.Allocator,
+    slab: []u8,
+    packets: []Packet,
+    free_list: std.ArrayList(u32),
+    buffer_size: usize,
+    headroom: usize,
+    backing: SlabBacking,
+    mapping: []align(std.heap.page_size_min) u8, // Whole mapping (empty for .allocator)
+
+    const Self = @This();
+
+    pub fn init(allocator: std.mem.Allocator, count: usize, buffer_size: usize, headroom: usize) !Self {
+        return initWithOptions(allocator, count, buffer_size, headroom, .{});
+    }
+
+    pub fn initWithOptions(
+        allocator: std.mem.Allocator,
+        count: usize,
+        buffer_size: usize,
+        headroom: usize,
+        options: PoolOptions,
+    ) !Self {
+        if (headroom >= buffer_size) return error.InvalidConfiguration;
+        const slab_size = count * buffer_size;
+
+        var backing = SlabBacking.allocator;
+        var mapping: []align(std.heap.page_size_min) u8 = &.{};
+        if (options.huge_pages) {
+            if (mapHugeSlab(slab_size, options.prefault)) |mapped| {
+                backing = mapped.backing;
+                mapping = mapped.bytes;
+            } else |_| {}
+        }
+        errdefer if (backing != .allocator) std.posix.munmap(mapping);
+
+        const slab = if (backing == .allocator) try allocator.alloc(u8, slab_size) else mapping[0..slab_size];
+        errdefer if (backing == .allocator) allocator.free(slab);
+        if (options.prefault and backing != .hugetlb) prefault(slab);
+
+        const packets = try allocator.alloc(Packet, count);
+        errdefer allocator.free(packets);
+
+        var free_list = std.ArrayList(u32){};
+        errdefer free_list.deinit(allocator);
+        try free_list.ensureTotalCapacity(allocator, count);
+
+        for (packets, 0..) |*pkt, i| {
+            pkt.* = Packet.init(slab[i * buffer_size ..][0..buffer_size], headroom);
+            free_list.appendAssumeCapacity(@intCast(count - 1 - i));
+        }
+
+        return .{
+            .allocator = allocator,
+            .slab = slab,
+            .packets = packets,
+            .free_list = free_list,
+            .buffer_size = buffer_size,
+            .headroom = headroom,
+            .backing = backing,
+            .mapping = mapping,
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        self.free_list.deinit(self.allocator);
+        self.allocator.free(self.packets);
+        switch (self.backing) {
+            .allocator => self.allocator.free(self.slab),
+            .hugetlb, .transparent => std.posix.munmap(self.mapping),
+        }
+    }
+
+    /// Take a fresh packet (null if the pool is exhausted)
+    pub fn get(self: *Self) ?*Packet {
+        const index = self.free_list.pop() orelse return null;
+        const pkt = &self.packets[index];
+        pkt.reset(self.headroom);
+        return pkt;
+    }
+
+    /// Return a packet obtained from `get`
+    pub fn put(self: *Self, pkt: *Packet) void {
+        const index = (@intFromPtr(pkt) - @intFromPtr(self.packets.ptr)) / @sizeOf(Packet);
+        std.debug.assert(index < self.packets.len);
+        pkt.next = null;
+        self.free_list.appendAssumeCapacity(@intCast(index));
+    }
+
+    /// Return every segment of a chain obtained from this pool
+    pub fn putChain(self: *Self, pkt: *Packet) void {
+        var seg: ?*Packet = pkt;
+        while (seg) |s| {
+            seg = s.next;
+            self.put(s);
+        }
+    }
+
+    /// Number of packets currently available
+    pub fn available(self: *const Self) usize {
+        return self.free_list.items.len;
+    }
+};
+
+const MappedSlab = struct {
+    bytes: []align(std.heap.page_size_min) u8,
+    backing: SlabBacking,
+};
+
+/// Map a slab of at least `len` bytes on 2 MB pages
+fn mapHugeSlab(len: usize, populate: bool) !MappedSlab {
+    if (builtin.os.tag != .linux) return error.UnsupportedPlatform;
+    const posix = std.posix;
+    const linux = std.os.linux;
+    const size = std.mem.alignForward(usize, len, huge_page_size);
+    const prot = posix.PROT.READ | posix.PROT.WRITE;
+
+    // Explicit huge pages; MAP_POPULATE faults them all in up front
+    if (posix.mmap(null, size, prot, .{ .TYPE = .PRIVATE, .ANONYMOUS = true, .HUGETLB = true, .POPULATE = populate }, -1, 0)) |bytes| {
+        return .{ .bytes = bytes, .backing = .hugetlb };
+    } else |_| {}
+
+    // THP only backs 2 MB-aligned ranges: over-map, then trim both ends
+    const raw = try posix.mmap(null, size + huge_page_size, prot, .{ .TYPE = .PRIVATE, .ANONYMOUS = true }, -1, 0);
+    const lead = std.mem.alignForward(usize, @intFromPtr(raw.ptr), huge_page_size) - @intFromPtr(raw.ptr);
+    if (lead > 0) posix.munmap(raw[0..lead]);
+    posix.munmap(@alignCast(raw[lead + size ..]));
+
+    const bytes: []align(std.heap.page_size_min) u8 = @alignCast(raw[lead..][0..size]);
+    // Without THP enabled the mapping still works on normal pages
+    posix.madvise(bytes.ptr, bytes.len, linux.MADV.HUGEPAGE) catch {};
+    return .{ .bytes = bytes, .backing = .transparent };
+}
+
+/// Write one byte per page so every page is resident before traffic starts
+pub fn prefault(bytes: []u8) void {
+    const page = std.heap.pageSize();
+    var offset: usize = 0;
+    while (offset < bytes.len) : (offset += page) {
+        @as(*volatile u8, &bytes[offset]).* = 0;
+    }
+}
+
+test "Packet push/pull in place" {
+    var storage: [128]u8 = undefined;
+    var pkt = Packet.init(&storage, default_headroom);
+
+    const payload = try pkt.put(20);
+    @memset(payload, 0xAB);
+    try std.testing.expectEqual(@as(usize, default_headroom), pkt.headroom());
+
+    const eth = try pkt.push(headers.Ethernet.size);
+    try std.testing.expectEqual(@as(usize, 14), eth.len);
+    try std.testing.expectEqual(@as(usize, 34), pkt.len);
+
+    _ = try pkt.pull(headers.Ethernet.size);
+    try std.testing.expectEqual(@as(usize, 20), pkt.len);
+    try std.testing.expectError(error.NoHeadroom, pkt.push(default_headroom + 1));
+}
+
+test "Packet parse caches offsets and symmetric flow hash" {
+    var storage: [128]u8 = [_]u8{0} ** 128;
+    var pkt = Packet.init(&storage, 32);
+    const frame = try pkt.put(headers.Ethernet.size + headers.Ipv4.size + headers.Udp.size);
+
+    const eth = try headers.Ethernet.viewMut(frame);
+    eth.set(.dst_mac, [_]u8{0xFF} ** 6);
+    eth.set(.ethertype, EtherType.ipv4);
+    const ip = try headers.Ipv4.viewMut(frame[headers.Ethernet.size..]);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.protocol, IpProto.udp);
+    ip.set(.src_ip, 0x0A000001);
+    ip.set(.dst_ip, 0x0A000002);
+    const udp = try headers.Udp.viewMut(frame[headers.Ethernet.size + headers.Ipv4.size ..]);
+    udp.set(.src_port, 5000);
+    udp.set(.dst_port, 53);
+
+    try pkt.parse(.ethernet);
+    try std.testing.expect(pkt.flags.ipv4 and pkt.flags.broadcast);
+    try std.testing.expectEqual(@as(?u32, 32), pkt.l2_offset);
+    try std.testing.expectEqual(@as(?u32, 46), pkt.l3_offset);
+    try std.testing.expectEqual(@as(?u32, 66), pkt.l4_offset);
+    try std.testing.expectEqual(@as(u16, 53), pkt.dst_port);
+    try std.testing.expectEqual(@as(?u32, 0x0A000001), pkt.ipv4Src());
+
+    const a = [_]u8{ 10, 0, 0, 1 };
+    const b = [_]u8{ 10, 0, 0, 2 };
+    try std.testing.expectEqual(pkt.flow_hash, flowHash(&b, &a, IpProto.udp, 53, 5000));
+}
+
+test "Packet parse finds IPv6 ports behind extension headers" {
+    var storage: [128]u8 = [_]u8{0} ** 128;
+    var pkt = Packet.init(&storage, 0);
+    const ip_packet = try pkt.put(headers.Ipv6.size + 8 + headers.Udp.size);
+
+    ip_packet[0] = 0x60;
+    ip_packet[6] = IpProto.ipv6_hop_by_hop;
+    ip_packet[headers.Ipv6.size] = IpProto.udp;
+    const udp = try headers.Udp.viewMut(ip_packet[headers.Ipv6.size + 8 ..]);
+    udp.set(.src_port, 546);
+    udp.set(.dst_port, 547);
+
+    try pkt.parse(.ip);
+    try std.testing.expect(pkt.flags.ipv6 and !pkt.flags.fragment);
+    try std.testing.expectEqual(IpProto.udp, pkt.ip_proto);
+    try std.testing.expectEqual(@as(?u32, 48), pkt.l4_offset);
+    try std.testing.expectEqual(@as(u16, 547), pkt.dst_port);
+}
+
+test "Packet chain gather, linearize and collapse" {
+    var pool = try PacketPool.init(std.testing.allocator, 4, 256, default_headroom);
+    defer pool.deinit();
+
+    const head = pool.get().?;
+    @memset(try head.push(headers.Ethernet.size), 0xEE);
+    for (0..2) |i| {
+        const seg = pool.get().?;
+        @memset(try seg.put(90), @intCast(i));
+        head.append(seg);
+    }
+
+    try std.testing.expect(head.isChained());
+    try std.testing.expectEqual(@as(usize, 3), head.segmentCount());
+    try std.testing.expectEqual(@as(usize, 194), head.totalLen());
+
+    var iov: [max_segments]std.posix.iovec_const = undefined;
+    const vec = try head.gather(&iov);
+    try std.testing.expectEqual(@as(usize, 3), vec.len);
+    try std.testing.expectEqual(@as(usize, 14), vec[0].len);
+
+    var flat: [256]u8 = undefined;
+    const bytes = try head.linearize(&flat);
+    try std.testing.expectEqual(@as(u8, 0xEE), bytes[13]);
+    try std.testing.expectEqual(@as(u8, 1), bytes[193]);
+    try std.testing.expectError(error.BufferTooSmall, head.linearize(flat[0..100]));
+
+    const detached = (try head.collapse()).?;
+    try std.testing.expect(!head.isChained());
+    try std.testing.expectEqualSlices(u8, bytes, head.data());
+    pool.putChain(detached);
+    pool.put(head);
+    try std.testing.expectEqual(@as(usize, 4), pool.available());
+}
+
+test "PacketPool get/put" {
+    var pool = try PacketPool.init(std.testing.allocator, 4, 256, default_headroom);
+    defer pool.deinit();
+
+    const a = pool.get().?;
+    const b = pool.get().?;
+    try std.testing.expect(a != b);
+    try std.testing.expectEqual(@as(usize, 2), pool.available());
+
+    _ = try a.put(100);
+    pool.put(a);
+    const c = pool.get().?;
+    try std.testing.expectEqual(@as(usize, 0), c.len);
+    try std.testing.expectEqual(@as(usize, default_headroom), c.headroom());
+    pool.put(b);
+    pool.put(c);
+    try std.testing.expectEqual(@as(usize, 4), pool.available());
+}
+
+test "PacketPool with huge pages falls back and stays usable" {
+    var pool = try PacketPool.initWithOptions(std.testing.allocator, 64, 2048, default_headroom, .{
+        .huge_pages = true,
+        .prefault = true,
+    });
+    defer pool.deinit();
+
+    // Whatever backing the host allows, the slab is one contiguous range
+    if (pool.backing != .allocator) {
+        try std.testing.expect(std.mem.isAligned(@intFromPtr(pool.slab.ptr), huge_page_size));
+        try std.testing.expect(pool.mapping.len >= pool.slab.len);
+    }
+    try std.testing.expectEqual(@as(usize, 64 * 2048), pool.slab.len);
+
+    const pkt = pool.get().?;
+    @memset(try pkt.put(1500), 0x5A);
+    try std.testing.expectEqual(@as(u8, 0x5A), pkt.data()[1499]);
+    pool.put(pkt);
+    try std.testing.expectEqual(@as(usize, 64), pool.available());
+}
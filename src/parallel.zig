@@ -0,0 +1,398 @@
+//! Ordered Parallel Translation
+//!
+//! Flow-hash dispatch keeps each flow on one core, so a single elephant flow is
+//! translated at one core's speed however many cores there are. `Pipeline`
+//! spreads batches instead of flows and puts them back in order afterwards:
+//!
+//! - The reader thread fills a batch and submits it; submission numbers it.
+//! - A pool of workers translates batches. Each worker has its own queue of
+//!   sequence numbers, dealt round-robin, and steals from the others' queues
+//!   when its own is empty, so a slow batch does not strand the work queued
+//!   behind it.
+//! - Batches live in a ring of `window` slots indexed by sequence number, which
+//!   is also the reorder buffer: a worker marks its slot done, and the writer
+//!   thread only takes the slot it expects next, so a batch finished early waits
+//!   for those before it. At most `window` batches are in flight.
+//!
+//! Nothing takes a lock. A worker that finds no work spins briefly, then parks
+//! until the reader submits to its queue.
+//!
+//! Each worker owns a `Context`, normally its own translator, so translator
+//! features with side effects would split their state across workers. `create`
+//! rejects those: the DNS cache and multicast snooping in both directions, a
+//! tunnel MTU (its ICMP replies queue per translator), and inbound ARP handling,
+//! split-tunnel snooping, PMTU probing and the control plane (its ring has a
+//! single producer). Outbound workers may share a `ControlPlane`, as they only
+//! read its published state. Divert control frames before inbound dispatch.
+//!
+//! ```zig
+//! const pipeline = try OutboundPipeline.create(allocator, worker_translators, 64);
+//! defer pipeline.destroy();
+//! try pipeline.start();
+//!
+//! // TUN read thread
+//! if (pipeline.reserve()) |batch| {
+//!     batch.len = readBurst(&batch.packets);
+//!     pipeline.submit();
+//! }
+//!
+//! // VPN send thread
+//! while (pipeline.next()) |batch| {
+//!     sendDelivered(batch);
+//!     pipeline.release();
+//! }
+//! ```
+
+const std = @import("std");
+const packet = @import("packet.zig");
+const Packet = packet.Packet;
+const headers = @import("headers.zig");
+const simd = @import("simd.zig");
+const L2L3Translator = @import("translator.zig").L2L3Translator;
+
+/// Empty polls before an idle worker parks
+const idle_spins = 64;
+
+/// Reader → workers → writer pipeline that keeps batches in submission order
+/// `process` runs on a worker thread with that worker's context; `accepts`, if
+/// given, vets each context in `create`. Heap-allocated (`create`) since
+/// workers hold a pointer to it.
+pub fn Pipeline(
+    comptime Batch: type,
+    comptime Context: type,
+    comptime process: fn (*Context, *Batch) void,
+    comptime accepts: ?fn (*const Context) bool,
+) type {
+    return struct {
+        allocator: std.mem.Allocator,
+        slots: []Slot,
+        queues: []Queue,
+        contexts: []Context,
+        threads: []std.Thread,
+        running: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+        started: usize = 0,
+
+        seqs: []std.atomic.Value(usize), // Backing for every queue
+
+        /// Sequence number of the next batch to submit (reader only)
+        next_submit: usize = 0,
+        /// Sequence number of the next batch to write; slots behind it are free
+        next_write: std.atomic.Value(usize) align(std.atomic.cache_line) = std.atomic.Value(usize).init(0),
+
+        // Statistics
+        batches: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+        steals: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+
+        const Self = @This();
+
+        const Slot = struct {
+            batch: Batch,
+            /// Sequence number + 1 once translated; compared by the writer
+            done: std.atomic.Value(usize) align(std.atomic.cache_line) = std.atomic.Value(usize).init(0),
+        };
+
+        /// Sequence numbers for one worker: pushed by the reader, popped by any worker
+        const Queue = struct {
+            head: std.atomic.Value(usize) align(std.atomic.cache_line) = std.atomic.Value(usize).init(0),
+            tail: std.atomic.Value(usize) align(std.atomic.cache_line) = std.atomic.Value(usize).init(0),
+            seqs: []std.atomic.Value(usize),
+            /// Set while the owning worker sleeps on `wake`
+            parked: std.atomic.Value(bool) align(std.atomic.cache_line) = std.atomic.Value(bool).init(false),
+            wake: std.Thread.ResetEvent = .{},
+
+            /// Never full: a queue holds at most the batches in flight
+            fn push(self: *Queue, seq: usize) void {
+                const tail = self.tail.load(.monotonic);
+                self.seqs[tail & (self.seqs.len - 1)].store(seq, .monotonic);
+                self.tail.store(tail +% 1, .release);
+            }
+
+            fn pop(self: *Queue) ?usize {
+                var head = self.head.load(.acquire);
+                while (head != self.tail.load(.acquire)) {
+                    const seq = self.seqs[head & (self.seqs.len - 1)].load(.monotonic);
+                    // A stale read loses the race for head and is retried
+                    head = self.head.cmpxchgWeak(head, head +% 1, .acq_rel, .acquire) orelse return seq;
+                }
+                return null;
+            }
+        };
+
+        /// One worker per context; `contexts` must outlive the pipeline
+        /// `window` (a power of two) bounds the batches in flight.
+        pub fn create(allocator: std.mem.Allocator, contexts: []Context, window: usize) !*Self {
+            if (contexts.len == 0 or !std.math.isPowerOfTwo(window)) return error.InvalidConfiguration;
+            if (accepts) |accept| {
+                for (contexts) |*context| if (!accept(context)) return error.InvalidConfiguration;
+            }
+
+            const self = try allocator.create(Self);
+            errdefer allocator.destroy(self);
+            const slots = try allocator.alloc(Slot, window);
+            errdefer allocator.free(slots);
+            for (slots) |*slot| slot.* = .{ .batch = undefined };
+
+            const queues = try allocator.alloc(Queue, contexts.len);
+            errdefer allocator.free(queues);
+            const seqs = try allocator.alloc(std.atomic.Value(usize), window * contexts.len);
+            errdefer allocator.free(seqs);
+            for (queues, 0..) |*queue, i| queue.* = .{ .seqs = seqs[i * window ..][0..window] };
+
+            self.* = .{
+                .allocator = allocator,
+                .slots = slots,
+                .queues = queues,
+                .contexts = contexts,
+                .seqs = seqs,
+                .threads = try allocator.alloc(std.Thread, contexts.len),
+            };
+            return self;
+        }
+
+        pub fn destroy(self: *Self) void {
+            self.stop();
+            self.allocator.free(self.threads);
+            self.allocator.free(self.seqs);
+            self.allocator.free(self.queues);
+            self.allocator.free(self.slots);
+            self.allocator.destroy(self);
+        }
+
+        pub fn start(self: *Self) !void {
+            if (self.started > 0) return;
+            self.running.store(true, .release);
+            errdefer self.stop();
+            for (self.threads, 0..) |*thread, i| {
+                thread.* = try std.Thread.spawn(.{}, run, .{ self, i });
+                self.started += 1;
+            }
+        }
+
+        /// Stop and join the workers; batches not yet translated stay unfinished
+        pub fn stop(self: *Self) void {
+            self.running.store(false, .release);
+            for (self.queues) |*queue| {
+                _ = queue.parked.swap(false, .seq_cst);
+                queue.wake.set();
+            }
+            for (self.threads[0..self.started]) |thread| thread.join();
+            self.started = 0;
+        }
+
+        // ───────────────────────────────────────────────────────────────────
+        // Reader side (one thread)
+        // ───────────────────────────────────────────────────────────────────
+
+        /// Batch to fill next, or null while `window` batches are in flight
+        pub fn reserve(self: *Self) ?*Batch {
+            if (self.next_submit -% self.next_write.load(.acquire) >= self.slots.len) return null;
+            return &self.slots[self.next_submit & (self.slots.len - 1)].batch;
+        }
+
+        /// Hand the batch from `reserve` to the workers
+        pub fn submit(self: *Self) void {
+            const seq = self.next_submit;
+            const queue = &self.queues[seq % self.queues.len];
+            queue.push(seq);
+            self.next_submit = seq +% 1;
+            // Read-modify-write on both sides: either the worker sees the push or we see it parked
+            if (queue.parked.swap(false, .seq_cst)) queue.wake.set();
+        }
+
+        // ───────────────────────────────────────────────────────────────────
+        // Writer side (one thread)
+        // ───────────────────────────────────────────────────────────────────
+
+        /// Oldest batch, once translated; null while it is still being worked on
+        pub fn next(self: *Self) ?*Batch {
+            const seq = self.next_write.load(.monotonic);
+            const slot = &self.slots[seq & (self.slots.len - 1)];
+            if (slot.done.load(.acquire) != seq +% 1) return null;
+            return &slot.batch;
+        }
+
+        /// Free the batch returned by `next` for the reader
+        pub fn release(self: *Self) void {
+            self.next_write.store(self.next_write.load(.monotonic) +% 1, .release);
+        }
+
+        // ───────────────────────────────────────────────────────────────────
+        // Workers
+        // ───────────────────────────────────────────────────────────────────
+
+        fn run(self: *Self, index: usize) void {
+            const queue = &self.queues[index];
+            var idle: u32 = 0;
+            while (self.running.load(.acquire)) {
+                const seq = self.take(index) orelse {
+                    idle += 1;
+                    if (idle < idle_spins) {
+                        std.atomic.spinLoopHint();
+                        continue;
+                    }
+                    idle = 0;
+                    // Announce the park, then look once more before sleeping
+                    queue.wake.reset();
+                    _ = queue.parked.swap(true, .seq_cst);
+                    if (queue.head.load(.acquire) == queue.tail.load(.acquire) and self.running.load(.acquire)) {
+                        queue.wake.wait();
+                    }
+                    queue.parked.store(false, .monotonic);
+                    continue;
+                };
+                idle = 0;
+
+                const slot = &self.slots[seq & (self.slots.len - 1)];
+                process(&self.contexts[index], &slot.batch);
+                slot.done.store(seq +% 1, .release);
+                _ = self.batches.fetchAdd(1, .monotonic);
+            }
+        }
+
+        /// Own queue first, then steal from the others in turn
+        fn take(self: *Self, index: usize) ?usize {
+            if (self.queues[index].pop()) |seq| return seq;
+            for (1..self.queues.len) |offset| {
+                if (self.queues[(index + offset) % self.queues.len].pop()) |seq| {
+                    _ = self.steals.fetchAdd(1, .monotonic);
+                    return seq;
+                }
+            }
+            return null;
+        }
+    };
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Translator stages
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// A burst of packets translated as one batch
+pub const PacketBatch = struct {
+    packets: [simd.max_burst]Packet = undefined,
+    len: usize = 0,
+    /// Bit i set if `packets[i]` was translated and should be sent
+    delivered: u64 = 0,
+};
+
+/// IP → Ethernet in place; packets the translator rejects are left out of `delivered`
+pub fn translateOutbound(translator: *L2L3Translator, batch: *PacketBatch) void {
+    batch.delivered = 0;
+    for (batch.packets[0..batch.len], 0..) |*pkt, i| {
+        translator.ipToEthernetPacket(pkt) catch continue;
+        batch.delivered |= @as(u64, 1) << @intCast(i);
+    }
+}
+
+/// Ethernet → IP in place through the burst path
+pub fn translateInbound(translator: *L2L3Translator, batch: *PacketBatch) void {
+    batch.delivered = translator.ethernetToIpBurst(batch.packets[0..batch.len]) catch 0;
+}
+
+/// Outbound workers must not queue replies or record state the others need
+pub fn outboundWorkerSafe(translator: *const L2L3Translator) bool {
+    const options = translator.options;
+    return options.dns_cache == null and !options.snoop_multicast and options.tunnel_mtu == null;
+}
+
+/// Inbound workers additionally must not answer ARP, snoop DNS or feed the control ring
+pub fn inboundWorkerSafe(translator: *const L2L3Translator) bool {
+    const options = translator.options;
+    return outboundWorkerSafe(translator) and !options.handle_arp and options.split_tunnel == null and
+        options.control_plane == null and translator.pmtu_prober == null;
+}
+
+pub const OutboundPipeline = Pipeline(PacketBatch, L2L3Translator, translateOutbound, outboundWorkerSafe);
+pub const InboundPipeline = Pipeline(PacketBatch, L2L3Translator, translateInbound, inboundWorkerSafe);
+
+test "Pipeline returns batches in submission order" {
+    const Batch = struct { value: u64, result: u64 };
+    const Context = struct {
+        prng: std.Random.DefaultPrng,
+
+        fn process(self: *@This(), batch: *Batch) void {
+            // Uneven work so later batches often finish first
+            for (0..self.prng.random().uintLessThan(usize, 2000)) |_| std.atomic.spinLoopHint();
+            batch.result = batch.value * 3;
+        }
+    };
+
+    var contexts: [4]Context = undefined;
+    for (&contexts, 0..) |*context, i| context.* = .{ .prng = std.Random.DefaultPrng.init(i) };
+    const pipeline = try Pipeline(Batch, Context, Context.process, null).create(std.testing.allocator, &contexts, 16);
+    defer pipeline.destroy();
+    try pipeline.start();
+
+    const count = 5000;
+    var submitted: u64 = 0;
+    var written: u64 = 0;
+    while (written < count) {
+        if (submitted < count) {
+            if (pipeline.reserve()) |batch| {
+                batch.value = submitted;
+                pipeline.submit();
+                submitted += 1;
+            }
+        }
+        if (pipeline.next()) |batch| {
+            try std.testing.expectEqual(written * 3, batch.result);
+            pipeline.release();
+            written += 1;
+        }
+    }
+    try std.testing.expectEqual(@as(u64, count), pipeline.batches.load(.monotonic));
+}
+
+test "OutboundPipeline translates packet batches" {
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+    var translators: [2]L2L3Translator = undefined;
+    for (&translators) |*translator| {
+        translator.* = try L2L3Translator.init(std.testing.allocator, .{ .our_mac = our_mac, .snoop_multicast = false });
+        translator.gateway_mac = .{ 0x5E, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    }
+    defer for (&translators) |*translator| translator.deinit();
+
+    const pipeline = try OutboundPipeline.create(std.testing.allocator, &translators, 4);
+    defer pipeline.destroy();
+    try pipeline.start();
+
+    var bufs: [2][128]u8 = undefined;
+    const batch = pipeline.reserve().?;
+    batch.len = bufs.len;
+    for (batch.packets[0..bufs.len], &bufs, 0..) |*pkt, *buf, i| {
+        pkt.* = Packet.init(buf, headers.Ethernet.size);
+        const ip_packet = try pkt.put(headers.Ipv4.size);
+        @memset(ip_packet, 0);
+        const ip = try headers.Ipv4.viewMut(ip_packet);
+        // The second packet is not IP at all
+        ip.set(.version_ihl, @as(u8, if (i == 0) 0x45 else 0x05));
+        ip.set(.total_length, headers.Ipv4.size);
+        ip.set(.ttl, 64);
+    }
+    pipeline.submit();
+
+    const done = while (true) {
+        if (pipeline.next()) |b| break b;
+        std.Thread.yield() catch {};
+    };
+    try std.testing.expectEqual(@as(u64, 0b01), done.delivered);
+    try std.testing.expectEqual(headers.Ethernet.size + headers.Ipv4.size, done.packets[0].len);
+    pipeline.release();
+}
+
+test "pipelines reject translators whose side effects would split across workers" {
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+    var translators: [1]L2L3Translator = undefined;
+
+    // Multicast snooping is on by default
+    translators[0] = try L2L3Translator.init(std.testing.allocator, .{ .our_mac = our_mac });
+    try std.testing.expectError(error.InvalidConfiguration, OutboundPipeline.create(std.testing.allocator, &translators, 4));
+    translators[0].deinit();
+
+    // Answering ARP is fine outbound but not inbound
+    translators[0] = try L2L3Translator.init(std.testing.allocator, .{ .our_mac = our_mac, .snoop_multicast = false });
+    defer translators[0].deinit();
+    try std.testing.expectError(error.InvalidConfiguration, InboundPipeline.create(std.testing.allocator, &translators, 4));
+    const pipeline = try OutboundPipeline.create(std.testing.allocator, &translators, 4);
+    pipeline.destroy();
+}
@@ -6,6 +6,11 @@
 ///
 /// PCAP Format: https://wiki.wireshark.org/Development/LibpcapFileFormat
 const std = @import("std");
+const Packet = @import("packet.zig").Packet;
+
+/// Default snapshot length: libpcap's maximum, large enough for a full
+/// 65535-byte jumbo packet plus link-layer header
+pub const default_snaplen: u32 = 262144;
 
 /// PCAP File Header (24 bytes)
 const PcapHeader = packed struct {
@@ -14,7 +19,7 @@ const PcapHeader = packed struct {
     version_minor: u16 = 4, // Minor version
     thiszone: i32 = 0, // GMT to local correction
     sigfigs: u32 = 0, // Accuracy of timestamps
-    snaplen: u32 = 65535, // Max packet length
+    snaplen: u32, // Max captured bytes per packet
     network: u32, // Data link type (1 = Ethernet, 101 = Raw IP)
 };
 
@@ -37,6 +42,7 @@ pub const LinkType = enum(u32) {
 pub const PcapWriter = struct {
     file: std.fs.File,
     allocator: std.mem.Allocator,
+    snaplen: u32,
     packet_count: usize = 0,
     bytes_written: usize = 0,
 
@@ -44,16 +50,25 @@ pub const PcapWriter = struct {
 
     /// Create new PCAP file
     pub fn init(allocator: std.mem.Allocator, filepath: []const u8, link_type: LinkType) !*Self {
+        return initWithSnaplen(allocator, filepath, link_type, default_snaplen);
+    }
+
+    /// Create new PCAP file capturing at most `snaplen` bytes per packet
+    pub fn initWithSnaplen(allocator: std.mem.Allocator, filepath: []const u8, link_type: LinkType, snaplen: u32) !*Self {
+        if (snaplen == 0) return error.InvalidConfiguration;
+
         const file = try std.fs.cwd().createFile(filepath, .{});
         const self = try allocator.create(Self);
 
         self.* = .{
             .file = file,
             .allocator = allocator,
+            .snaplen = snaplen,
         };
 
         // Write PCAP file header
         const header = PcapHeader{
+            .snaplen = snaplen,
             .network = @intFromEnum(link_type),
         };
 
@@ -66,26 +81,52 @@ pub const PcapWriter = struct {
     }
 
     /// Write packet to PCAP file
+    /// Packets longer than the snaplen are truncated (orig_len keeps the real size)
     pub fn writePacket(self: *Self, data: []const u8) !void {
-        const now = std.time.microTimestamp();
-        const ts_sec: u32 = @intCast(@divFloor(now, std.time.us_per_s));
-        const ts_usec: u32 = @intCast(@mod(now, std.time.us_per_s));
+        const incl_len = try self.writeRecordHeader(data.len, std.time.microTimestamp());
+        try self.file.writeAll(data[0..incl_len]);
+        self.finishRecord(incl_len);
+    }
+
+    /// Write a packet descriptor (all chained segments), reusing its receive timestamp if stamped
+    pub fn writeDescriptor(self: *Self, pkt: *const Packet) !void {
+        const ts_us = if (pkt.timestamp_ns != 0)
+            @divFloor(pkt.timestamp_ns, std.time.ns_per_us)
+        else
+            std.time.microTimestamp();
+
+        const incl_len = try self.writeRecordHeader(pkt.totalLen(), ts_us);
+        var remaining = incl_len;
+        var seg: ?*const Packet = pkt;
+        while (seg) |s| : (seg = s.next) {
+            if (remaining == 0) break;
+            const n = @min(remaining, s.len);
+            try self.file.writeAll(s.data()[0..n]);
+            remaining -= n;
+        }
+        self.finishRecord(incl_len);
+    }
+
+    /// Write the per-packet header; returns the number of bytes to capture
+    fn writeRecordHeader(self: *Self, orig_len: usize, timestamp_us: i64) !usize {
+        const ts_sec: u32 = @intCast(@divFloor(timestamp_us, std.time.us_per_s));
+        const ts_usec: u32 = @intCast(@mod(timestamp_us, std.time.us_per_s));
+        const incl_len = @min(orig_len, self.snaplen);
 
         const packet_header = PcapPacketHeader{
             .ts_sec = ts_sec,
             .ts_usec = ts_usec,
-            .incl_len = @intCast(data.len),
-            .orig_len = @intCast(data.len),
+            .incl_len = @intCast(incl_len),
+            .orig_len = @intCast(orig_len),
         };
 
-        // Write packet header
         try self.file.writeAll(std.mem.asBytes(&packet_header));
+        return incl_len;
+    }
 
-        // Write packet data
-        try self.file.writeAll(data);
-
+    fn finishRecord(self: *Self, incl_len: usize) void {
         self.packet_count += 1;
-        self.bytes_written += @sizeOf(PcapPacketHeader) + data.len;
+        self.bytes_written += @sizeOf(PcapPacketHeader) + incl_len;
 
         if (self.packet_count % 100 == 0) {
             std.log.debug("📊 Captured {d} packets ({d} bytes)", .{
@@ -135,6 +176,7 @@ pub const CaptureSession = struct {
     base_filename: []const u8,
     link_type: LinkType,
     max_file_size: usize,
+    snaplen: u32 = default_snaplen,
     current_writer: ?*PcapWriter = null,
     file_index: usize = 0,
 
@@ -179,6 +221,19 @@ pub const CaptureSession = struct {
         try self.current_writer.?.writePacket(data);
     }
 
+    /// Write packet descriptor (with automatic rotation)
+    pub fn writeDescriptor(self: *Self, pkt: *const Packet) !void {
+        if (self.current_writer == null) {
+            try self.start();
+        }
+
+        if (self.current_writer.?.bytes_written + pkt.totalLen() > self.max_file_size) {
+            try self.rotateFile();
+        }
+
+        try self.current_writer.?.writeDescriptor(pkt);
+    }
+
     /// Rotate to new file
     fn rotateFile(self: *Self) !void {
         // Close current writer
@@ -199,7 +254,7 @@ pub const CaptureSession = struct {
         std.log.info("🔄 Rotating to new capture file: {s}", .{filename_owned});
 
         // Create new writer
-        self.current_writer = try PcapWriter.init(self.allocator, filename_owned, self.link_type);
+        self.current_writer = try PcapWriter.initWithSnaplen(self.allocator, filename_owned, self.link_type, self.snaplen);
         self.file_index += 1;
     }
 
@@ -251,6 +306,20 @@ test "PCAP file creation" {
     std.fs.cwd().deleteFile("test.pcap") catch {};
 }
 
+test "PCAP snaplen truncates jumbo frames" {
+    const allocator = std.testing.allocator;
+
+    defer std.fs.cwd().deleteFile("test_snaplen.pcap") catch {};
+    var writer = try PcapWriter.initWithSnaplen(allocator, "test_snaplen.pcap", .ETHERNET, 128);
+    defer writer.deinit();
+
+    const before = writer.bytes_written;
+    const jumbo = [_]u8{0x42} ** 9014;
+    try writer.writePacket(&jumbo);
+
+    try std.testing.expectEqual(before + @sizeOf(PcapPacketHeader) + 128, writer.bytes_written);
+}
+
 test "Capture session with rotation" {
     const allocator = std.testing.allocator;
 
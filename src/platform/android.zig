@@ -20,6 +20,8 @@
 const std = @import("std");
 const builtin = @import("builtin");
 const posix = std.posix;
+const min_mtu = @import("../packet.zig").min_mtu;
+const max_mtu = @import("../packet.zig").max_mtu;
 
 /// Android VPN device using VpnService API
 pub const AndroidVpnDevice = struct {
@@ -51,6 +53,7 @@ pub const AndroidVpnDevice = struct {
         mtu: u32,
     ) !Self {
         if (fd < 0) return error.InvalidFileDescriptor;
+        if (mtu < min_mtu or mtu > max_mtu) return error.InvalidMtu;
 
         // Set non-blocking mode
         const flags = try posix.fcntl(fd, posix.F.GETFL, 0);
@@ -156,6 +159,14 @@ pub const AndroidVpnDevice = struct {
         return self.mtu;
     }
 
+    /// Update the MTU after VpnService.Builder.setMtu() (68..65535)
+    pub fn setMtu(self: *Self, mtu: u32) !void {
+        if (mtu < min_mtu or mtu > max_mtu) {
+            return error.InvalidMtu;
+        }
+        self.mtu = mtu;
+    }
+
     /// Get file descriptor (for polling)
     pub fn getFd(self: *const Self) i32 {
         return self.fd;
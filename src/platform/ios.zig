@@ -17,6 +17,8 @@
 
 const std = @import("std");
 const builtin = @import("builtin");
+const min_mtu = @import("../packet.zig").min_mtu;
+const max_mtu = @import("../packet.zig").max_mtu;
 
 /// iOS VPN device using Network Extension framework
 pub const iOSVpnDevice = struct {
@@ -122,7 +124,7 @@ pub const iOSVpnDevice = struct {
 
     /// Set MTU
     pub fn setMtu(self: *Self, mtu: u32) !void {
-        if (mtu < 68 or mtu > 65535) {
+        if (mtu < min_mtu or mtu > max_mtu) {
             return error.InvalidMtu;
         }
         self.mtu = mtu;
@@ -12,6 +12,8 @@ const std = @import("std");
 const testing = std.testing;
 const posix = std.posix;
 const linux = std.os.linux;
+const min_mtu = @import("../packet.zig").min_mtu;
+const max_mtu = @import("../packet.zig").max_mtu;
 
 // Import C functions for ioctl
 const c = @cImport({
@@ -25,6 +27,7 @@ const TUNSETIFF: u32 = 0x400454ca;
 const TUNSETPERSIST: u32 = 0x400454cb;
 const TUNSETOWNER: u32 = 0x400454cc;
 const TUNSETGROUP: u32 = 0x400454ce;
+const TUNGETIFF: u32 = 0x800454d2;
 
 // Interface flags (from linux/if.h)
 const IFF_TUN: u16 = 0x0001;
@@ -45,6 +48,10 @@ const SIOCSIFMTU: u32 = 0x8922;
 const AF_INET: u16 = 2;
 const AF_INET6: u16 = 10;
 
+// TUN packet information header (struct tun_pi)
+const TUN_PI_SIZE: u32 = 4;
+const ETH_HLEN: u32 = 14;
+
 // Standard file flags
 const O_RDWR: u32 = 0x0002;
 const O_NONBLOCK: u32 = 0x0800;
@@ -79,6 +86,10 @@ pub const LinuxTunConfig = struct {
 
     /// Non-blocking I/O
     non_blocking: bool = true,
+
+    /// Interface MTU to apply on open (null = keep the kernel's current MTU).
+    /// Jumbo values up to 65535 are supported.
+    mtu: ?u32 = null,
 };
 
 /// Linux TUN/TAP device handle
@@ -95,9 +106,12 @@ pub const LinuxTunDevice = struct {
     /// Allocator for operations
     allocator: std.mem.Allocator,
 
-    /// MTU (Maximum Transmission Unit)
+    /// MTU (Maximum Transmission Unit), read from the interface on open
     mtu: u32 = 1500,
 
+    /// Whether packets carry the 4-byte packet information header
+    packet_info: bool = false,
+
     /// Whether non-blocking I/O is enabled
     non_blocking: bool,
 
@@ -113,8 +127,7 @@ pub const LinuxTunDevice = struct {
     /// ```
     pub fn open(allocator: std.mem.Allocator, config: LinuxTunConfig) !*LinuxTunDevice {
         // Open /dev/net/tun device
-        const flags = if (config.non_blocking) O_RDWR | O_NONBLOCK else O_RDWR;
-        const fd = try std.posix.open("/dev/net/tun", .{ .ACCMODE = .RDWR }, flags);
+        const fd = try std.posix.open("/dev/net/tun", .{ .ACCMODE = .RDWR, .NONBLOCK = config.non_blocking }, 0);
         errdefer posix.close(fd);
 
         // Prepare interface request structure
@@ -170,15 +183,55 @@ pub const LinuxTunDevice = struct {
 
         // Allocate and return device
         const device = try allocator.create(LinuxTunDevice);
+        errdefer allocator.destroy(device);
         device.* = LinuxTunDevice{
             .fd = fd,
             .name = device_name,
             .mode = config.mode,
             .allocator = allocator,
             .mtu = 1500,
+            .packet_info = config.packet_info,
             .non_blocking = config.non_blocking,
         };
 
+        // Cache the real interface MTU (it may already be configured for jumbo frames)
+        if (config.mtu) |mtu| {
+            try device.setMtu(mtu);
+        } else {
+            device.refreshMtu() catch {};
+        }
+
+        return device;
+    }
+
+    /// Take over an already attached TUN/TAP fd (e.g. one handed over by a previous
+    /// process, see handover.zig). The interface, its addresses and routes are untouched;
+    /// name, mode, packet info and blocking mode are read back from the fd.
+    pub fn adopt(allocator: std.mem.Allocator, fd: posix.fd_t) !*LinuxTunDevice {
+        var ifr = std.mem.zeroes(c.ifreq);
+        if (c.ioctl(fd, TUNGETIFF, &ifr) < 0) {
+            return error.DeviceNotFound;
+        }
+        const flags: u16 = @bitCast(ifr.ifr_ifru.ifru_flags);
+
+        const device_name_len = std.mem.indexOfScalar(u8, &ifr.ifr_name, 0) orelse c.IFNAMSIZ;
+        var device_name: [16]u8 = undefined;
+        @memset(&device_name, 0);
+        @memcpy(device_name[0..@min(device_name_len, 16)], ifr.ifr_name[0..@min(device_name_len, 16)]);
+
+        const fl = try posix.fcntl(fd, posix.F.GETFL, 0);
+
+        const device = try allocator.create(LinuxTunDevice);
+        device.* = LinuxTunDevice{
+            .fd = fd,
+            .name = device_name,
+            .mode = if (flags & IFF_TAP != 0) .tap else .tun,
+            .allocator = allocator,
+            .mtu = 1500,
+            .packet_info = flags & IFF_NO_PI == 0,
+            .non_blocking = fl & O_NONBLOCK != 0,
+        };
+        device.refreshMtu() catch {};
         return device;
     }
 
@@ -202,24 +255,21 @@ pub const LinuxTunDevice = struct {
         while (true) {
             const result = linux.read(self.fd, buffer.ptr, buffer.len);
 
-            if (result < 0) {
-                const err = linux.getErrno(result);
-                switch (err) {
-                    .INTR => continue, // Interrupted, retry
-                    .AGAIN => {
-                        if (self.non_blocking) {
-                            return error.WouldBlock;
-                        }
-                        continue;
-                    },
-                    .BADF => return error.BadFileDescriptor,
-                    .INVAL => return error.InvalidArgument,
-                    .IO => return error.InputOutput,
-                    else => return error.UnexpectedError,
-                }
+            // Raw syscalls return -errno folded into usize
+            switch (linux.E.init(result)) {
+                .SUCCESS => return result,
+                .INTR => continue, // Interrupted, retry
+                .AGAIN => {
+                    if (self.non_blocking) {
+                        return error.WouldBlock;
+                    }
+                    continue;
+                },
+                .BADF => return error.BadFileDescriptor,
+                .INVAL => return error.InvalidArgument,
+                .IO => return error.InputOutput,
+                else => return error.UnexpectedError,
             }
-
-            return @intCast(result);
         }
     }
 
@@ -231,7 +281,7 @@ pub const LinuxTunDevice = struct {
     /// try device.write(&packet);
     /// ```
     pub fn write(self: *LinuxTunDevice, packet: []const u8) !void {
-        if (packet.len > self.mtu) {
+        if (packet.len > self.maxWriteSize()) {
             return error.PacketTooLarge;
         }
 
@@ -239,25 +289,55 @@ pub const LinuxTunDevice = struct {
         while (total_written < packet.len) {
             const result = linux.write(self.fd, packet.ptr + total_written, packet.len - total_written);
 
-            if (result < 0) {
-                const err = linux.getErrno(result);
-                switch (err) {
-                    .INTR => continue, // Interrupted, retry
-                    .AGAIN => {
-                        if (self.non_blocking) {
-                            return error.WouldBlock;
-                        }
-                        continue;
-                    },
-                    .BADF => return error.BadFileDescriptor,
-                    .INVAL => return error.InvalidArgument,
-                    .IO => return error.InputOutput,
-                    .NOSPC => return error.NoSpaceLeft,
-                    else => return error.UnexpectedError,
-                }
+            switch (linux.E.init(result)) {
+                .SUCCESS => total_written += result,
+                .INTR => continue, // Interrupted, retry
+                .AGAIN => {
+                    if (self.non_blocking) {
+                        return error.WouldBlock;
+                    }
+                    continue;
+                },
+                .BADF => return error.BadFileDescriptor,
+                .INVAL => return error.InvalidArgument,
+                .IO => return error.InputOutput,
+                .NOSPC => return error.NoSpaceLeft,
+                else => return error.UnexpectedError,
             }
+        }
+    }
 
-            total_written += @intCast(result);
+    /// Write one packet gathered from several buffers (e.g. a segment chain)
+    ///
+    /// TUN writes are packet-atomic, so the whole vector goes out in one
+    /// syscall or not at all; a short write is reported as an error.
+    pub fn writev(self: *LinuxTunDevice, iov: []const posix.iovec_const) !void {
+        var total: usize = 0;
+        for (iov) |v| total += v.len;
+        if (total > self.maxWriteSize()) {
+            return error.PacketTooLarge;
+        }
+
+        while (true) {
+            const result = linux.writev(self.fd, iov.ptr, iov.len);
+            switch (linux.E.init(result)) {
+                .SUCCESS => {
+                    if (result != total) return error.IncompleteWrite;
+                    return;
+                },
+                .INTR => continue, // Interrupted, retry
+                .AGAIN => {
+                    if (self.non_blocking) {
+                        return error.WouldBlock;
+                    }
+                    continue;
+                },
+                .BADF => return error.BadFileDescriptor,
+                .INVAL => return error.InvalidArgument,
+                .IO => return error.InputOutput,
+                .NOSPC => return error.NoSpaceLeft,
+                else => return error.UnexpectedError,
+            }
         }
     }
 
@@ -272,8 +352,36 @@ pub const LinuxTunDevice = struct {
         return self.mtu;
     }
 
-    /// Set the device MTU
+    /// Largest write accepted: MTU plus the Ethernet header (TAP) and PI header
+    pub fn maxWriteSize(self: *const LinuxTunDevice) usize {
+        var size: usize = self.mtu;
+        if (self.mode == .tap) size += ETH_HLEN;
+        if (self.packet_info) size += TUN_PI_SIZE;
+        return size;
+    }
+
+    /// Re-read the MTU from the kernel (e.g. after `ip link set mtu`)
+    pub fn refreshMtu(self: *LinuxTunDevice) !void {
+        const sock = try posix.socket(posix.AF.INET, posix.SOCK.DGRAM, 0);
+        defer posix.close(sock);
+
+        var ifr = std.mem.zeroes(c.ifreq);
+        const name_len = std.mem.indexOfScalar(u8, &self.name, 0) orelse self.name.len;
+        @memcpy(ifr.ifr_name[0..name_len], self.name[0..name_len]);
+
+        if (c.ioctl(sock, SIOCGIFMTU, &ifr) < 0) {
+            return error.GetMtuFailed;
+        }
+
+        self.mtu = @intCast(ifr.ifr_ifru.ifru_mtu);
+    }
+
+    /// Set the device MTU (68..65535)
     pub fn setMtu(self: *LinuxTunDevice, mtu: u32) !void {
+        if (mtu < min_mtu or mtu > max_mtu) {
+            return error.InvalidMtu;
+        }
+
         const sock = try posix.socket(posix.AF.INET, posix.SOCK.DGRAM, 0);
         defer posix.close(sock);
 
@@ -375,6 +483,95 @@ pub const LinuxTunDevice = struct {
     }
 };
 
+// ============================================================================
+// Adapter interface (taptun.TunDevice, GenericTunAdapter)
+// ============================================================================
+
+/// A TUN device in the shape `GenericTunAdapter` expects of a platform device:
+/// opened by unit number, reads return the packet, the MTU is a field.
+/// Always TUN mode without the packet information header, so packets are bare IP.
+pub const LinuxTun = struct {
+    device: *LinuxTunDevice,
+    fd: posix.fd_t,
+    mtu: u32,
+
+    const Self = @This();
+
+    /// Open `tun<unit>`, or the next free TUN device if `unit` is null
+    pub fn open(allocator: std.mem.Allocator, unit: ?u32) !Self {
+        var name_buf: [16]u8 = undefined;
+        const name = if (unit) |u| try std.fmt.bufPrint(&name_buf, "tun{d}", .{u}) else null;
+        return wrap(try LinuxTunDevice.open(allocator, .{ .name = name, .non_blocking = false }));
+    }
+
+    /// Take over an attached TUN fd (see `LinuxTunDevice.adopt`)
+    /// TAP devices and devices with the packet information header are refused;
+    /// the fd stays with the caller then.
+    pub fn adopt(allocator: std.mem.Allocator, fd: posix.fd_t) !Self {
+        const device = try LinuxTunDevice.adopt(allocator, fd);
+        if (device.mode != .tun or device.packet_info) {
+            allocator.destroy(device);
+            return error.UnsupportedDevice;
+        }
+        return wrap(device);
+    }
+
+    fn wrap(device: *LinuxTunDevice) Self {
+        return .{ .device = device, .fd = device.fd, .mtu = device.mtu };
+    }
+
+    pub fn close(self: *Self) void {
+        self.device.close();
+    }
+
+    pub fn getName(self: *const Self) []const u8 {
+        return self.device.getName();
+    }
+
+    pub fn read(self: *Self, buffer: []u8) ![]const u8 {
+        const n = try self.device.read(buffer);
+        if (n == 0) return error.EndOfStream;
+        return buffer[0..n];
+    }
+
+    pub fn write(self: *Self, data: []const u8) !void {
+        try self.device.write(data);
+    }
+
+    pub fn writev(self: *Self, iov: []const posix.iovec_const) !void {
+        try self.device.writev(iov);
+    }
+
+    pub fn setNonBlocking(self: *Self, enabled: bool) !void {
+        const flags = try posix.fcntl(self.fd, posix.F.GETFL, 0);
+        const new_flags = if (enabled) flags | O_NONBLOCK else flags & ~@as(usize, O_NONBLOCK);
+        _ = try posix.fcntl(self.fd, posix.F.SETFL, new_flags);
+        self.device.non_blocking = enabled;
+    }
+
+    pub fn setMtu(self: *Self, mtu: u32) !void {
+        try self.device.setMtu(mtu);
+        self.mtu = mtu;
+    }
+};
+
+/// No protocol header: `LinuxTun` opens its devices with IFF_NO_PI
+pub const protocol_header_len: usize = 0;
+
+pub fn addProtocolHeader(allocator: std.mem.Allocator, ip_packet: []const u8) ![]u8 {
+    if (ip_packet.len == 0) return error.InvalidPacket;
+    return allocator.dupe(u8, ip_packet);
+}
+
+pub fn writeProtocolHeader(header: []u8, ip_packet: []const u8) !void {
+    if (header.len != protocol_header_len or ip_packet.len == 0) return error.InvalidPacket;
+}
+
+pub fn stripProtocolHeader(packet: []const u8) ![]const u8 {
+    if (packet.len == 0) return error.InvalidPacket;
+    return packet;
+}
+
 // ============================================================================
 // Tests
 // ============================================================================
@@ -418,7 +615,7 @@ test "LinuxTunDevice TAP mode flags" {
 
 test "LinuxTunDevice open/close TUN mode" {
     if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
-    if (std.posix.getuid() != 0) return error.SkipZigTest; // Requires root
+    if (linux.getuid() != 0) return error.SkipZigTest; // Requires root
 
     const allocator = testing.allocator;
 
@@ -436,7 +633,7 @@ test "LinuxTunDevice open/close TUN mode" {
 
 test "LinuxTunDevice open/close TAP mode" {
     if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
-    if (std.posix.getuid() != 0) return error.SkipZigTest; // Requires root
+    if (linux.getuid() != 0) return error.SkipZigTest; // Requires root
 
     const allocator = testing.allocator;
 
@@ -452,7 +649,7 @@ test "LinuxTunDevice open/close TAP mode" {
 
 test "LinuxTunDevice named device" {
     if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
-    if (std.posix.getuid() != 0) return error.SkipZigTest; // Requires root
+    if (linux.getuid() != 0) return error.SkipZigTest; // Requires root
 
     const allocator = testing.allocator;
 
@@ -467,7 +664,7 @@ test "LinuxTunDevice named device" {
 
 test "LinuxTunDevice MTU get/set" {
     if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
-    if (std.posix.getuid() != 0) return error.SkipZigTest; // Requires root
+    if (linux.getuid() != 0) return error.SkipZigTest; // Requires root
 
     const allocator = testing.allocator;
 
@@ -486,7 +683,7 @@ test "LinuxTunDevice MTU get/set" {
 
 test "LinuxTunDevice IP configuration" {
     if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
-    if (std.posix.getuid() != 0) return error.SkipZigTest; // Requires root
+    if (linux.getuid() != 0) return error.SkipZigTest; // Requires root
 
     const allocator = testing.allocator;
 
@@ -507,7 +704,7 @@ test "LinuxTunDevice IP configuration" {
 
 test "LinuxTunDevice interface up/down" {
     if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
-    if (std.posix.getuid() != 0) return error.SkipZigTest; // Requires root
+    if (linux.getuid() != 0) return error.SkipZigTest; // Requires root
 
     const allocator = testing.allocator;
 
@@ -523,7 +720,7 @@ test "LinuxTunDevice interface up/down" {
 
 test "LinuxTunDevice read/write simulation" {
     if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
-    if (std.posix.getuid() != 0) return error.SkipZigTest; // Requires root
+    if (linux.getuid() != 0) return error.SkipZigTest; // Requires root
 
     const allocator = testing.allocator;
 
@@ -545,7 +742,7 @@ test "LinuxTunDevice read/write simulation" {
 
 test "LinuxTunDevice persistent mode" {
     if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
-    if (std.posix.getuid() != 0) return error.SkipZigTest; // Requires root
+    if (linux.getuid() != 0) return error.SkipZigTest; // Requires root
 
     const allocator = testing.allocator;
 
@@ -560,7 +757,7 @@ test "LinuxTunDevice persistent mode" {
 
 test "LinuxTunDevice blocking mode" {
     if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
-    if (std.posix.getuid() != 0) return error.SkipZigTest; // Requires root
+    if (linux.getuid() != 0) return error.SkipZigTest; // Requires root
 
     const allocator = testing.allocator;
 
@@ -60,7 +60,7 @@ pub const MacOSUtunDevice = struct {
     name: [16]u8,
     name_len: usize,
     unit: u32,
-    mtu: u16,
+    mtu: u32,
     allocator: std.mem.Allocator,
 
     const Self = @This();
@@ -146,6 +146,17 @@ pub const MacOSUtunDevice = struct {
         }
     }
 
+    /// Write one packet gathered from several buffers (e.g. a segment chain)
+    pub fn writev(self: *Self, iov: []const posix.iovec_const) !void {
+        var total: usize = 0;
+        for (iov) |v| total += v.len;
+
+        const bytes_written = try posix.writev(self.fd, iov);
+        if (bytes_written != total) {
+            return error.IncompleteWrite;
+        }
+    }
+
     pub fn setNonBlocking(self: *Self, enabled: bool) !void {
         const O_NONBLOCK: u32 = 0x0004; // O_NONBLOCK on macOS
         const flags = try posix.fcntl(self.fd, posix.F.GETFL, 0);
@@ -176,6 +187,26 @@ pub fn addProtocolHeader(allocator: std.mem.Allocator, ip_packet: []const u8) ![
 
     return packet;
 }
+/// Size of the utun protocol family header
+pub const protocol_header_len: usize = 4;
+
+/// Write the AF header for `ip_packet` into `header` in place (packet path)
+pub fn writeProtocolHeader(header: []u8, ip_packet: []const u8) !void {
+    if (header.len != protocol_header_len or ip_packet.len == 0) {
+        return error.InvalidPacket;
+    }
+
+    const version = ip_packet[0] & 0xF0;
+    const af: u32 = if (version == 0x40)
+        AF_INET
+    else if (version == 0x60)
+        AF_INET6
+    else
+        return error.InvalidPacket;
+
+    std.mem.writeInt(u32, header[0..4], af, .big);
+}
+
 pub fn stripProtocolHeader(packet: []const u8) ![]const u8 {
     if (packet.len < 4) {
         return error.InvalidPacket;
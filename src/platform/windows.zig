@@ -81,7 +81,7 @@ pub const WindowsTapDevice = struct {
     name: [256]u8,
     name_len: usize,
     mac_address: [6]u8,
-    mtu: u16,
+    mtu: u32,
     read_overlapped: windows.OVERLAPPED,
     write_overlapped: windows.OVERLAPPED,
     read_event: windows.HANDLE,
@@ -462,6 +462,15 @@ pub fn addProtocolHeader(allocator: std.mem.Allocator, ethernet_frame: []const u
     return frame;
 }
 
+/// No protocol header for TAP devices
+pub const protocol_header_len: usize = 0;
+
+/// No protocol header to write for TAP devices (packet path)
+pub fn writeProtocolHeader(header: []u8, frame: []const u8) !void {
+    _ = header;
+    _ = frame;
+}
+
 /// No protocol header to strip for TAP devices
 pub fn stripProtocolHeader(packet: []const u8) ![]const u8 {
     // TAP devices work at Layer 2, so no header to strip
@@ -483,6 +492,6 @@ test "Windows TAP device structure" {
         .allocator = std.testing.allocator,
     };
 
-    try std.testing.expectEqual(@as(u16, 1500), device.mtu);
+    try std.testing.expectEqual(@as(u32, 1500), device.mtu);
     try std.testing.expectEqual(@as(u8, 0x02), device.mac_address[0]);
 }
@@ -0,0 +1,222 @@
+//! Packetization-Layer Path MTU Probing
+//!
+//! Finds the largest IP packet the tunnel path carries at connect time, in the
+//! spirit of DPLPMTUD (RFC 8899): padded ICMP echo requests with DF set are
+//! sent to the gateway through the VPN session, and an echo reply confirms the
+//! size made it end to end. Probes that go unanswered are retried a few times
+//! before the size is ruled out, so random loss does not shrink the result.
+//!
+//! The search tries the largest candidate first (most paths carry it), then
+//! binary-searches between the largest confirmed and smallest failed size.
+//! One probe is in flight at a time; the prober is driven by `poll` with the
+//! caller's clock and never blocks.
+
+const std = @import("std");
+const headers = @import("headers.zig");
+const IpProto = headers.IpProto;
+const checksum = @import("checksum.zig");
+
+/// ICMP echo identifier used for probes
+pub const probe_id: u16 = 0x5450;
+
+/// Smallest probe: IPv4 header + ICMP echo header
+pub const min_probe_size = headers.Ipv4.size + headers.Icmp.size;
+
+const icmp_echo_reply: u8 = 0;
+const icmp_echo_request: u8 = 8;
+
+pub const Probe = struct {
+    size: u32,
+    seq: u16,
+};
+
+pub const Prober = struct {
+    options: Options,
+    /// Largest size confirmed to work
+    lo: u32,
+    /// Largest size not yet ruled out
+    hi: u32,
+    probe_size: u32 = 0,
+    seq: u16 = 0,
+    attempts: u8 = 0,
+    sent_ms: ?i64 = null,
+    probes_sent: u32 = 0,
+
+    const Self = @This();
+
+    pub const Options = struct {
+        base_mtu: u32 = 1280, // Assumed to work; the search never goes below it
+        max_mtu: u32 = 1500, // Largest size to try
+        timeout_ms: u32 = 250, // Time to wait for an echo reply
+        max_attempts: u8 = 3, // Unanswered probes before a size is ruled out
+    };
+
+    pub fn init(options: Options) !Self {
+        if (options.base_mtu < min_probe_size or options.base_mtu > options.max_mtu or options.max_attempts == 0) {
+            return error.InvalidConfiguration;
+        }
+        return .{ .options = options, .lo = options.base_mtu, .hi = options.max_mtu };
+    }
+
+    /// True once the search has converged
+    pub fn isDone(self: *const Self) bool {
+        return self.lo >= self.hi;
+    }
+
+    /// Largest working MTU, once the search has converged
+    pub fn result(self: *const Self) ?u32 {
+        return if (self.isDone()) self.lo else null;
+    }
+
+    /// Advance the search; returns a probe to send now, or null while a probe
+    /// is outstanding or once the search is done
+    pub fn poll(self: *Self, now_ms: i64) ?Probe {
+        if (self.sent_ms) |sent| {
+            if (now_ms - sent < self.options.timeout_ms) return null;
+            self.sent_ms = null;
+            if (self.attempts >= self.options.max_attempts) {
+                // Ruled out: everything from here up fails too
+                self.hi = self.probe_size - 1;
+                self.attempts = 0;
+            }
+        }
+        if (self.isDone()) return null;
+
+        if (self.attempts == 0) {
+            // Largest candidate first, then the upper midpoint (always > lo)
+            self.probe_size = if (self.probes_sent == 0) self.hi else self.lo + (self.hi - self.lo + 1) / 2;
+        }
+
+        self.seq +%= 1;
+        self.attempts += 1;
+        self.sent_ms = now_ms;
+        self.probes_sent += 1;
+        return .{ .size = self.probe_size, .seq = self.seq };
+    }
+
+    /// Record an echo reply; replies to any attempt at the current size count
+    pub fn onAck(self: *Self, seq: u16) void {
+        if (self.sent_ms == null and self.attempts == 0) return;
+        if (self.seq -% seq >= self.attempts) return; // Stale reply for an earlier size
+
+        self.lo = self.probe_size;
+        self.attempts = 0;
+        self.sent_ms = null;
+    }
+};
+
+/// Build a DF ICMP echo request padded to exactly `size` bytes
+pub fn buildProbe(out: []u8, probe: Probe, src_ip: u32, dst_ip: u32) ![]u8 {
+    if (probe.size < min_probe_size or probe.size > std.math.maxInt(u16)) return error.InvalidPacket;
+    if (out.len < probe.size) return error.BufferTooSmall;
+    const pkt = out[0..probe.size];
+    @memset(pkt, 0);
+
+    const ip = try headers.Ipv4.viewMut(pkt);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, @intCast(probe.size));
+    ip.set(.identification, probe.seq);
+    ip.set(.flags_fragment, 0x4000); // DF: the probe must not be fragmented
+    ip.set(.ttl, 64);
+    ip.set(.protocol, IpProto.icmp);
+    ip.set(.src_ip, src_ip);
+    ip.set(.dst_ip, dst_ip);
+    ip.set(.checksum, checksum.internet(pkt[0..headers.Ipv4.size]));
+
+    const msg = pkt[headers.Ipv4.size..];
+    const icmp = try headers.Icmp.viewMut(msg);
+    icmp.set(.msg_type, icmp_echo_request);
+    icmp.set(.param, @as(u32, probe_id) << 16 | probe.seq);
+    icmp.set(.checksum, checksum.internet(msg));
+
+    return pkt;
+}
+
+/// Sequence number if `ip_packet` is an echo reply to one of our probes
+pub fn matchReply(ip_packet: []const u8) ?u16 {
+    const ip = headers.Ipv4.view(ip_packet) catch return null;
+    if (ip.get(.protocol) != IpProto.icmp) return null;
+    const ihl = headers.ipv4HeaderLen(ip);
+    if (ip_packet.len < ihl) return null;
+    const icmp = headers.Icmp.view(ip_packet[ihl..]) catch return null;
+    if (icmp.get(.msg_type) != icmp_echo_reply) return null;
+
+    const param = icmp.get(.param);
+    if (param >> 16 != probe_id) return null;
+    return @truncate(param);
+}
+
+/// Lossy link stand-in for tests: drops packets above `mtu` and a share of the rest
+const LossyLink = struct {
+    mtu: u32,
+    loss_percent: u32,
+    random: std.Random,
+
+    fn delivers(self: *LossyLink, size: u32) bool {
+        if (size > self.mtu) return false;
+        return self.random.uintLessThan(u32, 100) >= self.loss_percent;
+    }
+};
+
+/// Run a prober against a lossy link with a virtual clock; returns elapsed ms
+fn simulate(prober: *Prober, link: *LossyLink, rtt_ms: i64) !i64 {
+    var now_ms: i64 = 0;
+    var reply: ?struct { seq: u16, at_ms: i64 } = null;
+
+    while (!prober.isDone()) : (now_ms += 1) {
+        if (now_ms > 60_000) return error.Timeout;
+        if (reply) |r| {
+            if (now_ms >= r.at_ms) {
+                prober.onAck(r.seq);
+                reply = null;
+            }
+        }
+        if (prober.poll(now_ms)) |probe| {
+            // Probe and reply both cross the link
+            if (link.delivers(probe.size) and link.delivers(probe.size)) {
+                reply = .{ .seq = probe.seq, .at_ms = now_ms + rtt_ms };
+            }
+        }
+    }
+    return now_ms;
+}
+
+test "Prober finds the path MTU over a lossy link" {
+    var prng = std.Random.DefaultPrng.init(0x9A7B);
+
+    for ([_]u32{ 1500, 1436, 1392, 1280 }) |path_mtu| {
+        var link = LossyLink{ .mtu = path_mtu, .loss_percent = 5, .random = prng.random() };
+        var prober = try Prober.init(.{ .base_mtu = 1280, .max_mtu = 1500, .timeout_ms = 100, .max_attempts = 4 });
+        _ = try simulate(&prober, &link, 40);
+
+        try std.testing.expectEqual(@as(?u32, path_mtu), prober.result());
+        // Maximum plus ~log2(221) bisection steps, at most max_attempts each
+        try std.testing.expect(prober.probes_sent <= 40);
+    }
+}
+
+test "Prober confirms the maximum with a single probe on a clean path" {
+    var prng = std.Random.DefaultPrng.init(1);
+    var link = LossyLink{ .mtu = 9000, .loss_percent = 0, .random = prng.random() };
+    var prober = try Prober.init(.{ .max_mtu = 9000 });
+
+    const elapsed = try simulate(&prober, &link, 30);
+    try std.testing.expectEqual(@as(?u32, 9000), prober.result());
+    try std.testing.expectEqual(@as(u32, 1), prober.probes_sent);
+    try std.testing.expect(elapsed <= 31);
+}
+
+test "probe packets are padded DF echo requests" {
+    var buf: [1500]u8 = undefined;
+    const pkt = try buildProbe(&buf, .{ .size = 1400, .seq = 7 }, 0x0A150064, 0x0A150001);
+    try std.testing.expectEqual(@as(usize, 1400), pkt.len);
+
+    const ip = try headers.Ipv4.view(pkt);
+    try std.testing.expect(headers.ipv4DontFragment(ip));
+    try std.testing.expectEqual(@as(u16, 0), checksum.internet(pkt[headers.Ipv4.size..]));
+
+    // The gateway's reply: same packet with addresses swapped and type 0
+    pkt[headers.Ipv4.size] = icmp_echo_reply;
+    try std.testing.expectEqual(@as(?u16, 7), matchReply(pkt));
+    try std.testing.expectError(error.BufferTooSmall, buildProbe(buf[0..100], .{ .size = 1400, .seq = 1 }, 0, 0));
+}
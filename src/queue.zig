@@ -1,30 +1,111 @@
-//! Thread-safe packet queue
-//! This is a stub implementation - to be fully implemented
+//! Packet queues
+//!
+//! `SpscRing` is a lock-free single-producer/single-consumer ring used to hand
+//! frames between a data-path thread and a helper thread without locks or
+//! allocation.
 
 const std = @import("std");
 
-pub const PacketQueue = struct {
-    allocator: std.mem.Allocator,
+/// Fixed-capacity lock-free ring for exactly one producer and one consumer thread
+/// Slots are written and read in place: the producer fills `reserve()` and
+/// calls `commit()`, the consumer reads `peek()` and calls `release()`.
+/// `capacity` must be a power of two; the indices sit on separate cache lines
+/// so the two threads do not false-share.
+pub fn SpscRing(comptime T: type, comptime capacity: usize) type {
+    if (!std.math.isPowerOfTwo(capacity)) @compileError("SpscRing capacity must be a power of two");
 
-    pub fn init(allocator: std.mem.Allocator, capacity: usize) !PacketQueue {
-        _ = capacity;
-        return PacketQueue{
-            .allocator = allocator,
-        };
-    }
+    return struct {
+        /// Next slot to read (written by the consumer only)
+        head: std.atomic.Value(usize) align(std.atomic.cache_line) = std.atomic.Value(usize).init(0),
+        /// Next slot to write (written by the producer only)
+        tail: std.atomic.Value(usize) align(std.atomic.cache_line) = std.atomic.Value(usize).init(0),
+        slots: [capacity]T align(std.atomic.cache_line) = undefined,
 
-    pub fn deinit(self: *PacketQueue) void {
-        _ = self;
-    }
+        const Self = @This();
+        const mask = capacity - 1;
+
+        /// Producer: free slot to fill, or null if the ring is full
+        pub fn reserve(self: *Self) ?*T {
+            const tail = self.tail.load(.monotonic);
+            if (tail -% self.head.load(.acquire) == capacity) return null;
+            return &self.slots[tail & mask];
+        }
+
+        /// Producer: publish the slot returned by `reserve`
+        pub fn commit(self: *Self) void {
+            self.tail.store(self.tail.load(.monotonic) +% 1, .release);
+        }
+
+        /// Producer: copy `value` in; false if the ring is full
+        pub fn push(self: *Self, value: T) bool {
+            const slot = self.reserve() orelse return false;
+            slot.* = value;
+            self.commit();
+            return true;
+        }
+
+        /// Consumer: oldest filled slot, or null if the ring is empty
+        pub fn peek(self: *Self) ?*T {
+            const head = self.head.load(.monotonic);
+            if (head == self.tail.load(.acquire)) return null;
+            return &self.slots[head & mask];
+        }
 
-    pub fn enqueue(self: *PacketQueue, data: []const u8) !void {
-        _ = self;
-        _ = data;
-        return error.QueueFull;
+        /// Consumer: hand the slot returned by `peek` back to the producer
+        pub fn release(self: *Self) void {
+            self.head.store(self.head.load(.monotonic) +% 1, .release);
+        }
+
+        /// Consumer: copy the oldest value out
+        pub fn pop(self: *Self) ?T {
+            const slot = self.peek() orelse return null;
+            const value = slot.*;
+            self.release();
+            return value;
+        }
+
+        /// Approximate fill level (exact when called from either end with the other idle)
+        pub fn len(self: *const Self) usize {
+            return self.tail.load(.acquire) -% self.head.load(.acquire);
+        }
+    };
+}
+
+test "SpscRing fills, wraps and drains in order" {
+    var ring = SpscRing(u32, 4){};
+    try std.testing.expectEqual(@as(?u32, null), ring.pop());
+
+    for (0..3) |round| {
+        const base: u32 = @intCast(round * 10);
+        for (0..4) |i| try std.testing.expect(ring.push(base + @as(u32, @intCast(i))));
+        try std.testing.expect(!ring.push(99));
+        try std.testing.expectEqual(@as(usize, 4), ring.len());
+        for (0..4) |i| try std.testing.expectEqual(base + @as(u32, @intCast(i)), ring.pop().?);
+        try std.testing.expectEqual(@as(?u32, null), ring.pop());
     }
+}
+
+test "SpscRing hands values across threads" {
+    const Ring = SpscRing(u64, 64);
+    var ring = Ring{};
+    const count = 100_000;
+
+    const Producer = struct {
+        fn run(r: *Ring) void {
+            var i: u64 = 0;
+            while (i < count) {
+                if (r.push(i)) i += 1 else std.Thread.yield() catch {};
+            }
+        }
+    };
 
-    pub fn dequeue(self: *PacketQueue) ?[]const u8 {
-        _ = self;
-        return null;
+    const thread = try std.Thread.spawn(.{}, Producer.run, .{&ring});
+    var expected: u64 = 0;
+    while (expected < count) {
+        if (ring.pop()) |value| {
+            try std.testing.expectEqual(expected, value);
+            expected += 1;
+        } else std.Thread.yield() catch {};
     }
-};
+    thread.join();
+}
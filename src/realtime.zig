@@ -0,0 +1,222 @@
+//! Low-Latency Runtime Mode
+//!
+//! Tail latency on the data path is dominated by page faults, allocator slow
+//! paths and preemption rather than by translation itself. This module removes
+//! those sources up front:
+//!
+//! - `lockMemory` pins all current and future pages (mlockall)
+//! - `prepareTranslator`, `preparePool` and `prepareArena` prefault buffers and
+//!   reserve every queue and table so the steady state never allocates lazily
+//! - `enterDataPath` pins the calling thread to a CPU, switches it to
+//!   SCHED_FIFO and prefaults its stack
+//!
+//! Call order: create pools, arenas, rings and translators; prepare them;
+//! `lockMemory`; then `enterDataPath` at the start of each data-path thread.
+//! Everything is Linux-only and needs CAP_IPC_LOCK / CAP_SYS_NICE (or rlimits);
+//! elsewhere the calls return error.UnsupportedPlatform.
+//!
+//! `LatencyHistogram` records per-packet latencies without allocating, for
+//! measuring the effect on p99.9 and max.
+
+const std = @import("std");
+const builtin = @import("builtin");
+const packet = @import("packet.zig");
+const BatchArena = @import("arena.zig").BatchArena;
+const L2L3Translator = @import("translator.zig").L2L3Translator;
+
+/// Stack the data path may touch; prefaulted by `enterDataPath`
+pub const stack_prefault_size = 256 * 1024;
+
+pub const ThreadOptions = struct {
+    /// SCHED_FIFO priority 1-99 (null = keep the default policy)
+    fifo_priority: ?u8 = null,
+    /// Pin to this CPU (null = leave affinity alone)
+    cpu: ?u16 = null,
+    /// Prefault `stack_prefault_size` bytes of stack
+    prefault_stack: bool = true,
+};
+
+pub const Error = error{
+    UnsupportedPlatform,
+    PermissionDenied,
+    SystemResources,
+    InvalidConfiguration,
+    Unexpected,
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Process and Thread Setup
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Lock all current and future pages in memory
+pub fn lockMemory() Error!void {
+    if (builtin.os.tag != .linux) return error.UnsupportedPlatform;
+    const mcl_current = 1;
+    const mcl_future = 2;
+    return check(std.os.linux.syscall1(.mlockall, mcl_current | mcl_future));
+}
+
+pub fn unlockMemory() void {
+    if (builtin.os.tag != .linux) return;
+    _ = std.os.linux.syscall0(.munlockall);
+}
+
+/// Set up the calling thread for the data path
+pub fn enterDataPath(options: ThreadOptions) Error!void {
+    if (builtin.os.tag != .linux) return error.UnsupportedPlatform;
+    const linux = std.os.linux;
+
+    if (options.cpu) |cpu| {
+        var set = [_]usize{0} ** (1024 / @bitSizeOf(usize));
+        if (cpu >= set.len * @bitSizeOf(usize)) return error.InvalidConfiguration;
+        set[cpu / @bitSizeOf(usize)] |= @as(usize, 1) << @intCast(cpu % @bitSizeOf(usize));
+        // pid 0 is the calling thread
+        try check(linux.syscall3(.sched_setaffinity, 0, @sizeOf(@TypeOf(set)), @intFromPtr(&set)));
+    }
+
+    if (options.fifo_priority) |priority| {
+        if (priority < 1 or priority > 99) return error.InvalidConfiguration;
+        const sched_fifo = 1;
+        const param = extern struct { priority: i32 }{ .priority = priority };
+        try check(linux.syscall3(.sched_setscheduler, 0, sched_fifo, @intFromPtr(&param)));
+    }
+
+    if (options.prefault_stack) prefaultStack();
+}
+
+/// Touch the next `stack_prefault_size` bytes of stack
+noinline fn prefaultStack() void {
+    var buf: [stack_prefault_size]u8 = undefined;
+    packet.prefault(&buf);
+    std.mem.doNotOptimizeAway(&buf);
+}
+
+fn check(rc: usize) Error!void {
+    return switch (std.posix.errno(rc)) {
+        .SUCCESS => {},
+        .PERM, .ACCES => error.PermissionDenied,
+        .NOMEM, .AGAIN => error.SystemResources,
+        .INVAL => error.InvalidConfiguration,
+        else => error.Unexpected,
+    };
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Warming
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Reserve every queue and table the translator would otherwise grow on demand
+pub fn prepareTranslator(translator: *L2L3Translator) !void {
+    try translator.preallocate();
+}
+
+/// Fault in every buffer of a pool and its free list
+pub fn preparePool(pool: *packet.PacketPool) void {
+    packet.prefault(pool.slab);
+    packet.prefault(std.mem.sliceAsBytes(pool.packets));
+}
+
+/// Fault in an arena's buffer
+pub fn prepareArena(arena: *BatchArena) void {
+    packet.prefault(arena.buffer);
+}
+
+/// Fault in any fixed-size structure held by value (rings, histograms)
+pub fn prepareValue(ptr: anytype) void {
+    packet.prefault(std.mem.asBytes(ptr));
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Latency Histogram
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Log-linear latency histogram in nanoseconds (16 sub-buckets per power
+/// of two, ≤ 6.25% relative error); recording never allocates
+pub const LatencyHistogram = struct {
+    counts: [bucket_count]u64 = [_]u64{0} ** bucket_count,
+    total: u64 = 0,
+    sum: u64 = 0,
+    min: u64 = std.math.maxInt(u64),
+    max: u64 = 0,
+
+    const Self = @This();
+    const sub_bits = 4;
+    const sub_count = 1 << sub_bits;
+    pub const bucket_count = (64 - sub_bits + 1) * sub_count;
+
+    pub fn record(self: *Self, ns: u64) void {
+        self.counts[bucketOf(ns)] += 1;
+        self.total += 1;
+        self.sum +%= ns;
+        self.min = @min(self.min, ns);
+        self.max = @max(self.max, ns);
+    }
+
+    pub fn reset(self: *Self) void {
+        self.* = .{};
+    }
+
+    pub fn mean(self: *const Self) u64 {
+        return if (self.total == 0) 0 else self.sum / self.total;
+    }
+
+    /// Upper bound of the bucket holding the `p`-th percentile (0 < p ≤ 100)
+    pub fn percentile(self: *const Self, p: f64) u64 {
+        if (self.total == 0) return 0;
+        const rank: u64 = @max(1, @as(u64, @intFromFloat(@ceil(p / 100.0 * @as(f64, @floatFromInt(self.total))))));
+        var seen: u64 = 0;
+        for (self.counts, 0..) |count, i| {
+            seen += count;
+            if (seen >= rank) return @min(self.max, upperBound(i));
+        }
+        return self.max;
+    }
+
+    fn bucketOf(ns: u64) usize {
+        if (ns < sub_count) return @intCast(ns);
+        const msb: u6 = @intCast(63 - @clz(ns));
+        const shift = msb - sub_bits;
+        const sub = (ns >> shift) & (sub_count - 1);
+        return (@as(usize, shift) + 1) * sub_count + @as(usize, @intCast(sub));
+    }
+
+    fn lowerBound(index: usize) u64 {
+        if (index < sub_count) return index;
+        const shift: u6 = @intCast(index / sub_count - 1);
+        return (@as(u64, sub_count) | @as(u64, index % sub_count)) << shift;
+    }
+
+    fn upperBound(index: usize) u64 {
+        if (index + 1 >= bucket_count) return std.math.maxInt(u64);
+        return lowerBound(index + 1) - 1;
+    }
+};
+
+test "LatencyHistogram buckets and percentiles" {
+    var hist = LatencyHistogram{};
+    try std.testing.expectEqual(@as(u64, 0), hist.percentile(99));
+
+    // Bucket bounds are contiguous and within 1/16 of the value
+    for ([_]u64{ 0, 15, 16, 31, 32, 1000, 5000, 1 << 40, std.math.maxInt(u64) }) |v| {
+        const i = LatencyHistogram.bucketOf(v);
+        try std.testing.expect(LatencyHistogram.lowerBound(i) <= v);
+        try std.testing.expect(v <= LatencyHistogram.upperBound(i));
+        try std.testing.expect(LatencyHistogram.upperBound(i) - LatencyHistogram.lowerBound(i) <= v / 16);
+    }
+
+    for (0..990) |_| hist.record(5_000);
+    for (0..9) |_| hist.record(40_000);
+    hist.record(80_000);
+
+    try std.testing.expect(hist.percentile(50) >= 5_000 and hist.percentile(50) < 5_000 + 5_000 / 16);
+    try std.testing.expect(hist.percentile(99.9) >= 40_000 and hist.percentile(99.9) < 40_000 + 40_000 / 16);
+    try std.testing.expectEqual(@as(u64, 80_000), hist.percentile(100));
+    try std.testing.expectEqual(@as(u64, 5_000), hist.min);
+    try std.testing.expectEqual(@as(u64, 5_390), hist.mean());
+}
+
+test "enterDataPath rejects bad priorities before touching the scheduler" {
+    if (builtin.os.tag != .linux) return error.SkipZigTest;
+    try std.testing.expectError(error.InvalidConfiguration, enterDataPath(.{ .fifo_priority = 0, .prefault_stack = false }));
+    try std.testing.expectError(error.InvalidConfiguration, enterDataPath(.{ .cpu = 4096, .prefault_stack = false }));
+}
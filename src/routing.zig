@@ -45,6 +45,12 @@ pub const RouteManager = switch (builtin.os.tag) {
     else => UnsupportedRouteManager,
 };
 
+/// Batched host-route sink for domain-based split tunneling (Linux only)
+pub const BatchRouteSink = switch (builtin.os.tag) {
+    .linux => if (@hasDecl(@This(), "linux")) linux.BatchRouteSink else void,
+    else => void,
+};
+
 /// Unsupported platform placeholder
 const UnsupportedRouteManager = struct {
     allocator: std.mem.Allocator,
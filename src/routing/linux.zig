@@ -211,6 +211,68 @@ pub const RouteManager = struct {
     }
 };
 
+/// Applies host-route changes in one `ip -batch` run instead of one process per route
+/// Addresses are 16 bytes; IPv4 routes are passed IPv4-mapped (::ffff:a.b.c.d).
+pub const BatchRouteSink = struct {
+    allocator: std.mem.Allocator,
+    /// Device the routes point at (the TUN interface)
+    interface: []const u8,
+
+    const Self = @This();
+
+    pub fn applyRoutes(self: *Self, add: []const [16]u8, delete: []const [16]u8) !void {
+        var script = std.ArrayList(u8){};
+        defer script.deinit(self.allocator);
+
+        try self.buildScript(&script, add, delete);
+        if (script.items.len == 0) return;
+
+        // -force: keep going past routes that are already gone
+        var child = std.process.Child.init(&[_][]const u8{ "ip", "-force", "-batch", "-" }, self.allocator);
+        child.stdin_behavior = .Pipe;
+        try child.spawn();
+
+        child.stdin.?.writeAll(script.items) catch |err| {
+            _ = child.kill() catch {};
+            return err;
+        };
+        child.stdin.?.close();
+        child.stdin = null;
+
+        const term = try child.wait();
+        if (term != .Exited or term.Exited != 0) return error.CommandFailed;
+    }
+
+    /// The `ip -batch` input for a set of changes, one command per line
+    pub fn buildScript(self: *Self, script: *std.ArrayList(u8), add: []const [16]u8, delete: []const [16]u8) !void {
+        for (add) |addr| try self.appendCommand(script, "replace", addr);
+        for (delete) |addr| try self.appendCommand(script, "del", addr);
+    }
+
+    fn appendCommand(self: *Self, script: *std.ArrayList(u8), verb: []const u8, addr: [16]u8) !void {
+        var line_buf: [128]u8 = undefined;
+        const mapped = std.mem.allEqual(u8, addr[0..10], 0) and addr[10] == 0xFF and addr[11] == 0xFF;
+        const line = if (mapped)
+            try std.fmt.bufPrint(&line_buf, "route {s} {d}.{d}.{d}.{d}/32 dev {s}\n", .{
+                verb, addr[12], addr[13], addr[14], addr[15], self.interface,
+            })
+        else
+            try std.fmt.bufPrint(&line_buf, "-6 route {s} {x}:{x}:{x}:{x}:{x}:{x}:{x}:{x}/128 dev {s}\n", .{
+                verb,
+                std.mem.readInt(u16, addr[0..2], .big),
+                std.mem.readInt(u16, addr[2..4], .big),
+                std.mem.readInt(u16, addr[4..6], .big),
+                std.mem.readInt(u16, addr[6..8], .big),
+                std.mem.readInt(u16, addr[8..10], .big),
+                std.mem.readInt(u16, addr[10..12], .big),
+                std.mem.readInt(u16, addr[12..14], .big),
+                std.mem.readInt(u16, addr[14..16], .big),
+                self.interface,
+            });
+        try script.appendSlice(self.allocator, line);
+    }
+};
+
 test "Linux RouteManager basic operations" {
     if (@import("builtin").os.tag != .linux) {
         return error.SkipZigTest;
@@ -231,3 +293,25 @@ test "Linux RouteManager basic operations" {
 
     try std.testing.expect(rm.local_gateway != null);
 }
+
+test "BatchRouteSink writes one ip -batch line per route" {
+    const allocator = std.testing.allocator;
+    var sink = BatchRouteSink{ .allocator = allocator, .interface = "tun0" };
+
+    const v4 = [_]u8{0} ** 10 ++ [_]u8{ 0xFF, 0xFF, 10, 8, 0, 1 };
+    const v6 = [_]u8{ 0x20, 0x01, 0x0D, 0xB8 } ++ [_]u8{0} ** 11 ++ [_]u8{1};
+    const gone = [_]u8{0} ** 10 ++ [_]u8{ 0xFF, 0xFF, 10, 8, 0, 2 };
+
+    var script = std.ArrayList(u8){};
+    defer script.deinit(allocator);
+    try sink.buildScript(&script, &.{ v4, v6 }, &.{gone});
+    try std.testing.expectEqualStrings(
+        "route replace 10.8.0.1/32 dev tun0\n" ++
+            "-6 route replace 2001:db8:0:0:0:0:0:1/128 dev tun0\n" ++
+            "route del 10.8.0.2/32 dev tun0\n",
+        script.items,
+    );
+
+    // Nothing to change: no process is started
+    try sink.applyRoutes(&.{}, &.{});
+}
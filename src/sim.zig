@@ -0,0 +1,568 @@
+//! Deterministic Network Simulation
+//!
+//! Runs the control-plane exchanges a client goes through on connect (DHCP,
+//! gateway ARP, lease renewal) against scripted peers on a simulated VPN link,
+//! in process and on a virtual clock. The same seed always yields the same
+//! event order, so timing bugs reproduce and convergence can be measured:
+//!
+//! - `Link` delays, drops and reorders frames in one direction
+//! - `Gateway` plays the virtual hub's DHCP server and gateway ARP responder,
+//!   and can be scripted to ignore the first N messages
+//! - the host side drives an `L2L3Translator` the way a client does: DHCP
+//!   retransmission with RFC 2131 backoff, gateway ARP retries until the MAC
+//!   is known, and renewal at T1
+//!
+//! ```zig
+//! const result = try sim.run(allocator, .{
+//!     .seed = 7,
+//!     .downlink = .{ .latency_ms = 40, .loss = 0.1 },
+//! });
+//! std.debug.print("IP after {?d} ms\n", .{result.time_to_ip_ms});
+//! ```
+
+const std = @import("std");
+const headers = @import("headers.zig");
+const checksum = @import("checksum.zig");
+const control_plane = @import("control_plane.zig");
+const dhcp = @import("dhcp_client.zig");
+const ArpHandler = @import("arp.zig").ArpHandler;
+const L2L3Translator = @import("translator.zig").L2L3Translator;
+const EtherType = headers.EtherType;
+const IpProto = headers.IpProto;
+const DhcpPacket = dhcp.DhcpPacket;
+const MessageType = dhcp.MessageType;
+const Option = dhcp.Option;
+
+pub const default_host_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Clock and Link
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Simulated time in milliseconds; only moves when the event loop advances it
+pub const VirtualClock = struct {
+    now_ms: i64 = 0,
+
+    pub fn advanceTo(self: *VirtualClock, t_ms: i64) void {
+        std.debug.assert(t_ms >= self.now_ms);
+        self.now_ms = t_ms;
+    }
+};
+
+pub const LinkOptions = struct {
+    latency_ms: u32 = 20,
+    /// Extra uniform delay 0..jitter_ms per frame
+    jitter_ms: u32 = 0,
+    /// Probability a frame is dropped
+    loss: f32 = 0,
+    /// Probability a frame is held back `reorder_delay_ms`, letting later ones overtake it
+    reorder: f32 = 0,
+    reorder_delay_ms: u32 = 15,
+};
+
+/// One direction of the VPN link
+pub const Link = struct {
+    allocator: std.mem.Allocator,
+    options: LinkOptions,
+    random: std.Random,
+    queue: Queue,
+    next_seq: u64 = 0,
+
+    // Statistics
+    sent: u64 = 0,
+    lost: u64 = 0,
+    reordered: u64 = 0,
+
+    const Self = @This();
+
+    const InFlight = struct {
+        deliver_at: i64,
+        /// Send order breaks ties so equal delivery times stay deterministic
+        seq: u64,
+        frame: []u8,
+
+        fn order(_: void, a: InFlight, b: InFlight) std.math.Order {
+            const by_time = std.math.order(a.deliver_at, b.deliver_at);
+            return if (by_time == .eq) std.math.order(a.seq, b.seq) else by_time;
+        }
+    };
+
+    const Queue = std.PriorityQueue(InFlight, void, InFlight.order);
+
+    pub fn init(allocator: std.mem.Allocator, options: LinkOptions, random: std.Random) Self {
+        return .{
+            .allocator = allocator,
+            .options = options,
+            .random = random,
+            .queue = Queue.init(allocator, {}),
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        while (self.queue.removeOrNull()) |in_flight| self.allocator.free(in_flight.frame);
+        self.queue.deinit();
+    }
+
+    /// Put a copy of `frame` on the link at `now`
+    pub fn send(self: *Self, now: i64, frame: []const u8) !void {
+        self.sent += 1;
+        if (self.random.float(f32) < self.options.loss) {
+            self.lost += 1;
+            return;
+        }
+
+        var delay: i64 = self.options.latency_ms;
+        if (self.options.jitter_ms > 0) delay += self.random.uintAtMost(u32, self.options.jitter_ms);
+        if (self.random.float(f32) < self.options.reorder) {
+            delay += self.options.reorder_delay_ms;
+            self.reordered += 1;
+        }
+
+        const copy = try self.allocator.dupe(u8, frame);
+        errdefer self.allocator.free(copy);
+        try self.queue.add(.{ .deliver_at = now + delay, .seq = self.next_seq, .frame = copy });
+        self.next_seq += 1;
+    }
+
+    /// Delivery time of the next frame, if any is in flight
+    pub fn nextDue(self: *Self) ?i64 {
+        const next = self.queue.peek() orelse return null;
+        return next.deliver_at;
+    }
+
+    /// Next frame due by `now`; hand it back with `release`
+    pub fn receive(self: *Self, now: i64) ?[]u8 {
+        const next = self.queue.peek() orelse return null;
+        if (next.deliver_at > now) return null;
+        return self.queue.remove().frame;
+    }
+
+    pub fn release(self: *Self, frame: []u8) void {
+        self.allocator.free(frame);
+    }
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Scripted Gateway
+// ═══════════════════════════════════════════════════════════════════════════
+
+pub const GatewayScript = struct {
+    mac: [6]u8 = .{ 0x5E, 0x00, 0x00, 0x00, 0x00, 0x01 },
+    ip: u32 = 0x0A150001, // 10.21.0.1
+    /// Address handed to the client
+    client_ip: u32 = 0x0A150064, // 10.21.0.100
+    subnet_mask: u32 = 0xFFFF0000,
+    lease_time_s: u32 = 3600,
+    /// T1; null = half the lease
+    renewal_time_s: ?u32 = null,
+    /// Time the gateway takes to answer
+    think_ms: u32 = 1,
+    /// Ignore the first N DHCP messages (exercises retransmission)
+    ignore_dhcp: u32 = 0,
+    /// Ignore the first N ARP requests for the gateway (exercises ARP retry)
+    ignore_arp: u32 = 0,
+};
+
+/// Virtual hub gateway: DHCP server plus ARP responder for its own address
+pub const Gateway = struct {
+    script: GatewayScript,
+    arp: ArpHandler,
+    dhcp_messages: u32 = 0,
+    arp_requests: u32 = 0,
+
+    const Self = @This();
+
+    /// Ethernet + IPv4 + UDP + full BOOTP/DHCP message
+    const reply_frame_size = headers.Ethernet.size + headers.Ipv4.size + headers.Udp.size + DhcpPacket.wire_size;
+
+    pub fn init(allocator: std.mem.Allocator, script: GatewayScript) !Self {
+        return .{ .script = script, .arp = try ArpHandler.init(allocator, script.mac) };
+    }
+
+    pub fn deinit(self: *Self) void {
+        self.arp.deinit();
+    }
+
+    /// Handle a frame from the host; replies go on `downlink`
+    pub fn handle(self: *Self, frame: []const u8, now: i64, downlink: *Link) !void {
+        const eth = headers.Ethernet.view(frame) catch return;
+        switch (eth.get(.ethertype)) {
+            EtherType.arp => try self.handleArp(frame, now, downlink),
+            EtherType.ipv4 => try self.handleDhcp(frame, now, downlink),
+            else => {},
+        }
+    }
+
+    fn handleArp(self: *Self, frame: []const u8, now: i64, downlink: *Link) !void {
+        const arp = headers.Arp.view(frame[headers.Ethernet.size..]) catch return;
+        if (arp.get(.opcode) != 1 or arp.get(.target_ip) != self.script.ip) return;
+
+        self.arp_requests += 1;
+        if (self.arp_requests <= self.script.ignore_arp) return;
+
+        const reply = try self.arp.buildArpReply(self.script.ip, arp.get(.sender_mac), arp.get(.sender_ip));
+        defer self.arp.allocator.free(reply);
+        try downlink.send(now + self.script.think_ms, reply);
+    }
+
+    fn handleDhcp(self: *Self, frame: []const u8, now: i64, downlink: *Link) !void {
+        const l3 = frame[headers.Ethernet.size..];
+        const ip = headers.Ipv4.view(l3) catch return;
+        if (ip.get(.protocol) != IpProto.udp) return;
+        const ihl = headers.ipv4HeaderLen(ip);
+        const udp = headers.Udp.view(l3[@min(l3.len, ihl)..]) catch return;
+        if (udp.get(.dst_port) != 67) return;
+        const request = DhcpPacket.parse(l3[ihl + headers.Udp.size ..]) catch return;
+
+        self.dhcp_messages += 1;
+        if (self.dhcp_messages <= self.script.ignore_dhcp) return;
+
+        const reply_type: MessageType = switch (messageType(&request) orelse return) {
+            @intFromEnum(MessageType.DISCOVER) => .OFFER,
+            @intFromEnum(MessageType.REQUEST) => .ACK,
+            else => return,
+        };
+        var buf: [reply_frame_size]u8 = undefined;
+        try downlink.send(now + self.script.think_ms, try self.buildReply(&buf, &request, reply_type));
+    }
+
+    fn buildReply(self: *Self, buf: *[reply_frame_size]u8, request: *const DhcpPacket, reply_type: MessageType) ![]const u8 {
+        const s = &self.script;
+        var reply = DhcpPacket.init();
+        reply.op = DhcpPacket.BOOTREPLY;
+        reply.xid = request.xid;
+        reply.flags = request.flags;
+        reply.yiaddr = @bitCast(bigEndian(s.client_ip));
+        reply.siaddr = @bitCast(bigEndian(s.ip));
+        reply.chaddr = request.chaddr;
+
+        var options = OptionWriter{ .out = &reply.options };
+        options.add(.MESSAGE_TYPE, &.{@intFromEnum(reply_type)});
+        options.add(.SERVER_ID, &bigEndian(s.ip));
+        options.add(.SUBNET_MASK, &bigEndian(s.subnet_mask));
+        options.add(.ROUTER, &bigEndian(s.ip));
+        options.add(.LEASE_TIME, &bigEndian(s.lease_time_s));
+        options.add(.RENEWAL_TIME, &bigEndian(s.renewal_time_s orelse s.lease_time_s / 2));
+        options.end();
+
+        @memset(buf, 0);
+        const eth = try headers.Ethernet.viewMut(buf);
+        eth.set(.dst_mac, [_]u8{0xFF} ** 6);
+        eth.set(.src_mac, s.mac);
+        eth.set(.ethertype, EtherType.ipv4);
+
+        const l3 = buf[headers.Ethernet.size..];
+        const ip = try headers.Ipv4.viewMut(l3);
+        ip.set(.version_ihl, 0x45);
+        ip.set(.total_length, @intCast(l3.len));
+        ip.set(.ttl, 64);
+        ip.set(.protocol, IpProto.udp);
+        ip.set(.src_ip, s.ip);
+        ip.set(.dst_ip, 0xFFFFFFFF);
+        ip.set(.checksum, checksum.internet(l3[0..headers.Ipv4.size]));
+
+        const udp = try headers.Udp.viewMut(l3[headers.Ipv4.size..]);
+        udp.set(.src_port, 67);
+        udp.set(.dst_port, 68);
+        udp.set(.length, @intCast(l3.len - headers.Ipv4.size));
+
+        try reply.writeTo(l3[headers.Ipv4.size + headers.Udp.size ..]);
+        return buf;
+    }
+};
+
+const OptionWriter = struct {
+    out: *[312]u8,
+    len: usize = 0,
+
+    fn add(self: *OptionWriter, option: Option, value: []const u8) void {
+        self.out[self.len] = @intFromEnum(option);
+        self.out[self.len + 1] = @intCast(value.len);
+        @memcpy(self.out[self.len + 2 ..][0..value.len], value);
+        self.len += 2 + value.len;
+    }
+
+    fn end(self: *OptionWriter) void {
+        self.out[self.len] = @intFromEnum(Option.END);
+        self.len += 1;
+    }
+};
+
+/// Value of option 53, if present
+fn messageType(packet: *const DhcpPacket) ?u8 {
+    var off: usize = 0;
+    while (off + 2 < packet.options.len) {
+        const option = packet.options[off];
+        if (option == @intFromEnum(Option.END)) return null;
+        if (option == @intFromEnum(Option.PAD)) {
+            off += 1;
+            continue;
+        }
+        if (option == @intFromEnum(Option.MESSAGE_TYPE)) return packet.options[off + 2];
+        off += 2 + @as(usize, packet.options[off + 1]);
+    }
+    return null;
+}
+
+fn bigEndian(value: u32) [4]u8 {
+    var bytes: [4]u8 = undefined;
+    std.mem.writeInt(u32, &bytes, value, .big);
+    return bytes;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Host
+// ═══════════════════════════════════════════════════════════════════════════
+
+pub const HostOptions = struct {
+    mac: [6]u8 = default_host_mac,
+    /// First DHCP retransmission timeout; doubles up to the maximum, ±1 s
+    /// randomization (RFC 2131 §4.1)
+    dhcp_timeout_ms: u32 = 4000,
+    dhcp_max_timeout_ms: u32 = 64000,
+    /// Gateway ARP request interval until its MAC is known
+    arp_retry_ms: u32 = 1000,
+};
+
+/// Client-side driver around the translator, as a VPN client runs it
+const Host = struct {
+    translator: *L2L3Translator,
+    options: HostOptions,
+    random: std.Random,
+    result: *Result,
+
+    phase: enum { idle, acquiring, bound, renewing } = .idle,
+    dhcp_timeout_ms: u32 = 0,
+    dhcp_deadline: ?i64 = null,
+    arp_deadline: ?i64 = null,
+    renew_at: ?i64 = null,
+
+    fn start(self: *Host, now: i64) !void {
+        try self.translator.startDhcp();
+        self.phase = .acquiring;
+        self.armDhcp(now, self.options.dhcp_timeout_ms);
+    }
+
+    fn armDhcp(self: *Host, now: i64, timeout_ms: u32) void {
+        self.dhcp_timeout_ms = timeout_ms;
+        const fuzz = self.random.intRangeAtMost(i64, -1000, 1000);
+        self.dhcp_deadline = now + @max(timeout_ms / 2, @as(i64, timeout_ms) + fuzz);
+    }
+
+    fn nextTimer(self: *const Host) ?i64 {
+        return earliest(&.{ self.dhcp_deadline, self.arp_deadline, self.renew_at });
+    }
+
+    fn receive(self: *Host, now: i64, frame: []const u8) !void {
+        const eth = headers.Ethernet.view(frame) catch return;
+        if (eth.get(.ethertype) == EtherType.ipv4 and control_plane.classify(frame) == .control) {
+            try self.translator.processDhcpPacket(frame);
+        } else if (try self.translator.ethernetToIp(frame)) |ip_packet| {
+            self.translator.allocator.free(ip_packet);
+        }
+        self.observe(now);
+    }
+
+    /// Fire due timers
+    fn poll(self: *Host, now: i64, uplink: *Link) !void {
+        if (due(self.dhcp_deadline, now)) {
+            try self.translator.retransmitDhcp();
+            self.result.dhcp_retransmits += 1;
+            self.armDhcp(now, @min(self.dhcp_timeout_ms * 2, self.options.dhcp_max_timeout_ms));
+        }
+
+        if (due(self.arp_deadline, now)) {
+            const t = self.translator;
+            const request = try t.arp_handler.buildArpRequest(t.our_ip.?, t.gateway_ip.?);
+            defer t.allocator.free(request);
+            try uplink.send(now, request);
+            self.result.arp_requests += 1;
+            self.arp_deadline = now + self.options.arp_retry_ms;
+        }
+
+        if (due(self.renew_at, now)) {
+            try self.translator.renewDhcp();
+            self.phase = .renewing;
+            self.renew_at = null;
+            self.armDhcp(now, self.options.dhcp_timeout_ms);
+        }
+    }
+
+    /// React to state the translator learned from a frame
+    fn observe(self: *Host, now: i64) void {
+        const t = self.translator;
+        if (t.dhcp_client) |client| {
+            switch (self.phase) {
+                .acquiring, .renewing => if (client.state == .BOUND) {
+                    if (self.phase == .acquiring) {
+                        self.result.time_to_ip_ms = now;
+                        const gateway = std.mem.readInt(u32, &client.lease.?.gateway, .big);
+                        if (t.gateway_ip == null and gateway != 0) t.setGateway(gateway);
+                        if (t.gateway_ip != null) self.arp_deadline = now;
+                    } else {
+                        self.result.renewals += 1;
+                    }
+                    self.phase = .bound;
+                    self.dhcp_deadline = null;
+                    self.renew_at = now + @as(i64, client.lease.?.renewal_time) * std.time.ms_per_s;
+                },
+                else => {},
+            }
+            // A NAK restarts discovery
+            if (self.phase == .renewing and client.state == .SELECTING) self.phase = .acquiring;
+        }
+
+        if (t.gateway_mac != null and self.result.time_to_gateway_mac_ms == null) {
+            self.result.time_to_gateway_mac_ms = now;
+            self.arp_deadline = null;
+        }
+    }
+
+    /// Send what the translator queued for the VPN
+    fn flush(self: *Host, now: i64, uplink: *Link) !void {
+        const t = self.translator;
+        while (t.popDhcpPacket()) |frame| {
+            defer t.allocator.free(frame);
+            try uplink.send(now, frame);
+        }
+        while (t.popArpReply()) |frame| {
+            defer t.allocator.free(frame);
+            try uplink.send(now, frame);
+        }
+    }
+};
+
+fn due(deadline: ?i64, now: i64) bool {
+    const t = deadline orelse return false;
+    return now >= t;
+}
+
+fn earliest(times: []const ?i64) ?i64 {
+    var best: ?i64 = null;
+    for (times) |time| {
+        const t = time orelse continue;
+        if (best == null or t < best.?) best = t;
+    }
+    return best;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Scenario
+// ═══════════════════════════════════════════════════════════════════════════
+
+pub const Scenario = struct {
+    seed: u64 = 1,
+    /// Host → gateway
+    uplink: LinkOptions = .{},
+    /// Gateway → host
+    downlink: LinkOptions = .{},
+    gateway: GatewayScript = .{},
+    host: HostOptions = .{},
+    /// Simulated time limit
+    duration_ms: i64 = 120_000,
+    /// Stop as soon as the host has an IP and the gateway MAC
+    stop_when_converged: bool = true,
+};
+
+/// Convergence times are virtual milliseconds since the host started
+pub const Result = struct {
+    time_to_ip_ms: ?i64 = null,
+    time_to_gateway_mac_ms: ?i64 = null,
+    dhcp_retransmits: u32 = 0,
+    arp_requests: u32 = 0,
+    renewals: u32 = 0,
+    frames_sent: u64 = 0,
+    frames_lost: u64 = 0,
+    frames_reordered: u64 = 0,
+    /// Virtual time when the run ended
+    elapsed_ms: i64 = 0,
+
+    pub fn converged(self: Result) bool {
+        return self.time_to_ip_ms != null and self.time_to_gateway_mac_ms != null;
+    }
+};
+
+/// Run one scenario to convergence or its time limit
+pub fn run(allocator: std.mem.Allocator, scenario: Scenario) !Result {
+    var prng = std.Random.DefaultPrng.init(scenario.seed);
+    const random = prng.random();
+    var clock = VirtualClock{};
+    var result = Result{};
+
+    var uplink = Link.init(allocator, scenario.uplink, random);
+    defer uplink.deinit();
+    var downlink = Link.init(allocator, scenario.downlink, random);
+    defer downlink.deinit();
+
+    var gateway = try Gateway.init(allocator, scenario.gateway);
+    defer gateway.deinit();
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = scenario.host.mac });
+    defer translator.deinit();
+
+    var host = Host{ .translator = &translator, .options = scenario.host, .random = random, .result = &result };
+    try host.start(clock.now_ms);
+    try host.flush(clock.now_ms, &uplink);
+
+    while (!(scenario.stop_when_converged and result.converged())) {
+        const next = earliest(&.{ uplink.nextDue(), downlink.nextDue(), host.nextTimer() }) orelse break;
+        if (next > scenario.duration_ms) break;
+        clock.advanceTo(next);
+
+        while (uplink.receive(clock.now_ms)) |frame| {
+            defer uplink.release(frame);
+            try gateway.handle(frame, clock.now_ms, &downlink);
+        }
+        while (downlink.receive(clock.now_ms)) |frame| {
+            defer downlink.release(frame);
+            try host.receive(clock.now_ms, frame);
+        }
+        try host.poll(clock.now_ms, &uplink);
+        try host.flush(clock.now_ms, &uplink);
+    }
+
+    result.frames_sent = uplink.sent + downlink.sent;
+    result.frames_lost = uplink.lost + downlink.lost;
+    result.frames_reordered = uplink.reordered + downlink.reordered;
+    result.elapsed_ms = clock.now_ms;
+    return result;
+}
+
+test "clean link converges in two DHCP round trips plus one ARP round trip" {
+    const result = try run(std.testing.allocator, .{});
+    // DISCOVER/OFFER and REQUEST/ACK: 4 x 20 ms latency + 2 x 1 ms think time
+    try std.testing.expectEqual(@as(?i64, 82), result.time_to_ip_ms);
+    try std.testing.expectEqual(@as(?i64, 82 + 41), result.time_to_gateway_mac_ms);
+    try std.testing.expectEqual(@as(u32, 0), result.dhcp_retransmits);
+    try std.testing.expectEqual(@as(u32, 1), result.arp_requests);
+}
+
+test "ignored messages are retried and the same seed replays exactly" {
+    const scenario = Scenario{
+        .seed = 42,
+        .uplink = .{ .latency_ms = 30, .jitter_ms = 20, .loss = 0.1, .reorder = 0.1 },
+        .downlink = .{ .latency_ms = 30, .jitter_ms = 20, .loss = 0.1, .reorder = 0.1 },
+        .gateway = .{ .ignore_dhcp = 1, .ignore_arp = 2 },
+    };
+    const first = try run(std.testing.allocator, scenario);
+    try std.testing.expect(first.converged());
+    try std.testing.expect(first.dhcp_retransmits >= 1);
+    try std.testing.expect(first.arp_requests >= 3);
+    // The ignored DISCOVER costs at least one 4 s ± 1 s retransmission timeout
+    try std.testing.expect(first.time_to_ip_ms.? >= 3000);
+
+    const second = try run(std.testing.allocator, scenario);
+    try std.testing.expectEqual(first, second);
+}
+
+test "lease is renewed at T1 and the address is kept" {
+    const result = try run(std.testing.allocator, .{
+        .gateway = .{ .lease_time_s = 60, .renewal_time_s = 30 },
+        .duration_ms = 100_000,
+        .stop_when_converged = false,
+    });
+    try std.testing.expectEqual(@as(?i64, 82), result.time_to_ip_ms);
+    // Renewals complete shortly after 30, 60 and 90 s
+    try std.testing.expectEqual(@as(u32, 3), result.renewals);
+    try std.testing.expectEqual(@as(u32, 0), result.dhcp_retransmits);
+}
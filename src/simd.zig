@@ -0,0 +1,363 @@
+//! Runtime SIMD Dispatch
+//!
+//! The hot kernels (checksum, copy, destination filter, control classifier) are
+//! built once per instruction set, and the newest one the host supports is
+//! chosen on first use from CPUID (x86_64) or HWCAP (aarch64). `active()`
+//! reports which.
+//!
+//! Zig has no per-function target attributes, so build.zig compiles the kernel
+//! bodies (`simd_kernels.zig`) into one object per instruction set through
+//! `simd_isa.zig`: x86_64_v2 for SSE4.2 (16-byte vectors), x86_64_v3 for AVX2
+//! (32-byte) and x86_64_v4 for AVX-512 (64-byte) on x86_64, and aarch64+neon.
+//! Each object exports its kernels with the C ABI and they are wrapped into
+//! dispatch tables here. `baseline` is the 16-byte kernel compiled for the
+//! build target, for hosts older than every object; `scalar` is the reference
+//! the others are tested against.
+//!
+//! ```zig
+//! const k = simd.kernels();
+//! cs.sum += k.sum16(payload);
+//! std.log.info("simd: {s}", .{@tagName(simd.active())});
+//! ```
+
+const std = @import("std");
+const builtin = @import("builtin");
+const simd_options = @import("simd_options");
+const impl = @import("simd_kernels.zig");
+const headers = @import("headers.zig");
+const EtherType = headers.EtherType;
+const IpProto = headers.IpProto;
+
+/// Inputs shorter than this skip the dispatch and run the scalar kernel
+pub const min_vector_len = 64;
+
+/// Most lanes a mask-returning kernel handles per call
+pub const max_burst = impl.max_burst;
+
+/// Reference kernels; also handle the tails of the vector variants
+pub const Scalar = impl.Scalar;
+
+/// Kernel variants, named by the instruction set they are compiled for
+pub const Variant = enum(u8) {
+    scalar,
+    baseline,
+    sse4_2,
+    avx2,
+    avx512,
+    neon,
+
+    /// Vector width in bytes (0 = scalar)
+    pub fn width(self: Variant) usize {
+        return switch (self) {
+            .scalar => 0,
+            .baseline, .sse4_2, .neon => 16,
+            .avx2 => 32,
+            .avx512 => 64,
+        };
+    }
+};
+
+/// One variant's kernels
+pub const Kernels = struct {
+    variant: Variant,
+    /// Sum of big-endian 16-bit words (`bytes.len` must be even), unfolded
+    sum16: *const fn (bytes: []const u8) u64,
+    /// Copy `src` to the start of `dst`
+    copy: *const fn (dst: []u8, src: []const u8) void,
+    /// Bit i set if `keys[i]` is unicast and not `our_key` (≤ 64 keys)
+    unicastMiss: *const fn (keys: []const u64, our_key: u64) u64,
+    /// Bit i set if frame i may be control traffic: ARP, IPv4/UDP or
+    /// IPv6/ICMPv6 (≤ 64 frames)
+    controlCandidates: *const fn (ethertypes: []const u16, protocols: []const u8) u64,
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Dispatch
+// ═══════════════════════════════════════════════════════════════════════════
+
+const tables = std.enums.EnumArray(Variant, ?Kernels).init(.{
+    .scalar = tableFor(.scalar),
+    .baseline = tableFor(.baseline),
+    .sse4_2 = tableFor(.sse4_2),
+    .avx2 = tableFor(.avx2),
+    .avx512 = tableFor(.avx512),
+    .neon = tableFor(.neon),
+});
+
+const unselected = std.math.maxInt(u8);
+var selected = std.atomic.Value(u8).init(unselected);
+
+/// Whether this build has the variant: scalar and baseline always, the
+/// instruction sets only where build.zig linked their object
+pub fn built(variant: Variant) bool {
+    return switch (variant) {
+        .scalar, .baseline => true,
+        else => for (simd_options.isas) |isa| {
+            if (std.mem.eql(u8, isa, @tagName(variant))) break true;
+        } else false,
+    };
+}
+
+fn tableFor(comptime variant: Variant) ?Kernels {
+    if (comptime !built(variant)) return null;
+    const K = switch (variant) {
+        .scalar => impl.Scalar,
+        .baseline => impl.Vectorized(variant.width()),
+        else => Linked(@tagName(variant)),
+    };
+    return .{
+        .variant = variant,
+        .sum16 = K.sum16,
+        .copy = K.copy,
+        .unicastMiss = K.unicastMiss,
+        .controlCandidates = K.controlCandidates,
+    };
+}
+
+/// Slice wrappers around one per-ISA object's C-ABI exports
+fn Linked(comptime isa: []const u8) type {
+    const prefix = "taptun_simd_" ++ isa ++ "_";
+    return struct {
+        const c_sum16 = @extern(*const fn ([*]const u8, usize) callconv(.c) u64, .{ .name = prefix ++ "sum16" });
+        const c_copy = @extern(*const fn ([*]u8, [*]const u8, usize) callconv(.c) void, .{ .name = prefix ++ "copy" });
+        const c_unicast_miss = @extern(*const fn ([*]const u64, usize, u64) callconv(.c) u64, .{ .name = prefix ++ "unicast_miss" });
+        const c_control_candidates = @extern(*const fn ([*]const u16, [*]const u8, usize) callconv(.c) u64, .{ .name = prefix ++ "control_candidates" });
+
+        fn sum16(bytes: []const u8) u64 {
+            std.debug.assert(bytes.len % 2 == 0);
+            return c_sum16(bytes.ptr, bytes.len);
+        }
+
+        fn copy(dst: []u8, src: []const u8) void {
+            std.debug.assert(dst.len >= src.len);
+            c_copy(dst.ptr, src.ptr, src.len);
+        }
+
+        fn unicastMiss(keys: []const u64, our_key: u64) u64 {
+            std.debug.assert(keys.len <= max_burst);
+            return c_unicast_miss(keys.ptr, keys.len, our_key);
+        }
+
+        fn controlCandidates(ethertypes: []const u16, protocols: []const u8) u64 {
+            std.debug.assert(ethertypes.len <= max_burst and protocols.len == ethertypes.len);
+            return c_control_candidates(ethertypes.ptr, protocols.ptr, ethertypes.len);
+        }
+    };
+}
+
+/// Kernels of the active variant, detecting the host on first use
+pub inline fn kernels() *const Kernels {
+    const index = selected.load(.acquire);
+    if (index != unselected) return &tables.values[index].?;
+    return selectBest();
+}
+
+/// Variant the kernels dispatch to
+pub fn active() Variant {
+    return kernels().variant;
+}
+
+/// Kernels of one variant, for benchmarks and tests; null if not in this build
+/// They may use instructions this host lacks: check `hostFeatures().supports`.
+pub fn kernelsFor(variant: Variant) ?*const Kernels {
+    const table = tables.getPtrConst(variant);
+    if (table.* == null) return null;
+    return &table.*.?;
+}
+
+/// Force a variant, e.g. to keep 512-bit registers idle where they lower the clock
+pub fn select(variant: Variant) error{Unsupported}!void {
+    if (!hostFeatures().supports(variant)) return error.Unsupported;
+    selected.store(@intFromEnum(variant), .release);
+}
+
+fn selectBest() *const Kernels {
+    // Racing first callers detect the same host, so the last store is harmless
+    const variant = hostFeatures().best();
+    selected.store(@intFromEnum(variant), .release);
+    return &tables.getPtrConst(variant).*.?;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Host Detection
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Instruction sets the host can run, as reported by the CPU and OS
+/// The x86 flags stand for the whole psABI level the object is compiled for.
+pub const Features = struct {
+    sse4_2: bool = false, // x86_64_v2
+    avx2: bool = false, // x86_64_v3
+    avx512: bool = false, // x86_64_v4
+    neon: bool = false,
+
+    /// Whether this build has the variant and the host can run it
+    pub fn supports(self: Features, variant: Variant) bool {
+        if (!built(variant)) return false;
+        return switch (variant) {
+            .scalar, .baseline => true,
+            .sse4_2 => self.sse4_2,
+            .avx2 => self.avx2,
+            .avx512 => self.avx512,
+            .neon => self.neon,
+        };
+    }
+
+    /// Newest supported instruction set, else the baseline build
+    pub fn best(self: Features) Variant {
+        inline for (.{ Variant.avx512, Variant.avx2, Variant.sse4_2, Variant.neon }) |variant| {
+            if (self.supports(variant)) return variant;
+        }
+        // SSE2 and NEON give every x86_64 and AArch64 build 16-byte vectors
+        return switch (builtin.cpu.arch) {
+            .x86_64, .aarch64, .aarch64_be => .baseline,
+            else => .scalar,
+        };
+    }
+};
+
+pub fn hostFeatures() Features {
+    return switch (builtin.cpu.arch) {
+        .x86_64 => x86Features(),
+        .aarch64, .aarch64_be => .{ .neon = armHasNeon() },
+        else => .{},
+    };
+}
+
+fn x86Features() Features {
+    const max_leaf = cpuid(0, 0).eax;
+    const max_ext_leaf = cpuid(0x8000_0000, 0).eax;
+    const ecx1 = cpuid(1, 0).ecx;
+    const ext_ecx = if (max_ext_leaf >= 0x8000_0001) cpuid(0x8000_0001, 0).ecx else 0;
+
+    // x86_64_v2: SSE3, SSSE3, CMPXCHG16B, SSE4.1, SSE4.2, POPCNT and LAHF/SAHF
+    var features = Features{ .sse4_2 = allBits(ecx1, &.{ 0, 9, 13, 19, 20, 23 }) and allBits(ext_ecx, &.{0}) };
+
+    // AVX registers are only usable if the OS saves them (OSXSAVE + XCR0)
+    if (!features.sse4_2 or !allBits(ecx1, &.{27}) or max_leaf < 7) return features;
+    const xcr0 = xgetbv();
+    const ebx7 = cpuid(7, 0).ebx;
+
+    // x86_64_v3: AVX, AVX2, BMI1, BMI2, F16C, FMA, LZCNT, MOVBE and XSAVE
+    features.avx2 = xcr0 & 0x06 == 0x06 and allBits(ecx1, &.{ 12, 22, 26, 28, 29 }) and
+        allBits(ebx7, &.{ 3, 5, 8 }) and allBits(ext_ecx, &.{5});
+    // x86_64_v4: AVX-512 F, DQ, CD, BW and VL
+    features.avx512 = features.avx2 and xcr0 & 0xE6 == 0xE6 and allBits(ebx7, &.{ 16, 17, 28, 30, 31 });
+    return features;
+}
+
+fn allBits(word: u32, comptime bits: []const u5) bool {
+    comptime var mask: u32 = 0;
+    inline for (bits) |bit| mask |= @as(u32, 1) << bit;
+    return word & mask == mask;
+}
+
+const CpuidLeaf = struct { eax: u32, ebx: u32, ecx: u32, edx: u32 };
+
+fn cpuid(leaf: u32, subleaf: u32) CpuidLeaf {
+    var eax: u32 = undefined;
+    var ebx: u32 = undefined;
+    var ecx: u32 = undefined;
+    var edx: u32 = undefined;
+    asm volatile ("cpuid"
+        : [eax] "={eax}" (eax),
+          [ebx] "={ebx}" (ebx),
+          [ecx] "={ecx}" (ecx),
+          [edx] "={edx}" (edx),
+        : [leaf] "{eax}" (leaf),
+          [subleaf] "{ecx}" (subleaf),
+    );
+    return .{ .eax = eax, .ebx = ebx, .ecx = ecx, .edx = edx };
+}
+
+fn xgetbv() u64 {
+    var low: u32 = undefined;
+    var high: u32 = undefined;
+    asm volatile ("xgetbv"
+        : [low] "={eax}" (low),
+          [high] "={edx}" (high),
+        : [index] "{ecx}" (@as(u32, 0)),
+    );
+    return (@as(u64, high) << 32) | low;
+}
+
+/// Advanced SIMD is part of the AArch64 base ISA; Linux still reports it
+fn armHasNeon() bool {
+    if (builtin.os.tag != .linux) return true;
+    const hwcap_asimd = 1 << 1;
+    return std.os.linux.getauxval(std.elf.AT_HWCAP) & hwcap_asimd != 0;
+}
+
+fn fold(sum: u64) u16 {
+    var s = sum;
+    while ((s >> 16) != 0) s = (s & 0xFFFF) + (s >> 16);
+    return @intCast(s);
+}
+
+test "every variant matches the scalar kernels" {
+    var prng = std.Random.DefaultPrng.init(0x51D);
+    const random = prng.random();
+
+    var src: [1030]u8 = undefined;
+    random.bytes(&src);
+    var keys: [max_burst]u64 = undefined;
+    var ethertypes: [max_burst]u16 = undefined;
+    var protocols: [max_burst]u8 = undefined;
+    const our_key: u64 = 0x0200_5E10_2030;
+    for (&keys, &ethertypes, &protocols, 0..) |*key, *ethertype, *protocol, i| {
+        key.* = switch (i % 4) {
+            0 => our_key,
+            1 => 0xFFFF_FFFF_FFFF,
+            else => random.int(u48),
+        };
+        ethertype.* = ([_]u16{ EtherType.ipv4, EtherType.arp, EtherType.ipv6, 0x8100 })[random.uintLessThan(usize, 4)];
+        protocol.* = ([_]u8{ IpProto.udp, IpProto.tcp, IpProto.icmpv6 })[random.uintLessThan(usize, 3)];
+    }
+
+    const features = hostFeatures();
+    for (std.enums.values(Variant)) |variant| {
+        if (!features.supports(variant)) continue;
+        const k = kernelsFor(variant).?;
+        // Lengths around every vector boundary
+        for ([_]usize{ 0, 2, 14, 16, 30, 32, 62, 64, 66, 128, 1030 }) |len| {
+            try std.testing.expectEqual(fold(Scalar.sum16(src[0..len])), fold(k.sum16(src[0..len])));
+
+            var dst = [_]u8{0} ** src.len;
+            k.copy(&dst, src[0..len]);
+            try std.testing.expectEqualSlices(u8, src[0..len], dst[0..len]);
+        }
+        for ([_]usize{ 0, 1, 7, 8, 33, 63, 64 }) |n| {
+            try std.testing.expectEqual(Scalar.unicastMiss(keys[0..n], our_key), k.unicastMiss(keys[0..n], our_key));
+            try std.testing.expectEqual(
+                Scalar.controlCandidates(ethertypes[0..n], protocols[0..n]),
+                k.controlCandidates(ethertypes[0..n], protocols[0..n]),
+            );
+        }
+    }
+}
+
+test "dispatch picks a supported variant and honours select" {
+    const features = hostFeatures();
+    try std.testing.expect(features.supports(active()));
+    try std.testing.expectEqual(features.best(), active());
+
+    try select(.scalar);
+    try std.testing.expectEqual(Variant.scalar, active());
+    try select(features.best());
+
+    // No x86 object is linked into an AArch64 build
+    if (builtin.cpu.arch == .aarch64) try std.testing.expectError(error.Unsupported, select(.avx2));
+}
+
+test "the instruction-set objects for this architecture are linked in" {
+    const expected: []const Variant = switch (builtin.cpu.arch) {
+        .x86_64 => &.{ .sse4_2, .avx2, .avx512 },
+        .aarch64 => &.{.neon},
+        else => &.{},
+    };
+    for (std.enums.values(Variant)) |variant| {
+        const isa = variant != .scalar and variant != .baseline;
+        const want = !isa or std.mem.indexOfScalar(Variant, expected, variant) != null;
+        try std.testing.expectEqual(want, kernelsFor(variant) != null);
+    }
+}
+
@@ -0,0 +1,38 @@
+//! Per-ISA Kernel Object
+//!
+//! build.zig compiles this file once per instruction set the target
+//! architecture has a dispatch variant for (x86_64_v2, x86_64_v3 and
+//! x86_64_v4 for SSE4.2, AVX2 and AVX-512; aarch64 with NEON), each time with
+//! that CPU model, and links the objects into the taptun module. Each object
+//! exports the kernels with the C ABI under `taptun_simd_<isa>_`; `simd.zig`
+//! wraps them into a dispatch table and only calls them on hosts that have
+//! the instruction set.
+
+const options = @import("simd_isa_options");
+const kernels = @import("simd_kernels.zig");
+
+const K = kernels.Vectorized(options.width);
+const prefix = "taptun_simd_" ++ options.isa ++ "_";
+
+comptime {
+    @export(&sum16, .{ .name = prefix ++ "sum16" });
+    @export(&copy, .{ .name = prefix ++ "copy" });
+    @export(&unicastMiss, .{ .name = prefix ++ "unicast_miss" });
+    @export(&controlCandidates, .{ .name = prefix ++ "control_candidates" });
+}
+
+fn sum16(bytes: [*]const u8, len: usize) callconv(.c) u64 {
+    return K.sum16(bytes[0..len]);
+}
+
+fn copy(dst: [*]u8, src: [*]const u8, len: usize) callconv(.c) void {
+    K.copy(dst[0..len], src[0..len]);
+}
+
+fn unicastMiss(keys: [*]const u64, len: usize, our_key: u64) callconv(.c) u64 {
+    return K.unicastMiss(keys[0..len], our_key);
+}
+
+fn controlCandidates(ethertypes: [*]const u16, protocols: [*]const u8, len: usize) callconv(.c) u64 {
+    return K.controlCandidates(ethertypes[0..len], protocols[0..len]);
+}
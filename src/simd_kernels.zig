@@ -0,0 +1,162 @@
+//! SIMD Kernel Bodies
+//!
+//! The kernels `simd.zig` dispatches to, free of any dispatch state so they can
+//! be compiled into the library for the build target and, through
+//! `simd_isa.zig`, once more per instruction set. Everything here depends only
+//! on `builtin.cpu`, which differs between those builds.
+
+const std = @import("std");
+const builtin = @import("builtin");
+const headers = @import("headers.zig");
+const EtherType = headers.EtherType;
+const IpProto = headers.IpProto;
+
+/// Most lanes a mask-returning kernel handles per call
+pub const max_burst = 64;
+
+/// Group bit of a MAC packed by `mac_filter.macKey`
+const group_bit: u64 = 1 << 40;
+
+/// Reference kernels; also handle the tails of the vector variants
+pub const Scalar = struct {
+    pub fn sum16(bytes: []const u8) u64 {
+        std.debug.assert(bytes.len % 2 == 0);
+        var rest = bytes;
+        var sum: u64 = 0;
+        // 32-bit big-endian words fold to the same 16-bit result (2^16 ≡ 1 mod 0xFFFF)
+        while (rest.len >= 4) : (rest = rest[4..]) {
+            sum += std.mem.readInt(u32, rest[0..4], .big);
+        }
+        if (rest.len == 2) sum += std.mem.readInt(u16, rest[0..2], .big);
+        return sum;
+    }
+
+    pub fn copy(dst: []u8, src: []const u8) void {
+        @memcpy(dst[0..src.len], src);
+    }
+
+    pub fn unicastMiss(keys: []const u64, our_key: u64) u64 {
+        std.debug.assert(keys.len <= max_burst);
+        var mask: u64 = 0;
+        for (keys, 0..) |key, i| {
+            if (key != our_key and key & group_bit == 0) mask |= @as(u64, 1) << @intCast(i);
+        }
+        return mask;
+    }
+
+    pub fn controlCandidates(ethertypes: []const u16, protocols: []const u8) u64 {
+        std.debug.assert(ethertypes.len <= max_burst and protocols.len == ethertypes.len);
+        var mask: u64 = 0;
+        for (ethertypes, protocols, 0..) |ethertype, protocol, i| {
+            const hit = ethertype == EtherType.arp or
+                (ethertype == EtherType.ipv4 and protocol == IpProto.udp) or
+                (ethertype == EtherType.ipv6 and protocol == IpProto.icmpv6);
+            if (hit) mask |= @as(u64, 1) << @intCast(i);
+        }
+        return mask;
+    }
+};
+
+/// Kernels over `width`-byte vectors; tails shorter than a vector go scalar
+pub fn Vectorized(comptime width: usize) type {
+    return struct {
+        const Bytes = @Vector(width, u8);
+
+        const word_lanes = width / 2;
+        const Words = @Vector(word_lanes, u16);
+        const WordSums = @Vector(word_lanes, u32);
+        const WordTotals = @Vector(word_lanes, u64);
+        const WordMask = std.meta.Int(.unsigned, word_lanes);
+
+        const key_lanes = width / 8;
+        const Keys = @Vector(key_lanes, u64);
+        const KeyMask = std.meta.Int(.unsigned, key_lanes);
+
+        /// 32-bit lanes hold this many 16-bit additions without overflowing
+        const max_rounds = 1 << 16;
+
+        pub fn sum16(bytes: []const u8) u64 {
+            std.debug.assert(bytes.len % 2 == 0);
+            var rest = bytes;
+            var lanes: WordSums = @splat(0);
+            var native: u64 = 0;
+            var rounds: usize = 0;
+            while (rest.len >= width) : (rest = rest[width..]) {
+                const block: Bytes = rest[0..width].*;
+                const words: Words = @bitCast(block);
+                const widened: WordSums = @intCast(words);
+                lanes += widened;
+                rounds += 1;
+                if (rounds == max_rounds) {
+                    native += @reduce(.Add, @as(WordTotals, @intCast(lanes)));
+                    lanes = @splat(0);
+                    rounds = 0;
+                }
+            }
+            native += @reduce(.Add, @as(WordTotals, @intCast(lanes)));
+            return toBigEndianSum(native) + Scalar.sum16(rest);
+        }
+
+        pub fn copy(dst: []u8, src: []const u8) void {
+            std.debug.assert(dst.len >= src.len);
+            var i: usize = 0;
+            while (i + width <= src.len) : (i += width) {
+                const block: Bytes = src[i..][0..width].*;
+                dst[i..][0..width].* = block;
+            }
+            @memcpy(dst[i..src.len], src[i..]);
+        }
+
+        pub fn unicastMiss(keys: []const u64, our_key: u64) u64 {
+            std.debug.assert(keys.len <= max_burst);
+            const ours: Keys = @splat(our_key);
+            const group: Keys = @splat(group_bit);
+            const zero: Keys = @splat(0);
+            var mask: u64 = 0;
+            var i: usize = 0;
+            while (i + key_lanes <= keys.len) : (i += key_lanes) {
+                const block: Keys = keys[i..][0..key_lanes].*;
+                const miss = both(block != ours, block & group == zero);
+                mask |= @as(u64, @as(KeyMask, @bitCast(miss))) << @intCast(i);
+            }
+            if (i == keys.len) return mask;
+            return mask | Scalar.unicastMiss(keys[i..], our_key) << @intCast(i);
+        }
+
+        pub fn controlCandidates(ethertypes: []const u16, protocols: []const u8) u64 {
+            std.debug.assert(ethertypes.len <= max_burst and protocols.len == ethertypes.len);
+            const Protocols = @Vector(word_lanes, u8);
+            var mask: u64 = 0;
+            var i: usize = 0;
+            while (i + word_lanes <= ethertypes.len) : (i += word_lanes) {
+                const types: Words = ethertypes[i..][0..word_lanes].*;
+                const protos: Protocols = protocols[i..][0..word_lanes].*;
+                const arp = types == @as(Words, @splat(EtherType.arp));
+                const udp4 = both(types == @as(Words, @splat(EtherType.ipv4)), protos == @as(Protocols, @splat(IpProto.udp)));
+                const icmp6 = both(types == @as(Words, @splat(EtherType.ipv6)), protos == @as(Protocols, @splat(IpProto.icmpv6)));
+                const hit = either(arp, either(udp4, icmp6));
+                mask |= @as(u64, @as(WordMask, @bitCast(hit))) << @intCast(i);
+            }
+            if (i == ethertypes.len) return mask;
+            return mask | Scalar.controlCandidates(ethertypes[i..], protocols[i..]) << @intCast(i);
+        }
+    };
+}
+
+inline fn both(a: anytype, b: @TypeOf(a)) @TypeOf(a) {
+    return @select(bool, a, b, @as(@TypeOf(a), @splat(false)));
+}
+
+inline fn either(a: anytype, b: @TypeOf(a)) @TypeOf(a) {
+    return @select(bool, a, @as(@TypeOf(a), @splat(true)), b);
+}
+
+/// Convert a sum of native-order words into an equivalent big-endian one
+/// Byte order commutes with one's-complement addition (RFC 1071 §2(B)), so the
+/// folded sum only needs its bytes swapped.
+inline fn toBigEndianSum(native: u64) u64 {
+    if (builtin.cpu.arch.endian() == .big) return native;
+    var sum = native;
+    while ((sum >> 16) != 0) sum = (sum & 0xFFFF) + (sum >> 16);
+    return @byteSwap(@as(u16, @intCast(sum)));
+}
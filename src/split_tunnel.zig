@@ -0,0 +1,447 @@
+//! Domain-Based Split Tunneling
+//!
+//! Turns domain policy ("route *.corp.example through the tunnel") into IP
+//! routes. DNS responses arriving from the tunnel are snooped on the L2→L3 path;
+//! when the question name matches a tunnel rule, the A/AAAA addresses in the
+//! answer section become host routes that expire with the record TTLs.
+//! Only responses from the resolvers registered with `addResolver` are
+//! trusted; anything else on source port 53 could steer traffic into or
+//! out of the tunnel.
+//!
+//! Rules are compiled into a label trie keyed from the top-level domain down,
+//! so matching a name costs one hash lookup per label: O(name length). The
+//! longest matching rule wins, which allows exclusions:
+//!
+//! ```zig
+//! try split.addRule("corp.example", .tunnel); // corp.example and subdomains
+//! try split.addRule("*.cdn.example", .tunnel); // subdomains only
+//! try split.addRule("www.corp.example", .direct); // exception
+//! try split.addResolver(0x0A150001); // 10.21.0.1, the tunnel's DNS server
+//! ```
+//!
+//! Route changes are batched: `flush` hands every pending addition and expired
+//! route to a sink in one call (e.g. one `ip -batch` run on Linux), instead of
+//! one routing-table command per DNS answer.
+
+const std = @import("std");
+const dns = @import("dns_proxy.zig");
+
+pub const Policy = enum { tunnel, direct };
+
+/// Route destination; IPv4 addresses are stored IPv4-mapped (::ffff:a.b.c.d)
+pub const Address = [16]u8;
+
+pub fn addressFromIpv4(ip: [4]u8) Address {
+    return [_]u8{0} ** 10 ++ [_]u8{ 0xFF, 0xFF } ++ ip;
+}
+
+pub fn isIpv4(addr: Address) bool {
+    return std.mem.allEqual(u8, addr[0..10], 0) and addr[10] == 0xFF and addr[11] == 0xFF;
+}
+
+/// Longest textual domain name
+const max_name_len = 253;
+/// Most labels a name can have
+const max_labels = 128;
+
+/// Compiled domain-suffix rules
+pub const DomainTrie = struct {
+    allocator: std.mem.Allocator,
+    nodes: std.ArrayList(Node),
+    children: std.AutoHashMap(ChildKey, u32),
+
+    const Self = @This();
+
+    const Node = struct {
+        /// Lowercase label (empty for the root)
+        label: []const u8,
+        /// Rule for the name ending at this node
+        self_policy: ?Policy = null,
+        /// Rule for strict subdomains of this node
+        sub_policy: ?Policy = null,
+    };
+
+    const ChildKey = struct {
+        parent: u32,
+        label_hash: u64,
+    };
+
+    pub fn init(allocator: std.mem.Allocator) !Self {
+        var nodes = std.ArrayList(Node){};
+        try nodes.append(allocator, .{ .label = "" });
+        return .{
+            .allocator = allocator,
+            .nodes = nodes,
+            .children = std.AutoHashMap(ChildKey, u32).init(allocator),
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        for (self.nodes.items[1..]) |node| self.allocator.free(node.label);
+        self.nodes.deinit(self.allocator);
+        self.children.deinit();
+    }
+
+    /// Add a rule: "corp.example" matches the domain and all subdomains,
+    /// "*.corp.example" only subdomains. A later rule for the same pattern replaces the earlier one.
+    pub fn addRule(self: *Self, pattern: []const u8, policy: Policy) !void {
+        var name = std.mem.trimRight(u8, pattern, ".");
+        const subdomains_only = std.mem.startsWith(u8, name, "*.");
+        if (subdomains_only) name = name[2..];
+        if (name.len == 0 or name.len > max_name_len) return error.InvalidRule;
+
+        var node: u32 = 0;
+        var it = std.mem.splitBackwardsScalar(u8, name, '.');
+        while (it.next()) |label| {
+            if (label.len == 0 or label.len > 63) return error.InvalidRule;
+            node = self.findChild(node, label) orelse try self.addChild(node, label);
+        }
+
+        if (!subdomains_only) self.nodes.items[node].self_policy = policy;
+        self.nodes.items[node].sub_policy = policy;
+    }
+
+    /// Number of distinct labels in the trie
+    pub fn nodeCount(self: *const Self) usize {
+        return self.nodes.items.len;
+    }
+
+    fn labelHash(label: []const u8) u64 {
+        var lower: [63]u8 = undefined;
+        for (label, 0..) |c, i| lower[i] = std.ascii.toLower(c);
+        return std.hash.Wyhash.hash(0, lower[0..label.len]);
+    }
+
+    fn findChild(self: *const Self, parent: u32, label: []const u8) ?u32 {
+        if (label.len > 63) return null;
+        const index = self.children.get(.{ .parent = parent, .label_hash = labelHash(label) }) orelse return null;
+        if (!std.ascii.eqlIgnoreCase(self.nodes.items[index].label, label)) return null; // Hash collision
+        return index;
+    }
+
+    fn addChild(self: *Self, parent: u32, label: []const u8) !u32 {
+        const lower = try std.ascii.allocLowerString(self.allocator, label);
+        errdefer self.allocator.free(lower);
+
+        const index: u32 = @intCast(self.nodes.items.len);
+        try self.nodes.append(self.allocator, .{ .label = lower });
+        errdefer _ = self.nodes.pop();
+        try self.children.put(.{ .parent = parent, .label_hash = labelHash(label) }, index);
+        return index;
+    }
+
+    /// Policy for a name given as labels in wire order (leftmost first)
+    fn matchLabels(self: *const Self, labels: []const []const u8) ?Policy {
+        var node: u32 = 0;
+        var best: ?Policy = null;
+        var i = labels.len;
+        while (i > 0) {
+            i -= 1;
+            node = self.findChild(node, labels[i]) orelse break;
+            const n = self.nodes.items[node];
+            // More labels to the left: the name is a strict subdomain of this node
+            if (i > 0) {
+                if (n.sub_policy) |p| best = p;
+            } else if (n.self_policy) |p| best = p;
+        }
+        return best;
+    }
+
+    /// Policy for a dotted name ("host.corp.example")
+    pub fn match(self: *const Self, name: []const u8) ?Policy {
+        var labels: [max_labels][]const u8 = undefined;
+        var count: usize = 0;
+        var it = std.mem.splitScalar(u8, std.mem.trimRight(u8, name, "."), '.');
+        while (it.next()) |label| {
+            if (count == max_labels) return null;
+            labels[count] = label;
+            count += 1;
+        }
+        return self.matchLabels(labels[0..count]);
+    }
+
+    /// Policy for an uncompressed wire-format name (a DNS question name)
+    pub fn matchWire(self: *const Self, wire: []const u8) ?Policy {
+        var labels: [max_labels][]const u8 = undefined;
+        var count: usize = 0;
+        var off: usize = 0;
+        while (off < wire.len and wire[off] != 0) {
+            const len = wire[off];
+            if (len > 63 or off + 1 + len > wire.len or count == max_labels) return null;
+            labels[count] = wire[off + 1 ..][0..len];
+            count += 1;
+            off += 1 + len;
+        }
+        return self.matchLabels(labels[0..count]);
+    }
+};
+
+pub const Options = struct {
+    min_route_ttl_s: u32 = 300, // Floor on route lifetime; hosts often cache answers past the TTL
+    max_routes: u32 = 4096, // Routes beyond this are not installed
+};
+
+pub const SplitTunnel = struct {
+    allocator: std.mem.Allocator,
+    options: Options,
+    rules: DomainTrie,
+    /// Installed (or pending) routes and their expiry time
+    routes: std.AutoHashMap(Address, i64),
+    pending_add: std.ArrayList(Address),
+    /// IPv4 addresses whose DNS responses are snooped
+    resolvers: std.ArrayList(u32),
+
+    // Counters
+    answers_matched: u64 = 0,
+    answers_untrusted: u64 = 0,
+    routes_added: u64 = 0,
+    routes_expired: u64 = 0,
+    /// Routes refused because `max_routes` were already held
+    routes_dropped: u64 = 0,
+    /// Routes lost because the table could not grow (counted by the caller)
+    route_alloc_failures: u64 = 0,
+    batches: u64 = 0,
+
+    const Self = @This();
+
+    pub fn init(allocator: std.mem.Allocator, options: Options) !Self {
+        return .{
+            .allocator = allocator,
+            .options = options,
+            .rules = try DomainTrie.init(allocator),
+            .routes = std.AutoHashMap(Address, i64).init(allocator),
+            .pending_add = std.ArrayList(Address){},
+            .resolvers = std.ArrayList(u32){},
+        };
+    }
+
+    pub fn deinit(self: *Self) void {
+        self.rules.deinit();
+        self.routes.deinit();
+        self.pending_add.deinit(self.allocator);
+        self.resolvers.deinit(self.allocator);
+    }
+
+    pub fn addRule(self: *Self, pattern: []const u8, policy: Policy) !void {
+        try self.rules.addRule(pattern, policy);
+    }
+
+    /// Trust DNS responses from `ip`; with no resolvers nothing is snooped
+    pub fn addResolver(self: *Self, ip: u32) !void {
+        if (std.mem.indexOfScalar(u32, self.resolvers.items, ip) != null) return;
+        try self.resolvers.append(self.allocator, ip);
+    }
+
+    /// Snoop a DNS response (IPv4/UDP packet from the tunnel); answers for
+    /// tunnel-policy names from a configured resolver are queued as routes
+    /// Rejected answers and a full table are counted here; the only error is
+    /// running out of memory while adding a route.
+    pub fn onDnsResponse(self: *Self, ip_packet: []const u8, now_ms: i64) error{OutOfMemory}!void {
+        const dg = dns.udpDatagram(ip_packet) orelse return;
+        if (dg.src_port != dns.dns_port) return;
+        if (std.mem.indexOfScalar(u32, self.resolvers.items, dg.src_ip) == null) {
+            self.answers_untrusted += 1;
+            return;
+        }
+        const q = dns.parseQuestion(dg.payload) catch return;
+        if (q.flags & dns.flag_qr == 0) return;
+        if (self.rules.matchWire(q.name) != .tunnel) return;
+        self.answers_matched += 1;
+
+        // Addresses anywhere in the answer (including behind CNAMEs) belong to the asked name
+        var it = dns.RecordIterator.init(dg.payload, q);
+        while (it.next() catch return) |rec| {
+            if (rec.section != .answer) break;
+            const addr: Address = switch (rec.rtype) {
+                dns.type_a => if (rec.rdata.len == 4) addressFromIpv4(rec.rdata[0..4].*) else continue,
+                dns.type_aaaa => if (rec.rdata.len == 16) rec.rdata[0..16].* else continue,
+                else => continue,
+            };
+            const ttl_s = @max(rec.ttl, self.options.min_route_ttl_s);
+            try self.insert(addr, now_ms + @as(i64, ttl_s) * 1000);
+        }
+    }
+
+    fn insert(self: *Self, addr: Address, expires_ms: i64) error{OutOfMemory}!void {
+        if (self.routes.getPtr(addr)) |expiry| {
+            expiry.* = @max(expiry.*, expires_ms);
+            return;
+        }
+        if (self.routes.count() >= self.options.max_routes) {
+            self.routes_dropped += 1;
+            return;
+        }
+        try self.routes.put(addr, expires_ms);
+        errdefer _ = self.routes.remove(addr);
+        try self.pending_add.append(self.allocator, addr);
+    }
+
+    /// Number of routes currently held
+    pub fn routeCount(self: *const Self) usize {
+        return self.routes.count();
+    }
+
+    /// Hand pending additions and expired routes to `sink` in one batch
+    /// `sink` provides `applyRoutes(add: []const Address, delete: []const Address) !void`.
+    /// If the sink fails, nothing is dropped and the next flush retries.
+    pub fn flush(self: *Self, sink: anytype, now_ms: i64) !void {
+        var expired = std.ArrayList(Address){};
+        defer expired.deinit(self.allocator);
+
+        var it = self.routes.iterator();
+        while (it.next()) |kv| {
+            if (kv.value_ptr.* <= now_ms) try expired.append(self.allocator, kv.key_ptr.*);
+        }
+        if (self.pending_add.items.len == 0 and expired.items.len == 0) return;
+
+        try sink.applyRoutes(self.pending_add.items, expired.items);
+
+        for (expired.items) |addr| _ = self.routes.remove(addr);
+        self.routes_added += self.pending_add.items.len;
+        self.routes_expired += expired.items.len;
+        self.batches += 1;
+        self.pending_add.clearRetainingCapacity();
+    }
+};
+
+test "DomainTrie longest suffix match" {
+    var trie = try DomainTrie.init(std.testing.allocator);
+    defer trie.deinit();
+
+    try trie.addRule("corp.example", .tunnel);
+    try trie.addRule("www.corp.example", .direct);
+    try trie.addRule("*.cdn.example.", .tunnel);
+
+    try std.testing.expectEqual(@as(?Policy, .tunnel), trie.match("corp.example"));
+    try std.testing.expectEqual(@as(?Policy, .tunnel), trie.match("git.eu.CORP.example"));
+    try std.testing.expectEqual(@as(?Policy, .direct), trie.match("www.corp.example"));
+    try std.testing.expectEqual(@as(?Policy, .direct), trie.match("a.www.corp.example"));
+    try std.testing.expectEqual(@as(?Policy, null), trie.match("cdn.example"));
+    try std.testing.expectEqual(@as(?Policy, .tunnel), trie.match("img.cdn.example"));
+    try std.testing.expectEqual(@as(?Policy, null), trie.match("example"));
+    try std.testing.expectEqual(@as(?Policy, null), trie.match("notcorp.example"));
+
+    try std.testing.expectEqual(@as(?Policy, .tunnel), trie.matchWire("\x03git\x04corp\x07example\x00"));
+    try std.testing.expectError(error.InvalidRule, trie.addRule("a..b", .tunnel));
+}
+
+const RecordingSink = struct {
+    added: usize = 0,
+    deleted: usize = 0,
+    calls: usize = 0,
+
+    pub fn applyRoutes(self: *RecordingSink, add: []const Address, delete: []const Address) !void {
+        self.added += add.len;
+        self.deleted += delete.len;
+        self.calls += 1;
+    }
+};
+
+const resolver_ip: u32 = 0x0A150001; // 10.21.0.1
+
+/// DNS response for `name` (wire format) with one A record per address, from `resolver_ip`
+fn testResponse(buf: []u8, name: []const u8, addrs: []const [4]u8, ttl: u32) []u8 {
+    const headers = @import("headers.zig");
+    const msg_off = headers.Ipv4.size + headers.Udp.size;
+    const msg = buf[msg_off..];
+    @memset(msg[0..headers.Dns.size], 0);
+    const hdr = headers.Dns.viewMut(msg) catch unreachable;
+    hdr.set(.flags, dns.flag_qr | 0x0180);
+    hdr.set(.qdcount, 1);
+    hdr.set(.ancount, @intCast(addrs.len));
+
+    var len: usize = headers.Dns.size;
+    @memcpy(msg[len..][0..name.len], name);
+    len += name.len;
+    @memcpy(msg[len..][0..4], &[_]u8{ 0, 1, 0, 1 });
+    len += 4;
+    for (addrs) |addr| {
+        const rr = [_]u8{ 0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0, 0, 0, 4 };
+        @memcpy(msg[len..][0..rr.len], &rr);
+        std.mem.writeInt(u32, msg[len + 6 ..][0..4], ttl, .big);
+        @memcpy(msg[len + rr.len ..][0..4], &addr);
+        len += rr.len + 4;
+    }
+
+    const total = msg_off + len;
+    @memset(buf[0..msg_off], 0);
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, @intCast(total));
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.src_ip, resolver_ip);
+    const udp = headers.Udp.viewMut(buf[headers.Ipv4.size..]) catch unreachable;
+    udp.set(.src_port, dns.dns_port);
+    udp.set(.dst_port, 40000);
+    udp.set(.length, @intCast(headers.Udp.size + len));
+    return buf[0..total];
+}
+
+test "SplitTunnel installs and expires routes from snooped answers" {
+    var split = try SplitTunnel.init(std.testing.allocator, .{ .min_route_ttl_s = 60 });
+    defer split.deinit();
+    try split.addRule("corp.example", .tunnel);
+    try split.addResolver(resolver_ip);
+
+    var buf: [512]u8 = undefined;
+    const addrs = [_][4]u8{ .{ 10, 8, 0, 1 }, .{ 10, 8, 0, 2 } };
+    try split.onDnsResponse(testResponse(&buf, "\x03git\x04corp\x07example\x00", &addrs, 30), 0);
+    try split.onDnsResponse(testResponse(&buf, "\x03git\x04corp\x07example\x00", addrs[0..1], 120), 1000);
+    try split.onDnsResponse(testResponse(&buf, "\x03www\x06public\x07example\x00", addrs[0..1], 120), 1000);
+
+    var sink = RecordingSink{};
+    try split.flush(&sink, 2000);
+    try std.testing.expectEqual(@as(usize, 2), sink.added);
+    try std.testing.expectEqual(@as(usize, 1), sink.calls);
+    try std.testing.expectEqual(@as(u64, 2), split.answers_matched);
+
+    // 10.8.0.2 lives for the 60 s floor; 10.8.0.1 was refreshed to 121 s
+    try split.flush(&sink, 61_000);
+    try std.testing.expectEqual(@as(usize, 1), sink.deleted);
+    try std.testing.expectEqual(@as(usize, 1), split.routeCount());
+    try split.flush(&sink, 121_000);
+    try std.testing.expectEqual(@as(usize, 2), sink.deleted);
+    try std.testing.expectEqual(@as(usize, 3), sink.calls);
+}
+
+test "SplitTunnel only trusts answers from configured resolvers" {
+    const headers = @import("headers.zig");
+    var split = try SplitTunnel.init(std.testing.allocator, .{});
+    defer split.deinit();
+    try split.addRule("corp.example", .tunnel);
+
+    var buf: [512]u8 = undefined;
+    const addrs = [_][4]u8{.{ 10, 8, 0, 1 }};
+    const response = testResponse(&buf, "\x04corp\x07example\x00", &addrs, 300);
+
+    // No resolver configured: nothing is snooped
+    try split.onDnsResponse(response, 0);
+    try std.testing.expectEqual(@as(usize, 0), split.routeCount());
+
+    // A forged answer from another host on the tunnel is ignored
+    try split.addResolver(resolver_ip);
+    const ip = try headers.Ipv4.viewMut(response);
+    ip.set(.src_ip, 0x0A150063);
+    try split.onDnsResponse(response, 0);
+    try std.testing.expectEqual(@as(usize, 0), split.routeCount());
+    try std.testing.expectEqual(@as(u64, 2), split.answers_untrusted);
+
+    ip.set(.src_ip, resolver_ip);
+    try split.onDnsResponse(response, 0);
+    try std.testing.expectEqual(@as(usize, 1), split.routeCount());
+}
+
+test "SplitTunnel reports a route it cannot allocate as an error, not a drop" {
+    var failing = std.testing.FailingAllocator.init(std.testing.allocator, .{});
+    var split = try SplitTunnel.init(failing.allocator(), .{});
+    defer split.deinit();
+    try split.addRule("corp.example", .tunnel);
+    try split.addResolver(resolver_ip);
+
+    var buf: [512]u8 = undefined;
+    const addrs = [_][4]u8{.{ 10, 8, 0, 1 }};
+    failing.fail_index = failing.alloc_index;
+    try std.testing.expectError(error.OutOfMemory, split.onDnsResponse(testResponse(&buf, "\x04corp\x07example\x00", &addrs, 300), 0));
+    try std.testing.expectEqual(@as(u64, 0), split.routes_dropped);
+    try std.testing.expectEqual(@as(usize, 0), split.routeCount());
+}
@@ -16,6 +16,41 @@ pub const L2L3Translator = @import("translator.zig").L2L3Translator;
 pub const ArpHandler = @import("arp.zig").ArpHandler;
 pub const DhcpClient = @import("dhcp_client.zig").DhcpClient;
 pub const DhcpPacket = @import("dhcp_client.zig").DhcpPacket;
+pub const headers = @import("headers.zig");
+pub const packet = @import("packet.zig");
+pub const Packet = packet.Packet;
+pub const PacketPool = packet.PacketPool;
+pub const checksum = @import("checksum.zig");
+pub const MacFilter = @import("mac_filter.zig").MacFilter;
+pub const multicast = @import("multicast.zig");
+pub const icmp = @import("icmp.zig");
+pub const pmtu = @import("pmtu.zig");
+pub const dns_proxy = @import("dns_proxy.zig");
+pub const DnsProxy = dns_proxy.DnsProxy;
+pub const split_tunnel = @import("split_tunnel.zig");
+pub const SplitTunnel = split_tunnel.SplitTunnel;
+pub const pcap = @import("pcap.zig");
+pub const config = @import("config.zig");
+pub const handover = @import("handover.zig");
+pub const control_plane = @import("control_plane.zig");
+pub const ControlPlane = control_plane.ControlPlane;
+pub const SpscRing = @import("queue.zig").SpscRing;
+pub const arena = @import("arena.zig");
+pub const BatchArena = arena.BatchArena;
+pub const realtime = @import("realtime.zig");
+pub const simd = @import("simd.zig");
+pub const validate = @import("validate.zig");
+pub const sim = @import("sim.zig");
+pub const block = @import("block.zig");
+pub const bonding = @import("bonding.zig");
+pub const Bond = bonding.Bond;
+pub const parallel = @import("parallel.zig");
+
+// MTU limits shared by devices, buffers and the FFI
+pub const min_mtu = packet.min_mtu;
+pub const max_mtu = packet.max_mtu;
+pub const default_mtu = packet.default_mtu;
+pub const maxFrameSize = packet.maxFrameSize;
 
 // C FFI exports (for iOS/Android packet adapters)
 // DISABLED: SoftEtherClient provides its own C wrapper in taptun_wrapper.zig
@@ -36,18 +71,22 @@ pub const DhcpPacket = @import("dhcp_client.zig").DhcpPacket;
 
 // High-level adapter (combines device + translator)
 pub const TunAdapter = @import("tun_adapter.zig").TunAdapter;
+pub const GenericTunAdapter = @import("tun_adapter.zig").GenericTunAdapter;
+pub const LoopbackDevice = @import("loopback.zig").LoopbackDevice;
 
 // Platform-specific device implementations
 pub const platform = switch (builtin.os.tag) {
     .macos, .ios => @import("platform/macos.zig"),
     .windows => @import("platform/windows.zig"),
-    else => @compileError("Platform not yet supported. Available: macOS, Windows. Coming soon: Linux, FreeBSD"),
+    .linux => @import("platform/linux.zig"),
+    else => @compileError("Platform not yet supported. Available: macOS, Windows, Linux. Coming soon: FreeBSD"),
 };
 
 /// Platform-specific TUN device (low-level, for advanced users)
 pub const TunDevice = switch (builtin.os.tag) {
     .macos, .ios => platform.MacOSUtunDevice,
     .windows => platform.WindowsTapDevice,
+    .linux => platform.LinuxTun,
     else => @compileError("Platform not yet supported"),
 };
 
@@ -59,12 +98,21 @@ pub const TranslatorOptions = struct {
     handle_arp: bool = true,
     arp_timeout_ms: u32 = 60000,
     verbose: bool = false,
+    filter_dst_mac: bool = true, // Drop inbound frames not addressed to us (virtual hub flooding)
+    validate_ip: bool = false, // Check inbound IP headers and trim Ethernet padding to the IP length
+    snoop_multicast: bool = true, // Track IGMP/MLD joins; drop inbound multicast for other groups
+    tunnel_mtu: ?u32 = null, // Effective tunnel MTU; larger DF/IPv6 packets get a local ICMP Too Big
+    icmp_rate_per_sec: u32 = 100, // Rate limit for locally generated ICMP errors
+    icmp_burst: u32 = 10,
+    dns_cache: ?dns_proxy.Options = null, // Answer/coalesce UDP/53 queries in path (null = disabled)
+    split_tunnel: ?*split_tunnel.SplitTunnel = null, // Snoop DNS answers into domain routes (caller flushes)
+    control_plane: ?*control_plane.ControlPlane = null, // Divert ARP/DHCP to a control thread, copy RAs to it (caller owns it)
 };
 
 /// Device options for TUN/TAP creation
 pub const DeviceOptions = struct {
     unit: ?u32 = null, // Device unit number (null = auto-assign)
-    mtu: u16 = 1500,
+    mtu: u32 = default_mtu, // Interface MTU, up to max_mtu (65535) for jumbo tunnels
     non_blocking: bool = true,
 };
 
@@ -5,9 +5,23 @@
 
 const std = @import("std");
 const taptun = @import("taptun.zig");
+const headers = @import("headers.zig");
+const EtherType = headers.EtherType;
 const ArpHandler = @import("arp.zig").ArpHandler;
 const DhcpClient = @import("dhcp_client.zig").DhcpClient;
 const DhcpPacket = @import("dhcp_client.zig").DhcpPacket;
+const Packet = @import("packet.zig").Packet;
+const checksum = @import("checksum.zig");
+const MacFilter = @import("mac_filter.zig").MacFilter;
+const multicast = @import("multicast.zig");
+const icmp = @import("icmp.zig");
+const pmtu = @import("pmtu.zig");
+const DnsProxy = @import("dns_proxy.zig").DnsProxy;
+const rewriteQueryId = @import("dns_proxy.zig").rewriteQueryId;
+const control_plane = @import("control_plane.zig");
+const BatchArena = @import("arena.zig").BatchArena;
+const simd = @import("simd.zig");
+const validate = @import("validate.zig");
 
 pub const L2L3Translator = struct {
     allocator: std.mem.Allocator,
@@ -18,10 +32,17 @@ pub const L2L3Translator = struct {
     gateway_ip: ?u32, // Gateway IP address
     gateway_mac: ?[6]u8, // Gateway MAC address (learned from ARP)
     last_gateway_learn: i64, // Timestamp of last gateway MAC learn
+    router_mac: ?[6]u8, // IPv6 default router (published by the control plane)
+    control_generation: u64, // Last control-plane snapshot adopted
 
     // ARP handling
     arp_handler: ArpHandler,
 
+    // Inbound destination MAC filter (first step of L2→L3)
+    mac_filter: MacFilter,
+    // Multicast groups joined by the host (snooped from outgoing IGMP/MLD)
+    multicast_groups: multicast.Membership,
+
     // DHCP client (active - initiates DHCP discovery)
     dhcp_client: ?*DhcpClient,
     dhcp_packet_queue: std.ArrayList([]const u8), // Queue of DHCP packets to send
@@ -32,13 +53,33 @@ pub const L2L3Translator = struct {
     // ARP reply queue (for replies that need to be sent back to VPN)
     arp_reply_queue: std.ArrayList([]const u8),
     pending_arp_ips: std.AutoHashMap(u32, void), // Track IPs with pending replies
+
+    // Locally generated replies to write back into the TUN (ICMP Too Big)
+    tun_reply_queue: std.ArrayList([]const u8),
+    scratch: ?*BatchArena, // Per-batch arena for TUN replies (null = general allocator)
+    icmp_limiter: icmp.RateLimiter,
+    icmp_too_big_sent: u64,
+    icmp_too_big_suppressed: u64,
+
+    // Path MTU prober (active during startup) and the frames it sends to the VPN
+    pmtu_prober: ?pmtu.Prober,
+    vpn_frame_queue: std.ArrayList([]const u8),
+
+    // In-path DNS cache (optional)
+    dns_proxy: ?DnsProxy,
+
     packets_translated_l2_to_l3: u64,
     packets_translated_l3_to_l2: u64,
     arp_requests_handled: u64,
     arp_replies_learned: u64,
+    invalid_dropped: u64, // Inbound IP packets rejected by validate_ip
 
     const Self = @This();
 
+    /// Queue limits for locally generated replies
+    const max_arp_replies = 10;
+    const max_tun_replies = 16;
+
     pub fn init(allocator: std.mem.Allocator, options: taptun.TranslatorOptions) !Self {
         return .{
             .allocator = allocator,
@@ -47,7 +88,16 @@ pub const L2L3Translator = struct {
             .gateway_ip = null,
             .gateway_mac = null,
             .last_gateway_learn = 0,
+            .router_mac = null,
+            .control_generation = 0,
             .arp_handler = try ArpHandler.init(allocator, options.our_mac),
+            .mac_filter = blk: {
+                var filter = MacFilter.init(options.our_mac);
+                // Without snooping we cannot know the joined groups
+                filter.accept_all_multicast = !options.snoop_multicast;
+                break :blk filter;
+            },
+            .multicast_groups = .{},
             .dhcp_client = null,
             .dhcp_packet_queue = std.ArrayList([]const u8){},
             .dhcp_started = false,
@@ -55,10 +105,19 @@ pub const L2L3Translator = struct {
             .offered_server_id = null,
             .arp_reply_queue = std.ArrayList([]const u8){},
             .pending_arp_ips = std.AutoHashMap(u32, void).init(allocator),
+            .tun_reply_queue = std.ArrayList([]const u8){},
+            .scratch = null,
+            .icmp_limiter = icmp.RateLimiter.init(options.icmp_rate_per_sec, options.icmp_burst),
+            .icmp_too_big_sent = 0,
+            .icmp_too_big_suppressed = 0,
+            .pmtu_prober = null,
+            .vpn_frame_queue = std.ArrayList([]const u8){},
+            .dns_proxy = if (options.dns_cache) |dns_options| DnsProxy.init(allocator, dns_options) else null,
             .packets_translated_l2_to_l3 = 0,
             .packets_translated_l3_to_l2 = 0,
             .arp_requests_handled = 0,
             .arp_replies_learned = 0,
+            .invalid_dropped = 0,
         };
     }
 
@@ -80,10 +139,57 @@ pub const L2L3Translator = struct {
             self.allocator.free(reply);
         }
         self.arp_reply_queue.deinit(self.allocator);
+        for (self.tun_reply_queue.items) |reply| {
+            self.releaseTunReply(reply);
+        }
+        self.tun_reply_queue.deinit(self.allocator);
+        for (self.vpn_frame_queue.items) |frame| {
+            self.allocator.free(frame);
+        }
+        self.vpn_frame_queue.deinit(self.allocator);
+        if (self.dns_proxy) |*proxy| proxy.deinit();
         self.pending_arp_ips.deinit();
         self.arp_handler.deinit();
     }
 
+    /// Reserve reply queues and tables up to their limits so steady-state
+    /// translation does not allocate (low-latency mode, see `realtime`)
+    /// Replies themselves still come from the allocator or the scratch arena.
+    pub fn preallocate(self: *Self) !void {
+        try self.arp_reply_queue.ensureTotalCapacity(self.allocator, max_arp_replies);
+        try self.pending_arp_ips.ensureTotalCapacity(max_arp_replies);
+        try self.tun_reply_queue.ensureTotalCapacity(self.allocator, max_tun_replies);
+        if (self.dns_proxy) |*proxy| try proxy.preallocate();
+    }
+
+    /// Apply new options to a running translator
+    /// Learned state (IP, gateway, ARP and multicast membership) is kept; only the
+    /// components whose settings changed are rebuilt. Changing the DNS cache options
+    /// starts an empty cache.
+    pub fn reconfigure(self: *Self, options: taptun.TranslatorOptions) void {
+        if (!std.mem.eql(u8, &options.our_mac, &self.options.our_mac)) {
+            self.arp_handler.our_mac = options.our_mac;
+            self.mac_filter.our_key = MacFilter.init(options.our_mac).our_key;
+        }
+        // Left alone otherwise: a full filter falls back to accepting all multicast
+        if (options.snoop_multicast != self.options.snoop_multicast) {
+            self.mac_filter.accept_all_multicast = !options.snoop_multicast;
+        }
+
+        if (options.icmp_rate_per_sec != self.options.icmp_rate_per_sec or options.icmp_burst != self.options.icmp_burst) {
+            self.icmp_limiter = icmp.RateLimiter.init(options.icmp_rate_per_sec, options.icmp_burst);
+        }
+
+        if (!std.meta.eql(options.dns_cache, self.options.dns_cache)) {
+            if (self.dns_proxy) |*proxy| proxy.deinit();
+            self.dns_proxy = if (options.dns_cache) |dns_options| DnsProxy.init(self.allocator, dns_options) else null;
+        }
+
+        if (options.control_plane != self.options.control_plane) self.control_generation = 0;
+
+        self.options = options;
+    }
+
     /// Convert IP packet (L3) to Ethernet frame (L2)
     /// Used when sending packets from TUN device to network/VPN that expects Ethernet frames
     ///
@@ -99,41 +205,26 @@ pub const L2L3Translator = struct {
     /// ```
     ///
     /// Returns: Allocated Ethernet frame (14-byte header + IP packet)
-    /// Errors: InvalidPacket if the IP packet is malformed
+    /// Errors: InvalidPacket if the IP packet is malformed,
+    ///         PacketTooBig if it exceeds `tunnel_mtu` (see `popTunReply`),
+    ///         HandledLocally if a DNS query was answered from cache or coalesced
     pub fn ipToEthernet(self: *Self, ip_packet: []const u8) ![]const u8 {
         if (ip_packet.len == 0) return error.InvalidPacket;
+        self.syncControlPlane();
+        try self.checkTunnelMtu(ip_packet, ip_packet.len);
+        const prefetch_id = try self.interceptDns(ip_packet);
 
-        // Determine EtherType and destination MAC
-        var ethertype: u16 = undefined;
-        var dest_mac: [6]u8 = undefined;
-
-        if (ip_packet.len > 0 and (ip_packet[0] & 0xF0) == 0x40) {
-            // IPv4 packet
-            ethertype = 0x0800;
-
-            // Use learned gateway MAC if available, otherwise broadcast
-            if (self.gateway_mac) |gw_mac| {
-                dest_mac = gw_mac;
-            } else {
-                @memset(&dest_mac, 0xFF); // Broadcast
-            }
-        } else if (ip_packet.len > 0 and (ip_packet[0] & 0xF0) == 0x60) {
-            // IPv6 packet
-            ethertype = 0x86DD;
-            @memset(&dest_mac, 0xFF); // Broadcast for IPv6
-        } else {
-            return error.InvalidPacket;
-        }
+        const l2 = try self.resolveL2(ip_packet);
+        self.snoopOutbound(ip_packet);
 
         // Build Ethernet frame: [6 dest MAC][6 src MAC][2 EtherType][payload]
-        const frame_size = 14 + ip_packet.len;
+        const frame_size = headers.Ethernet.size + ip_packet.len;
         const frame = try self.allocator.alloc(u8, frame_size);
         errdefer self.allocator.free(frame);
 
-        @memcpy(frame[0..6], &dest_mac); // Destination MAC
-        @memcpy(frame[6..12], &self.options.our_mac); // Source MAC
-        std.mem.writeInt(u16, frame[12..14], ethertype, .big); // EtherType
-        @memcpy(frame[14..], ip_packet); // IP packet
+        self.writeEthernetHeader(frame[0..headers.Ethernet.size], l2);
+        @memcpy(frame[headers.Ethernet.size..], ip_packet); // IP packet
+        if (prefetch_id) |id| rewriteQueryId(frame[headers.Ethernet.size..], id);
 
         self.packets_translated_l3_to_l2 += 1;
 
@@ -143,6 +234,123 @@ pub const L2L3Translator = struct {
         return frame;
     }
 
+    /// Convert IP packet (L3) to Ethernet frame (L2) in place
+    /// The Ethernet header is prepended into the packet's headroom; no allocation or copy.
+    /// Parses the packet first if no earlier stage has done so.
+    ///
+    /// Errors: InvalidPacket if not IPv4/IPv6, NoHeadroom if fewer than 14 bytes of headroom,
+    ///         PacketTooBig if it exceeds `tunnel_mtu` (see `popTunReply`),
+    ///         HandledLocally if a DNS query was answered from cache or coalesced
+    pub fn ipToEthernetPacket(self: *Self, pkt: *Packet) !void {
+        if (!pkt.flags.parsed) try pkt.parse(.ip);
+        self.syncControlPlane();
+
+        const ip_packet = pkt.l3() orelse return error.InvalidPacket;
+        try self.checkTunnelMtu(ip_packet, pkt.totalLen());
+        if (try self.interceptDns(ip_packet)) |id| rewriteQueryId(ip_packet, id);
+        const l2 = try self.resolveL2(ip_packet);
+        self.snoopOutbound(ip_packet);
+
+        const hdr = try pkt.push(headers.Ethernet.size);
+        self.writeEthernetHeader(hdr[0..headers.Ethernet.size], l2);
+        pkt.l2_offset = @intCast(pkt.head);
+
+        self.packets_translated_l3_to_l2 += 1;
+    }
+
+    const L2Info = struct {
+        dest_mac: [6]u8,
+        ethertype: u16,
+    };
+
+    /// Determine EtherType and destination MAC for an outgoing IP packet
+    fn resolveL2(self: *const Self, ip_packet: []const u8) !L2Info {
+        return switch (headers.ipVersion(ip_packet)) {
+            4 => blk: {
+                // Multicast goes to the group MAC so peers' filters accept it
+                if (headers.Ipv4.view(ip_packet)) |ip| {
+                    const dst = ip.get(.dst_ip);
+                    if (multicast.isIpv4Multicast(dst)) break :blk .{
+                        .dest_mac = multicast.groupMac(multicast.groupFromIpv4(dst)),
+                        .ethertype = EtherType.ipv4,
+                    };
+                } else |_| {}
+
+                // Otherwise use learned gateway MAC if available, or broadcast
+                break :blk .{
+                    .dest_mac = self.gateway_mac orelse [_]u8{0xFF} ** 6,
+                    .ethertype = EtherType.ipv4,
+                };
+            },
+            6 => blk: {
+                if (headers.Ipv6.view(ip_packet)) |ip| {
+                    const dst = ip.get(.dst_ip);
+                    if (multicast.isIpv6Multicast(&dst)) break :blk .{
+                        .dest_mac = multicast.groupMac(dst),
+                        .ethertype = EtherType.ipv6,
+                    };
+                } else |_| {}
+
+                // IPv6 unicast: default router if the control plane knows it, else broadcast
+                break :blk .{
+                    .dest_mac = self.router_mac orelse [_]u8{0xFF} ** 6,
+                    .ethertype = EtherType.ipv6,
+                };
+            },
+            else => error.InvalidPacket,
+        };
+    }
+
+    /// Refuse packets the tunnel cannot carry, queueing a rate-limited
+    /// Fragmentation Needed / Packet Too Big for the host.
+    /// IPv4 packets without DF pass; they can still be fragmented downstream.
+    fn checkTunnelMtu(self: *Self, ip_packet: []const u8, packet_len: usize) !void {
+        const mtu = self.options.tunnel_mtu orelse return;
+        if (packet_len <= mtu) return;
+        if (!icmp.needsTooBig(ip_packet, packet_len, mtu)) return;
+
+        if (self.tun_reply_queue.items.len >= max_tun_replies or
+            !self.icmp_limiter.allow(std.time.milliTimestamp()))
+        {
+            self.icmp_too_big_suppressed += 1;
+            return error.PacketTooBig;
+        }
+
+        var buf: [icmp.max_reply_size]u8 = undefined;
+        const reply = try icmp.buildTooBig(&buf, ip_packet, mtu, self.gateway_ip);
+        const copy = try self.replyAllocator().dupe(u8, reply);
+        // Arena copies go with the batch; a heap copy is ours until queued
+        errdefer if (self.scratch == null) self.allocator.free(copy);
+        try self.tun_reply_queue.append(self.allocator, copy);
+        self.icmp_too_big_sent += 1;
+        return error.PacketTooBig;
+    }
+
+    /// Answer or coalesce outgoing DNS queries through the DNS cache
+    /// Returns a DNS ID to forward the query under (background refresh), or
+    /// null to forward it unchanged.
+    fn interceptDns(self: *Self, ip_packet: []const u8) !?u16 {
+        const proxy = if (self.dns_proxy) |*p| p else return null;
+        return switch (try proxy.onQuery(ip_packet, std.time.milliTimestamp(), &self.tun_reply_queue, self.replyAllocator())) {
+            .forward => null,
+            .prefetch => |id| id,
+            .consumed => error.HandledLocally,
+        };
+    }
+
+    /// Learn multicast joins/leaves from the host's own IGMP/MLD reports
+    inline fn snoopOutbound(self: *Self, ip_packet: []const u8) void {
+        if (!self.options.snoop_multicast) return;
+        multicast.snoop(ip_packet, &self.multicast_groups, &self.mac_filter);
+    }
+
+    fn writeEthernetHeader(self: *const Self, hdr: *[headers.Ethernet.size]u8, l2: L2Info) void {
+        const eth = headers.Ethernet.MutView{ .bytes = hdr };
+        eth.set(.dst_mac, l2.dest_mac);
+        eth.set(.src_mac, self.options.our_mac);
+        eth.set(.ethertype, l2.ethertype);
+    }
+
     /// Convert Ethernet frame (L2) to IP packet (L3)
     /// Used when receiving Ethernet frames from network/VPN to write to TUN device
     ///
@@ -164,82 +372,257 @@ pub const L2L3Translator = struct {
     /// Returns: Optional allocated IP packet slice (null if handled internally)
     /// Errors: InvalidPacket if the Ethernet frame is malformed
     pub fn ethernetToIp(self: *Self, eth_frame: []const u8) !?[]const u8 {
-        if (eth_frame.len < 14) return error.InvalidPacket;
+        const eth = try headers.Ethernet.view(eth_frame);
+        if (!self.acceptDestination(eth.raw(.dst_mac))) return null;
+        const ethertype = eth.get(.ethertype);
+
+        // Drop malformed IP and cut the Ethernet padding before anything reads it
+        var frame = eth_frame;
+        if (self.options.validate_ip) {
+            const l3 = eth_frame[headers.Ethernet.size..];
+            const ip_len = self.validInboundLength(ethertype, l3, l3.len) orelse return null;
+            frame = eth_frame[0 .. headers.Ethernet.size + ip_len];
+        }
 
-        const ethertype = std.mem.readInt(u16, eth_frame[12..14], .big);
+        var src_ip: ?u32 = null;
+        if (ethertype == EtherType.ipv4) {
+            if (headers.Ipv4.view(frame[headers.Ethernet.size..])) |ip| {
+                src_ip = ip.get(.src_ip);
+            } else |_| {}
+        }
 
-        // Handle ARP packets
-        if (ethertype == 0x0806 and self.options.handle_arp) {
-            return try self.handleArpFrame(eth_frame);
+        const ip_packet = (try self.processInbound(frame, ethertype, src_ip)) orelse return null;
+
+        // Allocate copy of IP packet
+        const result = try self.allocator.alloc(u8, ip_packet.len);
+        @memcpy(result, ip_packet);
+
+        self.packets_translated_l2_to_l3 += 1;
+
+        return result;
+    }
+
+    /// Convert Ethernet frame (L2) to IP packet (L3) in place
+    /// Strips the Ethernet header from the packet without copying. Uses the
+    /// packet's cached parse results (parsing once if needed).
+    ///
+    /// Returns: true if the packet now holds an IP packet to deliver,
+    ///          false if the frame was handled internally (e.g., ARP) or ignored
+    pub fn ethernetToIpPacket(self: *Self, pkt: *Packet) !bool {
+        if (pkt.len < headers.Ethernet.size) return error.InvalidPacket;
+        if (!self.acceptDestination(pkt.data()[0..6])) return false;
+        return self.inboundPacket(pkt);
+    }
+
+    /// Convert a burst of up to `simd.max_burst` Ethernet frames to IP packets in place
+    /// The destination filter screens the whole burst in one vector pass and only
+    /// accepted frames are parsed. Malformed frames are counted as invalid and
+    /// dropped rather than failing the burst.
+    ///
+    /// Returns: bit i set if `pkts[i]` now holds an IP packet to deliver
+    pub fn ethernetToIpBurst(self: *Self, pkts: []Packet) !u64 {
+        std.debug.assert(pkts.len <= simd.max_burst);
+        if (pkts.len == 0) return 0;
+        var frames: [simd.max_burst][]const u8 = undefined;
+        var runts: u64 = 0;
+        for (pkts, frames[0..pkts.len], 0..) |*pkt, *frame, i| {
+            frame.* = pkt.data();
+            if (pkt.len < headers.Ethernet.size) runts |= @as(u64, 1) << @intCast(i);
+        }
+        self.invalid_dropped += @popCount(runts);
+
+        const accepted: u64 = if (self.options.filter_dst_mac)
+            self.mac_filter.acceptBurst(frames[0..pkts.len])
+        else
+            std.math.maxInt(u64) >> @intCast(simd.max_burst - pkts.len);
+
+        var pending = accepted & ~runts;
+        var delivered: u64 = 0;
+        while (pending != 0) : (pending &= pending - 1) {
+            const i = @ctz(pending);
+            const pkt = &pkts[i];
+            const ok = self.inboundPacket(pkt) catch |err| switch (err) {
+                error.OutOfMemory => return err,
+                else => blk: {
+                    self.invalid_dropped += 1;
+                    break :blk false;
+                },
+            };
+            if (ok) delivered |= @as(u64, 1) << @intCast(i);
         }
+        return delivered;
+    }
 
-        // Extract IP packet (strip 14-byte Ethernet header)
-        var ip_packet: []const u8 = undefined;
-
-        if (ethertype == 0x0800 or ethertype == 0x86DD) {
-            // IPv4 or IPv6 - strip Ethernet header
-            ip_packet = eth_frame[14..];
-
-            // 🔥 FIX: Learn gateway MAC from ANY packet from gateway IP (not just ARP replies!)
-            // Many VPN servers don't respond to ARP requests, but we can learn MAC from DHCP/ICMP/etc.
-            if (ethertype == 0x0800 and ip_packet.len >= 20 and self.options.learn_gateway_mac) {
-                const src_ip = std.mem.readInt(u32, ip_packet[12..16], .big);
-
-                // If this packet is from our gateway, learn its MAC address
-                if (self.gateway_ip) |gw_ip| {
-                    if (src_ip == gw_ip) {
-                        var new_mac: [6]u8 = undefined;
-                        @memcpy(&new_mac, eth_frame[6..12]); // Source MAC from Ethernet header
-
-                        const changed = if (self.gateway_mac) |old_mac|
-                            !std.mem.eql(u8, &old_mac, &new_mac)
-                        else
-                            true;
-
-                        if (changed) {
-                            self.gateway_mac = new_mac;
-                            self.last_gateway_learn = std.time.milliTimestamp();
-                            std.debug.print("[🎯 GATEWAY MAC LEARNED] {X:0>2}:{X:0>2}:{X:0>2}:{X:0>2}:{X:0>2}:{X:0>2} from IP packet (src=", .{
-                                new_mac[0], new_mac[1], new_mac[2], new_mac[3], new_mac[4], new_mac[5],
-                            });
-                            std.debug.print("{}.{}.{}.{})\n", .{
-                                (src_ip >> 24) & 0xFF, (src_ip >> 16) & 0xFF,
-                                (src_ip >> 8) & 0xFF,  src_ip & 0xFF,
-                            });
-                        }
-                    }
+    /// Inbound packet path after the destination check
+    fn inboundPacket(self: *Self, pkt: *Packet) !bool {
+        if (!pkt.flags.parsed) try pkt.parse(.ethernet);
+
+        if (self.options.validate_ip) {
+            const l3_len = pkt.totalLen() - headers.Ethernet.size;
+            const ip_len = self.validInboundLength(pkt.ethertype, pkt.data()[headers.Ethernet.size..], l3_len) orelse return false;
+            if (ip_len != l3_len) {
+                // Padding only follows short frames; the translator cannot release
+                // trailing segments, so a chain that disagrees with its header is dropped
+                if (pkt.isChained()) {
+                    self.invalid_dropped += 1;
+                    return false;
                 }
+                pkt.trim(headers.Ethernet.size + ip_len);
             }
-        } else {
+        }
+
+        _ = (try self.processInbound(pkt.data(), pkt.ethertype, pkt.ipv4Src())) orelse return false;
+        _ = try pkt.pull(headers.Ethernet.size);
+
+        self.packets_translated_l2_to_l3 += 1;
+        return true;
+    }
+
+    /// IP length of a validated inbound packet, or null (counted) to drop it
+    /// Non-IP frames pass through with their full length.
+    fn validInboundLength(self: *Self, ethertype: u16, l3: []const u8, available: usize) ?usize {
+        const result = switch (ethertype) {
+            EtherType.ipv4 => validate.ipv4Length(l3, available),
+            EtherType.ipv6 => validate.ipv6Length(l3, available),
+            else => return available,
+        };
+        return result catch {
+            self.invalid_dropped += 1;
+            return null;
+        };
+    }
+
+    fn fromGateway(self: *const Self, src_ip: ?u32) bool {
+        const ip = src_ip orelse return false;
+        const gateway_ip = self.gateway_ip orelse return false;
+        return ip == gateway_ip;
+    }
+
+    /// Destination MAC check, run before any parse or copy
+    inline fn acceptDestination(self: *Self, dst_mac: *const [6]u8) bool {
+        if (!self.options.filter_dst_mac) return true;
+        return self.mac_filter.accept(dst_mac);
+    }
+
+    /// Inbound handling shared by the slice and packet paths
+    /// Returns the IP payload of the frame, or null if it was consumed or ignored.
+    fn processInbound(self: *Self, eth_frame: []const u8, ethertype: u16, src_ip: ?u32) !?[]const u8 {
+        // ARP and DHCP go to the control thread, RAs are copied to it; its results come back via syncControlPlane
+        if (self.options.control_plane) |cp| {
+            self.syncControlPlane();
+            switch (control_plane.classify(eth_frame)) {
+                .control => {
+                    _ = cp.submit(eth_frame);
+                    return null;
+                },
+                .observe => _ = cp.submit(eth_frame),
+                .data => {},
+            }
+        }
+
+        // Handle ARP packets
+        if (ethertype == EtherType.arp and self.options.handle_arp) {
+            return try self.handleArpFrame(eth_frame);
+        }
+
+        if (ethertype != EtherType.ipv4 and ethertype != EtherType.ipv6) {
             // Unknown EtherType - ignore
             return null;
         }
 
-        // Allocate copy of IP packet
-        const result = try self.allocator.alloc(u8, ip_packet.len);
-        @memcpy(result, ip_packet);
+        // 🔥 FIX: Learn gateway MAC from ANY packet from gateway IP (not just ARP replies!)
+        // Many VPN servers don't respond to ARP requests, but we can learn MAC from DHCP/ICMP/etc.
+        if (src_ip) |ip| {
+            if (self.options.learn_gateway_mac) {
+                const eth = try headers.Ethernet.view(eth_frame);
+                self.learnGatewayMac(ip, eth.get(.src_mac));
+            }
+        }
 
-        self.packets_translated_l2_to_l3 += 1;
+        // The gateway's echo replies to our path MTU probes are consumed while the search runs
+        if (self.pmtu_prober) |*prober| {
+            if (ethertype == EtherType.ipv4 and !prober.isDone() and self.fromGateway(src_ip)) {
+                if (pmtu.matchReply(eth_frame[headers.Ethernet.size..])) |seq| {
+                    prober.onAck(seq);
+                    return null;
+                }
+            }
+        }
 
-        return result;
+        // Snoop DNS answers for domain routes; a failed insert must not drop the answer
+        if (self.options.split_tunnel) |split| {
+            if (ethertype == EtherType.ipv4) {
+                split.onDnsResponse(eth_frame[headers.Ethernet.size..], std.time.milliTimestamp()) catch |err| switch (err) {
+                    error.OutOfMemory => split.route_alloc_failures += 1,
+                };
+            }
+        }
+
+        // Cache DNS responses; background refreshes are not delivered
+        if (self.dns_proxy) |*proxy| {
+            if (ethertype == EtherType.ipv4 and
+                !try proxy.onResponse(eth_frame[headers.Ethernet.size..], std.time.milliTimestamp(), &self.tun_reply_queue, self.replyAllocator()))
+            {
+                return null;
+            }
+        }
+
+        // IPv4 or IPv6 - strip Ethernet header
+        return eth_frame[headers.Ethernet.size..];
+    }
+
+    /// Adopt addresses published by the control thread
+    /// One atomic load while nothing changed; unknown values keep what was learned here.
+    inline fn syncControlPlane(self: *Self) void {
+        const cp = self.options.control_plane orelse return;
+        if (cp.currentGeneration() == self.control_generation) return;
+
+        const snapshot = cp.snapshot();
+        self.control_generation = snapshot.generation;
+        if (snapshot.our_ip) |ip| self.our_ip = ip;
+        if (snapshot.gateway_ip) |ip| self.gateway_ip = ip;
+        if (snapshot.gateway_mac) |mac| self.gateway_mac = mac;
+        self.router_mac = snapshot.router_mac;
+    }
+
+    /// Learn gateway MAC from an IP packet's source
+    fn learnGatewayMac(self: *Self, src_ip: u32, new_mac: [6]u8) void {
+        // If this packet is from our gateway, learn its MAC address
+        const gw_ip = self.gateway_ip orelse return;
+        if (src_ip != gw_ip) return;
+
+        const changed = if (self.gateway_mac) |old_mac|
+            !std.mem.eql(u8, &old_mac, &new_mac)
+        else
+            true;
+
+        if (changed) {
+            self.gateway_mac = new_mac;
+            self.last_gateway_learn = std.time.milliTimestamp();
+            if (!self.options.verbose) return;
+            std.debug.print("[🎯 GATEWAY MAC LEARNED] {X:0>2}:{X:0>2}:{X:0>2}:{X:0>2}:{X:0>2}:{X:0>2} from IP packet (src=", .{
+                new_mac[0], new_mac[1], new_mac[2], new_mac[3], new_mac[4], new_mac[5],
+            });
+            std.debug.print("{}.{}.{}.{})\n", .{
+                (src_ip >> 24) & 0xFF, (src_ip >> 16) & 0xFF,
+                (src_ip >> 8) & 0xFF,  src_ip & 0xFF,
+            });
+        }
     }
 
     /// Handle incoming ARP frame
     fn handleArpFrame(self: *Self, eth_frame: []const u8) !?[]const u8 {
-        if (eth_frame.len < 42) return error.InvalidPacket; // Min ARP packet size
-
-        const arp_data = eth_frame[14..]; // Skip Ethernet header
-        const opcode = std.mem.readInt(u16, arp_data[6..8], .big);
+        const arp = try headers.Arp.view(eth_frame[headers.Ethernet.size..]); // Min ARP packet size
+        const opcode = arp.get(.opcode);
 
         // Learn gateway MAC from ARP replies (opcode=2)
         if (opcode == 2 and self.options.learn_gateway_mac) {
-            const sender_ip = std.mem.readInt(u32, arp_data[14..18], .big);
+            const sender_ip = arp.get(.sender_ip);
 
             // Check if this is from our gateway (typically x.x.x.1)
             if (self.gateway_ip) |gw_ip| {
                 if (sender_ip == gw_ip) {
-                    var new_mac: [6]u8 = undefined;
-                    @memcpy(&new_mac, arp_data[8..14]);
+                    const new_mac = arp.get(.sender_mac);
 
                     const changed = if (self.gateway_mac) |old_mac|
                         !std.mem.eql(u8, &old_mac, &new_mac)
@@ -257,33 +640,29 @@ pub const L2L3Translator = struct {
 
         // Handle ARP requests targeting our IP (opcode=1)
         if (opcode == 1 and self.our_ip != null) {
-            const target_ip = std.mem.readInt(u32, arp_data[24..28], .big);
+            const target_ip = arp.get(.target_ip);
 
             if (target_ip == self.our_ip.?) {
-                const sender_mac = arp_data[8..14];
-                const sender_ip_bytes = arp_data[14..18];
+                const requester_ip = arp.get(.sender_ip);
+                self.arp_requests_handled += 1;
+
+                // Already pending or queue full - drop the duplicate before building a reply
+                if (self.pending_arp_ips.contains(requester_ip) or self.arp_reply_queue.items.len >= max_arp_replies) {
+                    return null;
+                }
 
                 const reply = try self.arp_handler.buildArpReply(
                     self.our_ip.?,
-                    sender_mac[0..6].*,
-                    std.mem.readInt(u32, sender_ip_bytes, .big),
+                    arp.get(.sender_mac),
+                    requester_ip,
                 );
 
-                self.arp_requests_handled += 1;
-
-                // Check if we already have a pending reply for this IP
-                const already_pending = self.pending_arp_ips.contains(target_ip);
-
-                // Limit queue size to prevent memory overflow
-                const max_queue_size = 10;
-                if (!already_pending and self.arp_reply_queue.items.len < max_queue_size) {
-                    // Queue the ARP reply and mark IP as pending
-                    try self.arp_reply_queue.append(self.allocator, reply);
-                    try self.pending_arp_ips.put(target_ip, {});
-                } else {
-                    // Already pending or queue full - free the duplicate reply
+                // Queue the ARP reply and mark requester as pending
+                self.arp_reply_queue.append(self.allocator, reply) catch |err| {
                     self.allocator.free(reply);
-                }
+                    return err;
+                };
+                try self.pending_arp_ips.put(requester_ip, {});
                 return null;
             }
         }
@@ -326,33 +705,114 @@ pub const L2L3Translator = struct {
         }
         const reply = self.arp_reply_queue.orderedRemove(0);
 
-        // Extract target IP from ARP reply to remove from pending set
-        // ARP reply format: dest_mac(6) + src_mac(6) + type(2) + arp_data(28+)
-        // Target IP is at offset 24 (in ARP data section)
-        if (reply.len >= 38) {
-            const target_ip_bytes = reply[24..28];
-            const target_ip = std.mem.readInt(u32, target_ip_bytes[0..4], .big);
-            _ = self.pending_arp_ips.remove(target_ip);
-        }
+        // The reply's target is the requester we marked as pending
+        if (headers.Arp.view(reply[headers.Ethernet.size..])) |arp| {
+            _ = self.pending_arp_ips.remove(arp.get(.target_ip));
+        } else |_| {}
 
         return reply;
     }
 
+    /// Check if there are locally generated IP packets to write back into the TUN
+    pub fn hasPendingTunReply(self: *const Self) bool {
+        return self.tun_reply_queue.items.len > 0;
+    }
+
+    /// Get the next IP packet for the TUN (caller hands it back with `releaseTunReply`)
+    pub fn popTunReply(self: *Self) ?[]const u8 {
+        if (self.tun_reply_queue.items.len == 0) {
+            return null;
+        }
+        return self.tun_reply_queue.orderedRemove(0);
+    }
+
+    /// Free a reply from `popTunReply`; replies in the scratch arena go at its next reset
+    pub fn releaseTunReply(self: *Self, reply: []const u8) void {
+        if (self.scratch == null) self.allocator.free(reply);
+    }
+
+    /// Allocate TUN replies (ICMP Too Big, cached DNS answers) from a per-batch arena
+    /// The owner must drain `popTunReply` before each `reset`. Set this before
+    /// traffic flows so queued replies never mix allocators.
+    pub fn setScratch(self: *Self, arena: ?*BatchArena) void {
+        self.scratch = arena;
+    }
+
+    inline fn replyAllocator(self: *Self) std.mem.Allocator {
+        return if (self.scratch) |arena| arena.allocator() else self.allocator;
+    }
+
     /// Get translation statistics
     pub fn getStats(self: *const Self) struct {
         l2_to_l3: u64,
         l3_to_l2: u64,
         arp_handled: u64,
         arp_learned: u64,
+        mac_filtered: u64,
+        icmp_too_big: u64,
+        dns_hits: u64,
+        invalid: u64,
+        /// Kernel instruction set picked for this CPU
+        simd: simd.Variant,
     } {
         return .{
             .l2_to_l3 = self.packets_translated_l2_to_l3,
             .l3_to_l2 = self.packets_translated_l3_to_l2,
             .arp_handled = self.arp_requests_handled,
             .arp_learned = self.arp_replies_learned,
+            .mac_filtered = self.mac_filter.dropped(),
+            .icmp_too_big = self.icmp_too_big_sent,
+            .dns_hits = if (self.dns_proxy) |proxy| proxy.hits else 0,
+            .invalid = self.invalid_dropped,
+            .simd = simd.active(),
         };
     }
 
+    // ═══════════════════════════════════════════════════════════════════════════
+    // Path MTU Probing
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    /// Start probing the tunnel path MTU towards the gateway
+    /// Requires our IP and the gateway IP (learned or set). Drive the search with
+    /// `pollPmtuProbe` and send the frames from `popVpnFrame` to the VPN session;
+    /// the gateway's echo replies are consumed by `ethernetToIp`.
+    pub fn startPmtuProbe(self: *Self, options: pmtu.Prober.Options) !void {
+        if (self.our_ip == null or self.gateway_ip == null) return error.NoGateway;
+        self.pmtu_prober = try pmtu.Prober.init(options);
+    }
+
+    /// Advance the probe search at `now_ms`, queueing the next probe frame if one is due
+    pub fn pollPmtuProbe(self: *Self, now_ms: i64) !void {
+        const prober = if (self.pmtu_prober) |*p| p else return;
+        const probe = prober.poll(now_ms) orelse return;
+
+        const frame = try self.allocator.alloc(u8, headers.Ethernet.size + probe.size);
+        errdefer self.allocator.free(frame);
+        const ip_packet = try pmtu.buildProbe(frame[headers.Ethernet.size..], probe, self.our_ip.?, self.gateway_ip.?);
+        self.writeEthernetHeader(frame[0..headers.Ethernet.size], try self.resolveL2(ip_packet));
+
+        try self.vpn_frame_queue.append(self.allocator, frame);
+    }
+
+    /// Largest MTU confirmed by the prober, once the search has finished
+    pub fn pmtuResult(self: *const Self) ?u32 {
+        const prober = self.pmtu_prober orelse return null;
+        return prober.result();
+    }
+
+    /// Check if there are locally generated Ethernet frames to send to the VPN
+    pub fn hasPendingVpnFrame(self: *const Self) bool {
+        return self.vpn_frame_queue.items.len > 0;
+    }
+
+    /// Get the next Ethernet frame for the VPN (caller takes ownership and must free)
+    pub fn popVpnFrame(self: *Self) ?[]const u8 {
+        if (self.vpn_frame_queue.items.len == 0) {
+            return null;
+        }
+        return self.vpn_frame_queue.orderedRemove(0);
+    }
+
     // ═══════════════════════════════════════════════════════════════════════════
     // DHCP Client Integration (WAVE 5 PHASE 1)
     // ═══════════════════════════════════════════════════════════════════════════
@@ -376,7 +836,35 @@ pub const L2L3Translator = struct {
         const dhcp_frame = try self.wrapDhcpInEthernet(&discover_packet);
         try self.dhcp_packet_queue.append(self.allocator, dhcp_frame);
 
-        std.debug.print("[DHCP] 📡 DISCOVER packet generated (xid=0x{X:0>8})\n", .{discover_packet.xid});
+        if (self.options.verbose) std.debug.print("[DHCP] 📡 DISCOVER packet generated (xid=0x{X:0>8})\n", .{discover_packet.xid});
+    }
+
+    /// Queue the current DHCP message again after a retransmission timeout
+    /// Rebuilt from the client state: DISCOVER while selecting, REQUEST while
+    /// requesting or renewing. No-op when bound or not started.
+    pub fn retransmitDhcp(self: *Self) !void {
+        const client = self.dhcp_client orelse return;
+        const packet = switch (client.state) {
+            .SELECTING => try client.createDiscover(),
+            .REQUESTING => try client.createRequest(self.offered_ip orelse return, self.offered_server_id orelse return),
+            .RENEWING => try client.createRenewal(),
+            else => return,
+        };
+        const frame = if (client.state == .RENEWING)
+            try self.wrapDhcpInEthernetTo(&packet, self.renewalDestination(client))
+        else
+            try self.wrapDhcpInEthernet(&packet);
+        errdefer self.allocator.free(frame);
+        try self.dhcp_packet_queue.append(self.allocator, frame);
+    }
+
+    /// Start renewing the bound lease (at T1); the ACK is handled by `processDhcpPacket`
+    pub fn renewDhcp(self: *Self) !void {
+        const client = self.dhcp_client orelse return error.DhcpNotStarted;
+        const packet = try client.createRenewal();
+        const frame = try self.wrapDhcpInEthernetTo(&packet, self.renewalDestination(client));
+        errdefer self.allocator.free(frame);
+        try self.dhcp_packet_queue.append(self.allocator, frame);
     }
 
     /// Check if there are pending DHCP packets to send
@@ -396,22 +884,16 @@ pub const L2L3Translator = struct {
     pub fn processDhcpPacket(self: *Self, ethernet_frame: []const u8) !void {
         if (self.dhcp_client == null) return;
 
-        // Parse Ethernet frame to extract DHCP packet
-        // Ethernet(14) + IP(20) + UDP(8) + DHCP
-        if (ethernet_frame.len < 14 + 20 + 8 + @sizeOf(DhcpPacket)) {
+        // Parse Ethernet(14) + IP(20+options) + UDP(8) to reach the DHCP payload
+        const ip_data = ethernet_frame[@min(ethernet_frame.len, headers.Ethernet.size)..];
+        const ip = headers.Ipv4.view(ip_data) catch return error.PacketTooSmall;
+        const ip_header_len = headers.ipv4HeaderLen(ip);
+        if (ip_header_len < headers.Ipv4.size or ip_data.len < ip_header_len + headers.Udp.size) {
             return error.PacketTooSmall;
         }
 
-        // Skip Ethernet(14) + IP(20) + UDP(8) headers
-        const dhcp_offset = 14 + 20 + 8;
-        const dhcp_data = ethernet_frame[dhcp_offset..];
-
-        // Cast to DHCP packet (note: may need proper deserialization)
-        if (dhcp_data.len < @sizeOf(DhcpPacket)) {
-            return error.InvalidDhcpPacket;
-        }
-
-        const dhcp_packet = @as(*const DhcpPacket, @ptrCast(@alignCast(dhcp_data.ptr))).*;
+        const dhcp_data = ip_data[ip_header_len + headers.Udp.size ..];
+        const dhcp_packet = try DhcpPacket.parse(dhcp_data);
 
         // Check if this is for us
         const client = self.dhcp_client.?;
@@ -435,7 +917,7 @@ pub const L2L3Translator = struct {
                 const request_frame = try self.wrapDhcpInEthernet(&request_packet);
                 try self.dhcp_packet_queue.append(self.allocator, request_frame);
 
-                std.debug.print("[DHCP] 📬 OFFER received, sending REQUEST\n", .{});
+                if (self.options.verbose) std.debug.print("[DHCP] 📬 OFFER received, sending REQUEST\n", .{});
             },
             5 => { // ACK
                 try client.parseAck(&dhcp_packet);
@@ -444,12 +926,12 @@ pub const L2L3Translator = struct {
                 const ip_bytes = std.mem.toBytes(dhcp_packet.yiaddr);
                 self.our_ip = std.mem.readInt(u32, &ip_bytes, .big);
 
-                std.debug.print("[DHCP] ✅ ACK received! IP assigned: {}.{}.{}.{}\n", .{
+                if (self.options.verbose) std.debug.print("[DHCP] ✅ ACK received! IP assigned: {}.{}.{}.{}\n", .{
                     ip_bytes[0], ip_bytes[1], ip_bytes[2], ip_bytes[3],
                 });
             },
             6 => { // NAK
-                std.debug.print("[DHCP] ❌ NAK received, restarting...\n", .{});
+                if (self.options.verbose) std.debug.print("[DHCP] ❌ NAK received, restarting...\n", .{});
                 // Restart DHCP
                 self.dhcp_started = false;
                 if (self.dhcp_client) |c| {
@@ -467,50 +949,70 @@ pub const L2L3Translator = struct {
         }
     }
 
+    /// Addresses for a DHCP message sent to a known server instead of broadcast
+    const DhcpUnicast = struct {
+        src_ip: u32,
+        dst_ip: u32,
+        dst_mac: [6]u8,
+    };
+
+    /// A renewing REQUEST goes from the leased address to the leasing server
+    /// (RFC 2131 §4.4.5), through the gateway MAC when it is known
+    fn renewalDestination(self: *const Self, client: *const DhcpClient) DhcpUnicast {
+        const lease = client.lease.?;
+        return .{
+            .src_ip = std.mem.readInt(u32, &lease.ip_address, .big),
+            .dst_ip = std.mem.readInt(u32, &lease.server_id, .big),
+            .dst_mac = self.gateway_mac orelse [_]u8{0xFF} ** 6,
+        };
+    }
+
     // Helper: Wrap DHCP packet in UDP/IP/Ethernet frame
     fn wrapDhcpInEthernet(self: *Self, dhcp_packet: *const DhcpPacket) ![]const u8 {
-        const dhcp_size = @sizeOf(DhcpPacket);
-        const udp_size = 8 + dhcp_size;
-        const ip_size = 20 + udp_size;
-        const frame_size = 14 + ip_size;
+        return self.wrapDhcpInEthernetTo(dhcp_packet, null);
+    }
 
-        var frame = try self.allocator.alloc(u8, frame_size);
+    /// Broadcast when `unicast` is null
+    fn wrapDhcpInEthernetTo(self: *Self, dhcp_packet: *const DhcpPacket, unicast: ?DhcpUnicast) ![]const u8 {
+        const dhcp_size = DhcpPacket.wire_size;
+        const udp_size = headers.Udp.size + dhcp_size;
+        const ip_size = headers.Ipv4.size + udp_size;
+        const frame_size = headers.Ethernet.size + ip_size;
+
+        const frame = try self.allocator.alloc(u8, frame_size);
+        errdefer self.allocator.free(frame);
         @memset(frame, 0);
 
         // Ethernet header (14 bytes)
-        @memset(frame[0..6], 0xFF); // Broadcast dest MAC
-        @memcpy(frame[6..12], &self.options.our_mac); // Our source MAC
-        frame[12] = 0x08; // EtherType = IPv4
-        frame[13] = 0x00;
+        const eth = try headers.Ethernet.viewMut(frame);
+        eth.set(.dst_mac, if (unicast) |u| u.dst_mac else [_]u8{0xFF} ** 6);
+        eth.set(.src_mac, self.options.our_mac); // Our source MAC
+        eth.set(.ethertype, EtherType.ipv4);
 
         // IP header (20 bytes)
-        const ip_offset: usize = 14;
-        frame[ip_offset + 0] = 0x45; // Version 4, IHL 5
-        frame[ip_offset + 1] = 0x00; // DSCP/ECN
-        std.mem.writeInt(u16, frame[ip_offset + 2 .. ip_offset + 4], @intCast(ip_size), .big); // Total length
-        std.mem.writeInt(u16, frame[ip_offset + 4 .. ip_offset + 6], 0x1234, .big); // ID
-        std.mem.writeInt(u16, frame[ip_offset + 6 .. ip_offset + 8], 0x0000, .big); // Flags/offset
-        frame[ip_offset + 8] = 64; // TTL
-        frame[ip_offset + 9] = 17; // Protocol = UDP
-        // Checksum at offset 10-11 (will calculate later)
-        std.mem.writeInt(u32, frame[ip_offset + 12 .. ip_offset + 16], 0x00000000, .big); // Source IP = 0.0.0.0
-        std.mem.writeInt(u32, frame[ip_offset + 16 .. ip_offset + 20], 0xFFFFFFFF, .big); // Dest IP = broadcast
-
-        // Calculate IP checksum
-        const ip_checksum = self.calculateChecksum(frame[ip_offset .. ip_offset + 20]);
-        std.mem.writeInt(u16, frame[ip_offset + 10 .. ip_offset + 12], ip_checksum, .big);
+        const ip_offset: usize = headers.Ethernet.size;
+        const ip = try headers.Ipv4.viewMut(frame[ip_offset..]);
+        ip.set(.version_ihl, 0x45); // Version 4, IHL 5
+        ip.set(.tos, 0x00); // DSCP/ECN
+        ip.set(.total_length, @intCast(ip_size));
+        ip.set(.identification, 0x1234);
+        ip.set(.flags_fragment, 0x0000);
+        ip.set(.ttl, 64);
+        ip.set(.protocol, headers.IpProto.udp);
+        ip.set(.src_ip, if (unicast) |u| u.src_ip else 0x00000000);
+        ip.set(.dst_ip, if (unicast) |u| u.dst_ip else 0xFFFFFFFF);
+        ip.set(.checksum, checksum.internet(frame[ip_offset .. ip_offset + headers.Ipv4.size]));
 
         // UDP header (8 bytes)
-        const udp_offset: usize = ip_offset + 20;
-        std.mem.writeInt(u16, frame[udp_offset + 0 .. udp_offset + 2], 68, .big); // Source port (DHCP client)
-        std.mem.writeInt(u16, frame[udp_offset + 2 .. udp_offset + 4], 67, .big); // Dest port (DHCP server)
-        std.mem.writeInt(u16, frame[udp_offset + 4 .. udp_offset + 6], @intCast(udp_size), .big); // Length
-        std.mem.writeInt(u16, frame[udp_offset + 6 .. udp_offset + 8], 0x0000, .big); // Checksum (optional for UDP)
+        const udp_offset: usize = ip_offset + headers.Ipv4.size;
+        const udp = try headers.Udp.viewMut(frame[udp_offset..]);
+        udp.set(.src_port, 68); // DHCP client
+        udp.set(.dst_port, 67); // DHCP server
+        udp.set(.length, @intCast(udp_size));
+        udp.set(.checksum, 0x0000); // Optional for UDP over IPv4
 
         // DHCP packet
-        const dhcp_offset = udp_offset + 8;
-        const dhcp_bytes = std.mem.asBytes(dhcp_packet);
-        @memcpy(frame[dhcp_offset .. dhcp_offset + dhcp_size], dhcp_bytes);
+        try dhcp_packet.writeTo(frame[udp_offset + headers.Udp.size ..]);
 
         return frame;
     }
@@ -558,24 +1060,6 @@ pub const L2L3Translator = struct {
         }
         return error.ServerIdNotFound;
     }
-
-    // Helper: Calculate IP checksum
-    fn calculateChecksum(self: *Self, data: []const u8) u16 {
-        _ = self;
-        var sum: u32 = 0;
-        var i: usize = 0;
-        while (i < data.len - 1) : (i += 2) {
-            const word = (@as(u32, data[i]) << 8) | @as(u32, data[i + 1]);
-            sum += word;
-        }
-        if (i < data.len) {
-            sum += @as(u32, data[i]) << 8;
-        }
-        while ((sum >> 16) != 0) {
-            sum = (sum & 0xFFFF) + (sum >> 16);
-        }
-        return @intCast(~sum & 0xFFFF);
-    }
 };
 
 test "L2L3Translator basic init" {
@@ -589,3 +1073,401 @@ test "L2L3Translator basic init" {
     try std.testing.expect(translator.our_ip == null);
     try std.testing.expect(translator.gateway_mac == null);
 }
+
+test "L2L3Translator ARP reply dedup per requester" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+    const peer_mac = [_]u8{ 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = our_mac });
+    defer translator.deinit();
+    translator.setOurIp(0x0A150064); // 10.21.0.100
+
+    // ARP request from 10.21.0.1 asking for our IP
+    var handler = try ArpHandler.init(allocator, peer_mac);
+    defer handler.deinit();
+    const request = try handler.buildArpRequest(0x0A150001, 0x0A150064);
+    defer allocator.free(request);
+
+    try std.testing.expect((try translator.ethernetToIp(request)) == null);
+    try std.testing.expect((try translator.ethernetToIp(request)) == null);
+    try std.testing.expectEqual(@as(usize, 1), translator.arp_reply_queue.items.len);
+
+    const reply = translator.popArpReply().?;
+    defer allocator.free(reply);
+    const arp = try headers.Arp.view(reply[headers.Ethernet.size..]);
+    try std.testing.expectEqual(@as(u32, 0x0A150001), arp.get(.target_ip));
+    try std.testing.expectEqualSlices(u8, &peer_mac, &arp.get(.target_mac));
+
+    // Popping clears the pending marker, so a new request is answered again
+    try std.testing.expectEqual(@as(u32, 0), translator.pending_arp_ips.count());
+    try std.testing.expect((try translator.ethernetToIp(request)) == null);
+    try std.testing.expectEqual(@as(usize, 1), translator.arp_reply_queue.items.len);
+}
+
+test "L2L3Translator packet path translates in place" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = our_mac });
+    defer translator.deinit();
+
+    var storage = [_]u8{0} ** 128;
+    var pkt = Packet.init(&storage, 32);
+    const ip = try headers.Ipv4.viewMut(try pkt.put(headers.Ipv4.size));
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, headers.Ipv4.size);
+    const ip_start = pkt.head;
+
+    try translator.ipToEthernetPacket(&pkt);
+    try std.testing.expectEqual(ip_start - headers.Ethernet.size, pkt.head);
+    const eth = try headers.Ethernet.view(pkt.data());
+    try std.testing.expectEqual(EtherType.ipv4, eth.get(.ethertype));
+    try std.testing.expectEqualSlices(u8, &our_mac, &eth.get(.src_mac));
+
+    // Loop the frame back inbound: header is stripped without copying
+    pkt.flags.parsed = false;
+    try std.testing.expect(try translator.ethernetToIpPacket(&pkt));
+    try std.testing.expectEqual(ip_start, pkt.head);
+    try std.testing.expectEqual(@as(usize, headers.Ipv4.size), pkt.len);
+}
+
+test "L2L3Translator handles jumbo packets up to max MTU" {
+    const allocator = std.testing.allocator;
+
+    var translator = try L2L3Translator.init(allocator, .{
+        .our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 },
+    });
+    defer translator.deinit();
+
+    for ([_]u32{ 9000, taptun.max_mtu }) |mtu| {
+        const ip_packet = try allocator.alloc(u8, mtu);
+        defer allocator.free(ip_packet);
+        @memset(ip_packet, 0);
+        const ip = try headers.Ipv4.viewMut(ip_packet);
+        ip.set(.version_ihl, 0x45);
+        ip.set(.total_length, @intCast(mtu));
+
+        const frame = try translator.ipToEthernet(ip_packet);
+        defer allocator.free(frame);
+        try std.testing.expectEqual(taptun.maxFrameSize(mtu), frame.len);
+
+        const back = (try translator.ethernetToIp(frame)).?;
+        defer allocator.free(back);
+        try std.testing.expectEqual(@as(usize, mtu), back.len);
+    }
+}
+
+test "L2L3Translator drops frames addressed to other hub members" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = our_mac });
+    defer translator.deinit();
+
+    var frame = [_]u8{0} ** (headers.Ethernet.size + headers.Ipv4.size);
+    const eth = try headers.Ethernet.viewMut(&frame);
+    eth.set(.ethertype, EtherType.ipv4);
+    const ip = try headers.Ipv4.viewMut(frame[headers.Ethernet.size..]);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, headers.Ipv4.size);
+
+    // Unicast for another member: dropped before any copy
+    eth.set(.dst_mac, .{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x99 });
+    try std.testing.expect((try translator.ethernetToIp(&frame)) == null);
+    try std.testing.expectEqual(@as(u64, 1), translator.getStats().mac_filtered);
+
+    // Unicast for us: delivered
+    eth.set(.dst_mac, our_mac);
+    const ip_packet = (try translator.ethernetToIp(&frame)).?;
+    defer allocator.free(ip_packet);
+    try std.testing.expectEqual(@as(usize, headers.Ipv4.size), ip_packet.len);
+    try std.testing.expectEqual(@as(u64, 1), translator.mac_filter.accepted_unicast);
+}
+
+test "L2L3Translator validate_ip trims padding and drops corrupt headers" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = our_mac, .validate_ip = true });
+    defer translator.deinit();
+
+    // 40-byte TCP ACK padded to the 60-byte Ethernet minimum
+    var frame = [_]u8{0} ** 60;
+    const eth = try headers.Ethernet.viewMut(&frame);
+    eth.set(.dst_mac, our_mac);
+    eth.set(.ethertype, EtherType.ipv4);
+    const ip = try headers.Ipv4.viewMut(frame[headers.Ethernet.size..]);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, 40);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.tcp);
+    ip.set(.checksum, checksum.internet(frame[headers.Ethernet.size..][0..headers.Ipv4.size]));
+
+    const ip_packet = (try translator.ethernetToIp(&frame)).?;
+    defer allocator.free(ip_packet);
+    try std.testing.expectEqual(@as(usize, 40), ip_packet.len);
+
+    // Same frame through the packet path
+    var storage = [_]u8{0} ** 128;
+    var pkt = Packet.init(&storage, 32);
+    @memcpy(try pkt.put(frame.len), &frame);
+    try std.testing.expect(try translator.ethernetToIpPacket(&pkt));
+    try std.testing.expectEqual(@as(usize, 40), pkt.len);
+
+    // Corrupt header: rejected before any copy or TUN write
+    frame[headers.Ethernet.size + 8] = 1;
+    try std.testing.expect((try translator.ethernetToIp(&frame)) == null);
+    try std.testing.expectEqual(@as(u64, 1), translator.getStats().invalid);
+}
+
+test "L2L3Translator snoops IGMP joins for inbound multicast" {
+    const allocator = std.testing.allocator;
+
+    var translator = try L2L3Translator.init(allocator, .{
+        .our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 },
+    });
+    defer translator.deinit();
+
+    // Outgoing IGMPv2 report for 239.255.255.250 (SSDP)
+    var report = [_]u8{0} ** (headers.Ipv4.size + 8);
+    const ip = try headers.Ipv4.viewMut(&report);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.protocol, headers.IpProto.igmp);
+    ip.set(.dst_ip, 0xEFFFFFFA);
+    report[headers.Ipv4.size] = 0x16;
+    std.mem.writeInt(u32, report[headers.Ipv4.size + 4 ..][0..4], 0xEFFFFFFA, .big);
+
+    // Inbound SSDP frame is dropped until the host joins
+    var frame = [_]u8{0} ** (headers.Ethernet.size + headers.Ipv4.size);
+    const eth = try headers.Ethernet.viewMut(&frame);
+    eth.set(.dst_mac, .{ 0x01, 0x00, 0x5E, 0x7F, 0xFF, 0xFA });
+    eth.set(.ethertype, EtherType.ipv4);
+    frame[headers.Ethernet.size] = 0x45;
+    try std.testing.expect((try translator.ethernetToIp(&frame)) == null);
+
+    const out = try translator.ipToEthernet(&report);
+    defer allocator.free(out);
+    // Report itself is addressed to the group MAC
+    try std.testing.expectEqualSlices(u8, frame[0..6], out[0..6]);
+
+    const delivered = (try translator.ethernetToIp(&frame)).?;
+    defer allocator.free(delivered);
+    try std.testing.expectEqual(@as(usize, 1), translator.multicast_groups.count);
+}
+
+fn testDfPacket(buf: []u8, len: usize) []const u8 {
+    @memset(buf[0..len], 0);
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, @intCast(len));
+    ip.set(.flags_fragment, 0x4000);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.tcp);
+    ip.set(.src_ip, 0x0A150002); // 10.21.0.2
+    ip.set(.dst_ip, 0x5DB8D822); // 93.184.216.34
+    return buf[0..len];
+}
+
+test "L2L3Translator local Packet Too Big lets the host recover without a tunnel round trip" {
+    const allocator = std.testing.allocator;
+
+    var translator = try L2L3Translator.init(allocator, .{
+        .our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 },
+        .tunnel_mtu = 1400,
+    });
+    defer translator.deinit();
+
+    // Simulated host: sends one full-size DF segment per virtual millisecond at
+    // its path MTU and lowers the path MTU when an ICMP Too Big arrives on the
+    // TUN. A reply from the far end would take one tunnel round trip.
+    const tunnel_rtt_ms = 80;
+    var path_mtu: usize = 1500;
+    var first_drop_ms: ?u64 = null;
+    var recovered_ms: ?u64 = null;
+    var buf: [1500]u8 = undefined;
+
+    var now_ms: u64 = 0;
+    while (now_ms < 1000 and recovered_ms == null) : (now_ms += 1) {
+        if (translator.ipToEthernet(testDfPacket(&buf, path_mtu))) |frame| {
+            allocator.free(frame);
+            if (first_drop_ms != null) recovered_ms = now_ms;
+        } else |err| {
+            if (err != error.PacketTooBig) return err;
+            if (first_drop_ms == null) first_drop_ms = now_ms;
+            while (translator.popTunReply()) |reply| {
+                defer allocator.free(reply);
+                if (icmp.advertisedMtu(reply)) |mtu| path_mtu = mtu;
+            }
+        }
+    }
+
+    const time_to_recover = recovered_ms.? - first_drop_ms.?;
+    try std.testing.expectEqual(@as(u64, 1), time_to_recover);
+    try std.testing.expect(time_to_recover < tunnel_rtt_ms);
+    try std.testing.expectEqual(@as(usize, 1400), path_mtu);
+    try std.testing.expectEqual(@as(u64, 1), translator.getStats().icmp_too_big);
+
+    // Non-DF packets are forwarded for downstream fragmentation
+    var plain = [_]u8{0} ** 1500;
+    @memcpy(&plain, testDfPacket(&buf, 1500));
+    plain[6] = 0;
+    const frame = try translator.ipToEthernet(&plain);
+    allocator.free(frame);
+}
+
+test "L2L3Translator rate-limits Packet Too Big bursts" {
+    const allocator = std.testing.allocator;
+
+    var translator = try L2L3Translator.init(allocator, .{
+        .our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 },
+        .tunnel_mtu = 1280,
+        .icmp_burst = 4,
+    });
+    defer translator.deinit();
+
+    var buf: [1500]u8 = undefined;
+    for (0..50) |_| {
+        try std.testing.expectError(error.PacketTooBig, translator.ipToEthernet(testDfPacket(&buf, 1500)));
+    }
+
+    // Burst plus at most one refill while the loop ran
+    try std.testing.expect(translator.icmp_too_big_sent <= 5);
+    try std.testing.expectEqual(@as(u64, 50), translator.icmp_too_big_sent + translator.icmp_too_big_suppressed);
+    try std.testing.expectEqual(@as(usize, @intCast(translator.icmp_too_big_sent)), translator.tun_reply_queue.items.len);
+}
+
+test "L2L3Translator frees a Packet Too Big reply it cannot queue" {
+    var failing = std.testing.FailingAllocator.init(std.testing.allocator, .{});
+    var translator = try L2L3Translator.init(failing.allocator(), .{
+        .our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 },
+        .tunnel_mtu = 1280,
+    });
+    defer translator.deinit();
+
+    // The reply copy succeeds, growing the queue fails
+    failing.fail_index = failing.alloc_index + 1;
+    var buf: [1500]u8 = undefined;
+    try std.testing.expectError(error.OutOfMemory, translator.ipToEthernet(testDfPacket(&buf, 1500)));
+    try std.testing.expectEqual(@as(usize, 0), translator.tun_reply_queue.items.len);
+}
+
+test "L2L3Translator probes the path MTU through a lossy gateway stand-in" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+    const gateway_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0xFE };
+    const path_mtu = 1452;
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = our_mac });
+    defer translator.deinit();
+
+    try std.testing.expectError(error.NoGateway, translator.startPmtuProbe(.{}));
+    translator.setOurIp(0x0A150064); // 10.21.0.100
+    translator.setGateway(0x0A150001); // 10.21.0.1
+    try translator.startPmtuProbe(.{ .base_mtu = 1280, .max_mtu = 1500, .timeout_ms = 50 });
+
+    // Gateway stand-in: drops frames above the path MTU and every fifth frame,
+    // answers the rest with an echo reply
+    var frames_seen: usize = 0;
+    var now_ms: i64 = 0;
+    var last_reply: ?[]u8 = null;
+    defer if (last_reply) |reply| allocator.free(reply);
+    while (translator.pmtuResult() == null) : (now_ms += 10) {
+        try std.testing.expect(now_ms < 10_000);
+        try translator.pollPmtuProbe(now_ms);
+
+        while (translator.popVpnFrame()) |frame| {
+            defer allocator.free(frame);
+            frames_seen += 1;
+            if (frame.len - headers.Ethernet.size > path_mtu or frames_seen % 5 == 0) continue;
+
+            const reply = try allocator.dupe(u8, frame);
+            if (last_reply) |previous| allocator.free(previous);
+            last_reply = reply;
+            const eth = try headers.Ethernet.viewMut(reply);
+            eth.set(.dst_mac, our_mac);
+            eth.set(.src_mac, gateway_mac);
+            const ip = try headers.Ipv4.viewMut(reply[headers.Ethernet.size..]);
+            ip.set(.src_ip, 0x0A150099);
+            ip.set(.dst_ip, 0x0A150064);
+            reply[headers.Ethernet.size + headers.Ipv4.size] = 0; // Echo reply
+
+            // A host other than the gateway cannot answer for it
+            const spoofed = (try translator.ethernetToIp(reply)) orelse return error.NotDelivered;
+            allocator.free(spoofed);
+
+            // The gateway's reply is consumed by the prober, never delivered to the TUN
+            ip.set(.src_ip, 0x0A150001);
+            try std.testing.expect((try translator.ethernetToIp(reply)) == null);
+        }
+    }
+
+    try std.testing.expectEqual(@as(?u32, path_mtu), translator.pmtuResult());
+
+    // Once the search is over, replies are ordinary traffic again
+    const late = (try translator.ethernetToIp(last_reply.?)) orelse return error.NotDelivered;
+    allocator.free(late);
+}
+
+test "L2L3Translator reconfigure keeps learned state" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = our_mac });
+    defer translator.deinit();
+    translator.setOurIp(0x0A150064);
+    translator.setGateway(0x0A150001);
+    translator.gateway_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0xFE };
+
+    translator.reconfigure(.{ .our_mac = our_mac, .tunnel_mtu = 1400, .icmp_burst = 2, .dns_cache = .{} });
+    try std.testing.expectEqual(@as(?u32, 0x0A150064), translator.our_ip);
+    try std.testing.expect(translator.gateway_mac != null);
+    try std.testing.expect(translator.dns_proxy != null);
+    try std.testing.expectEqual(@as(?u32, 1400), translator.options.tunnel_mtu);
+
+    // The multicast filter's overflow fallback survives unrelated changes
+    translator.mac_filter.accept_all_multicast = true;
+    translator.reconfigure(.{ .our_mac = our_mac, .tunnel_mtu = 1300 });
+    try std.testing.expect(translator.mac_filter.accept_all_multicast);
+
+    const new_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x02 };
+    translator.reconfigure(.{ .our_mac = new_mac });
+    try std.testing.expect(translator.dns_proxy == null);
+    try std.testing.expectEqualSlices(u8, &new_mac, &translator.arp_handler.our_mac);
+}
+
+test "L2L3Translator unicasts the renewing REQUEST to the leasing server" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+    const gateway_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x00, 0x00, 0xFE };
+
+    var translator = try L2L3Translator.init(allocator, .{ .our_mac = our_mac });
+    defer translator.deinit();
+    try translator.startDhcp();
+    allocator.free(translator.popDhcpPacket().?);
+    translator.gateway_mac = gateway_mac;
+
+    const client = translator.dhcp_client.?;
+    client.lease = .{
+        .ip_address = [_]u8{ 10, 21, 0, 100 },
+        .subnet_mask = [_]u8{ 255, 255, 0, 0 },
+        .gateway = [_]u8{ 10, 21, 0, 1 },
+        .dns_servers = .{},
+        .lease_time = 60,
+        .renewal_time = 30,
+        .rebinding_time = 52,
+        .server_id = [_]u8{ 10, 21, 0, 1 },
+        .obtained_at = std.time.timestamp(),
+    };
+    client.state = .BOUND;
+
+    try translator.renewDhcp();
+    const frame = translator.popDhcpPacket().?;
+    defer allocator.free(frame);
+
+    const eth = try headers.Ethernet.view(frame);
+    try std.testing.expectEqualSlices(u8, &gateway_mac, &eth.get(.dst_mac));
+    const ip = try headers.Ipv4.view(frame[headers.Ethernet.size..]);
+    try std.testing.expectEqual(@as(u32, 0x0A150064), ip.get(.src_ip));
+    try std.testing.expectEqual(@as(u32, 0x0A150001), ip.get(.dst_ip));
+}
@@ -11,6 +11,7 @@
 //! defer adapter.close();
 //!
 //! // Read Ethernet frame (automatic conversion from IP)
+//! // Size buffers for the configured MTU: taptun.maxFrameSize(mtu)
 //! var buffer: [2048]u8 = undefined;
 //! const eth_frame = try adapter.readEthernet(&buffer);
 //!
@@ -21,6 +22,15 @@
 const std = @import("std");
 const taptun = @import("taptun.zig");
 const builtin = @import("builtin");
+const packet = @import("packet.zig");
+const Packet = packet.Packet;
+const config = @import("config.zig");
+const pcap = @import("pcap.zig");
+const arena = @import("arena.zig");
+const headers = @import("headers.zig");
+const LoopbackDevice = @import("loopback.zig").LoopbackDevice;
+const block = @import("block.zig");
+const simd = @import("simd.zig");
 
 // Platform-specific route management
 const RouteManager = if (builtin.os.tag == .macos)
@@ -28,255 +38,625 @@ const RouteManager = if (builtin.os.tag == .macos)
 else
     void; // Other platforms not yet implemented
 
-pub const TunAdapter = struct {
-    allocator: std.mem.Allocator,
-    device: taptun.TunDevice,
-    translator: taptun.L2L3Translator,
-    route_manager: ?*RouteManager, // Optional route management
-    read_buffer: []u8, // Internal buffer for AF header handling
-    write_buffer: []u8, // Internal buffer for AF header construction
-
-    const Self = @This();
-
-    /// Options for TunAdapter creation
-    pub const Options = struct {
-        device: taptun.DeviceOptions = .{},
-        translator: taptun.TranslatorOptions,
-        buffer_size: usize = 65536, // Internal buffer size for packet handling
-        manage_routes: bool = false, // Enable automatic route management (save/restore)
-    };
+/// TUN adapter over the platform device
+pub const TunAdapter = GenericTunAdapter(taptun.TunDevice);
+
+/// TUN adapter over any device with the platform device's interface
+/// (`open`, `close`, `read`, `write`, `setNonBlocking`, `getName`, `mtu`).
+/// A device that declares `framing` supplies its own protocol header
+/// handling in place of `taptun.platform`, e.g. `LoopbackDevice`.
+pub fn GenericTunAdapter(comptime Device: type) type {
+    return struct {
+        allocator: std.mem.Allocator,
+        device: Device,
+        translator: taptun.L2L3Translator,
+        route_manager: ?*RouteManager, // Optional route management
+        read_buffer: []u8, // Internal buffer for AF header handling
+        write_buffer: []u8, // Internal buffer for AF header construction
+        config_store: config.Store, // Versioned live configuration (see `reconfigure`)
+        config_reader: config.Reader, // The data path's view of config_store
+        capture: ?*pcap.PcapWriter, // Frame capture, switched by reconfiguration
+        scratch: arena.BatchArena, // Per-batch memory for TUN replies and protocol headers
+        packets_skipped: u64 = 0, // Outbound packets readBlock could not translate
+
+        const Self = @This();
+        const Framing = if (@hasDecl(Device, "framing")) Device.framing else taptun.platform;
+
+        /// Options for TunAdapter creation
+        pub const Options = struct {
+            device: taptun.DeviceOptions = .{},
+            translator: taptun.TranslatorOptions,
+            buffer_size: ?usize = null, // Internal buffer size (null = derived from device.mtu)
+            manage_routes: bool = false, // Enable automatic route management (save/restore)
+            scratch_size: usize = arena.default_size, // Initial per-batch scratch arena size
+        };
 
-    /// Open TUN device with L2↔L3 translation
-    pub fn open(allocator: std.mem.Allocator, options: Options) !*Self {
-        // Open platform-specific TUN device
-        var device = try taptun.TunDevice.open(allocator, options.device.unit);
-        errdefer device.close();
+        /// Open TUN device with L2↔L3 translation
+        pub fn open(allocator: std.mem.Allocator, options: Options) !*Self {
+            // Open platform-specific TUN device
+            const mtu = options.device.mtu;
+            if (mtu < taptun.min_mtu or mtu > taptun.max_mtu) {
+                return error.InvalidConfiguration;
+            }
 
-        // Set non-blocking if requested
-        if (options.device.non_blocking) {
-            try device.setNonBlocking(true);
+            var device = try Device.open(allocator, options.device.unit);
+            errdefer device.close();
+
+            if (@hasDecl(Device, "setMtu")) {
+                try device.setMtu(mtu);
+            } else {
+                device.mtu = mtu; // utun/TAP MTU is configured on the interface (see ifconfig.zig)
+            }
+
+            // Set non-blocking if requested
+            if (options.device.non_blocking) {
+                try device.setNonBlocking(true);
+            }
+
+            return adopt(allocator, device, options);
         }
 
-        // Initialize L2↔L3 translator
-        var translator = try taptun.L2L3Translator.init(allocator, options.translator);
-        errdefer translator.deinit();
+        /// Build an adapter around a device that is already open, e.g. one adopted
+        /// from a previous process (see handover.zig); the adapter owns it from then on.
+        /// The device keeps its MTU and blocking mode (`options.device` is ignored).
+        /// On error the device stays with the caller.
+        pub fn adopt(allocator: std.mem.Allocator, device: Device, options: Options) !*Self {
+            const mtu = device.mtu;
+            if (mtu < taptun.min_mtu or mtu > taptun.max_mtu) {
+                return error.InvalidConfiguration;
+            }
 
-        // Allocate internal buffers
-        const read_buffer = try allocator.alloc(u8, options.buffer_size);
-        errdefer allocator.free(read_buffer);
+            // Initialize L2↔L3 translator
+            var translator = try taptun.L2L3Translator.init(allocator, options.translator);
+            errdefer translator.deinit();
 
-        const write_buffer = try allocator.alloc(u8, options.buffer_size);
-        errdefer allocator.free(write_buffer);
+            // Allocate internal buffers: a full frame at this MTU plus the platform header
+            const buffer_size = options.buffer_size orelse
+                taptun.maxFrameSize(mtu) + Framing.protocol_header_len;
 
-        // Initialize route manager if enabled (macOS only for now)
-        var route_manager: ?*RouteManager = null;
-        if (options.manage_routes and builtin.os.tag == .macos) {
-            route_manager = try RouteManager.init(allocator);
-            errdefer route_manager.?.deinit();
+            const read_buffer = try allocator.alloc(u8, buffer_size);
+            errdefer allocator.free(read_buffer);
 
-            // Save original gateway immediately
-            try route_manager.?.getDefaultGateway();
+            const write_buffer = try allocator.alloc(u8, buffer_size);
+            errdefer allocator.free(write_buffer);
+
+            // Initialize route manager if enabled (macOS only for now)
+            var route_manager: ?*RouteManager = null;
+            if (builtin.os.tag == .macos and options.manage_routes) {
+                route_manager = try RouteManager.init(allocator);
+                errdefer route_manager.?.deinit();
+
+                // Save original gateway immediately
+                try route_manager.?.getDefaultGateway();
+            }
+
+            var config_store = try config.Store.init(allocator, .{ .mtu = mtu, .translator = options.translator });
+            errdefer config_store.deinit();
+
+            var scratch = try arena.BatchArena.init(allocator, options.scratch_size);
+            errdefer scratch.deinit();
+
+            const self = try allocator.create(Self);
+            errdefer allocator.destroy(self);
+
+            self.* = .{
+                .allocator = allocator,
+                .device = device,
+                .translator = translator,
+                .route_manager = route_manager,
+                .read_buffer = read_buffer,
+                .write_buffer = write_buffer,
+                .config_store = config_store,
+                .config_reader = undefined,
+                .capture = null,
+                .scratch = scratch,
+            };
+            // The store and arena have reached their final addresses
+            self.config_reader = try self.config_store.register();
+            self.translator.setScratch(&self.scratch);
+
+            return self;
         }
 
-        const self = try allocator.create(Self);
-        errdefer allocator.destroy(self);
+        /// Close device and free resources
+        pub fn close(self: *Self) void {
+            std.log.info("[TUN CLOSE] Starting TUN adapter cleanup...", .{});
 
-        self.* = .{
-            .allocator = allocator,
-            .device = device,
-            .translator = translator,
-            .route_manager = route_manager,
-            .read_buffer = read_buffer,
-            .write_buffer = write_buffer,
-        };
+            // ✅ CRITICAL: Restore routes BEFORE closing device!
+            inline for (.{RouteManager}) |RM| {
+                if (RM != void and self.route_manager != null) {
+                    std.log.info("[TUN CLOSE] Restoring routes...", .{});
+                    self.route_manager.?.deinit();
+                    std.log.info("[TUN CLOSE] ✅ Routes restored", .{});
+                }
+            }
 
-        return self;
-    }
+            std.log.info("[TUN CLOSE] Closing TUN device...", .{});
+            self.device.close();
+            std.log.info("[TUN CLOSE] ✅ TUN device closed", .{});
 
-    /// Close device and free resources
-    pub fn close(self: *Self) void {
-        std.log.info("[TUN CLOSE] Starting TUN adapter cleanup...", .{});
+            std.log.info("[TUN CLOSE] Cleaning up translator...", .{});
+            self.translator.deinit();
+            std.log.info("[TUN CLOSE] ✅ Translator cleaned up", .{});
 
-        // ✅ CRITICAL: Restore routes BEFORE closing device!
-        inline for (.{RouteManager}) |RM| {
-            if (RM != void and self.route_manager != null) {
-                std.log.info("[TUN CLOSE] Restoring routes...", .{});
-                self.route_manager.?.deinit();
-                std.log.info("[TUN CLOSE] ✅ Routes restored", .{});
+            self.config_store.unregister(&self.config_reader);
+            self.config_store.deinit();
+            self.scratch.deinit();
+
+            self.allocator.free(self.read_buffer);
+            self.allocator.free(self.write_buffer);
+            self.allocator.destroy(self);
+            std.log.info("[TUN CLOSE] ✅ TUN adapter cleanup complete", .{});
+        }
+
+        /// Read Ethernet frame from TUN device
+        /// Returns Ethernet frame in provided buffer (automatically translated from IP packet)
+        /// Buffer must be large enough for Ethernet frame (IP packet size + 14 bytes)
+        /// Packets handled locally (ICMP Too Big for oversize packets, cached DNS
+        /// answers) get their replies written back to the device, and the next
+        /// packet is read instead.
+        pub fn readEthernet(self: *Self, buffer: []u8) ![]u8 {
+            try self.beginBatch();
+            const eth_frame = while (true) {
+                // Read IP packet from device (handles AF header stripping internally)
+                const ip_packet_with_header = try self.device.read(self.read_buffer);
+
+                // Strip AF header (4 bytes on macOS/BSD)
+                const ip_packet = try Framing.stripProtocolHeader(ip_packet_with_header);
+
+                // Translate IP → Ethernet
+                break self.translator.ipToEthernet(ip_packet) catch |err| switch (err) {
+                    error.PacketTooBig, error.HandledLocally => {
+                        try self.flushTunReplies();
+                        continue;
+                    },
+                    else => return err,
+                };
+            };
+            defer self.allocator.free(eth_frame);
+
+            if (eth_frame.len > buffer.len) {
+                return error.BufferTooSmall;
             }
+
+            @memcpy(buffer[0..eth_frame.len], eth_frame);
+            if (self.capture) |writer| writer.writePacket(eth_frame) catch {};
+            return buffer[0..eth_frame.len];
         }
 
-        std.log.info("[TUN CLOSE] Closing TUN device...", .{});
-        self.device.close();
-        std.log.info("[TUN CLOSE] ✅ TUN device closed", .{});
+        /// Write Ethernet frame to TUN device
+        /// Automatically translates Ethernet frame to IP packet and handles AF header
+        pub fn writeEthernet(self: *Self, eth_frame: []const u8) !void {
+            try self.beginBatch();
+            if (self.capture) |writer| writer.writePacket(eth_frame) catch {};
 
-        std.log.info("[TUN CLOSE] Cleaning up translator...", .{});
-        self.translator.deinit();
-        std.log.info("[TUN CLOSE] ✅ Translator cleaned up", .{});
+            // Translate Ethernet → IP (may return null for ARP, etc.)
+            const maybe_ip = try self.translator.ethernetToIp(eth_frame);
 
-        self.allocator.free(self.read_buffer);
-        self.allocator.free(self.write_buffer);
-        self.allocator.destroy(self);
-        std.log.info("[TUN CLOSE] ✅ TUN adapter cleanup complete", .{});
-    }
+            if (maybe_ip) |ip_packet| {
+                defer self.allocator.free(ip_packet);
 
-    /// Read Ethernet frame from TUN device
-    /// Returns Ethernet frame in provided buffer (automatically translated from IP packet)
-    /// Buffer must be large enough for Ethernet frame (IP packet size + 14 bytes)
-    pub fn readEthernet(self: *Self, buffer: []u8) ![]u8 {
-        // Read IP packet from device (handles AF header stripping internally)
-        const ip_packet_with_header = try self.device.read(self.read_buffer);
+                // Add AF header for macOS/BSD
+                const packet_with_header = try Framing.addProtocolHeader(
+                    self.scratch.allocator(),
+                    ip_packet,
+                );
+                defer self.scratch.allocator().free(packet_with_header);
 
-        // Strip AF header (4 bytes on macOS/BSD)
-        const ip_packet = try taptun.platform.stripProtocolHeader(ip_packet_with_header);
+                // Write to device
+                try self.device.write(packet_with_header);
+            }
+            // If null, packet was handled internally (e.g., ARP reply sent)
 
-        // Translate IP → Ethernet
-        const eth_frame = try self.translator.ipToEthernet(ip_packet);
-        defer self.allocator.free(eth_frame);
+            // Coalesced DNS queries answered by this frame
+            if (self.translator.hasPendingTunReply()) try self.flushTunReplies();
+        }
 
-        if (eth_frame.len > buffer.len) {
-            return error.BufferTooSmall;
+        /// Read one packet from the TUN device and translate it to an Ethernet frame in place
+        /// The device reads straight into `pkt`'s buffer; the protocol header is pulled
+        /// off and the Ethernet header pushed into headroom, so there is no allocation or copy.
+        /// `pkt` must be empty and have at least 14 bytes of headroom (see `packet.default_headroom`).
+        /// Oversize packets are handled as in `readEthernet`.
+        pub fn readEthernetPacket(self: *Self, pkt: *Packet) !void {
+            try self.beginBatch();
+            const headroom = pkt.headroom();
+            while (true) {
+                const raw = try self.device.read(pkt.tail());
+                pkt.len = raw.len;
+                pkt.stamp();
+
+                // Strip AF header (4 bytes on macOS/BSD)
+                const ip_packet = try Framing.stripProtocolHeader(pkt.data());
+                _ = try pkt.pull(pkt.len - ip_packet.len);
+
+                self.translator.ipToEthernetPacket(pkt) catch |err| switch (err) {
+                    error.PacketTooBig, error.HandledLocally => {
+                        try self.flushTunReplies();
+                        pkt.reset(headroom);
+                        continue;
+                    },
+                    else => return err,
+                };
+                if (self.capture) |writer| writer.writeDescriptor(pkt) catch {};
+                return;
+            }
         }
 
-        @memcpy(buffer[0..eth_frame.len], eth_frame);
-        return buffer[0..eth_frame.len];
-    }
+        /// Write locally generated replies (ICMP Too Big) back into the device
+        pub fn flushTunReplies(self: *Self) !void {
+            while (self.translator.popTunReply()) |reply| {
+                defer self.translator.releaseTunReply(reply);
+                try self.writeIp(reply);
+            }
+        }
 
-    /// Write Ethernet frame to TUN device
-    /// Automatically translates Ethernet frame to IP packet and handles AF header
-    pub fn writeEthernet(self: *Self, eth_frame: []const u8) !void {
-        // Translate Ethernet → IP (may return null for ARP, etc.)
-        const maybe_ip = try self.translator.ethernetToIp(eth_frame);
+        /// Translate the Ethernet frame in `pkt` to an IP packet in place and write it to the device
+        /// Chained packets are written with gather I/O where the device supports it and
+        /// are only linearized (into the internal write buffer) where it does not.
+        /// Returns false if the frame was handled internally (e.g., ARP)
+        pub fn writeEthernetPacket(self: *Self, pkt: *Packet) !bool {
+            try self.beginBatch();
+            if (self.capture) |writer| writer.writeDescriptor(pkt) catch {};
+            defer if (self.translator.hasPendingTunReply()) self.flushTunReplies() catch {};
+            if (!try self.translator.ethernetToIpPacket(pkt)) return false;
+
+            // Add AF header for macOS/BSD in the space the Ethernet header occupied
+            const header = try pkt.push(Framing.protocol_header_len);
+            try Framing.writeProtocolHeader(header, pkt.data()[header.len..]);
+
+            if (!pkt.isChained()) {
+                try self.device.write(pkt.data());
+            } else if (@hasDecl(Device, "writev")) {
+                var iov: [packet.max_segments]std.posix.iovec_const = undefined;
+                try self.device.writev(try pkt.gather(&iov));
+            } else {
+                try self.device.write(try pkt.linearize(self.write_buffer));
+            }
+            return true;
+        }
 
-        if (maybe_ip) |ip_packet| {
-            defer self.allocator.free(ip_packet);
+        /// Translate every frame of a SoftEther block and write the IP packets to the device
+        /// Frames are translated in place in `blk` a burst at a time through the
+        /// translator's batch path, and each burst is handed to the device in one
+        /// `writePackets` call. `blk` is overwritten. A keep-alive writes nothing.
+        /// Returns the number of packets written
+        pub fn writeBlock(self: *Self, blk: []u8) !usize {
+            try self.beginBatch();
+            defer if (self.translator.hasPendingTunReply()) self.flushTunReplies() catch {};
+
+            var reader = try block.Reader.init(blk);
+            var burst: [simd.max_burst]Packet = undefined;
+            var iov: [simd.max_burst]std.posix.iovec_const = undefined;
+            var written: usize = 0;
+            while (!reader.done()) {
+                const packets = try self.translateBlock(&reader, &burst, &iov);
+                try self.writePackets(packets);
+                written += packets.len;
+            }
+            return written;
+        }
 
-            // Add AF header for macOS/BSD
-            const packet_with_header = try taptun.platform.addProtocolHeader(
-                self.allocator,
-                ip_packet,
-            );
-            defer self.allocator.free(packet_with_header);
+        /// Translate the next burst of up to `burst.len` frames from `reader`
+        /// Returns an iovec per IP packet to deliver, protocol header included,
+        /// pointing into the block buffer.
+        pub fn translateBlock(
+            self: *Self,
+            reader: *block.Reader,
+            burst: []Packet,
+            iov: []std.posix.iovec_const,
+        ) ![]std.posix.iovec_const {
+            std.debug.assert(burst.len <= simd.max_burst and iov.len >= burst.len);
+            var n: usize = 0;
+            while (n < burst.len) : (n += 1) {
+                burst[n] = (try reader.next()) orelse break;
+                if (self.capture) |writer| writer.writeDescriptor(&burst[n]) catch {};
+            }
 
-            // Write to device
-            try self.device.write(packet_with_header);
+            var delivered = try self.translator.ethernetToIpBurst(burst[0..n]);
+            var count: usize = 0;
+            while (delivered != 0) : (delivered &= delivered - 1) {
+                const pkt = &burst[@ctz(delivered)];
+                // Protocol header goes where the Ethernet header was
+                const header = try pkt.push(Framing.protocol_header_len);
+                try Framing.writeProtocolHeader(header, pkt.data()[header.len..]);
+                iov[count] = .{ .base = pkt.data().ptr, .len = pkt.len };
+                count += 1;
+            }
+            return iov[0..count];
         }
-        // If null, packet was handled internally (e.g., ARP reply sent)
-    }
 
-    /// Read raw IP packet (no L2↔L3 translation)
-    /// Returns IP packet in provided buffer (AF header already stripped)
-    pub fn readIp(self: *Self, buffer: []u8) ![]u8 {
-        const ip_packet_with_header = try self.device.read(self.read_buffer);
-        const ip_packet = try taptun.platform.stripProtocolHeader(ip_packet_with_header);
+        /// Read packets from the device straight into an outbound SoftEther block
+        /// Each packet lands in `buf` where its frame belongs and is translated in
+        /// place. Stops at `max_frames`, when `buf` has no room for a full-MTU
+        /// frame, or when the device has nothing more to read. A blocking device
+        /// only waits for the first packet; after that the block goes out as soon
+        /// as nothing is ready. A packet that cannot be translated is counted in
+        /// `packets_skipped` and left out of the block.
+        /// Returns the finished block, or null if no packet was waiting
+        pub fn readBlock(self: *Self, buf: []u8, max_frames: usize) !?[]u8 {
+            try self.beginBatch();
+            var writer = try block.Writer.init(buf);
+            const frame_size = self.maxFrameSize();
+            const headroom = headers.Ethernet.size - Framing.protocol_header_len;
+
+            while (writer.count < max_frames and writer.available() >= frame_size) {
+                if (writer.count > 0 and !self.readable()) break;
+                var pkt = Packet.init(buf[writer.nextOffset()..][0..frame_size], headroom);
+                const raw = self.device.read(pkt.tail()) catch |err| {
+                    if (err == error.WouldBlock) break;
+                    return err;
+                };
+                pkt.len = raw.len;
+                pkt.stamp();
+
+                // Strip AF header (4 bytes on macOS/BSD)
+                const ip_packet = Framing.stripProtocolHeader(pkt.data()) catch {
+                    self.packets_skipped += 1;
+                    continue;
+                };
+                _ = try pkt.pull(pkt.len - ip_packet.len);
+
+                self.translator.ipToEthernetPacket(&pkt) catch |err| switch (err) {
+                    error.PacketTooBig, error.HandledLocally => {
+                        try self.flushTunReplies();
+                        continue;
+                    },
+                    // The frames already committed still go out
+                    else => {
+                        self.packets_skipped += 1;
+                        continue;
+                    },
+                };
+                // The Ethernet header filled the headroom, so the frame starts at nextOffset()
+                std.debug.assert(pkt.headroom() == 0);
+                if (self.capture) |capture| capture.writeDescriptor(&pkt) catch {};
+                writer.commit(pkt.len);
+            }
+            if (writer.count == 0) return null;
+            return writer.finish();
+        }
 
-        if (ip_packet.len > buffer.len) {
-            return error.BufferTooSmall;
+        /// Whether a read would return a packet without waiting
+        /// Descriptor-backed devices are polled with a zero timeout; a device
+        /// that can neither be polled nor report it counts as never ready.
+        fn readable(self: *Self) bool {
+            if (@hasDecl(Device, "readable")) return self.device.readable();
+            if (!@hasField(Device, "fd")) return false;
+            var fds = [_]std.posix.pollfd{.{ .fd = self.device.fd, .events = std.posix.POLL.IN, .revents = 0 }};
+            const ready = std.posix.poll(&fds, 0) catch return false;
+            return ready > 0;
         }
 
-        @memcpy(buffer[0..ip_packet.len], ip_packet);
-        return buffer[0..ip_packet.len];
-    }
+        /// Hand packets to the device, in one call where it takes a batch
+        /// A TUN device takes one packet per write, so there this is a write each.
+        fn writePackets(self: *Self, packets: []const std.posix.iovec_const) !void {
+            if (@hasDecl(Device, "writeBatch")) {
+                try self.device.writeBatch(packets);
+            } else {
+                for (packets) |p| try self.device.write(p.base[0..p.len]);
+            }
+        }
 
-    /// Write raw IP packet (no L2↔L3 translation)
-    /// Automatically adds AF header for platform
-    pub fn writeIp(self: *Self, ip_packet: []const u8) !void {
-        const packet_with_header = try taptun.platform.addProtocolHeader(
-            self.allocator,
-            ip_packet,
-        );
-        defer self.allocator.free(packet_with_header);
+        /// Apply the MTU found by the translator's path MTU prober
+        /// Sets the device MTU, grows the internal buffers if needed and enables the
+        /// translator's local Packet Too Big check at the new size.
+        /// Returns the applied MTU, or null if probing has not finished.
+        /// The change goes through the config store, so later `reconfigure` calls
+        /// built from `latestConfig` keep it.
+        pub fn applyProbedMtu(self: *Self) !?u32 {
+            const mtu = self.translator.pmtuResult() orelse return null;
+            if (mtu < taptun.min_mtu or mtu > taptun.max_mtu) return error.InvalidConfiguration;
+
+            _ = try self.config_store.update(mtu, setProbedMtu);
+            try self.syncConfig();
+            return mtu;
+        }
 
-        try self.device.write(packet_with_header);
-    }
+        fn setProbedMtu(mtu: u32, cfg: *config.Config) void {
+            cfg.mtu = mtu;
+            cfg.translator.tunnel_mtu = mtu;
+        }
 
-    /// Get device name (e.g., "utun4")
-    pub fn getDeviceName(self: *Self) []const u8 {
-        return self.device.getName();
-    }
+        /// Set the device MTU, growing the internal buffers if needed
+        fn setDeviceMtu(self: *Self, mtu: u32) !void {
+            const buffer_size = taptun.maxFrameSize(mtu) + Framing.protocol_header_len;
+            if (buffer_size > self.read_buffer.len) {
+                self.read_buffer = try self.allocator.realloc(self.read_buffer, buffer_size);
+                self.write_buffer = try self.allocator.realloc(self.write_buffer, buffer_size);
+            }
 
-    /// Get device file descriptor (Unix) or handle (Windows)
-    pub fn getFd(self: *Self) i32 {
-        return switch (builtin.os.tag) {
-            .macos, .ios, .linux => self.device.fd,
-            .windows => @intCast(@intFromPtr(self.device.handle)),
-            else => -1,
-        };
-    }
+            if (@hasDecl(Device, "setMtu")) {
+                try self.device.setMtu(mtu);
+            } else {
+                self.device.mtu = mtu;
+            }
+        }
 
-    /// Get learned IP address (auto-detected from outgoing packets)
-    pub fn getLearnedIp(self: *Self) ?u32 {
-        return self.translator.our_ip;
-    }
+        /// Publish a new configuration for the running adapter; returns its version
+        /// Safe to call from any thread. The device stays open: the data path applies
+        /// the change at its next batch boundary (the next read/write call, or an explicit
+        /// `syncConfig`), keeping learned IP/gateway/ARP state and in-flight traffic.
+        /// Build `new_config` from `latestConfig` to keep what the adapter changed itself.
+        pub fn reconfigure(self: *Self, new_config: config.Config) !u64 {
+            return self.config_store.publish(new_config);
+        }
 
-    /// Get learned gateway MAC address (from ARP replies)
-    pub fn getGatewayMac(self: *Self) ?[6]u8 {
-        return self.translator.gateway_mac;
-    }
+        /// Latest published configuration, including changes not yet applied
+        pub fn latestConfig(self: *Self) config.Config {
+            return self.config_store.latest();
+        }
 
-    /// Get translator statistics
-    pub fn getStats(self: *Self) TranslatorStats {
-        return .{
-            .packets_l3_to_l2 = self.translator.packets_translated_l3_to_l2,
-            .packets_l2_to_l3 = self.translator.packets_translated_l2_to_l3,
-            .arp_requests_handled = self.translator.arp_requests_handled,
-            .arp_replies_learned = self.translator.arp_replies_learned,
-        };
-    }
+        /// Current configuration as seen by the data path
+        pub fn currentConfig(self: *const Self) *const config.Config {
+            return self.config_reader.current();
+        }
 
-    /// Set non-blocking mode
-    pub fn setNonBlocking(self: *Self, enabled: bool) !void {
-        try self.device.setNonBlocking(enabled);
-    }
+        /// Batch boundary: apply configuration changes and release scratch memory
+        /// Runs at the start of every read/write call; batch loops over the packet API
+        /// may call it once per batch instead.
+        pub fn beginBatch(self: *Self) !void {
+            try self.syncConfig();
+            // Queued replies live in the arena until they are written
+            if (!self.translator.hasPendingTunReply()) self.scratch.reset();
+        }
 
-    /// Configure VPN routing (replace default gateway)
-    /// Requires manage_routes=true in Options
-    pub fn configureVpnRouting(self: *Self, vpn_gateway: [4]u8, vpn_server: ?[4]u8) !void {
-        inline for (.{RouteManager}) |RM| {
-            if (RM == void) {
-                return error.PlatformNotSupported;
+        /// Apply a pending configuration change, if any
+        /// Only fields that differ from the previous version are applied, so state
+        /// changed since (a learned gateway, a swapped capture) survives unrelated
+        /// updates. Costs one atomic load when nothing changed.
+        pub fn syncConfig(self: *Self) !void {
+            if (!self.config_reader.changed()) return;
+            // Copied before `sync` lets the store free it
+            const previous = self.config_reader.current().*;
+            const cfg = &self.config_reader.sync().?.config;
+
+            if (cfg.mtu != previous.mtu and cfg.mtu != self.device.mtu) try self.setDeviceMtu(cfg.mtu);
+            if (!std.meta.eql(cfg.translator, previous.translator)) self.translator.reconfigure(cfg.translator);
+            if (cfg.gateway_ip != previous.gateway_ip) {
+                if (cfg.gateway_ip) |gateway_ip| {
+                    if (self.translator.gateway_ip != gateway_ip) {
+                        self.translator.setGateway(gateway_ip);
+                        self.translator.gateway_mac = null; // Relearn for the new gateway only
+                    }
+                }
             }
+            if (cfg.capture != previous.capture) self.capture = cfg.capture;
         }
 
-        if (self.route_manager) |rm| {
-            // Add host route for VPN server through original gateway (if provided)
-            if (vpn_server) |server| {
-                if (rm.local_gateway) |orig_gw| {
-                    try rm.addHostRoute(server, orig_gw);
-                }
+        /// Current device MTU
+        pub fn getMtu(self: *const Self) u32 {
+            return self.device.mtu;
+        }
+
+        /// Buffer size needed by `readEthernet` for a full-MTU frame
+        pub fn maxFrameSize(self: *const Self) usize {
+            return taptun.maxFrameSize(self.device.mtu);
+        }
+
+        /// Read raw IP packet (no L2↔L3 translation)
+        /// Returns IP packet in provided buffer (AF header already stripped)
+        pub fn readIp(self: *Self, buffer: []u8) ![]u8 {
+            const ip_packet_with_header = try self.device.read(self.read_buffer);
+            const ip_packet = try Framing.stripProtocolHeader(ip_packet_with_header);
+
+            if (ip_packet.len > buffer.len) {
+                return error.BufferTooSmall;
             }
 
-            // Replace default gateway with VPN gateway
-            try rm.replaceDefaultGateway(vpn_gateway);
-        } else {
-            return error.RouteManagementDisabled;
+            @memcpy(buffer[0..ip_packet.len], ip_packet);
+            return buffer[0..ip_packet.len];
+        }
+
+        /// Write raw IP packet (no L2↔L3 translation)
+        /// Automatically adds AF header for platform
+        pub fn writeIp(self: *Self, ip_packet: []const u8) !void {
+            const packet_with_header = try Framing.addProtocolHeader(
+                self.scratch.allocator(),
+                ip_packet,
+            );
+            defer self.scratch.allocator().free(packet_with_header);
+
+            try self.device.write(packet_with_header);
+        }
+
+        /// Get device name (e.g., "utun4")
+        pub fn getDeviceName(self: *Self) []const u8 {
+            return self.device.getName();
+        }
+
+        /// Get device file descriptor (Unix) or handle (Windows), -1 if it has neither
+        pub fn getFd(self: *Self) i32 {
+            if (@hasField(Device, "fd")) return self.device.fd;
+            if (@hasField(Device, "handle")) return @intCast(@intFromPtr(self.device.handle));
+            return -1; // In-memory devices
+        }
+
+        /// Get learned IP address (auto-detected from outgoing packets)
+        pub fn getLearnedIp(self: *Self) ?u32 {
+            return self.translator.our_ip;
+        }
+
+        /// Get learned gateway MAC address (from ARP replies)
+        pub fn getGatewayMac(self: *Self) ?[6]u8 {
+            return self.translator.gateway_mac;
+        }
+
+        /// Get translator statistics
+        pub fn getStats(self: *Self) TranslatorStats {
+            return .{
+                .packets_l3_to_l2 = self.translator.packets_translated_l3_to_l2,
+                .packets_l2_to_l3 = self.translator.packets_translated_l2_to_l3,
+                .arp_requests_handled = self.translator.arp_requests_handled,
+                .arp_replies_learned = self.translator.arp_replies_learned,
+                .frames_filtered = self.translator.mac_filter.dropped(),
+                .icmp_too_big_sent = self.translator.icmp_too_big_sent,
+                .dns_cache_hits = if (self.translator.dns_proxy) |proxy| proxy.hits else 0,
+                .frames_invalid = self.translator.invalid_dropped,
+                .packets_skipped = self.packets_skipped,
+                .simd_variant = taptun.simd.active(),
+            };
         }
-    }
 
-    /// Configure VPN network route (for point-to-point TUN interfaces)
-    /// This adds an explicit route for the VPN subnet through the gateway
-    /// Critical for macOS TUN interfaces where routing isn't automatic
-    pub fn configureVpnNetworkRoute(self: *Self, network: [4]u8, netmask: [4]u8, gateway: [4]u8) !void {
-        inline for (.{RouteManager}) |RM| {
-            if (RM == void) {
-                return error.PlatformNotSupported;
+        /// Set non-blocking mode
+        pub fn setNonBlocking(self: *Self, enabled: bool) !void {
+            try self.device.setNonBlocking(enabled);
+        }
+
+        /// Configure VPN routing (replace default gateway)
+        /// Requires manage_routes=true in Options
+        pub fn configureVpnRouting(self: *Self, vpn_gateway: [4]u8, vpn_server: ?[4]u8) !void {
+            inline for (.{RouteManager}) |RM| {
+                if (RM == void) {
+                    return error.PlatformNotSupported;
+                }
+            }
+
+            if (self.route_manager) |rm| {
+                // Add host route for VPN server through original gateway (if provided)
+                if (vpn_server) |server| {
+                    if (rm.local_gateway) |orig_gw| {
+                        try rm.addHostRoute(server, orig_gw);
+                    }
+                }
+
+                // Replace default gateway with VPN gateway
+                try rm.replaceDefaultGateway(vpn_gateway);
+            } else {
+                return error.RouteManagementDisabled;
             }
         }
 
-        if (self.route_manager) |rm| {
-            try rm.addNetworkRoute(network, netmask, gateway);
-        } else {
-            return error.RouteManagementDisabled;
+        /// Configure VPN network route (for point-to-point TUN interfaces)
+        /// This adds an explicit route for the VPN subnet through the gateway
+        /// Critical for macOS TUN interfaces where routing isn't automatic
+        pub fn configureVpnNetworkRoute(self: *Self, network: [4]u8, netmask: [4]u8, gateway: [4]u8) !void {
+            inline for (.{RouteManager}) |RM| {
+                if (RM == void) {
+                    return error.PlatformNotSupported;
+                }
+            }
+
+            if (self.route_manager) |rm| {
+                try rm.addNetworkRoute(network, netmask, gateway);
+            } else {
+                return error.RouteManagementDisabled;
+            }
         }
-    }
 
-    pub const TranslatorStats = struct {
-        packets_l3_to_l2: u64,
-        packets_l2_to_l3: u64,
-        arp_requests_handled: u64,
-        arp_replies_learned: u64,
+        pub const TranslatorStats = struct {
+            packets_l3_to_l2: u64,
+            packets_l2_to_l3: u64,
+            arp_requests_handled: u64,
+            arp_replies_learned: u64,
+            frames_filtered: u64, // Dropped by the destination MAC filter
+            icmp_too_big_sent: u64, // Local Frag-Needed / Packet-Too-Big replies
+            dns_cache_hits: u64, // DNS queries answered from the in-path cache
+            frames_invalid: u64, // Malformed IP rejected by validate_ip
+            packets_skipped: u64, // Outbound packets readBlock could not translate
+            simd_variant: taptun.simd.Variant, // Instruction set of the checksum/copy/filter kernels chosen for this CPU
+        };
     };
-};
+}
 
 test "TunAdapter basic operations" {
     // This test requires root privileges
@@ -304,3 +684,191 @@ test "TunAdapter basic operations" {
     std.debug.print("Opened TUN adapter: {s}\n", .{adapter.getDeviceName()});
     try std.testing.expect(adapter.getFd() >= 0);
 }
+
+test "GenericTunAdapter over a loopback device round-trips frames" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+    const adapter = try GenericTunAdapter(LoopbackDevice).open(allocator, .{
+        .translator = .{ .our_mac = our_mac },
+    });
+    defer adapter.close();
+
+    // IPv4/UDP frame from the VPN, addressed to us
+    var frame = [_]u8{0} ** (headers.Ethernet.size + headers.Ipv4.size + headers.Udp.size);
+    const eth = try headers.Ethernet.viewMut(&frame);
+    eth.set(.dst_mac, our_mac);
+    eth.set(.src_mac, .{ 0x5E, 0x00, 0x00, 0x00, 0x00, 0x01 });
+    eth.set(.ethertype, headers.EtherType.ipv4);
+    const l3 = frame[headers.Ethernet.size..];
+    const ip = try headers.Ipv4.viewMut(l3);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, @intCast(l3.len));
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.src_ip, 0x0A150001);
+    ip.set(.dst_ip, 0x0A150064);
+    ip.set(.checksum, taptun.checksum.internet(l3[0..headers.Ipv4.size]));
+
+    // Written to the device as bare IP, which loops back as a frame for the VPN
+    try adapter.writeEthernet(&frame);
+    try std.testing.expectEqual(@as(usize, 1), adapter.device.pending());
+
+    var buffer: [2048]u8 = undefined;
+    const out = try adapter.readEthernet(&buffer);
+    try std.testing.expectEqualSlices(u8, l3, out[headers.Ethernet.size..]);
+    try std.testing.expectError(error.WouldBlock, adapter.readEthernet(&buffer));
+    try std.testing.expectEqual(@as(i32, -1), adapter.getFd());
+    try std.testing.expectEqualStrings("loop0", adapter.getDeviceName());
+}
+
+test "GenericTunAdapter translates whole blocks both ways" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+    const adapter = try GenericTunAdapter(LoopbackDevice).open(allocator, .{
+        .translator = .{ .our_mac = our_mac },
+    });
+    defer adapter.close();
+
+    var frame = [_]u8{0} ** (headers.Ethernet.size + headers.Ipv4.size + headers.Udp.size);
+    const eth = try headers.Ethernet.viewMut(&frame);
+    eth.set(.dst_mac, our_mac);
+    eth.set(.src_mac, .{ 0x5E, 0x00, 0x00, 0x00, 0x00, 0x01 });
+    eth.set(.ethertype, headers.EtherType.ipv4);
+    const l3 = frame[headers.Ethernet.size..];
+    const ip = try headers.Ipv4.viewMut(l3);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, @intCast(l3.len));
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.src_ip, 0x0A150001);
+    ip.set(.dst_ip, 0x0A150064);
+    ip.set(.checksum, taptun.checksum.internet(l3[0..headers.Ipv4.size]));
+
+    // Two frames for us around one flooded to another station
+    var buf: [1024]u8 = undefined;
+    var writer = try block.Writer.init(&buf);
+    try writer.append(&frame);
+    var flooded = frame;
+    flooded[5] ^= 0x01;
+    try writer.append(&flooded);
+    try writer.append(&frame);
+    try std.testing.expectEqual(@as(usize, 2), try adapter.writeBlock(writer.finish()));
+    try std.testing.expectEqual(@as(usize, 2), adapter.device.pending());
+
+    // Both loop back into one outbound block
+    var out: [4096]u8 = undefined;
+    const blk = (try adapter.readBlock(&out, 16)).?;
+    var reader = try block.Reader.init(blk);
+    for (0..2) |_| {
+        const pkt = (try reader.next()).?;
+        try std.testing.expectEqualSlices(u8, l3, pkt.data()[headers.Ethernet.size..]);
+    }
+    try std.testing.expect(reader.done());
+    try std.testing.expect((try adapter.readBlock(&out, 16)) == null);
+
+    // A packet that does not parse is skipped without losing its neighbours
+    try adapter.device.write(l3);
+    try adapter.device.write(&[_]u8{ 0xF0, 0x00, 0x00, 0x00 });
+    try adapter.device.write(l3);
+    reader = try block.Reader.init((try adapter.readBlock(&out, 16)).?);
+    for (0..2) |_| {
+        const pkt = (try reader.next()).?;
+        try std.testing.expectEqualSlices(u8, l3, pkt.data()[headers.Ethernet.size..]);
+    }
+    try std.testing.expect(reader.done());
+    try std.testing.expectEqual(@as(u64, 1), adapter.getStats().packets_skipped);
+}
+
+/// Device over a blocking pipe: a read waits until something is written
+const PipeDevice = struct {
+    fd: std.posix.fd_t,
+    write_fd: std.posix.fd_t,
+    mtu: u32 = taptun.default_mtu,
+
+    pub const framing = LoopbackDevice.framing;
+
+    pub fn read(self: *PipeDevice, buffer: []u8) ![]u8 {
+        const n = try std.posix.read(self.fd, buffer);
+        if (n == 0) return error.EndOfStream;
+        return buffer[0..n];
+    }
+
+    pub fn write(self: *PipeDevice, data: []const u8) !void {
+        _ = try std.posix.write(self.write_fd, data);
+    }
+
+    pub fn close(self: *PipeDevice) void {
+        std.posix.close(self.fd);
+        std.posix.close(self.write_fd);
+    }
+};
+
+test "GenericTunAdapter readBlock does not wait on a blocking device for a full block" {
+    if (builtin.os.tag == .windows) return error.SkipZigTest;
+
+    const allocator = std.testing.allocator;
+    const fds = try std.posix.pipe();
+    const adapter = GenericTunAdapter(PipeDevice).adopt(allocator, .{ .fd = fds[0], .write_fd = fds[1] }, .{
+        .translator = .{ .our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 } },
+    }) catch |err| {
+        std.posix.close(fds[0]);
+        std.posix.close(fds[1]);
+        return err;
+    };
+    defer adapter.close();
+
+    var l3 = [_]u8{0} ** (headers.Ipv4.size + headers.Udp.size);
+    const ip = try headers.Ipv4.viewMut(&l3);
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, @intCast(l3.len));
+    ip.set(.ttl, 64);
+    ip.set(.protocol, headers.IpProto.udp);
+    ip.set(.src_ip, 0x0A150064);
+    ip.set(.dst_ip, 0x0A150001);
+    ip.set(.checksum, taptun.checksum.internet(l3[0..headers.Ipv4.size]));
+
+    // One packet waiting: the block comes back with it rather than blocking for more
+    try adapter.device.write(&l3);
+    var out: [4096]u8 = undefined;
+    var reader = try block.Reader.init((try adapter.readBlock(&out, 16)).?);
+    try std.testing.expectEqualSlices(u8, &l3, (try reader.next()).?.data()[headers.Ethernet.size..]);
+    try std.testing.expect(reader.done());
+}
+
+test "GenericTunAdapter syncConfig applies only what changed" {
+    const allocator = std.testing.allocator;
+    const our_mac = [_]u8{ 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+    const adapter = try GenericTunAdapter(LoopbackDevice).open(allocator, .{
+        .translator = .{ .our_mac = our_mac },
+    });
+    defer adapter.close();
+
+    // Pin a gateway, then let the data path learn another one and overflow its multicast filter
+    var cfg = adapter.latestConfig();
+    cfg.gateway_ip = 0x0A150001;
+    _ = try adapter.reconfigure(cfg);
+    try adapter.syncConfig();
+    adapter.translator.setGateway(0x0A150002);
+    adapter.translator.mac_filter.accept_all_multicast = true;
+
+    // The probed MTU goes through the store like any other change
+    const Edit = struct {
+        fn probed(mtu: u32, c: *config.Config) void {
+            c.mtu = mtu;
+            c.translator.tunnel_mtu = mtu;
+        }
+    };
+    _ = try adapter.config_store.update(@as(u32, 1400), Edit.probed);
+
+    // A republish that only touches verbosity keeps all of it
+    cfg = adapter.latestConfig();
+    cfg.translator.verbose = true;
+    _ = try adapter.reconfigure(cfg);
+    try adapter.syncConfig();
+
+    try std.testing.expect(adapter.translator.options.verbose);
+    try std.testing.expectEqual(@as(?u32, 0x0A150002), adapter.translator.gateway_ip);
+    try std.testing.expect(adapter.translator.mac_filter.accept_all_multicast);
+    try std.testing.expectEqual(@as(u32, 1400), adapter.getMtu());
+    try std.testing.expectEqual(@as(?u32, 1400), adapter.translator.options.tunnel_mtu);
+}
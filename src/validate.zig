@@ -0,0 +1,129 @@
+//! Inbound IP Validation
+//!
+//! Frames from the VPN reach the TUN as-is unless checked. Ethernet pads short
+//! frames to 60 bytes, so a 40-byte TCP ACK arrives with 6 bytes of trailing
+//! junk that the TUN would hand to the stack as part of the packet, and a
+//! truncated or corrupt header still costs a write before the kernel drops it.
+//!
+//! The checks read only the fixed IP header and return the length the header
+//! claims, so callers can trim the padding:
+//!
+//! - IPv4: version, 20 ≤ IHL ≤ frame, IHL ≤ total length ≤ frame, header checksum
+//! - IPv6: version, 40 + payload length ≤ frame (jumbograms are left untrimmed)
+
+const std = @import("std");
+const headers = @import("headers.zig");
+const checksum = @import("checksum.zig");
+const IpProto = headers.IpProto;
+
+pub const Error = error{
+    Truncated,
+    BadVersion,
+    BadHeaderLength,
+    BadTotalLength,
+    BadChecksum,
+};
+
+/// Hop-by-Hop Options next-header value (carries the jumbo payload option)
+const ipv6_hop_by_hop: u8 = 0;
+
+/// Validate an IPv4 header and return the packet length it claims
+/// `l3` must hold the whole header; `available` counts every L3 byte present,
+/// which exceeds `l3.len` for chained packets.
+pub fn ipv4Length(l3: []const u8, available: usize) Error!usize {
+    std.debug.assert(available >= l3.len);
+    if (l3.len < headers.Ipv4.size) return error.Truncated;
+    if (l3[0] >> 4 != 4) return error.BadVersion;
+
+    const ihl = @as(usize, l3[0] & 0x0F) * 4;
+    if (ihl < headers.Ipv4.size or ihl > l3.len) return error.BadHeaderLength;
+
+    const total_length = std.mem.readInt(u16, l3[2..4], .big);
+    if (total_length < ihl or total_length > available) return error.BadTotalLength;
+
+    // A correct header sums to 0xFFFF, including its own checksum field
+    if (checksum.internet(l3[0..ihl]) != 0) return error.BadChecksum;
+    return total_length;
+}
+
+/// Validate an IPv6 header and return the packet length it claims
+pub fn ipv6Length(l3: []const u8, available: usize) Error!usize {
+    std.debug.assert(available >= l3.len);
+    if (l3.len < headers.Ipv6.size) return error.Truncated;
+    if (l3[0] >> 4 != 6) return error.BadVersion;
+
+    const payload_length = std.mem.readInt(u16, l3[4..6], .big);
+    // Zero with a Hop-by-Hop header may be a jumbogram (RFC 2675); keep it whole
+    if (payload_length == 0 and l3[6] == ipv6_hop_by_hop) return available;
+
+    const total_length = headers.Ipv6.size + @as(usize, payload_length);
+    if (total_length > available) return error.BadTotalLength;
+    return total_length;
+}
+
+/// Validate a contiguous IP packet by its version and trim any link padding
+pub fn ipPacket(l3: []const u8) Error![]const u8 {
+    if (l3.len == 0) return error.Truncated;
+    const len = switch (l3[0] >> 4) {
+        4 => try ipv4Length(l3, l3.len),
+        6 => try ipv6Length(l3, l3.len),
+        else => return error.BadVersion,
+    };
+    return l3[0..len];
+}
+
+fn buildIpv4(buf: []u8, total_length: u16) []u8 {
+    @memset(buf, 0);
+    const ip = headers.Ipv4.viewMut(buf) catch unreachable;
+    ip.set(.version_ihl, 0x45);
+    ip.set(.total_length, total_length);
+    ip.set(.ttl, 64);
+    ip.set(.protocol, IpProto.tcp);
+    ip.set(.src_ip, 0x0A000001);
+    ip.set(.dst_ip, 0x0A000002);
+    ip.set(.checksum, checksum.internet(buf[0..headers.Ipv4.size]));
+    return buf;
+}
+
+test "ipPacket trims Ethernet padding to the IPv4 total length" {
+    // 40-byte TCP ACK in a minimum-size frame: 46 bytes of L3 payload
+    var buf: [46]u8 = undefined;
+    const l3 = buildIpv4(&buf, 40);
+    try std.testing.expectEqual(@as(usize, 40), (try ipPacket(l3)).len);
+    try std.testing.expectEqual(@as(usize, 46), try ipv4Length(l3[0..20], 46));
+}
+
+test "ipPacket rejects malformed IPv4 headers" {
+    var buf: [64]u8 = undefined;
+
+    try std.testing.expectError(error.Truncated, ipPacket(buildIpv4(&buf, 40)[0..19]));
+    try std.testing.expectError(error.BadTotalLength, ipPacket(buildIpv4(&buf, 65)));
+    try std.testing.expectError(error.BadTotalLength, ipPacket(buildIpv4(&buf, 12)));
+
+    var ip = buildIpv4(&buf, 40);
+    ip[0] = 0x44; // IHL 4
+    try std.testing.expectError(error.BadHeaderLength, ipPacket(ip));
+
+    ip = buildIpv4(&buf, 40);
+    ip[8] -= 1; // TTL changed without fixing the checksum
+    try std.testing.expectError(error.BadChecksum, ipPacket(ip));
+
+    ip = buildIpv4(&buf, 40);
+    ip[0] = 0x55;
+    try std.testing.expectError(error.BadVersion, ipv4Length(ip, ip.len));
+}
+
+test "ipv6Length trims padding and keeps jumbograms" {
+    var buf: [60]u8 = [_]u8{0} ** 60;
+    buf[0] = 0x60;
+    buf[6] = IpProto.icmpv6;
+    std.mem.writeInt(u16, buf[4..6], 8, .big);
+    try std.testing.expectEqual(@as(usize, 48), (try ipPacket(&buf)).len);
+
+    std.mem.writeInt(u16, buf[4..6], 21, .big);
+    try std.testing.expectError(error.BadTotalLength, ipPacket(&buf));
+
+    std.mem.writeInt(u16, buf[4..6], 0, .big);
+    buf[6] = ipv6_hop_by_hop;
+    try std.testing.expectEqual(@as(usize, 60), (try ipPacket(&buf)).len);
+}